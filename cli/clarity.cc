@@ -7,24 +7,47 @@
 // CLarity Imports
 #include "camera.h"
 #include "buffer.h"
+#include "cl_line_of_sight.h"
 #include "cl_range_calculator.h"
+#include "cpu_line_of_sight.h"
 #include "cpu_range_calculator.h"
 #include "diamond_square_terrain_generator.h"
 #include "device_buffer.h"
+#include "huge_pages.h"
+#include "hybrid_range_calculator.h"
+#include "line_of_sight.h"
+#include "noise_terrain_generator.h"
+#include "numa.h"
+#include "numa_range_calculator.h"
 #include "range_calculator.h"
+#include "range_quantization.h"
+#include "range_sequence.h"
+#include "server.h"
 #include "terrain.h"
 
 // Standard Imports
+#include <algorithm>
 #include <cmath>
 #include <chrono>
+#include <cstdint>
+#include <cstring>
 #include <memory>
 #include <fstream>
 #include <iostream>
+#include <random>
+#include <sstream>
 #include <string>
 #include <sys/stat.h>
+#include <tuple>
+#include <vector>
 
 // Third-Party Imports
 #include "cl.hpp"
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 
 namespace clarity {
@@ -33,7 +56,12 @@ namespace cli {
 enum Tool {
   HELP = 0,
   TERRAIN_GENERATOR = 1,
-  RANGE_MAPPER
+  RANGE_MAPPER,
+  NOISE_GENERATOR,
+  LINE_OF_SIGHT,
+  PAGES,
+  TRAJECTORY,
+  SERVER
 };
 
 
@@ -44,7 +72,12 @@ void general_usage()
   std::cerr << "clarity-cli <tool> [ <tool args> ]" << std::endl;
   std::cerr << "\tAvailable tools: " << std::endl;
   std::cerr << "\t\tterrain - generate a terrain map file" << std::endl;
+  std::cerr << "\t\tnoise - generate a terrain map file of any size from gradient noise" << std::endl;
   std::cerr << "\t\trange - calculate a range mapping" << std::endl;
+  std::cerr << "\t\ttrajectory - render a camera path into a range sequence file" << std::endl;
+  std::cerr << "\t\tserver - serve render and line-of-sight requests over a Unix domain socket" << std::endl;
+  std::cerr << "\t\tlos - benchmark batched line-of-sight queries" << std::endl;
+  std::cerr << "\t\tpages - benchmark range mapping over a terrain with and without huge pages" << std::endl;
   std::cerr << "\tRun clarity-cli help <tool name> for more information" << std::endl;
 }
 
@@ -66,6 +99,16 @@ Tool get_tool_name(int argc, char ** argv)
     return Tool::TERRAIN_GENERATOR;
   } else if (toolname == "range") {
     return Tool::RANGE_MAPPER;
+  } else if (toolname == "noise") {
+    return Tool::NOISE_GENERATOR;
+  } else if (toolname == "los") {
+    return Tool::LINE_OF_SIGHT;
+  } else if (toolname == "pages") {
+    return Tool::PAGES;
+  } else if (toolname == "trajectory") {
+    return Tool::TRAJECTORY;
+  } else if (toolname == "server") {
+    return Tool::SERVER;
   }
 
   return Tool::HELP;
@@ -76,11 +119,12 @@ void terrain_tool_usage()
 {
   std::cerr << "CLarity Terrain Generator - generates a random scene of terrain" << std::endl;
   std::cerr << "Usage: " << std::endl;
-  std::cerr << "clarity-cli terrain <scale> <detail> <roughness> <output>" << std::endl;
+  std::cerr << "clarity-cli terrain <scale> <detail> <roughness> <output> [seed]" << std::endl;
   std::cerr << "\t<scale> - the scale of the terrain map, in meters per pixel." << std::endl;
   std::cerr << "\t<detail> - the detail level of the the terrain. Valid in the range [1, 5]" << std::endl;
   std::cerr << "\t<roughness> - the roughness of the terrain. Valid in the range [1, 100]" << std::endl;
   std::cerr << "\t<output> - complete path to an output file where the map will be stored" << std::endl;
+  std::cerr << "\t[seed] - optional seed. The same seed always generates the same map." << std::endl;
 }
 
 
@@ -90,6 +134,8 @@ struct Terrain_Args
   int detail;
   int roughness;
   std::string output;
+  bool seeded;
+  uint64_t seed;
 };
 
 
@@ -106,6 +152,8 @@ Terrain_Args parse_terrain_tool_args(int argc, char ** argv)
   args.detail = std::stoi(std::string(argv[1]));
   args.roughness = std::stoi(std::string(argv[2]));
   args.output = std::string(argv[3]);
+  args.seeded = argc > 4;
+  args.seed = args.seeded ? std::stoull(std::string(argv[4])) : 0;
 
   if (args.detail < 1 || args.detail > 5) {
     std::cerr << "Invalid arguments. Detail must be between [1, 5]" << std::endl;
@@ -134,6 +182,9 @@ void run_terrain_tool(int argc, char ** argv)
   std::shared_ptr<Buffer> buffer = std::make_shared<Buffer>(size, size);
 
   Diamond_Square_Generator generator;
+  if (args.seeded) {
+    generator.set_seed(args.seed);
+  }
   Terrain t = generator.generate_terrain(buffer, args.scale, args.roughness);
 
   std::ofstream out(args.output, std::ios::out | std::ios::binary);
@@ -142,18 +193,77 @@ void run_terrain_tool(int argc, char ** argv)
 
   out.write(reinterpret_cast<char *>(buffer->data().get()), size * size * sizeof(float)); // terrain data
 
-  std::cout << "Wrote terrain file to " << args.output << std::endl;
+  std::cout << "Wrote terrain file to " << args.output << " (seed " << generator.seed() << ")" << std::endl;
   const float sz_m = size * args.scale;
   std::cout << "Valid locations for this terrain: (0.0, " << sz_m << ") m in x-dimension,  (0.0, " << sz_m << ") m in y-dimension" << std::endl;
 }
 
 
+void noise_tool_usage()
+{
+  std::cerr << "CLarity Noise Terrain Generator - generates a scene of terrain of any size" << std::endl;
+  std::cerr << "Usage: " << std::endl;
+  std::cerr << "clarity-cli noise <scale> <size> <roughness> <output> [seed]" << std::endl;
+  std::cerr << "\t<scale> - the scale of the terrain map, in meters per pixel." << std::endl;
+  std::cerr << "\t<size> - the number of rows and columns in the terrain map." << std::endl;
+  std::cerr << "\t<roughness> - the roughness of the terrain. Valid in the range [1, 100]" << std::endl;
+  std::cerr << "\t<output> - complete path to an output file where the map will be stored" << std::endl;
+  std::cerr << "\t[seed] - optional seed. The same seed always generates the same map." << std::endl;
+}
+
+
+void run_noise_tool(int argc, char ** argv)
+{
+  if (argc < 4) {
+    std::cerr << "Invalid arguments. The Noise tool has 4 required arguments" << std::endl;
+    noise_tool_usage();
+    exit(EXIT_FAILURE);
+  }
+
+  const float scale = std::stof(std::string(argv[0]));
+  const long size = std::stol(std::string(argv[1]));
+  const int roughness = std::stoi(std::string(argv[2]));
+  const std::string output(argv[3]);
+  const uint64_t seed = argc > 4 ? std::stoull(std::string(argv[4])) : std::random_device()();
+
+  if (size < 2 || size > 65536) {
+    std::cerr << "Invalid arguments. Size must be between [2, 65536]" << std::endl;
+    noise_tool_usage();
+    exit(EXIT_FAILURE);
+  }
+
+  if (roughness < 1 || roughness > 100) {
+    std::cerr << "Invalid arguments. Roughness must be between [1, 100]" << std::endl;
+    noise_tool_usage();
+    exit(EXIT_FAILURE);
+  }
+
+  // Features up to ~60 km across at 30 m per pixel, down to 2 pixels
+  Noise_Params params = { seed, 2048, 11, 500.0f, 0.5f };
+  Noise_Terrain_Generator generator(params);
+
+  const auto start = std::chrono::high_resolution_clock::now();
+  Terrain t = generator.generate_terrain(size, size, scale, roughness / 100.0f);
+  const auto end = std::chrono::high_resolution_clock::now();
+  const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+  const uint32_t dim = size;
+  std::ofstream out(output, std::ios::out | std::ios::binary);
+  out.write(reinterpret_cast<const char *>(&dim), 4); // dimension of terrain - 4 bytes, uint32_t
+  out.write(reinterpret_cast<const char *>(&scale), 4); // scale of terrain - 4 bytes, float
+  out.write(reinterpret_cast<char *>(t.data().data().get()), size_t(dim) * dim * sizeof(float));
+
+  std::cout << "Generated " << dim << "x" << dim << " terrain in " << duration.count() << " ms" << std::endl;
+  std::cout << "Wrote terrain file to " << output << " (seed " << seed << ")" << std::endl;
+}
+
+
 void range_tool_usage()
 {
   std::cerr << "CLarity Range Image Generator - creates range map based on terrain and position" << std::endl;
   std::cerr << "Usage: " << std::endl;
-  std::cerr << "clarity-cli range <mode> <terrain_file> <cam fov> <cam dim> <cam_posn> <cam_yaw> <cam_roll> <output>" << std::endl;
-  std::cerr << "\tmode - should we run on the CPU (naive) or use OpenCL? Valid modes: (CPU, OpenCL)" << std::endl;
+  std::cerr << "clarity-cli range <mode> <terrain_file> <cam fov> <cam dim> <cam_posn> <cam_yaw> <cam_roll> <output> [pages] [u16]" << std::endl;
+  std::cerr << "\tmode - should we run on the CPU (naive), on every CPU with NUMA-local terrain, use OpenCL, or split the frame between the CPU and OpenCL? Valid modes: (CPU, NUMA, OpenCL, Hybrid)" << std::endl;
   std::cerr << "\tterrain_file - terrain to use. Should be file generated by terrain tool" << std::endl;
   std::cerr << "\tcamera fov - field of view of the camera, in degrees (90 is typical)" << std::endl;
   std::cerr << "\tcamera dim - dimensions of the camera's focal plane array. One value (256 is typical)" << std::endl;
@@ -161,13 +271,17 @@ void range_tool_usage()
   std::cerr << "\tcamera yaw - rotation of the camera about the +Z axis, in degrees." << std::endl;
   std::cerr << "\tcamera_pitch - rotation of the camera about the +Y axis, in degrees." << std::endl;
   std::cerr << "\toutput - output file." << std::endl;
+  std::cerr << "\t[pages] - optional. Use \"huge\" to load the terrain into 2 MB pages" << std::endl;
+  std::cerr << "\t[u16] - optional. Write 16 bit range codes, packed on the device in OpenCL mode, instead of 32 bit floats" << std::endl;
 }
 
 
 enum Range_Tool_Mode
 {
   CPU = 0,
-  OPEN_CL
+  OPEN_CL,
+  HYBRID,
+  NUMA
 };
 
 
@@ -181,9 +295,32 @@ struct Range_Args
   float yaw;
   float pitch;
   std::string output;
+  Page_Policy pages;
+  bool quantized;
 };
 
 
+//! @brief  Parse the name of a range mapping mode
+//!
+//! @return false if the name is not a mode
+bool parse_range_mode(const std::string & modestr, Range_Tool_Mode & mode)
+{
+  if (modestr == "CPU") {
+    mode = Range_Tool_Mode::CPU;
+  } else if (modestr == "OpenCL") {
+    mode = Range_Tool_Mode::OPEN_CL;
+  } else if (modestr == "Hybrid") {
+    mode = Range_Tool_Mode::HYBRID;
+  } else if (modestr == "NUMA") {
+    mode = Range_Tool_Mode::NUMA;
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+
 Range_Args parse_range_tool_args(int argc, char ** argv)
 {
   if (argc < 10) {
@@ -193,13 +330,8 @@ Range_Args parse_range_tool_args(int argc, char ** argv)
   }
 
   Range_Args args;
-  std::string modestr(argv[0]);
-  if (modestr == "CPU") {
-    args.mode = Range_Tool_Mode::CPU;
-  } else if (modestr == "OpenCL") {
-    args.mode = Range_Tool_Mode::OPEN_CL;
-  } else {
-    std::cerr << "Invalid mode. Only CPU and OpenCL are allowed" << std::endl;
+  if (! parse_range_mode(argv[0], args.mode)) {
+    std::cerr << "Invalid mode. Only CPU, NUMA, OpenCL and Hybrid are allowed" << std::endl;
     range_tool_usage();
     exit(EXIT_FAILURE);
   }
@@ -211,6 +343,21 @@ Range_Args parse_range_tool_args(int argc, char ** argv)
   args.yaw = std::stof(argv[7]);
   args.pitch = std::stof(argv[8]);
   args.output = std::string(argv[9]);
+  args.pages = STANDARD_PAGES;
+  args.quantized = false;
+
+  for (int i = 10; i < argc; i++) {
+    const std::string option(argv[i]);
+    if (option == "huge") {
+      args.pages = HUGE_PAGES;
+    } else if (option == "u16") {
+      args.quantized = true;
+    } else {
+      std::cerr << "Invalid Argument. The only options are huge and u16" << std::endl;
+      range_tool_usage();
+      exit(EXIT_FAILURE);
+    }
+  }
 
   if (args.fov < 50 || args.fov > 180) {
     std::cerr << "Invalid Argument. Camera FOV must be in the range [50, 180]" << std::endl;
@@ -234,7 +381,7 @@ Range_Args parse_range_tool_args(int argc, char ** argv)
 }
 
 
-Terrain read_terrain_file(const std::string & fname)
+Terrain read_terrain_file(const std::string & fname, const Page_Policy pages = STANDARD_PAGES)
 {
   std::ifstream in(fname, std::ios::in | std::ios::binary);
 
@@ -245,13 +392,13 @@ Terrain read_terrain_file(const std::string & fname)
     exit(EXIT_FAILURE);
   }
 
-  uint32_t file_size = results.st_size;
+  const uint64_t file_size = results.st_size;
 
   uint32_t size;
   float scale;
   in.read(reinterpret_cast<char *>(&size), 4);
 
-  if (file_size != (size * size * 4 + 8)) {
+  if (file_size != (uint64_t(size) * size * 4 + 8)) {
     std::cerr << "Invalid argument, file is not a terrain file (inconsistent size)" << std::endl;
     range_tool_usage();
     exit(EXIT_FAILURE);
@@ -259,21 +406,55 @@ Terrain read_terrain_file(const std::string & fname)
 
   in.read(reinterpret_cast<char *>(&scale), 4);
 
-  auto b = std::make_shared<Buffer>(size, size);
+  auto b = std::make_shared<Buffer>(size, size, 1, pages);
 
-  in.read(reinterpret_cast<char *>(b->data().get()), size * size * 4);
+  in.read(reinterpret_cast<char *>(b->data().get()), size_t(size) * size * 4);
   
   return Terrain(b, scale);
 }
 
 
+//! @brief  Create the calculator of a mode, and the OpenCL context it uses, if any
+std::unique_ptr<Range_Calculator> make_range_calculator(const Range_Tool_Mode mode,
+                                                        std::shared_ptr<cl::Context> & ctx)
+{
+  if (mode == Range_Tool_Mode::OPEN_CL) {
+    ctx = get_context();
+    return std::unique_ptr<Range_Calculator>(new CL_Range_Calculator(ctx));
+  } else if (mode == Range_Tool_Mode::HYBRID) {
+    ctx = get_context();
+    std::unique_ptr<Range_Calculator> device(new CL_Range_Calculator(ctx));
+    return std::unique_ptr<Range_Calculator>(new Hybrid_Range_Calculator(std::move(device)));
+  } else if (mode == Range_Tool_Mode::NUMA) {
+    return std::unique_ptr<Range_Calculator>(new NUMA_Range_Calculator(numa::REPLICATE));
+  }
+
+  return std::unique_ptr<Range_Calculator>(new CPU_Range_Calculator);
+}
+
+
+//! @brief  Get the quantization that covers every range a calculator can return over a
+//!         terrain
+Range_Quantization full_span_quantization(const Terrain & t)
+{
+  return range_quantization::covering(0.0f, Range_Calculator::max_range(t));
+}
+
+
 void run_range_tool(int argc, char ** argv)
 {
   // Parse args
   Range_Args args = parse_range_tool_args(argc, argv);
 
+  // Set up calculator first, so its kernels compile while the terrain loads
+  std::shared_ptr<cl::Context> ctx;
+  std::unique_ptr<Range_Calculator> calculator = make_range_calculator(args.mode, ctx);
+
   // Set up terrain
-  Terrain t = read_terrain_file(args.terrain);
+  Terrain t = read_terrain_file(args.terrain, args.pages);
+  if (args.pages == HUGE_PAGES) {
+    std::cout << "Terrain is backed by " << huge_pages::name(t.data().backing()) << std::endl;
+  }
 
   // Set up camera
   Camera cam(args.fov, args.dim, args.dim);
@@ -281,41 +462,523 @@ void run_range_tool(int argc, char ** argv)
   cam.set_yaw(M_PI * args.yaw / 180.0);
   cam.set_pitch(M_PI * args.yaw / 180.0);
 
-  // Set up calculator
-  Range_Calculator * calculator;
-  Terrain * tt;
-  Buffer * rng;
+  if (args.quantized) {
+    const Range_Quantization q = full_span_quantization(t);
+
+    std::cout << "Starting range mapping (" << q.step << " m per code)..." << std::endl;
+    std::vector<uint16_t> codes;
+    const auto start = std::chrono::high_resolution_clock::now();
+    calculator->Calculate_Quantized(cam, t, q, codes);
+    const auto end = std::chrono::high_resolution_clock::now();
+    const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+    std::cout << "Done. Completed in " << duration.count() << " us" << std::endl;
+
+    std::ofstream out(args.output, std::ios::out | std::ios::binary);
+    out.write(reinterpret_cast<char *>(&args.dim), 2); // dimension of image, 2 bytes (uint16_t)
+    out.write(reinterpret_cast<const char *>(&q.offset), 4); // range of code 0 - 4 bytes, float
+    out.write(reinterpret_cast<const char *>(&q.step), 4); // meters per code - 4 bytes, float
+    out.write(reinterpret_cast<char *>(codes.data()), codes.size() * sizeof(uint16_t));
+
+    std::cout << "Wrote 16 bit image to " << args.output << std::endl;
+    return;
+  }
 
-  if (args.mode == Range_Tool_Mode::OPEN_CL)
+  // The OpenCL calculator makes the terrain resident itself, uploading it once
+  Buffer * rng;
+  if (args.mode == Range_Tool_Mode::OPEN_CL || args.mode == Range_Tool_Mode::HYBRID)
   {
-    std::shared_ptr<cl::Context> ctx = get_context();
-    calculator = new CL_Range_Calculator(ctx);
     rng = new Device_Buffer(*ctx, args.dim, args.dim);
-
-    // Transfer to a device buffer
-    std::shared_ptr<Device_Buffer> tb = std::make_shared<Device_Buffer>(t.data(), *ctx);
-    tt = new Terrain(tb, t.scale());
   } else {
-    calculator = new CPU_Range_Calculator;
     rng = new Buffer(args.dim, args.dim);
-    tt = &t;
   }
 
   std::cout << "Starting range mapping..." << std::endl;
   const auto start = std::chrono::high_resolution_clock::now();
-  calculator->Calculate(cam, *tt, *rng);
+  calculator->Calculate(cam, t, *rng);
   const auto end = std::chrono::high_resolution_clock::now();
   const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
   std::cout << "Done. Completed in " << duration.count() << " us" << std::endl;
 
   std::ofstream out(args.output, std::ios::out | std::ios::binary);
   out.write(reinterpret_cast<char *>(&args.dim), 2); // dimension of image, 2 bytes (uint16_t)
-  out.write(reinterpret_cast<char *>(rng->data().get()), args.dim * args.dim * 4);
+  out.write(reinterpret_cast<char *>(rng->data().get()), size_t(args.dim) * args.dim * 4);
 
   std::cout << "Wrote image to " << args.output << ". It can be viewed with CLarity viewer tool" << std::endl; 
 }
 
 
+void trajectory_tool_usage()
+{
+  std::cerr << "CLarity Trajectory Renderer - renders every pose of a camera path into a range sequence file" << std::endl;
+  std::cerr << "Usage: " << std::endl;
+  std::cerr << "clarity-cli trajectory <mode> <terrain_file> <cam fov> <cam dim> <path_file> <output> [pages] [u16]" << std::endl;
+  std::cerr << "\tmode - where to render. Valid modes: (CPU, NUMA, OpenCL, Hybrid)" << std::endl;
+  std::cerr << "\tterrain_file - terrain to use. Should be file generated by terrain tool" << std::endl;
+  std::cerr << "\tcamera fov - field of view of the camera, in degrees (90 is typical)" << std::endl;
+  std::cerr << "\tcamera dim - dimensions of the camera's focal plane array. One value (256 is typical)" << std::endl;
+  std::cerr << "\tpath_file - one pose per line: <timestamp> <x> <y> <z> <yaw> <pitch>, in seconds, meters and degrees. Blank lines and lines starting with # are skipped" << std::endl;
+  std::cerr << "\toutput - range sequence file to write. Row 0 of each frame is the top row of the camera" << std::endl;
+  std::cerr << "\t[pages] - optional. Use \"huge\" to load the terrain into 2 MB pages" << std::endl;
+  std::cerr << "\t[u16] - optional. Store 16 bit range codes, packed on the device in OpenCL mode, instead of 32 bit floats" << std::endl;
+}
+
+
+//! @brief  One pose of a camera path
+struct Pose
+{
+  double timestamp;
+  std::tuple<float, float, float> posn;
+  float yaw;
+  float pitch;
+};
+
+
+//! @brief  Read a camera path file, exiting with a message if it is malformed
+std::vector<Pose> read_camera_path(const std::string & fname)
+{
+  std::ifstream in(fname);
+  if (! in.good()) {
+    std::cerr << "Invalid argument, camera path file (" << fname << ") cannot be read" << std::endl;
+    trajectory_tool_usage();
+    exit(EXIT_FAILURE);
+  }
+
+  std::vector<Pose> path;
+  std::string line;
+  for (uint64_t n = 1; std::getline(in, line); n++) {
+    const size_t first = line.find_first_not_of(" \t\r");
+    if (first == std::string::npos || line[first] == '#') {
+      continue;
+    }
+
+    std::istringstream fields(line);
+    Pose p;
+    float x, y, z;
+    if (! (fields >> p.timestamp >> x >> y >> z >> p.yaw >> p.pitch)) {
+      std::cerr << "Invalid camera path. Line " << n << " does not hold 6 numbers" << std::endl;
+      trajectory_tool_usage();
+      exit(EXIT_FAILURE);
+    }
+
+    p.posn = std::make_tuple(x, y, z);
+    path.push_back(p);
+  }
+
+  if (path.empty()) {
+    std::cerr << "Invalid camera path. The file holds no poses" << std::endl;
+    trajectory_tool_usage();
+    exit(EXIT_FAILURE);
+  }
+
+  return path;
+}
+
+
+//! @brief  Get a percentile of sorted samples, by the nearest-rank method
+double percentile(const std::vector<double> & sorted, const double p)
+{
+  const double rank = std::ceil(p / 100.0 * sorted.size());
+  const size_t i = static_cast<size_t>(std::max(rank, 1.0)) - 1;
+  return sorted[std::min(i, sorted.size() - 1)];
+}
+
+
+//! @brief  Point a Camera along a pose of a camera path
+void set_pose(Camera & cam, const Pose & p)
+{
+  cam.set_position(p.posn);
+  cam.set_yaw(M_PI * p.yaw / 180.0);
+  cam.set_pitch(M_PI * p.pitch / 180.0);
+}
+
+
+//! @brief  Flip the rows of a row-major image in place, so that a frame from a calculator whose
+//!         rows run bottom-up is stored top-down like every other frame of a sequence
+template <typename T>
+void flip_rows(T * image, const uint32_t rows, const uint32_t cols)
+{
+  for (uint32_t r = 0; r < rows / 2; r++) {
+    std::swap_ranges(image + size_t(r) * cols,
+                     image + size_t(r + 1) * cols,
+                     image + size_t(rows - 1 - r) * cols);
+  }
+}
+
+
+void run_trajectory_tool(int argc, char ** argv)
+{
+  typedef std::chrono::steady_clock Clock;
+
+  if (argc < 6) {
+    std::cerr << "Invalid arguments. The trajectory tool has 6 required arguments" << std::endl;
+    trajectory_tool_usage();
+    exit(EXIT_FAILURE);
+  }
+
+  Range_Tool_Mode mode;
+  if (! parse_range_mode(argv[0], mode)) {
+    std::cerr << "Invalid mode. Only CPU, NUMA, OpenCL and Hybrid are allowed" << std::endl;
+    trajectory_tool_usage();
+    exit(EXIT_FAILURE);
+  }
+
+  const std::string terrain_file(argv[1]);
+  const float fov = std::stof(argv[2]);
+  const int dim = std::stoi(argv[3]);
+  const std::vector<Pose> path = read_camera_path(argv[4]);
+  const std::string output(argv[5]);
+
+  Page_Policy pages = STANDARD_PAGES;
+  bool quantized = false;
+  for (int i = 6; i < argc; i++) {
+    const std::string option(argv[i]);
+    if (option == "huge") {
+      pages = HUGE_PAGES;
+    } else if (option == "u16") {
+      quantized = true;
+    } else {
+      std::cerr << "Invalid Argument. The only options are huge and u16" << std::endl;
+      trajectory_tool_usage();
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  if (fov < 50 || fov > 180 || dim < 1 || dim > 65535) {
+    std::cerr << "Invalid Argument. Camera FOV must be in the range [50, 180] and the camera "
+              << "dimension in the range [1, 65535]" << std::endl;
+    trajectory_tool_usage();
+    exit(EXIT_FAILURE);
+  }
+
+  // Everything that a one-shot render pays for is paid once here
+  const auto setup_start = Clock::now();
+  std::shared_ptr<cl::Context> ctx;
+  std::unique_ptr<Range_Calculator> calculator = make_range_calculator(mode, ctx);
+  Terrain t = read_terrain_file(terrain_file, pages);
+
+  std::unique_ptr<Buffer> rng;
+  if (mode == Range_Tool_Mode::OPEN_CL || mode == Range_Tool_Mode::HYBRID) {
+    rng = std::unique_ptr<Buffer>(new Device_Buffer(*ctx, dim, dim));
+  } else {
+    rng = std::unique_ptr<Buffer>(new Buffer(dim, dim));
+  }
+
+  const Range_Quantization q = full_span_quantization(t);
+  std::unique_ptr<Range_Sequence_Writer> writer;
+  if (quantized) {
+    writer = std::unique_ptr<Range_Sequence_Writer>(
+        new Range_Sequence_Writer(output, dim, dim, q));
+    std::cout << "Storing 16 bit ranges (" << q.step << " m per code)" << std::endl;
+  } else {
+    writer = std::unique_ptr<Range_Sequence_Writer>(new Range_Sequence_Writer(output, dim, dim));
+  }
+
+  // The first render waits for the kernels to build, so it is part of the set-up
+  Camera cam(M_PI * fov / 180.0, dim, dim);
+  set_pose(cam, path[0]);
+  std::vector<uint16_t> codes;
+  if (quantized) {
+    calculator->Calculate_Quantized(cam, t, q, codes);
+  } else {
+    calculator->Calculate(cam, t, *rng);
+  }
+  const auto setup_end = Clock::now();
+
+  // The writer thread stores each frame while the next one renders. Frames are stored top-down
+  // whichever calculator renders them.
+  const bool bottom_up = calculator->rows_bottom_up();
+  std::vector<double> latencies;
+  latencies.reserve(path.size());
+  const auto start = Clock::now();
+  for (const Pose & p : path) {
+    const auto frame_start = Clock::now();
+    set_pose(cam, p);
+
+    if (quantized) {
+      calculator->Calculate_Quantized(cam, t, q, codes);
+      if (bottom_up) {
+        flip_rows(codes.data(), dim, dim);
+      }
+      writer->append(cam, codes, q, p.timestamp);
+    } else {
+      calculator->Calculate(cam, t, *rng);
+      if (bottom_up) {
+        flip_rows(rng->data().get(), dim, dim);
+      }
+      writer->append(cam, *rng, p.timestamp);
+    }
+
+    const auto frame_end = Clock::now();
+    latencies.push_back(std::chrono::duration<double, std::milli>(frame_end - frame_start).count());
+  }
+  writer->close();
+  const auto end = Clock::now();
+
+  const double setup_seconds = std::chrono::duration<double>(setup_end - setup_start).count();
+  const double seconds = std::chrono::duration<double>(end - start).count();
+  std::sort(latencies.begin(), latencies.end());
+
+  std::cout << "Set-up (terrain, calculator, first render) took " << setup_seconds << " s" << std::endl;
+  std::cout << path.size() << " frames in " << seconds << " s ("
+            << path.size() / std::max(seconds, 1e-9) << " frames/s, including the last write)"
+            << std::endl;
+  std::cout << "Frame latency (render and queue) in ms: p50 " << percentile(latencies, 50)
+            << ", p90 " << percentile(latencies, 90) << ", p99 " << percentile(latencies, 99)
+            << ", max " << latencies.back() << std::endl;
+  std::cout << "Wrote range sequence to " << output << std::endl;
+}
+
+
+void los_tool_usage()
+{
+  std::cerr << "CLarity Line-of-Sight Benchmark - times batches of random observer/target queries" << std::endl;
+  std::cerr << "Usage: " << std::endl;
+  std::cerr << "clarity-cli los <mode> <terrain_file> <count> <height> [seed]" << std::endl;
+  std::cerr << "\tmode - should we run on the CPU or use OpenCL? Valid modes: (CPU, OpenCL)" << std::endl;
+  std::cerr << "\tterrain_file - terrain to use. Should be file generated by terrain tool" << std::endl;
+  std::cerr << "\tcount - the number of lines in the batch" << std::endl;
+  std::cerr << "\theight - the height of each observer and target above the terrain, in meters" << std::endl;
+  std::cerr << "\t[seed] - optional seed for the placement of the lines" << std::endl;
+}
+
+
+//! @brief  Time one batch of line-of-sight queries and report the throughput
+void time_los(Line_Of_Sight & los,
+              const Terrain & t,
+              const std::vector<Line_Of_Sight::Point> & observers,
+              const std::vector<Line_Of_Sight::Point> & targets,
+              const std::string & label)
+{
+  std::vector<uint8_t> visible;
+  std::vector<float> distance;
+
+  const auto start = std::chrono::high_resolution_clock::now();
+  los.Check(t, observers, targets, visible, distance);
+  const auto end = std::chrono::high_resolution_clock::now();
+  const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+
+  size_t num_visible = 0;
+  for (const auto v : visible) {
+    num_visible += v;
+  }
+
+  const double seconds = std::max<double>(duration.count(), 1.0) / 1e6;
+  std::cout << label << ": " << observers.size() << " lines in " << duration.count() << " us ("
+            << static_cast<uint64_t>(observers.size() / seconds) << " rays/s), "
+            << num_visible << " visible" << std::endl;
+}
+
+
+void run_los_tool(int argc, char ** argv)
+{
+  if (argc < 4) {
+    std::cerr << "Invalid arguments. The line-of-sight tool has 4 required arguments" << std::endl;
+    los_tool_usage();
+    exit(EXIT_FAILURE);
+  }
+
+  const std::string modestr(argv[0]);
+  if (modestr != "CPU" && modestr != "OpenCL") {
+    std::cerr << "Invalid mode. Only CPU and OpenCL are allowed" << std::endl;
+    los_tool_usage();
+    exit(EXIT_FAILURE);
+  }
+
+  Terrain t = read_terrain_file(std::string(argv[1]));
+  const long count = std::stol(std::string(argv[2]));
+  const float height = std::stof(std::string(argv[3]));
+  const uint64_t seed = argc > 4 ? std::stoull(std::string(argv[4])) : std::random_device()();
+
+  if (count < 1) {
+    std::cerr << "Invalid arguments. Count must be positive" << std::endl;
+    los_tool_usage();
+    exit(EXIT_FAILURE);
+  }
+
+  // Place both ends of each line at the same height above random cells
+  const uint32_t size = t.data().size().first;
+  std::mt19937_64 gen(seed);
+  std::uniform_int_distribution<uint32_t> cell(0, size - 1);
+  std::vector<Line_Of_Sight::Point> observers;
+  std::vector<Line_Of_Sight::Point> targets;
+  for (long i = 0; i < count; i++) {
+    for (auto * points : { &observers, &targets }) {
+      const uint32_t r = cell(gen);
+      const uint32_t c = cell(gen);
+      points->emplace_back(r * t.scale(), c * t.scale(), t.data().at(r, c) * t.scale() + height);
+    }
+  }
+
+  std::unique_ptr<Line_Of_Sight> los;
+  Terrain plain(t);
+  if (modestr == "OpenCL") {
+    los = std::unique_ptr<Line_Of_Sight>(new CL_Line_Of_Sight(get_context()));
+
+    // The first query makes the terrain resident, so the upload is kept out of the timings
+    std::vector<uint8_t> visible;
+    std::vector<float> distance;
+    los->Check(plain, { observers[0] }, { targets[0] }, visible, distance);
+  } else {
+    los = std::unique_ptr<Line_Of_Sight>(new CPU_Line_Of_Sight);
+  }
+
+  time_los(*los, plain, observers, targets, "Plain walk");
+
+  Terrain accelerated(plain);
+  accelerated.build_pyramid();
+  time_los(*los, accelerated, observers, targets, "Pyramid walk");
+}
+
+
+void pages_tool_usage()
+{
+  std::cerr << "CLarity Huge Page Benchmark - times range mapping over a terrain in standard and huge pages" << std::endl;
+  std::cerr << "Usage: " << std::endl;
+  std::cerr << "clarity-cli pages <terrain_file> <cam dim> <frames> [seed]" << std::endl;
+  std::cerr << "\tterrain_file - terrain to use. Should be file generated by terrain tool. Large terrains show the difference" << std::endl;
+  std::cerr << "\tcamera dim - dimensions of the camera's focal plane array. One value (256 is typical)" << std::endl;
+  std::cerr << "\tframes - the number of frames to render with each kind of page, from random positions" << std::endl;
+  std::cerr << "\t[seed] - optional seed for the camera positions" << std::endl;
+}
+
+
+//! @brief  Open a counter of the data-TLB read misses of this process and the threads it starts
+//!
+//! @return the file descriptor of the counter, or -1 if the kernel does not allow it
+int open_dtlb_counter()
+{
+#ifdef __linux__
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HW_CACHE;
+  attr.config = PERF_COUNT_HW_CACHE_DTLB |
+                (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  attr.inherit = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+
+  return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#else
+  return -1;
+#endif
+}
+
+
+//! @brief  Read and close a counter from open_dtlb_counter
+//!
+//! @detail Inherited counts are only added when a thread exits, so the threads being counted
+//!         should be joined first.
+//!
+//! @return the count, or -1 if there is none
+int64_t close_dtlb_counter(int fd)
+{
+  int64_t count = -1;
+#ifdef __linux__
+  if (fd >= 0) {
+    if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+      count = -1;
+    }
+    close(fd);
+  }
+#else
+  (void) fd;
+#endif
+  return count;
+}
+
+
+//! @brief  Render frames over a terrain and report the throughput and data-TLB misses
+void time_pages(const Terrain & t, const std::vector<Camera> & cams, const std::string & label)
+{
+  const Buffer & b = t.data();
+  const size_t bytes = size_t(b.size().first) * b.size().second * sizeof(float);
+  const size_t resident = huge_pages::resident_bytes(const_cast<Buffer &>(b).data().get(), bytes);
+  std::cout << label << ": " << huge_pages::name(b.backing()) << ", "
+            << resident / (1 << 20) << " of " << bytes / (1 << 20) << " MB in huge pages" << std::endl;
+
+  const auto dim = std::get<0>(cams.front().focal_plane_dimensions());
+  Buffer rng(dim, dim);
+
+  // The counter is opened before the calculator starts its threads, so they inherit it
+  const int counter = open_dtlb_counter();
+  std::unique_ptr<Range_Calculator> calculator(new CPU_Range_Calculator);
+
+  const auto start = std::chrono::high_resolution_clock::now();
+  for (const auto & cam : cams) {
+    calculator->Calculate(cam, t, rng);
+  }
+  const auto end = std::chrono::high_resolution_clock::now();
+
+  calculator.reset();
+  const int64_t misses = close_dtlb_counter(counter);
+
+  const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+  const double seconds = std::max<double>(duration.count(), 1.0) / 1e6;
+  const double rays = double(dim) * dim * cams.size();
+  std::cout << "\t" << cams.size() << " frames in " << duration.count() << " us ("
+            << cams.size() / seconds << " frames/s, "
+            << static_cast<uint64_t>(rays / seconds) << " rays/s)" << std::endl;
+
+  if (misses < 0) {
+    std::cout << "\tdTLB misses unavailable (see /proc/sys/kernel/perf_event_paranoid)" << std::endl;
+  } else {
+    std::cout << "\t" << misses << " dTLB read misses (" << 1000.0 * misses / rays
+              << " per 1000 rays)" << std::endl;
+  }
+}
+
+
+void run_pages_tool(int argc, char ** argv)
+{
+  if (argc < 3) {
+    std::cerr << "Invalid arguments. The huge page benchmark has 3 required arguments" << std::endl;
+    pages_tool_usage();
+    exit(EXIT_FAILURE);
+  }
+
+  const std::string fname(argv[0]);
+  const long dim = std::stol(std::string(argv[1]));
+  const long frames = std::stol(std::string(argv[2]));
+  const uint64_t seed = argc > 3 ? std::stoull(std::string(argv[3])) : std::random_device()();
+
+  if (dim < 1 || dim > 4096 || frames < 1) {
+    std::cerr << "Invalid arguments. Dim must be in [1, 4096] and frames must be positive" << std::endl;
+    pages_tool_usage();
+    exit(EXIT_FAILURE);
+  }
+
+  Terrain standard = read_terrain_file(fname, STANDARD_PAGES);
+
+  // Look out over the terrain from a little above random cells
+  const uint32_t size = standard.data().size().first;
+  std::mt19937_64 gen(seed);
+  std::uniform_int_distribution<uint32_t> cell(0, size - 1);
+  std::uniform_real_distribution<float> yaw(0.0f, 2.0f * M_PI);
+  std::uniform_real_distribution<float> pitch(-0.3f, 0.0f);
+  std::vector<Camera> cams;
+  for (long i = 0; i < frames; i++) {
+    const uint32_t r = cell(gen);
+    const uint32_t c = cell(gen);
+    Camera cam(M_PI / 2.0, dim, dim);
+    cam.set_position(std::make_tuple(r * standard.scale(),
+                                     c * standard.scale(),
+                                     standard.data().at(r, c) * standard.scale() + 50.0f));
+    cam.set_yaw(yaw(gen));
+    cam.set_pitch(pitch(gen));
+    cams.push_back(cam);
+  }
+
+  time_pages(standard, cams, "Standard pages");
+
+  // Release the first copy, so both runs have the same memory to work with
+  standard = Terrain(1, 1, 1.0f);
+  Terrain huge = read_terrain_file(fname, HUGE_PAGES);
+  time_pages(huge, cams, "Huge pages");
+}
+
+
 void main(int argc, char ** argv)
 {
   Tool t = get_tool_name(argc, argv);
@@ -326,6 +989,16 @@ void main(int argc, char ** argv)
       range_tool_usage();
     } else if (ht == Tool::TERRAIN_GENERATOR) {
       terrain_tool_usage();
+    } else if (ht == Tool::NOISE_GENERATOR) {
+      noise_tool_usage();
+    } else if (ht == Tool::LINE_OF_SIGHT) {
+      los_tool_usage();
+    } else if (ht == Tool::PAGES) {
+      pages_tool_usage();
+    } else if (ht == Tool::TRAJECTORY) {
+      trajectory_tool_usage();
+    } else if (ht == Tool::SERVER) {
+      server_tool_usage();
     } else {
       general_usage();
     }
@@ -333,6 +1006,16 @@ void main(int argc, char ** argv)
     run_terrain_tool(argc - 2, &(argv[2]));
   } else if (t == Tool::RANGE_MAPPER) {
     run_range_tool(argc - 2, &(argv[2]));
+  } else if (t == Tool::NOISE_GENERATOR) {
+    run_noise_tool(argc - 2, &(argv[2]));
+  } else if (t == Tool::LINE_OF_SIGHT) {
+    run_los_tool(argc - 2, &(argv[2]));
+  } else if (t == Tool::PAGES) {
+    run_pages_tool(argc - 2, &(argv[2]));
+  } else if (t == Tool::TRAJECTORY) {
+    run_trajectory_tool(argc - 2, &(argv[2]));
+  } else if (t == Tool::SERVER) {
+    run_server_tool(argc - 2, &(argv[2]));
   }
 
   exit(EXIT_SUCCESS);
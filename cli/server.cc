@@ -0,0 +1,112 @@
+//! @file       server.cc
+//! @brief      Defines the render server tool of the CLI, which serves render and
+//!             line-of-sight requests over a Unix domain socket until it is interrupted
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "cl_line_of_sight.h"
+#include "cl_range_calculator.h"
+#include "cl_utils.h"
+#include "cpu_line_of_sight.h"
+#include "cpu_range_calculator.h"
+#include "line_of_sight.h"
+#include "range_calculator.h"
+#include "render_server.h"
+#include "server.h"
+
+// Standard Imports
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+
+// Third-Party Imports
+#include "cl.hpp"
+
+
+namespace clarity {
+namespace cli {
+
+//! @brief  Set by SIGINT and SIGTERM to stop the server
+static std::atomic<bool> _stop_requested(false);
+
+
+static void _request_stop(int)
+{
+  _stop_requested = true;
+}
+
+
+void server_tool_usage()
+{
+  std::cerr << "CLarity Render Server - keeps terrains and calculators warm and serves render and line-of-sight requests" << std::endl;
+  std::cerr << "Usage: " << std::endl;
+  std::cerr << "clarity-cli server <mode> <socket_path> [terrain_file ...]" << std::endl;
+  std::cerr << "\tmode - should we run on the CPU or use OpenCL? Valid modes: (CPU, OpenCL)" << std::endl;
+  std::cerr << "\tsocket_path - the Unix domain socket to listen on. See include/render_server.h for the protocol" << std::endl;
+  std::cerr << "\t[terrain_file ...] - terrains to load before listening. They get handles 0, 1, ... in order" << std::endl;
+  std::cerr << "\tThe server runs until it receives SIGINT or SIGTERM" << std::endl;
+}
+
+
+void run_server_tool(int argc, char ** argv)
+{
+  if (argc < 2) {
+    std::cerr << "Invalid arguments. The server tool has 2 required arguments" << std::endl;
+    server_tool_usage();
+    exit(EXIT_FAILURE);
+  }
+
+  const std::string modestr(argv[0]);
+  if (modestr != "CPU" && modestr != "OpenCL") {
+    std::cerr << "Invalid mode. Only CPU and OpenCL are allowed" << std::endl;
+    server_tool_usage();
+    exit(EXIT_FAILURE);
+  }
+
+  // Without SA_RESTART, a signal also cuts the accept loop's poll short
+  struct sigaction action;
+  std::memset(&action, 0, sizeof(action));
+  action.sa_handler = _request_stop;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGINT, &action, nullptr);
+  sigaction(SIGTERM, &action, nullptr);
+
+  try {
+    std::shared_ptr<cl::Context> ctx;
+    std::unique_ptr<Range_Calculator> calculator;
+    std::unique_ptr<Line_Of_Sight> los;
+    if (modestr == "OpenCL") {
+      ctx = get_context();
+      calculator = std::unique_ptr<Range_Calculator>(new CL_Range_Calculator(ctx));
+      los = std::unique_ptr<Line_Of_Sight>(new CL_Line_Of_Sight(ctx));
+    } else {
+      calculator = std::unique_ptr<Range_Calculator>(new CPU_Range_Calculator);
+      los = std::unique_ptr<Line_Of_Sight>(new CPU_Line_Of_Sight);
+    }
+
+    Render_Server server(std::move(calculator), std::move(los), ctx);
+    for (int i = 2; i < argc; i++) {
+      const server_protocol::Terrain_Info terrain = server.load(argv[i]);
+      std::cout << "Loaded terrain " << terrain.terrain << " (" << terrain.rows << "x"
+                << terrain.cols << ") from " << argv[i] << std::endl;
+    }
+
+    std::cout << "Listening on " << argv[1] << std::endl;
+    server.serve(argv[1], _stop_requested);
+  } catch (const std::exception & e) {
+    std::cerr << "Server failed: " << e.what() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  std::cout << "Server stopped" << std::endl;
+}
+
+}}
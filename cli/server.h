@@ -0,0 +1,26 @@
+//! @file       server.h
+//! @brief      Declares the render server tool of the CLI
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+#pragma once
+
+// CLarity Imports
+
+// Standard Imports
+
+// Third-Party Imports
+
+
+namespace clarity {
+namespace cli {
+
+//! @brief  Print the usage of the server tool
+void server_tool_usage();
+
+
+//! @brief  Run the render server until it is interrupted. See Render_Server.
+void run_server_tool(int argc, char ** argv);
+
+}}
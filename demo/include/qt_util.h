@@ -11,6 +11,7 @@
 
 // Standard Imports
 #include <cstdint>
+#include <vector>
 
 // Third-Party Imports
 #include <QLabel>
@@ -25,4 +26,12 @@ void display_grayscale_buffer(const Buffer & b,
                               const uint32_t out_cols);
 
 
+void display_rgba(const std::vector<uint8_t> & rgba,
+                  const uint32_t rows,
+                  const uint32_t cols,
+                  QLabel & lbl,
+                  const uint32_t out_rows,
+                  const uint32_t out_cols);
+
+
 }}
@@ -8,8 +8,9 @@
 
 // CLarity Imports
 #include "camera.h"
+#include "buffer.h"
 #include "device_buffer.h"
-#include "range_calculator.h"
+#include "render_worker.h"
 #include "terrain.h"
 #include "terrain_viewer.h"
 
@@ -39,6 +40,7 @@ public:
 
 private slots:
     void on_display();
+    void on_frame();
     void on_update_camera();
     void on_update_terrain(Terrain & terrain);
 
@@ -49,11 +51,12 @@ private:
     std::shared_ptr<cl::Context> m_ctx;
     Camera m_cam;
     Terrain m_terrain;
-    Device_Buffer m_range;
-    std::unique_ptr<Range_Calculator> m_calculator;
+    Buffer m_range;
+    Render_Worker m_worker;
 
     QLabel m_img_lbl;
     QLabel m_rng_lbl;
+    QLabel m_time_lbl;
     QSlider m_yaw_slider;
     QSlider m_pitch_slider;
     QSlider m_roll_slider;
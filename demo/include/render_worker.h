@@ -0,0 +1,112 @@
+//! @file       render_worker.h
+//! @brief      Declaration for a worker thread that renders range images off the GUI thread
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+#pragma once
+
+// CLarity Imports
+#include "buffer.h"
+#include "camera.h"
+#include "range_calculator.h"
+#include "range_display.h"
+#include "terrain.h"
+
+// Standard Imports
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Third-Party Imports
+#include <QObject>
+
+
+namespace clarity {
+namespace demo {
+
+
+//! @brief  A rendered range image, and how long it took
+struct Render_Frame
+{
+    //! The range image. Owned by the frame; the worker never writes to it again.
+    std::shared_ptr<Buffer> range;
+
+    //! The range image as grayscale RGBA, 4 bytes per pixel
+    std::shared_ptr<std::vector<uint8_t>> rgba;
+
+    //! The pixel spacing of the pass the image came from. 1 is a complete frame.
+    uint32_t stride;
+
+    //! The time from the start of the render to the end of this pass, in milliseconds
+    double milliseconds;
+};
+
+
+//! @brief  Renders range images on a dedicated thread, keeping only the latest request.
+//!
+//! @detail request() never blocks on a render. It replaces any request that has not started
+//!         and cancels the one in progress, so dragging a slider costs one render per frame
+//!         the worker can finish rather than one per slider event. Each pass of the
+//!         progressive render is published as a Render_Frame and announced with frame_ready,
+//!         which Qt delivers on the thread that owns the receiver.
+class Render_Worker : public QObject
+{
+private:
+    Q_OBJECT
+
+public:
+    //! @brief  Start the worker thread
+    //!
+    //! @param[in]  calculator  the calculator to render with. Only the worker thread uses it.
+    //! @param[in]  display     converts each frame to RGBA. Only the worker thread uses it.
+    Render_Worker(std::unique_ptr<Range_Calculator> calculator,
+                  std::unique_ptr<Range_Display> display,
+                  QObject * parent = nullptr);
+
+
+    //! @brief  Cancel any render and join the worker thread
+    ~Render_Worker();
+
+
+    //! @brief  Render a new view, superseding any earlier request
+    void request(const Camera & cam, const Terrain & t);
+
+
+    //! @brief  Take the latest published frame
+    //!
+    //! @return false if no frame has been published since the last call
+    bool take_frame(Render_Frame & frame);
+
+signals:
+    //! @brief  Emitted from the worker thread whenever a frame is published
+    void frame_ready();
+
+private:
+    //! @brief  The body of the worker thread
+    void run();
+
+    std::unique_ptr<Range_Calculator> m_calculator;
+    std::unique_ptr<Range_Display> m_display;
+
+    //! Guards the members below it
+    std::mutex m_mutex;
+    std::condition_variable m_requested;
+    std::unique_ptr<Camera> m_pending_cam;
+    std::unique_ptr<Terrain> m_pending_terrain;
+    Render_Frame m_frame;
+    bool m_has_frame;
+    bool m_stopping;
+
+    //! Set to abandon the render in progress
+    std::atomic<bool> m_cancel;
+
+    std::thread m_thread;
+};
+
+
+}}
@@ -7,6 +7,7 @@
 // CLarity Imports
 #include "camera.h"
 #include "cl_range_calculator.h"
+#include "cl_range_display.h"
 #include "device_buffer.h"
 #include "terrain.h"
 #include "range_viewer.h"
@@ -58,10 +59,12 @@ Range_Viewer::Range_Viewer(std::shared_ptr<cl::Context> ctx,
     , m_ctx(ctx)
     , m_cam(_DEFAULT_CAM_FOV, _DEFAULT_CAM_X_DIM, _DEFAULT_CAM_Y_DIM)
     , m_terrain(512, 512, 25.0)
-    , m_range(*m_ctx, _DEFAULT_CAM_X_DIM, _DEFAULT_CAM_Y_DIM)
-    , m_calculator(new CL_Range_Calculator(m_ctx))
+    , m_range(_DEFAULT_CAM_X_DIM, _DEFAULT_CAM_Y_DIM)
+    , m_worker(std::unique_ptr<Range_Calculator>(new CL_Range_Calculator(m_ctx)),
+               std::unique_ptr<Range_Display>(new CL_Range_Display(m_ctx)))
     , m_img_lbl(this)
     , m_rng_lbl(this)
+    , m_time_lbl(this)
     , m_yaw_slider(Qt::Horizontal, this)
     , m_pitch_slider(Qt::Horizontal, this)
     , m_roll_slider(Qt::Horizontal, this)
@@ -114,6 +117,11 @@ Range_Viewer::Range_Viewer(std::shared_ptr<cl::Context> ctx,
       hlbl->addWidget(lbl);
       hlbl->addWidget(&m_rng_lbl);
       vbox->addLayout(hlbl);
+
+      QHBoxLayout * htime = new QHBoxLayout;
+      htime->addWidget(new QLabel("Frame: "));
+      htime->addWidget(&m_time_lbl);
+      vbox->addLayout(htime);
       rlbls->setLayout(vbox);
     }
 
@@ -155,6 +163,10 @@ Range_Viewer::Range_Viewer(std::shared_ptr<cl::Context> ctx,
     connect(&m_roll_slider, &QSlider::valueChanged, this, &Range_Viewer::on_update_camera);
     connect(&terrain_viewer, &Terrain_Viewer::generate, this, &Range_Viewer::on_update_terrain);
 
+    // The worker emits from its own thread, so the frame is picked up on the GUI thread
+    connect(&m_worker, &Render_Worker::frame_ready, this, &Range_Viewer::on_frame,
+            Qt::QueuedConnection);
+
     setLayout(layout);
 }
 
@@ -179,15 +191,24 @@ bool Range_Viewer::eventFilter(QObject * obj, QEvent * evt)
 
 void Range_Viewer::on_display()
 {
-    std::cerr << "on display" << std::endl;
-    const auto sz = m_cam.focal_plane_dimensions();
+    // Returns at once; the worker drops any view that is superseded before it is drawn
+    m_worker.request(m_cam, m_terrain);
+}
 
-    try {
-      m_calculator->Calculate(m_cam, m_terrain, m_range);
-    } catch (const std::exception & e) {
-      std::cerr << "Caught exception: " << e.what() << std::endl;
+
+void Range_Viewer::on_frame()
+{
+    // Several signals may arrive for one frame; only the first finds it
+    Render_Frame frame;
+    if (! m_worker.take_frame(frame)) {
+        return;
     }
-    display_grayscale_buffer(m_range, m_img_lbl, std::get<0>(sz), std::get<1>(sz));
+
+    m_range = *frame.range;
+    const auto sz = m_range.size();
+    display_rgba(*frame.rgba, sz.first, sz.second, m_img_lbl, sz.first, sz.second);
+    m_time_lbl.setText(QString("%1 ms (1/%2)").arg(frame.milliseconds, 0, 'f', 1)
+                                              .arg(frame.stride));
 }
 
 
@@ -0,0 +1,142 @@
+//! @file       render_worker.cc
+//! @brief      Defines a worker thread that renders range images off the GUI thread
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "buffer.h"
+#include "camera.h"
+#include "range_calculator.h"
+#include "range_display.h"
+#include "render_worker.h"
+#include "terrain.h"
+
+// Standard Imports
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+// Third-Party Imports
+
+namespace clarity {
+namespace demo {
+
+
+Render_Worker::Render_Worker(std::unique_ptr<Range_Calculator> calculator,
+                             std::unique_ptr<Range_Display> display,
+                             QObject * parent)
+    : QObject(parent)
+    , m_calculator(std::move(calculator))
+    , m_display(std::move(display))
+    , m_mutex()
+    , m_requested()
+    , m_pending_cam()
+    , m_pending_terrain()
+    , m_frame()
+    , m_has_frame(false)
+    , m_stopping(false)
+    , m_cancel(false)
+    , m_thread()
+{
+    m_thread = std::thread(&Render_Worker::run, this);
+}
+
+
+Render_Worker::~Render_Worker()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        m_cancel = true;
+    }
+    m_requested.notify_one();
+    m_thread.join();
+}
+
+
+void Render_Worker::request(const Camera & cam, const Terrain & t)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending_cam = std::unique_ptr<Camera>(new Camera(cam));
+        m_pending_terrain = std::unique_ptr<Terrain>(new Terrain(t));
+        m_cancel = true;
+    }
+    m_requested.notify_one();
+}
+
+
+bool Render_Worker::take_frame(Render_Frame & frame)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (! m_has_frame) {
+        return false;
+    }
+
+    frame = m_frame;
+    m_has_frame = false;
+    return true;
+}
+
+
+void Render_Worker::run()
+{
+    for (;;) {
+        std::unique_ptr<Camera> cam;
+        std::unique_ptr<Terrain> terrain;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_requested.wait(lock, [this] { return m_stopping || m_pending_cam != nullptr; });
+            if (m_stopping) {
+                return;
+            }
+
+            // Anything requested from here on supersedes this render
+            cam = std::move(m_pending_cam);
+            terrain = std::move(m_pending_terrain);
+            m_cancel = false;
+        }
+
+        const auto sz = cam->focal_plane_dimensions();
+        Buffer range(std::get<0>(sz), std::get<1>(sz));
+        const auto begin = std::chrono::steady_clock::now();
+
+        auto publish = [&](const uint32_t stride, const Buffer & rng) {
+            const std::chrono::duration<double, std::milli> elapsed =
+                std::chrono::steady_clock::now() - begin;
+
+            // The frame gets its own copy, as later passes keep writing to rng
+            std::shared_ptr<Buffer> copy(new Buffer(rng.size().first, rng.size().second));
+            std::copy(&rng.at(0, 0),
+                      &rng.at(0, 0) + rng.size().first * rng.size().second,
+                      &copy->at(0, 0));
+
+            std::shared_ptr<std::vector<uint8_t>> rgba(new std::vector<uint8_t>());
+            m_display->Convert(rng, *rgba);
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_frame.range = copy;
+                m_frame.rgba = rgba;
+                m_frame.stride = stride;
+                m_frame.milliseconds = elapsed.count();
+                m_has_frame = true;
+            }
+            emit frame_ready();
+        };
+
+        try {
+            m_calculator->Calculate_Progressive(*cam, *terrain, range, publish, &m_cancel);
+        } catch (const std::exception & e) {
+            std::cerr << "Caught exception: " << e.what() << std::endl;
+        }
+    }
+}
+
+}}
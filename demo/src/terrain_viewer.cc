@@ -5,8 +5,8 @@
 //! @copyright  MIT
 
 // CLarity Imports
+#include "cl_diamond_square_terrain_generator.h"
 #include "device_buffer.h"
-#include "diamond_square_terrain_generator.h"
 #include "terrain.h"
 #include "terrain_generator.h"
 #include "terrain_viewer.h"
@@ -17,6 +17,7 @@
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <random>
 
 // Third-Party Imports
 #include <QByteArray>
@@ -59,7 +60,7 @@ Terrain_Viewer::Terrain_Viewer(std::shared_ptr<cl::Context> ctx, QWidget * paren
     : QWidget(parent)
     , m_ctx(ctx)
     , m_terrain(512, 512, 25.)
-    , m_generator(new Diamond_Square_Generator)
+    , m_generator(new CL_Diamond_Square_Generator(ctx, std::random_device()()))
     , m_img_lbl(this)
     , m_scale_box(this)
     , m_detail_slider(Qt::Horizontal, this)
@@ -142,12 +143,14 @@ void Terrain_Viewer::on_generate()
     const float scale = m_scale_box.text().toFloat();
     m_terrain = m_generator->generate_terrain(tbuffer, scale, roughness);
 
+    // The terrain is already on the device, so ranging can start before the host copy is made
+    emit generate(m_terrain);
+
     ////////////////////////////////////////////////////////////////////////////////// 
     //// Convert to a grayscale image
     ////////////////////////////////////////////////////////////////////////////////// 
+    dynamic_cast<Device_Buffer &>(m_terrain.data()).from_device();
     display_grayscale_buffer(m_terrain.data(), m_img_lbl, _VIEW_SIZE, _VIEW_SIZE);
-
-    emit generate(m_terrain);
 }
 
 }}
@@ -7,17 +7,31 @@
 #pragma once
 
 // CLarity Imports
+#include "huge_pages.h"
 
 // Standard Imports
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <utility>
+#include <vector>
 
 // Third-Party Importss
 
 namespace clarity 
 {
 
+//! @brief  The pages a Buffer asks for when it allocates its memory
+enum Page_Policy
+{
+    STANDARD_PAGES = 0,
+
+    //! 2 MB pages, which cut the TLB misses of scattered reads over a large Buffer. See
+    //! huge_pages::allocate for the fallbacks, and Buffer::backing for the result.
+    HUGE_PAGES = 1
+};
+
+
 //! @brief a 2-D area of memory in row-major order
 //!
 //! @detail This type supports efficient copies and assignments
@@ -25,12 +39,41 @@ class Buffer
 {
 public: 
 
+    //! @brief  A rectangle of cells
+    struct Region
+    {
+        uint32_t row;
+        uint32_t col;
+        uint32_t rows;
+        uint32_t cols;
+    };
+
+
     //! @brief Constructor for the Buffer type
     //! 
     //! @param[in] rows                 number of rows in the buffer
     //! @param[in] cols                 number of cols in the buffer
     //! @param[in] depth                the number of values at each point
-    Buffer(const uint32_t rows, const uint32_t cols, const uint8_t depth = 1);
+    //! @param[in] pages                the pages to back the memory with
+    Buffer(const uint32_t rows,
+           const uint32_t cols,
+           const uint8_t depth = 1,
+           const Page_Policy pages = STANDARD_PAGES);
+
+
+    //! @brief Construct a Buffer around existing memory
+    //!
+    //! @detail The Buffer shares ownership of the memory; no copy is made. The memory must hold
+    //!         at least rows * cols * depth values.
+    //!
+    //! @param[in] data                 the memory to wrap
+    //! @param[in] rows                 number of rows in the buffer
+    //! @param[in] cols                 number of cols in the buffer
+    //! @param[in] depth                the number of values at each point
+    Buffer(std::shared_ptr<float> data, 
+           const uint32_t rows, 
+           const uint32_t cols, 
+           const uint8_t depth = 1);
 
 
     //! @brief Destructor for the Buffer type
@@ -67,7 +110,48 @@ public:
     //! @brief      Get the depth of the Buffer
     uint8_t depth() const;
 
+
+    //! @brief      Get how the memory of the Buffer is backed
+    //! @detail     Reports whether a request for huge pages was honored. A Buffer around existing
+    //!             memory reports STANDARD.
+    huge_pages::Backing backing() const;
+
+
+    //! @brief      Record that a rectangle of the Buffer has been written
+    //!
+    //! @detail     Copies of the Buffer share one list of dirty rectangles, so a Device_Buffer
+    //!             made from a Buffer sees the rectangles recorded through the original. Each
+    //!             record starts a new dirty generation, and each rectangle keeps the generation
+    //!             it was last written in. Rectangles that overlap are merged, and past a limit
+    //!             the list is collapsed to their bounding rectangle. Throws std::out_of_range if
+    //!             the rectangle is not inside the Buffer.
+    void mark_dirty(const Region & region);
+
+
+    //! @brief      Get the rectangles written that have not been forgotten by clear_dirty
+    std::vector<Region> dirty_regions() const;
+
+
+    //! @brief      Get the rectangles written after a dirty generation
+    std::vector<Region> dirty_regions_since(const uint64_t generation) const;
+
+
+    //! @brief      Get the generation of the last rectangle recorded. 0 if there is none.
+    uint64_t dirty_generation() const;
+
+
+    //! @brief      Forget the dirty rectangles that every device copy of the Buffer has
+    //!             uploaded. With no device copies, every rectangle is forgotten.
+    void clear_dirty();
+
 protected:
+    //! @brief      Keep the rectangles a device copy has not uploaded through clear_dirty
+    //!
+    //! @param[in]  synced  the dirty generation the copy has uploaded. The copy is forgotten
+    //!                     once synced is released.
+    void track_dirty(const std::shared_ptr<const std::atomic<uint64_t>> & synced);
+
+
     //! The number of rows in the terrain map
     uint32_t m_rows;
 
@@ -79,6 +163,13 @@ protected:
 
     //! The scale of each cell, in meters per cell
     std::shared_ptr<float> m_data;
+
+    //! How m_data is backed
+    huge_pages::Backing m_backing;
+
+    //! The record of written rectangles, shared by copies
+    struct Dirty_Log;
+    std::shared_ptr<Dirty_Log> m_dirty;
 };
 
 }
@@ -108,6 +108,16 @@ public:
     void set_pitch(const float pitch);
 
 
+    //! @brief  Get the unit pointing vector of a pixel, relative to Camera boresight
+    //!
+    //! @detail This is the pixel-to-angle calculation used by the range calculators to build
+    //!         their Camera coordinates. The x component is along boresight.
+    //!
+    //! @param[in]  row     the row of the pixel in the focal plane
+    //! @param[in]  col     the col of the pixel in the focal plane
+    virtual Position pixel_to_camera(const uint32_t row, const uint32_t col) const;
+
+
     //! @brief  Populate the given matrix with the rotation matrix for this
     //!         Camera
     void get_rotation_matrix(std::shared_ptr<float> rot_buffer) const;
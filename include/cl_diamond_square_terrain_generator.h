@@ -0,0 +1,95 @@
+//! @file       cl_diamond_square_terrain_generator.h
+//! @brief      Declares an implementation of Terrain_Generator that runs the diamond-square
+//!             algorithm with OpenCL kernels
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+#pragma once
+
+// CLarity Imports
+#include "buffer.h"
+#include "cl_utils.h"
+#include "device_buffer.h"
+#include "terrain.h"
+#include "terrain_generator.h"
+
+// Standard Imports
+#include <cstdint>
+#include <memory>
+
+// Third-Party Imports
+#include "cl.hpp"
+
+namespace clarity 
+{
+
+//! @brief  An implementation of Terrain_Generator that runs each square and diamond pass of the
+//!         Diamond-Square algorithm as a kernel launch.
+//!
+//! @detail The terrain is generated in the device memory of a Device_Buffer, so it can be passed
+//!         straight to CL_Range_Calculator. The host copy of the Buffer is left untouched;
+//!         call Device_Buffer::from_device when the heights are needed on the host.
+//!
+//!         Given the same seed, the result is bit-identical to Diamond_Square_Generator.
+class CL_Diamond_Square_Generator : public Terrain_Generator
+{
+public:
+
+    //! @brief  Constructor
+    //!
+    //! @param[in]  ctx     the OpenCL context to use. The first device of the context is used.
+    //! @param[in]  seed    the seed. Equal seeds generate equal terrain.
+    CL_Diamond_Square_Generator(const std::shared_ptr<cl::Context> ctx, const uint64_t seed);
+
+
+    //! @brief  Destructor
+    ~CL_Diamond_Square_Generator();
+
+
+    //! @brief  Deleted copy constructor
+    CL_Diamond_Square_Generator(const CL_Diamond_Square_Generator & other) = delete;
+
+
+    //! @brief  Deleted assignment operator
+    CL_Diamond_Square_Generator & operator=(const CL_Diamond_Square_Generator & other) = delete;
+
+
+    //! @brief  See Terrain_Generator::generate_terrain. The Terrain holds a Device_Buffer.
+    Terrain generate_terrain(const uint32_t rows, 
+                             const uint32_t cols, 
+                             const float scale, 
+                             const float roughness);
+    
+
+    //! @brief  See Terrain_Generator::generate_terrain. buffer must be a Device_Buffer in the
+    //!         context of this generator.
+    Terrain generate_terrain(std::shared_ptr<Buffer> buffer, 
+                             const float scale, 
+                             const float roughness);
+
+
+    //! @brief  Get the seed used to generate terrain
+    uint64_t seed() const;
+
+
+    //! @brief  Set the seed used to generate terrain
+    void set_seed(const uint64_t seed);
+
+private:
+    static constexpr float MAX_HEIGHT_M = 100;
+
+    //! The OpenCL context to use
+    std::shared_ptr<cl::Context> m_ctx;
+
+    //! The command queue the passes are run on
+    cl::CommandQueue m_queue;
+
+    //! The square and diamond kernels
+    std::unique_ptr<Kernel_Collection> m_kernels;
+
+    //! The seed of the random offsets
+    uint64_t m_seed;
+};
+
+}
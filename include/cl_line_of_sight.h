@@ -0,0 +1,130 @@
+//! @file       cl_line_of_sight.h
+//! @brief      Declares an implementation of Line_Of_Sight that uses OpenCL kernels
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+#pragma once
+
+// CLarity Imports
+#include "cl_utils.h"
+#include "device_buffer.h"
+#include "line_of_sight.h"
+#include "residency_manager.h"
+#include "terrain.h"
+#include "terrain_pyramid.h"
+
+// Standard Imports
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Third-Party Imports
+#include "cl.hpp"
+
+
+namespace clarity
+{
+
+//! @brief  Implementation of Line_Of_Sight that walks one line per OpenCL work item.
+//!
+//! @detail A Terrain backed by a Device_Buffer is walked in place, after the rectangles edited
+//!         since its last upload are sent. Any other Terrain is made resident through a
+//!         Residency_Manager, as by CL_Range_Calculator, so its height map is uploaded once and
+//!         reused until it is marked dirty. The pyramid of the Terrain, if any, is uploaded on
+//!         first use; when an edit refits it, only the refitted cells are sent.
+class CL_Line_Of_Sight : public Line_Of_Sight
+{
+public:
+    //! @brief  Constructor
+    //!
+    //! @param[in]  ctx     The OpenCL context to use. Lines are walked on its first device.
+    explicit CL_Line_Of_Sight(const std::shared_ptr<cl::Context> ctx);
+
+
+    //! @brief  Destructor
+    ~CL_Line_Of_Sight();
+
+
+    //! @brief  Deleted copy constructor
+    CL_Line_Of_Sight(const CL_Line_Of_Sight & other) = delete;
+
+
+    //! @brief  Deleted assignment operator
+    CL_Line_Of_Sight & operator=(const CL_Line_Of_Sight & other) = delete;
+
+
+    //! @brief  See Line_Of_Sight::Check
+    void Check(const Terrain & t,
+               const std::vector<Point> & observers,
+               const std::vector<Point> & targets,
+               std::vector<uint8_t> & visible,
+               std::vector<float> & distance);
+
+
+    //! @brief  Share a Residency_Manager with other objects, so they upload each terrain once
+    //!         between them and share one device-memory budget
+    //!
+    //! @param[in]  residency   the manager. It must use the context of this object.
+    void set_residency(const std::shared_ptr<Residency_Manager> residency);
+
+
+    //! @brief  Get the Residency_Manager that holds the terrains of this object
+    std::shared_ptr<Residency_Manager> residency() const;
+
+private:
+
+    //! @brief  Get the device copy of the height map of a Terrain, making it resident if the
+    //!         Terrain is not backed by a Device_Buffer and uploading its dirty rectangles if it
+    //!         is
+    const Device_Buffer & device_terrain(const Terrain & t);
+
+
+    //! @brief  Upload the pyramid of a Terrain and its level table the first time it is seen,
+    //!         and only its refitted cells after a later edit
+    void upload_pyramid(const std::shared_ptr<Terrain_Pyramid> & pyramid);
+
+    //! The OpenCL context to use
+    std::shared_ptr<cl::Context> m_ctx;
+
+    //! The command queue of the first device of the context
+    cl::CommandQueue m_queue;
+
+    //! The line_of_sight kernel
+    std::unique_ptr<Kernel_Collection> m_kernels;
+
+    //! The observers of the last query, 4 floats each, grown as needed
+    std::unique_ptr<Device_Buffer> m_observers;
+
+    //! The targets of the last query, 4 floats each
+    std::unique_ptr<Device_Buffer> m_targets;
+
+    //! The visibility of each line of the last query
+    cl::Buffer m_visible;
+
+    //! The distance of each line of the last query
+    std::unique_ptr<Device_Buffer> m_distance;
+
+    //! The number of lines the query buffers can hold
+    uint32_t m_capacity;
+
+    //! The device copy of the last Terrain_Pyramid used
+    std::unique_ptr<Device_Buffer> m_pyramid;
+
+    //! The (offset, cols) of each level of m_pyramid
+    cl::Buffer m_levels;
+
+    //! The Terrain_Pyramid m_pyramid was copied from
+    std::shared_ptr<Terrain_Pyramid> m_pyramid_source;
+
+    //! The version of m_pyramid_source when it was copied
+    uint64_t m_pyramid_version;
+
+    //! The device copies of the terrains that are not backed by a Device_Buffer
+    std::shared_ptr<Residency_Manager> m_residency;
+
+    //! The device copy of the last such terrain, held while it is in use
+    std::shared_ptr<Device_Buffer> m_terrain;
+};
+
+}
@@ -11,11 +11,18 @@
 #include "camera.h"
 #include "cl_utils.h"
 #include "device_buffer.h"
+#include "procedural_terrain.h"
 #include "range_calculator.h"
+#include "range_quantization.h"
+#include "residency_manager.h"
 #include "terrain.h"
+#include "terrain_pyramid.h"
 
 // Standard Imports
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <utility>
 #include <vector>
 
 // Third-Party Imports
@@ -27,12 +34,23 @@ namespace clarity
 
 //! @brief  Implementation of Range_Calculator that utilizes OpenCL to perform an efficent
 //!         range calculation.
+//!
+//! @detail A procedural Terrain is rendered from a window of tiles around the Camera, large
+//!         enough to hold the view distance. The window is only rebuilt and uploaded when the
+//!         Camera moves into another tile. Rendering throws std::invalid_argument if the window
+//!         holds more tiles than the max_tiles of the terrain.
+//!
+//!         A Terrain backed by a Device_Buffer is walked in place, after the rectangles edited
+//!         since its last upload are sent, so Terrain::edit reaches it. Any other Terrain is made
+//!         resident through a Residency_Manager, so its height map is uploaded the first time
+//!         it is rendered and reused by every later render until it is marked dirty.
 class CL_Range_Calculator : public Range_Calculator
 {
 public:
     //! @brief  Default constructor.
     //!
-    //! @detail Selects first platform/context and a single device for computation.
+    //! @detail Uses the context and queues of the process-wide CL_Runtime, so default calculators
+    //!         share one context and one build of their kernels.
     CL_Range_Calculator();
 
 
@@ -78,6 +96,51 @@ public:
                        Buffer & rng);
 
 
+    //! @brief  See Range_Calculator::rows_bottom_up. The range image of the device runs
+    //!         bottom-up.
+    bool rows_bottom_up() const;
+
+
+    //! @brief  See Range_Calculator::Calculate_Quantized
+    //!
+    //! @detail The ranges are packed on the device, and only the codes are copied back.
+    void Calculate_Quantized(const Camera & cam, 
+                             const Terrain & t, 
+                             const Range_Quantization & q,
+                             std::vector<uint16_t> & codes);
+
+
+    //! @brief  See Range_Calculator::Calculate_Hits. hits must be a Device_Buffer.
+    void Calculate_Hits(const Camera & cam, const Terrain & t, Buffer & hits);
+
+
+    //! @brief  See Range_Calculator::Calculate_Pixels
+    //!
+    //! @detail The pointing vectors of the pixels are computed on the host and only those rays
+    //!         are walked on the device.
+    void Calculate_Pixels(const Camera & cam, 
+                          const Terrain & t, 
+                          const std::vector<Pixel> & pixels, 
+                          std::vector<float> & ranges);
+
+
+    //! @brief  See Range_Calculator::Calculate_Pixels. The start of each ray is passed to the
+    //!         device with its pointing vector.
+    void Calculate_Pixels(const Camera & cam, 
+                          const Terrain & t, 
+                          const std::vector<Pixel> & pixels, 
+                          const std::vector<float> & start,
+                          std::vector<float> & ranges);
+
+
+    //! @brief  See Range_Calculator::Calculate_Region. rng may be any Buffer.
+    void Calculate_Region(const Camera & cam, 
+                          const Terrain & t, 
+                          const uint32_t row0, 
+                          const uint32_t col0, 
+                          Buffer & rng);
+
+
     //! @brief  Get the OpenCL devices that can be used
     std::vector<cl::Device> & get_devices();
 
@@ -88,6 +151,30 @@ public:
     //!                         that specifies the device to use
     void use_device(const uint8_t device_idx);
 
+
+    //! @brief  Set the level-of-detail error budget. See CPU_Range_Calculator.
+    //!
+    //! @detail The pyramid of the Terrain is uploaded on first use, and again whenever its
+    //!         version changes. A procedural Terrain is always walked at full detail.
+    //!
+    //! @param[in]  pixels  the largest error allowed at any range, in pixels. 0 disables LOD.
+    void set_lod_error_budget(const float pixels);
+
+
+    //! @brief  Get the level-of-detail error budget, in pixels
+    float lod_error_budget() const;
+
+
+    //! @brief  Share a Residency_Manager with other objects, so they upload each terrain once
+    //!         between them and share one device-memory budget
+    //!
+    //! @param[in]  residency   the manager. It must use the context of this calculator.
+    void set_residency(const std::shared_ptr<Residency_Manager> residency);
+
+
+    //! @brief  Get the Residency_Manager that holds the terrains of this calculator
+    std::shared_ptr<Residency_Manager> residency() const;
+
 private:
     
     void run_pix2cam(const Camera & cam, Buffer & cam_coords, const bool copy);
@@ -99,11 +186,55 @@ private:
                        const bool copy);
 
 
+    //! @brief  Walk the ray of each pixel, writing a range image or, if hits is set, a hit
+    //!         image to out
     void run_map_range(const Camera & cam, 
                        const Terrain & t, 
                        const Buffer & world_coords, 
-                       Buffer & rng,
-                       bool copy);
+                       Buffer & out,
+                       const bool hits,
+                       const bool copy);
+
+
+    //! @brief  Run the map_range kernel, or the map_hits kernel if hits is set, over a Terrain
+    //!         backed by a Device_Buffer
+    //!
+    //! @param[in]  cell_offset     the (row, col) of the first cell of the Terrain in the
+    //!                             terrain it was taken from, added to hit positions
+    void enqueue_map_range(const Camera & cam, 
+                           const Terrain & t, 
+                           const Buffer & world_coords, 
+                           Buffer & out,
+                           const float max_range,
+                           const bool hits,
+                           const std::pair<int64_t, int64_t> & cell_offset,
+                           const bool copy);
+
+
+    //! @brief  Walk a list of rays with the map_range_rays kernel
+    //!
+    //! @param[in]  rays    the world pointing vector of each ray and the range at which to
+    //!                     start walking it, 4 floats per ray
+    //! @param[out] ranges  the range of each ray
+    void run_rays(const Camera & cam, 
+                  const Terrain & t, 
+                  const std::vector<float> & rays, 
+                  float * ranges);
+
+
+    //! @brief  Get the device copy of a Terrain_Pyramid, uploading it if it is stale
+    const Device_Buffer & device_pyramid(const std::shared_ptr<Terrain_Pyramid> & pyramid);
+
+
+    //! @brief  Get the device copy of the height map of a Terrain, making it resident if the
+    //!         Terrain is not backed by a Device_Buffer and uploading its dirty rectangles if it
+    //!         is
+    const Device_Buffer & device_terrain(const Terrain & t);
+
+
+    //! @brief  Get the window of a procedural Terrain around the Camera, and the position of
+    //!         the Camera relative to the window
+    Terrain procedural_window(const Camera & cam, const Terrain & t, Camera & local_cam);
 
     //! The OpenCL context to use
     std::shared_ptr<cl::Context> m_ctx;
@@ -128,6 +259,48 @@ private:
 
     //! The index of the device to use in m_devices
     uint8_t m_device_idx;
+
+    //! The window of procedural terrain last uploaded
+    std::shared_ptr<Device_Buffer> m_window;
+
+    //! The procedural terrain m_window was copied from
+    std::shared_ptr<Procedural_Terrain> m_window_source;
+
+    //! The global (row, col) of the first cell of m_window
+    std::pair<int64_t, int64_t> m_window_origin;
+
+    //! The level-of-detail error budget, in pixels
+    float m_lod_error;
+
+    //! The device copy of the last Terrain_Pyramid used
+    std::unique_ptr<Device_Buffer> m_pyramid;
+
+    //! The Terrain_Pyramid m_pyramid was copied from
+    std::shared_ptr<Terrain_Pyramid> m_pyramid_source;
+
+    //! The version of m_pyramid_source when it was copied
+    uint64_t m_pyramid_version;
+
+    //! The pointing vectors of the rays of the last query, grown as needed
+    std::unique_ptr<Device_Buffer> m_rays;
+
+    //! The ranges of the rays of the last query
+    std::unique_ptr<Device_Buffer> m_ray_ranges;
+
+    //! The range image of the last quantized render, which never leaves the device
+    std::unique_ptr<Device_Buffer> m_range;
+
+    //! The codes of the last quantized render, grown as needed
+    cl::Buffer m_codes;
+
+    //! The size of m_codes, in bytes
+    size_t m_codes_bytes;
+
+    //! The device copies of the terrains that are not backed by a Device_Buffer
+    std::shared_ptr<Residency_Manager> m_residency;
+
+    //! The device copy of the last such terrain, held while it is in use
+    std::shared_ptr<Device_Buffer> m_terrain;
 };
 
 }
@@ -0,0 +1,82 @@
+//! @file       cl_range_display.h
+//! @brief      Declares an implementation of Range_Display that uses OpenCL kernels
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+#pragma once
+
+// CLarity Imports
+#include "buffer.h"
+#include "cl_utils.h"
+#include "device_buffer.h"
+#include "range_display.h"
+
+// Standard Imports
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Third-Party Imports
+#include "cl.hpp"
+
+
+namespace clarity
+{
+
+//! @brief  Implementation of Range_Display that reduces and converts on an OpenCL device.
+//!
+//! @detail A Device_Buffer is read from the device as it stands, so a range image that a
+//!         CL_Range_Calculator has just written never has to cross to the host as floats; only
+//!         the RGBA bytes, a quarter of the size, are read back. Any other Buffer is uploaded
+//!         to a device buffer owned by this object first.
+class CL_Range_Display : public Range_Display
+{
+public:
+    //! @brief  Constructor
+    //!
+    //! @param[in]  ctx     The OpenCL context to use. The conversion runs on its first device.
+    explicit CL_Range_Display(const std::shared_ptr<cl::Context> ctx);
+
+
+    //! @brief  Destructor
+    ~CL_Range_Display();
+
+
+    //! @brief  Deleted copy constructor
+    CL_Range_Display(const CL_Range_Display & other) = delete;
+
+
+    //! @brief  Deleted assignment operator
+    CL_Range_Display & operator=(const CL_Range_Display & other) = delete;
+
+
+    //! @brief  See Range_Display::Convert
+    std::pair<float, float> Convert(const Buffer & rng, std::vector<uint8_t> & rgba);
+
+private:
+
+    //! The OpenCL context to use
+    std::shared_ptr<cl::Context> m_ctx;
+
+    //! The command queue of the first device of the context
+    cl::CommandQueue m_queue;
+
+    //! The reduction and conversion kernels
+    std::unique_ptr<Kernel_Collection> m_kernels;
+
+    //! The input, when the caller's Buffer is not a Device_Buffer
+    std::unique_ptr<Device_Buffer> m_range;
+
+    //! The (min, max) of each work group of the reduction. The first is the overall result.
+    cl::Buffer m_partials;
+
+    //! The RGBA output
+    cl::Buffer m_rgba;
+
+    //! The size of m_rgba, in pixels
+    size_t m_rgba_pixels;
+};
+
+}
@@ -0,0 +1,97 @@
+//! @file       cl_terrain_pyramid.h
+//! @brief      Declares the CL_Terrain_Pyramid type, which fits a terrain pyramid on an OpenCL
+//!             device
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+#pragma once
+
+// CLarity Imports
+#include "buffer.h"
+#include "cl_utils.h"
+#include "device_buffer.h"
+#include "terrain_pyramid.h"
+
+// Standard Imports
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Third-Party Imports
+#include "cl.hpp"
+
+
+namespace clarity
+{
+
+//! @brief  The levels of a Terrain_Pyramid, fitted on a device from a height map that lives
+//!         there.
+//!
+//! @detail The levels are packed as in Terrain_Pyramid::packed, so packed() can be walked by the
+//!         same kernels. build() fits every level. refit() fits only the cells above a rectangle
+//!         of the height map that has changed, one kernel launch per level, so a terrain that is
+//!         edited on the device never has to cross to the host to keep its pyramid current.
+class CL_Terrain_Pyramid
+{
+public:
+    //! @brief  Constructor
+    //!
+    //! @param[in]  ctx     The OpenCL context to use. The kernels run on its first device.
+    //! @param[in]  layout  a pyramid with the levels to keep. Only its sizes are used.
+    CL_Terrain_Pyramid(const std::shared_ptr<cl::Context> ctx, const Terrain_Pyramid & layout);
+
+
+    //! @brief  Destructor
+    ~CL_Terrain_Pyramid();
+
+
+    //! @brief  Deleted copy constructor
+    CL_Terrain_Pyramid(const CL_Terrain_Pyramid & other) = delete;
+
+
+    //! @brief  Deleted assignment operator
+    CL_Terrain_Pyramid & operator=(const CL_Terrain_Pyramid & other) = delete;
+
+
+    //! @brief  Fit every level from a height map on the device
+    void build(const Device_Buffer & heights);
+
+
+    //! @brief  Fit the cells above a rectangle of a height map on the device that has changed
+    //!
+    //! @detail Throws std::out_of_range if the rectangle is not inside the height map.
+    void refit(const Device_Buffer & heights, const Buffer::Region & region);
+
+
+    //! @brief  Get the packed levels. Only the device copy is current; call from_device to read
+    //!         them on the host.
+    Device_Buffer & packed();
+
+private:
+
+    //! @brief  Fit the cells above a rectangle of the height map, level by level
+    void fit(const Device_Buffer & heights, const Buffer::Region & region);
+
+    //! The OpenCL context to use
+    std::shared_ptr<cl::Context> m_ctx;
+
+    //! The command queue of the first device of the context
+    cl::CommandQueue m_queue;
+
+    //! The fitting kernel
+    std::unique_ptr<Kernel_Collection> m_kernels;
+
+    //! The (rows, cols) of each level, including level 0
+    std::vector<std::pair<uint32_t, uint32_t>> m_sizes;
+
+    //! The index of the first cell of each level in m_packed. Entry 0 is unused.
+    std::vector<size_t> m_offsets;
+
+    //! Every level above the height map
+    std::unique_ptr<Device_Buffer> m_packed;
+};
+
+}
@@ -9,9 +9,12 @@
 // CLarity imports
 
 // Standard imports
+#include <future>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
 
 // Third-party imports
@@ -35,21 +38,117 @@ enum Execution_Target
 std::vector<cl::Platform> find_supported_platforms();
 
 
-//! @brief      Get the first context
+//! @brief      Get the context of the process-wide CL_Runtime
+//!
+//! @detail     Every call returns the same context while any caller still holds it, so the
+//!             context and its queues are only created once per process.
 std::shared_ptr<cl::Context> get_context();
 
 
+//! @brief      The OpenCL state shared by every CLarity object in a process.
+//!
+//! @detail     The runtime owns a context over the devices of the first supported platform, a
+//!             command queue for each of those devices, and a cache of built programs. It is
+//!             reference-counted: instance() returns the live runtime if there is one and
+//!             creates it otherwise, and the runtime is released with its last reference. The
+//!             context and queues are created on first use, so a runtime that only builds
+//!             programs for other contexts never touches the default platform.
+//!
+//!             Programs are built from one source file each, on a background thread, and cached
+//!             by context and file, so any number of objects that use the same kernels pay for
+//!             one compilation. A cl::Kernel holds its arguments, so each Kernel_Collection
+//!             still makes its own kernels from the shared program.
+//!
+//!             All member functions are thread-safe.
+class CL_Runtime : public std::enable_shared_from_this<CL_Runtime>
+{
+public:
+
+    //! @brief  Get the process-wide runtime, creating it if no one holds it
+    static std::shared_ptr<CL_Runtime> instance();
+
+
+    //! @brief  Destructor
+    ~CL_Runtime();
+
+
+    //! @brief  Deleted copy constructor
+    CL_Runtime(const CL_Runtime & other) = delete;
+
+
+    //! @brief  Deleted assignment operator
+    CL_Runtime & operator=(const CL_Runtime & other) = delete;
+
+
+    //! @brief  Get the shared context. The runtime lives at least as long as the context.
+    std::shared_ptr<cl::Context> context();
+
+
+    //! @brief  Get the devices of the shared context
+    const std::vector<cl::Device> & devices();
+
+
+    //! @brief  Get the command queue of each device of the shared context, in device order
+    const std::vector<cl::CommandQueue> & queues();
+
+
+    //! @brief  Get the program of a source file, starting its build on first request
+    //!
+    //! @detail The source is read before returning, so a missing file throws here. A build
+    //!         error is rethrown by the future.
+    //!
+    //! @param[in]  ctx     the context to build the program for
+    //! @param[in]  path    the source file
+    //!
+    //! @return a future that becomes ready once the program has been built
+    std::shared_future<cl::Program> program(const cl::Context & ctx, const std::string & path);
+
+private:
+
+    //! @brief  Constructor. Use instance().
+    CL_Runtime();
+
+
+    //! @brief  Create the context and queues if they do not exist. m_mutex must be held.
+    void init();
+
+    //! Guards the members below it
+    std::mutex m_mutex;
+
+    //! The shared context, or null until first use
+    std::unique_ptr<cl::Context> m_ctx;
+
+    //! The devices of the shared context
+    std::vector<cl::Device> m_devices;
+
+    //! The command queue of each device
+    std::vector<cl::CommandQueue> m_queues;
+
+    //! The programs that have been built or are being built, by context and source file
+    std::map<std::pair<cl_context, std::string>, std::shared_future<cl::Program>> m_programs;
+};
+
+
 //! @brief      Simple wrapper around cl::Program to manage construction of program and retrieve
 //!             kernels.
+//!
+//! @detail     The program of each source file starts building in the background as soon as
+//!             the collection is created, and get() only waits for the program of the kernel
+//!             asked for. The owner can therefore do other set-up, such as loading a terrain,
+//!             while the kernels compile. A Kernel_Collection is not itself thread-safe.
 class Kernel_Collection
 {
 public:
 
     //! @brief  Cosntructor for the Kernel_Collection class
     //!
+    //! @detail The programs are taken from the CL_Runtime cache, so each file is only built the
+    //!         first time it is used with a context. Throws if a file cannot be read.
+    //!
     //! @param[in]  ctx             the OpenCL Context to use to construct the kernels
     //! @param[in]  kernel_files    a mapping from kernel name to implementation file path. Paths
-    //!                             can be relative to the pwd or absolute paths
+    //!                             can be relative to the pwd or absolute paths. Several kernels
+    //!                             may share a file.
     Kernel_Collection(const cl::Context & ctx, 
                       const std::map<std::string, std::string> & kernel_files);
 
@@ -67,13 +166,19 @@ public:
 
 
     //! @brief  Retrieve a kernel based on the name
+    //!
+    //! @detail Blocks until the program of the kernel has been built. Throws if the build failed
+    //!         or the program has no kernel of that name.
     cl::Kernel & get(const std::string & kernel_name);
 
 private:
-    //! The program that encapsulates the kernels
-    std::unique_ptr<cl::Program> m_program;
+    //! The runtime that caches the programs
+    std::shared_ptr<CL_Runtime> m_runtime;
+
+    //! The program of each kernel that has not been retrieved yet
+    std::map<std::string, std::shared_future<cl::Program>> m_pending;
 
-    //! The kernels in the program
+    //! The kernels that have been retrieved
     std::map<std::string, cl::Kernel> m_kernels;
 };
 
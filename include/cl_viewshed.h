@@ -0,0 +1,100 @@
+//! @file       cl_viewshed.h
+//! @brief      Declares an implementation of Viewshed that uses OpenCL kernels
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+#pragma once
+
+// CLarity Imports
+#include "buffer.h"
+#include "cl_utils.h"
+#include "device_buffer.h"
+#include "residency_manager.h"
+#include "terrain.h"
+#include "viewshed.h"
+
+// Standard Imports
+#include <memory>
+
+// Third-Party Imports
+#include "cl.hpp"
+
+
+namespace clarity
+{
+
+//! @brief  Implementation of Viewshed that sweeps each octant with one OpenCL work group.
+//!
+//! @detail The work items of a group share the cells of each ring, so a ring costs its length
+//!         divided by the group size. A Terrain backed by a Device_Buffer is swept in place,
+//!         after the rectangles edited since its last upload are sent. Any other Terrain is made
+//!         resident through a Residency_Manager, as by CL_Range_Calculator. If the output is a
+//!         Device_Buffer it is written on the device and then copied to the host; any other
+//!         Buffer is filled from a device buffer owned by this object.
+class CL_Viewshed : public Viewshed
+{
+public:
+    //! @brief  Constructor
+    //!
+    //! @param[in]  ctx     The OpenCL context to use. The sweep runs on its first device.
+    explicit CL_Viewshed(const std::shared_ptr<cl::Context> ctx);
+
+
+    //! @brief  Destructor
+    ~CL_Viewshed();
+
+
+    //! @brief  Deleted copy constructor
+    CL_Viewshed(const CL_Viewshed & other) = delete;
+
+
+    //! @brief  Deleted assignment operator
+    CL_Viewshed & operator=(const CL_Viewshed & other) = delete;
+
+
+    //! @brief  See Viewshed::Compute
+    void Compute(const Terrain & t, const Position & observer, Buffer & visible);
+
+
+    //! @brief  Share a Residency_Manager with other objects, so they upload each terrain once
+    //!         between them and share one device-memory budget
+    //!
+    //! @param[in]  residency   the manager. It must use the context of this object.
+    void set_residency(const std::shared_ptr<Residency_Manager> residency);
+
+
+    //! @brief  Get the Residency_Manager that holds the terrains of this object
+    std::shared_ptr<Residency_Manager> residency() const;
+
+private:
+
+    //! @brief  Get the device copy of the height map of a Terrain, making it resident if the
+    //!         Terrain is not backed by a Device_Buffer and uploading its dirty rectangles if it
+    //!         is
+    const Device_Buffer & device_terrain(const Terrain & t);
+
+
+    //! The OpenCL context to use
+    std::shared_ptr<cl::Context> m_ctx;
+
+    //! The command queue of the first device of the context
+    cl::CommandQueue m_queue;
+
+    //! The viewshed kernel
+    std::unique_ptr<Kernel_Collection> m_kernels;
+
+    //! The horizons of the rings being swept, grown as needed
+    std::unique_ptr<Device_Buffer> m_horizon;
+
+    //! The output of the last sweep, when the caller's Buffer is not a Device_Buffer
+    std::unique_ptr<Device_Buffer> m_visible;
+
+    //! The device copies of the terrains that are not backed by a Device_Buffer
+    std::shared_ptr<Residency_Manager> m_residency;
+
+    //! The device copy of the last such terrain, held while it is in use
+    std::shared_ptr<Device_Buffer> m_terrain;
+};
+
+}
@@ -0,0 +1,87 @@
+//! @file       counter_rng.h
+//! @brief      Declares a counter-based random number generator for procedural generation
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+#pragma once
+
+// CLarity Imports
+
+// Standard Imports
+#include <cstdint>
+
+// Third-Party Imports
+
+namespace clarity
+{
+
+//! @brief  A stateless random number generator keyed by (seed, level, row, col).
+//!
+//! @detail Each value is a hash of its key rather than the next draw from a stream, so cells can
+//!         be generated in any order, on any number of threads, and get the same value. Only
+//!         integer operations and exact float conversions are used, so the OpenCL kernels can
+//!         reproduce the values bit for bit - see ds_uniform in diamond_square.cl, which must be
+//!         kept in step with this file.
+namespace counter_rng
+{
+
+//! @brief  The SplitMix64 finalizer. Every input bit affects every output bit.
+inline uint64_t mix(uint64_t x)
+{
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+
+//! @brief  Hash a key to 64 random bits
+//!
+//! @param[in]  seed    the seed of the whole generation
+//! @param[in]  level   the pass or octave the value belongs to. Must be less than 64.
+//! @param[in]  row     the row of the cell. Must be less than 2^29.
+//! @param[in]  col     the col of the cell. Must be less than 2^29.
+inline uint64_t hash(const uint64_t seed, const uint32_t level, const uint32_t row,
+                     const uint32_t col)
+{
+    const uint64_t cell = (static_cast<uint64_t>(level) << 58)
+                        ^ (static_cast<uint64_t>(row) << 29)
+                        ^ col;
+    return mix(seed ^ mix(cell + 0x9e3779b97f4a7c15ull));
+}
+
+
+//! @brief  A 32-bit finalizer (lowbias32). Cheaper than mix in vector code, where 64-bit
+//!         multiplies are slow.
+inline uint32_t mix32(uint32_t x)
+{
+    x = (x ^ (x >> 16)) * 0x7feb352du;
+    x = (x ^ (x >> 15)) * 0x846ca68bu;
+    return x ^ (x >> 16);
+}
+
+
+//! @brief  Hash a key to 32 random bits. Rows and cols wrap at 2^32.
+//!
+//! @param[in]  seed    the seed of the whole generation
+//! @param[in]  level   the pass or octave the value belongs to
+//! @param[in]  row     the row of the cell
+//! @param[in]  col     the col of the cell
+inline uint32_t hash32(const uint64_t seed, const uint32_t level, const uint32_t row,
+                       const uint32_t col)
+{
+    const uint32_t key = mix32(static_cast<uint32_t>(seed ^ (seed >> 32)) ^ (level * 0x9e3779b9u));
+    return mix32(mix32(key ^ row) + col);
+}
+
+
+//! @brief  Get a uniformly distributed float in [-1, 1) with 24 bits of randomness
+inline float uniform(const uint64_t seed, const uint32_t level, const uint32_t row,
+                     const uint32_t col)
+{
+    const int32_t bits = static_cast<int32_t>(hash(seed, level, row, col) >> 40);
+    return static_cast<float>(bits - (1 << 23)) * (1.0f / (1 << 23));
+}
+
+}
+}
@@ -0,0 +1,59 @@
+//! @file       cpu_line_of_sight.h
+//! @brief      Declares an implementation of Line_Of_Sight that uses the CPU
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+#pragma once
+
+// CLarity Imports
+#include "line_of_sight.h"
+#include "terrain.h"
+#include "thread_pool.h"
+
+// Standard Imports
+#include <cstdint>
+#include <vector>
+
+// Third-Party Imports
+
+
+namespace clarity
+{
+
+//! @brief  An implementation of Line_Of_Sight for the CPU. Lines are spread over a Thread_Pool.
+class CPU_Line_Of_Sight : public Line_Of_Sight
+{
+public:
+    //! @brief  Constructor
+    //!
+    //! @param[in]  num_threads     the number of threads to use. 0 uses every hardware thread.
+    explicit CPU_Line_Of_Sight(const unsigned num_threads = 0);
+
+
+    //! @brief  Destructor
+    ~CPU_Line_Of_Sight();
+
+
+    //! @brief  Deleted copy constructor
+    CPU_Line_Of_Sight(const CPU_Line_Of_Sight & other) = delete;
+
+
+    //! @brief  Deleted assignment operator
+    CPU_Line_Of_Sight & operator=(const CPU_Line_Of_Sight & other) = delete;
+
+
+    //! @brief  See Line_Of_Sight::Check
+    void Check(const Terrain & t,
+               const std::vector<Point> & observers,
+               const std::vector<Point> & targets,
+               std::vector<uint8_t> & visible,
+               std::vector<float> & distance);
+
+private:
+
+    //! The threads that walk the lines
+    Thread_Pool m_pool;
+};
+
+}
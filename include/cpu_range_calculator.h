@@ -62,6 +62,69 @@ public:
                        const Buffer & world_coords, 
                        Buffer & rng);
 
+
+    //! @brief  See Range_Calculator::Calculate_Hits
+    void Calculate_Hits(const Camera & cam, const Terrain & t, Buffer & hits);
+
+
+    //! @brief  See Range_Calculator::Calculate_Pixels
+    void Calculate_Pixels(const Camera & cam, 
+                          const Terrain & t, 
+                          const std::vector<Pixel> & pixels, 
+                          std::vector<float> & ranges);
+
+
+    //! @brief  See Range_Calculator::Calculate_Pixels
+    void Calculate_Pixels(const Camera & cam, 
+                          const Terrain & t, 
+                          const std::vector<Pixel> & pixels, 
+                          const std::vector<float> & start,
+                          std::vector<float> & ranges);
+
+
+    //! @brief  See Range_Calculator::Calculate_Region
+    void Calculate_Region(const Camera & cam, 
+                          const Terrain & t, 
+                          const uint32_t row0, 
+                          const uint32_t col0, 
+                          Buffer & rng);
+
+
+    //! @brief  Set the level-of-detail error budget
+    //!
+    //! @detail When the Terrain has a pyramid (see Terrain::build_pyramid) and the budget is
+    //!         positive, each ray moves to coarser pyramid levels, with proportionally larger
+    //!         steps, as its footprint grows. Heights are taken from the maximum of each cell,
+    //!         so a ray never passes through terrain; it may stop up to a cell diagonal early.
+    //!
+    //! @param[in]  pixels  the largest error allowed at any range, in pixels. 0 disables LOD.
+    void set_lod_error_budget(const float pixels);
+
+
+    //! @brief  Get the level-of-detail error budget, in pixels
+    float lod_error_budget() const;
+
+private:
+
+    //! @brief  Walk the ray of each pixel of world_coords, writing the range image, the hit
+    //!         image, or both
+    //!
+    //! @param[out] rng     the range image, or null
+    //! @param[out] hits    the hit image, or null
+    //! @param[in]  lod     whether the level-of-detail budget applies. Must be false if hits
+    //!                     or start is given.
+    //! @param[in]  start   the range at which to start walking each ray, in meters, or null to
+    //!                     start at the Camera
+    void march(const Camera & cam, 
+               const Terrain & t, 
+               const Buffer & world_coords, 
+               Buffer * rng,
+               Buffer * hits,
+               const bool lod,
+               const float * start = nullptr);
+
+    //! The level-of-detail error budget, in pixels
+    float m_lod_error;
 };
 
 }
@@ -0,0 +1,60 @@
+//! @file       cpu_range_display.h
+//! @brief      Declares an implementation of Range_Display that runs on the CPU
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+#pragma once
+
+// CLarity Imports
+#include "buffer.h"
+#include "range_display.h"
+#include "thread_pool.h"
+
+// Standard Imports
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Third-Party Imports
+
+
+namespace clarity
+{
+
+//! @brief  Implementation of Range_Display that converts rows in parallel with vector code.
+//!
+//! @detail The image is reduced to its minimum and maximum in one pass and converted in a
+//!         second, each split across the threads of a Thread_Pool.
+class CPU_Range_Display : public Range_Display
+{
+public:
+    //! @brief  Constructor
+    //!
+    //! @param[in]  num_threads     the number of threads to use. 0 selects the number of
+    //!                             hardware threads.
+    explicit CPU_Range_Display(const unsigned num_threads = 0);
+
+
+    //! @brief  Destructor
+    ~CPU_Range_Display();
+
+
+    //! @brief  Deleted copy constructor
+    CPU_Range_Display(const CPU_Range_Display & other) = delete;
+
+
+    //! @brief  Deleted assignment operator
+    CPU_Range_Display & operator=(const CPU_Range_Display & other) = delete;
+
+
+    //! @brief  See Range_Display::Convert
+    std::pair<float, float> Convert(const Buffer & rng, std::vector<uint8_t> & rgba);
+
+private:
+
+    //! The threads that share the rows
+    Thread_Pool m_pool;
+};
+
+}
@@ -0,0 +1,54 @@
+//! @file       cpu_viewshed.h
+//! @brief      Declares an implementation of Viewshed that uses the CPU
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+#pragma once
+
+// CLarity Imports
+#include "buffer.h"
+#include "terrain.h"
+#include "thread_pool.h"
+#include "viewshed.h"
+
+// Standard Imports
+
+// Third-Party Imports
+
+
+namespace clarity
+{
+
+//! @brief  An implementation of Viewshed for the CPU. Each octant is swept by its own thread.
+class CPU_Viewshed : public Viewshed
+{
+public:
+    //! @brief  Constructor
+    //!
+    //! @param[in]  num_threads     the number of threads to use. 0 uses every hardware thread.
+    explicit CPU_Viewshed(const unsigned num_threads = 0);
+
+
+    //! @brief  Destructor
+    ~CPU_Viewshed();
+
+
+    //! @brief  Deleted copy constructor
+    CPU_Viewshed(const CPU_Viewshed & other) = delete;
+
+
+    //! @brief  Deleted assignment operator
+    CPU_Viewshed & operator=(const CPU_Viewshed & other) = delete;
+
+
+    //! @brief  See Viewshed::Compute
+    void Compute(const Terrain & t, const Position & observer, Buffer & visible);
+
+private:
+
+    //! The threads that sweep the octants
+    Thread_Pool m_pool;
+};
+
+}
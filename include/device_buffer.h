@@ -11,6 +11,10 @@
 #include "buffer.h"
 
 // Standard Imports
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 
 // Third-Party Imports
 #include "cl.hpp"
@@ -20,6 +24,10 @@ namespace clarity
 
 //! @brief  Defines a subtype of Buffer that has facilities for buffering the data to/from an
 //!         OpenCL device.
+//!
+//! @detail Each device copy remembers the dirty generation of the host data it holds, so
+//!         several device copies of one Buffer each upload every rectangle they have not seen.
+//!         Copies of a Device_Buffer share the device memory, and so share that generation.
 class Device_Buffer : public Buffer
 {
 public:
@@ -68,12 +76,26 @@ public:
 
     //! @brief  Copy the data from the host to the device buffer.
     //!
-    //! @detail This call is blocking
+    //! @detail This call is blocking. The device copy is then current with every dirty
+    //!         rectangle; see Buffer::clear_dirty.
     //!
     //! @param[in]  queue   Optinal command queue to use. The default will be used otherwise
     void to_device(const cl::CommandQueue * queu = nullptr);
 
 
+    //! @brief  Copy only the dirty rectangles that this device copy has not uploaded from the
+    //!         host to the device buffer
+    //!
+    //! @detail This call is blocking. Each rectangle is one enqueueWriteBufferRect, so an edit
+    //!         of a small patch of a large Buffer costs the patch rather than the Buffer. Other
+    //!         device copies of the Buffer still see the rectangles until they upload them.
+    //!
+    //! @param[in]  queue   Optinal command queue to use. The default will be used otherwise
+    //!
+    //! @return the number of cells copied
+    size_t to_device_dirty(const cl::CommandQueue * queue = nullptr);
+
+
     inline const cl::Buffer & get_cl_buffer() const { return m_cl_buffer; }
 
 private:
@@ -82,6 +104,9 @@ private:
 
     //! The OpenCL buffer
     cl::Buffer m_cl_buffer;
+
+    //! The dirty generation of the host data in m_cl_buffer
+    std::shared_ptr<std::atomic<uint64_t>> m_synced;
 };
 
 }
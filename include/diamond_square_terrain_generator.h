@@ -11,8 +11,10 @@
 #include "buffer.h"
 #include "terrain.h"
 #include "terrain_generator.h"
+#include "thread_pool.h"
 
 // Standard Imports
+#include <cstdint>
 
 // Third-Party Imports
 
@@ -22,6 +24,10 @@ namespace clarity
 //! An implementation of Terrain_Generator based on the Diamond-Square algorithm for fractal
 //! terrain generation.
 //!
+//! Each pass of the algorithm is spread over a Thread_Pool. Random offsets come from a
+//! counter_rng keyed by the seed and the cell, so a given seed produces the same terrain
+//! regardless of the number of threads.
+//!
 //! References:
 //!     Hunter Loftis: http://www.playfuljs.com/realistic-terrain-in-130-lines/
 //!     https://en.wikipedia.org/wiki/Diamond-square_algorithm
@@ -29,9 +35,18 @@ class Diamond_Square_Generator : public Terrain_Generator
 {
 public:
     
+    //! @brief  Construct a generator with a random seed, using every hardware thread
     Diamond_Square_Generator();
 
 
+    //! @brief  Construct a generator with an explicit seed
+    //!
+    //! @param[in]  seed            the seed. Equal seeds generate equal terrain.
+    //! @param[in]  num_threads     the number of threads to use. 0 selects the number of
+    //!                             hardware threads.
+    explicit Diamond_Square_Generator(const uint64_t seed, const unsigned num_threads = 0);
+
+
     ~Diamond_Square_Generator();
 
 
@@ -44,8 +59,22 @@ public:
                              const float scale, 
                              const float roughness);
 
+
+    //! @brief  Get the seed used to generate terrain
+    uint64_t seed() const;
+
+
+    //! @brief  Set the seed used to generate terrain
+    void set_seed(const uint64_t seed);
+
 private:
     static constexpr float MAX_HEIGHT_M = 100;
+
+    //! The seed of the random offsets
+    uint64_t m_seed;
+
+    //! The threads that process each pass
+    Thread_Pool m_pool;
 };
 
 }
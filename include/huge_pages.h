@@ -0,0 +1,64 @@
+//! @file       huge_pages.h
+//! @brief      Declares utilities for backing large allocations with huge pages
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+#pragma once
+
+// CLarity Imports
+
+// Standard Imports
+#include <cstddef>
+#include <memory>
+
+// Third-Party Imports
+
+namespace clarity
+{
+namespace huge_pages
+{
+
+//! @brief  The size of the huge pages that are asked for, in bytes
+static constexpr size_t PAGE_BYTES = 2u << 20;
+
+
+//! @brief  How an allocation is backed
+enum Backing
+{
+    //! Ordinary pages. Either huge pages were not asked for, or the request was refused.
+    STANDARD = 0,
+
+    //! Transparent huge pages. The kernel agreed to back the memory with huge pages where it
+    //! can find them, but may still use ordinary pages for parts of it.
+    TRANSPARENT = 1,
+
+    //! Pages from the reserved huge-page pool. Every page is a huge page.
+    EXPLICIT = 2
+};
+
+
+//! @brief  Allocate memory, backed by huge pages if the system allows it
+//!
+//! @detail Pages from the reserved pool are tried first, then transparent huge pages on a
+//!         mapping aligned to a huge page. If neither is available, or the allocation is
+//!         smaller than a huge page, ordinary pages are used. The memory is not initialized,
+//!         and huge pages are only placed as it is first written.
+//!
+//! @param[in]  count       the number of floats
+//! @param[out] backing     how the memory is backed
+std::shared_ptr<float> allocate(const size_t count, Backing & backing);
+
+
+//! @brief  Get the number of bytes of a range of memory that are resident in huge pages
+//!
+//! @detail Read from /proc/self/smaps, so the count is for each whole mapping that overlaps the
+//!         range. Returns 0 where this cannot be read.
+size_t resident_bytes(const void * addr, const size_t bytes);
+
+
+//! @brief  Get a readable name for a backing
+const char * name(const Backing backing);
+
+}
+}
@@ -0,0 +1,150 @@
+//! @file       hybrid_range_calculator.h
+//! @brief      Declares an implementation of Range_Calculator that splits each frame between
+//!             CPU threads and a device calculator
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+#pragma once
+
+// CLarity Imports
+#include "buffer.h"
+#include "camera.h"
+#include "cl_utils.h"
+#include "cpu_range_calculator.h"
+#include "range_calculator.h"
+#include "terrain.h"
+#include "thread_pool.h"
+
+// Standard Imports
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Third-Party Imports
+
+
+namespace clarity
+{
+
+//! @brief  Implementation of Range_Calculator that shares each frame between the CPU and a
+//!         device.
+//!
+//! @detail The rows of each frame are split in two. The device calculator, typically a
+//!         CL_Range_Calculator, computes the top rows on a thread of its own while the CPU
+//!         computes the rest in bands spread over a Thread_Pool. After each frame the split is
+//!         moved toward the ratio of the rows per second each side achieved, so both finish at
+//!         about the same time. Each side always keeps a small share, so its throughput keeps
+//!         being measured.
+//!
+//!         Every ray is walked at full detail, as Calculate_Region does, so the image matches
+//!         Calculate with LOD disabled. The Terrain must suit both sides; a Terrain backed by a
+//!         Device_Buffer suits both the CPU and OpenCL. The range image is written on the
+//!         host; a Device_Buffer output is then copied to the device. The image runs top-down,
+//!         as on the CPU; the rows of a device whose image runs bottom-up are flipped into place.
+//!
+//!         Calculate_Pixels is split by the current share. Camera and world coordinates,
+//!         Compute_Range and Calculate_Hits run on the CPU alone.
+class Hybrid_Range_Calculator : public Range_Calculator
+{
+public:
+    //! @brief  Constructor
+    //!
+    //! @param[in]  device          the calculator that shares the frame with the CPU
+    //! @param[in]  num_threads     the number of CPU threads to use. 0 selects the number of
+    //!                             hardware threads.
+    explicit Hybrid_Range_Calculator(std::unique_ptr<Range_Calculator> device,
+                                     const unsigned num_threads = 0);
+
+
+    //! @brief  Destructor
+    ~Hybrid_Range_Calculator();
+
+
+    //! @brief  Deleted copy constructor
+    Hybrid_Range_Calculator(const Hybrid_Range_Calculator & other) = delete;
+
+
+    //! @brief  Deleted assignment operator
+    Hybrid_Range_Calculator & operator=(const Hybrid_Range_Calculator & other) = delete;
+
+
+    //! @brief  See Range_Calculator::Calculate
+    void Calculate(const Camera & cam, const Terrain & t, Buffer & rng);
+
+
+    //! @brief  See Range_Calculator::Convert_Pixel_To_Camera_Coordinates
+    void Convert_Pixel_To_Camera_Coordinates(const Camera & cam, Buffer & cam_coords);
+
+
+    //! @brief  See Range_Calculator::Convert_Camera_To_World_Coordinates
+    void Convert_Camera_To_World_Coordinates(const Camera & cam, 
+                                             const Buffer & cam_coords, 
+                                             Buffer & world_coords);
+
+
+    //! @brief  See Range_Calculator::Compute_Range
+    void Compute_Range(const Camera & cam, 
+                       const Terrain & t, 
+                       const Buffer & world_coords, 
+                       Buffer & rng);
+
+
+    //! @brief  See Range_Calculator::Calculate_Hits
+    void Calculate_Hits(const Camera & cam, const Terrain & t, Buffer & hits);
+
+
+    //! @brief  See Range_Calculator::Calculate_Pixels
+    void Calculate_Pixels(const Camera & cam, 
+                          const Terrain & t, 
+                          const std::vector<Pixel> & pixels, 
+                          std::vector<float> & ranges);
+
+
+    //! @brief  See Range_Calculator::Calculate_Pixels
+    void Calculate_Pixels(const Camera & cam, 
+                          const Terrain & t, 
+                          const std::vector<Pixel> & pixels, 
+                          const std::vector<float> & start,
+                          std::vector<float> & ranges);
+
+
+    //! @brief  See Range_Calculator::Calculate_Region. The rows are split and the share is
+    //!         rebalanced, as for Calculate.
+    void Calculate_Region(const Camera & cam, 
+                          const Terrain & t, 
+                          const uint32_t row0, 
+                          const uint32_t col0, 
+                          Buffer & rng);
+
+
+    //! @brief  Get the fraction of the rows of the next frame that will go to one side
+    //!
+    //! @param[in]  target  CPU for the CPU threads, GPU for the device calculator
+    float share(const Execution_Target target) const;
+
+private:
+
+    //! @brief  Compute ranges at pixels, split between the two sides by the current share
+    //!
+    //! @param[in]  start   the start of each walk, or null to start at the Camera
+    void split_pixels(const Camera & cam, 
+                      const Terrain & t, 
+                      const std::vector<Pixel> & pixels, 
+                      const std::vector<float> * start,
+                      std::vector<float> & ranges);
+
+    //! The calculator that shares the frame with the CPU
+    std::unique_ptr<Range_Calculator> m_device;
+
+    //! The calculator for the CPU rows. Each band of rows is a separate call from the pool.
+    CPU_Range_Calculator m_cpu;
+
+    //! The threads that compute the CPU rows
+    Thread_Pool m_pool;
+
+    //! The fraction of each frame's rows given to the device
+    float m_device_share;
+};
+
+}
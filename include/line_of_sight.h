@@ -0,0 +1,64 @@
+//! @file       line_of_sight.h
+//! @brief      Declares the batched line-of-sight API
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+#pragma once
+
+// CLarity Imports
+#include "terrain.h"
+
+// Standard Imports
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+// Third-Party Imports
+
+
+namespace clarity
+{
+
+//! @brief  The interface for batched line-of-sight (intervisibility) queries.
+//!
+//! @detail Each query is a line from an observer to a target. The line is walked through the
+//!         height map in steps of a fifth of a cell, like the rays of a Range_Calculator, and is
+//!         blocked by the first step at or below the terrain. Steps within one step of the
+//!         target are not tested, so a target resting on the ground can be seen.
+//!
+//!         When the Terrain has a pyramid (see Terrain::build_pyramid), the walk skips over
+//!         any block of the pyramid that the line passes entirely above. The skipped steps
+//!         could not have been blocked, so the results are the same as without the pyramid.
+//!
+//!         This is a pure-virtual class; concrete implementations provide the walk.
+class Line_Of_Sight
+{
+public:
+    //! @brief  A point in world coordinates, in meters
+    typedef std::tuple<float, float, float> Point;
+
+
+    //! @brief  Destructor
+    virtual ~Line_Of_Sight()
+    {
+        // No-op
+    }
+
+
+    //! @brief  Test whether each target can be seen from its observer
+    //!
+    //! @param[in]  t           the terrain. Must not be procedural.
+    //! @param[in]  observers   the start of each line
+    //! @param[in]  targets     the end of each line. Must be the same length as observers.
+    //! @param[out] visible     1 if the line is clear, 0 if it is blocked. Resized to match.
+    //! @param[out] distance    the distance from the observer to the first blocking step, or
+    //!                         to the target if the line is clear, in meters. Resized to match.
+    virtual void Check(const Terrain & t,
+                       const std::vector<Point> & observers,
+                       const std::vector<Point> & targets,
+                       std::vector<uint8_t> & visible,
+                       std::vector<float> & distance) = 0;
+};
+
+}
@@ -0,0 +1,88 @@
+//! @file       noise.h
+//! @brief      Declares gradient noise functions for procedural terrain
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+#pragma once
+
+// CLarity Imports
+#include "buffer.h"
+
+// Standard Imports
+#include <cstdint>
+
+// Third-Party Imports
+
+namespace clarity
+{
+
+//! @brief  Parameters of fractal (fBm) gradient noise
+struct Noise_Params
+{
+    //! The seed. Equal seeds produce equal heights.
+    uint64_t seed;
+
+    //! The period of the coarsest octave, in cells. Must be a power of two, at least 2.
+    uint32_t feature_size;
+
+    //! The number of octaves. Each halves the period of the last; octaves with a period of less
+    //! than 2 cells are dropped.
+    uint32_t octaves;
+
+    //! The amplitude of the coarsest octave, in meters
+    float amplitude;
+
+    //! The ratio of the amplitude of each octave to the one before it
+    float persistence;
+};
+
+
+//! @brief  Fractal gradient noise evaluated at integer cell coordinates.
+//!
+//! @detail Heights are a pure function of (seed, row, col), so any region of an unbounded
+//!         world can be generated independently and neighbouring regions join seamlessly.
+//!         Lattice coordinates are computed with integer shifts, so there is no loss of
+//!         precision far from the origin.
+namespace noise
+{
+
+//! @brief  Check the parameters, throwing std::invalid_argument if they are unusable
+void validate(const Noise_Params & params);
+
+
+//! @brief  Get the height of a single cell, in meters. The parameters are not validated.
+//!
+//! @param[in]  params  the noise parameters
+//! @param[in]  row     the global row of the cell
+//! @param[in]  col     the global col of the cell
+float height(const Noise_Params & params, const int64_t row, const int64_t col);
+
+
+//! @brief  Fill a run of cells in one row. Vectorized; the parameters are not validated.
+//!
+//! @detail The result is bit-identical to calling height() for each cell.
+//!
+//! @param[in]  params  the noise parameters
+//! @param[in]  row     the global row of the cells
+//! @param[in]  col0    the global col of the first cell
+//! @param[in]  count   the number of cells
+//! @param[out] out     the heights, in meters
+void fill_row(const Noise_Params & params,
+              const int64_t row,
+              const int64_t col0,
+              const uint32_t count,
+              float * const out);
+
+
+//! @brief  Fill a Buffer with the heights of a rectangular region
+//!
+//! @param[in]  params  the noise parameters
+//! @param[in]  row0    the global row of the first row of the Buffer
+//! @param[in]  col0    the global col of the first col of the Buffer
+//! @param[out] out     the Buffer to fill. Its size sets the size of the region.
+void fill(const Noise_Params & params, const int64_t row0, const int64_t col0, Buffer & out);
+
+}
+
+}
@@ -0,0 +1,88 @@
+//! @file       noise_terrain_generator.h
+//! @brief      Declares an implementation of Terrain_Generator that samples fractal gradient
+//!             noise
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+#pragma once
+
+// CLarity Imports
+#include "buffer.h"
+#include "noise.h"
+#include "terrain.h"
+#include "terrain_generator.h"
+#include "thread_pool.h"
+
+// Standard Imports
+#include <cstdint>
+#include <memory>
+
+// Third-Party Imports
+
+namespace clarity 
+{
+
+//! @brief  An implementation of Terrain_Generator based on multi-octave gradient noise.
+//!
+//! @detail Unlike Diamond_Square_Generator, every cell is independent of the others, so maps
+//!         can be any rectangular size and any region of the unbounded noise field can be
+//!         generated on its own. Rows are spread over a Thread_Pool and each row is vectorized.
+//!         The output depends only on the parameters, not on the number of threads.
+class Noise_Terrain_Generator : public Terrain_Generator
+{
+public:
+
+    //! @brief  Constructor
+    //!
+    //! @param[in]  params          the noise parameters
+    //! @param[in]  num_threads     the number of threads to use. 0 selects the number of
+    //!                             hardware threads.
+    explicit Noise_Terrain_Generator(const Noise_Params & params, const unsigned num_threads = 0);
+
+
+    //! @brief  Destructor
+    ~Noise_Terrain_Generator();
+
+
+    //! @brief  See Terrain_Generator::generate_terrain. The map starts at cell (0, 0) of the
+    //!         noise field. roughness replaces the persistence of the parameters and is
+    //!         clamped to [0, 1].
+    Terrain generate_terrain(const uint32_t rows, 
+                             const uint32_t cols, 
+                             const float scale, 
+                             const float roughness);
+    
+
+    //! @brief  See Terrain_Generator::generate_terrain. The map starts at cell (0, 0) of the
+    //!         noise field. roughness replaces the persistence of the parameters and is
+    //!         clamped to [0, 1].
+    Terrain generate_terrain(std::shared_ptr<Buffer> buffer, 
+                             const float scale, 
+                             const float roughness);
+
+
+    //! @brief  Fill a Buffer with any region of the noise field, using the parameters as given
+    //!
+    //! @param[in]  row0    the global row of the first row of the Buffer
+    //! @param[in]  col0    the global col of the first col of the Buffer
+    //! @param[out] out     the Buffer to fill. Its size sets the size of the region.
+    void generate_tile(const int64_t row0, const int64_t col0, Buffer & out);
+
+
+    //! @brief  Get the noise parameters
+    const Noise_Params & params() const;
+
+private:
+
+    //! @brief  Fill a region with the given parameters
+    void fill(const Noise_Params & params, const int64_t row0, const int64_t col0, Buffer & out);
+
+    //! The noise parameters
+    Noise_Params m_params;
+
+    //! The threads that generate rows
+    Thread_Pool m_pool;
+};
+
+}
@@ -0,0 +1,77 @@
+//! @file       numa.h
+//! @brief      Declares utilities for placing memory and threads on the NUMA nodes of a machine
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+#pragma once
+
+// CLarity Imports
+
+// Standard Imports
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Third-Party Imports
+
+namespace clarity
+{
+namespace numa
+{
+
+//! @brief  How a NUMA-aware renderer places the terrain
+enum Placement
+{
+    //! One copy of the terrain, with its pages spread evenly over every node
+    INTERLEAVE = 0,
+
+    //! One copy of the terrain on each node, read only by the threads of that node
+    REPLICATE = 1
+};
+
+
+//! @brief  A NUMA node and the CPUs that belong to it
+struct Node
+{
+    //! The id of the node, as the kernel numbers it
+    unsigned id;
+
+    //! The CPUs of the node
+    std::vector<unsigned> cpus;
+};
+
+
+//! @brief  Get the NUMA nodes that have CPUs
+//!
+//! @detail On Linux the nodes are read from sysfs. Where they cannot be read, the machine is
+//!         reported as a single node holding every hardware thread, so callers need no
+//!         special case.
+std::vector<Node> topology();
+
+
+//! @brief  Allocate memory whose pages are interleaved over a set of nodes
+//!
+//! @detail The memory is mapped but not touched, so nothing is placed until it is first
+//!         written. Placement is a hint: where the kernel does not support it, the memory is
+//!         placed by the default first-touch policy.
+//!
+//! @param[in]  count   the number of floats
+//! @param[in]  nodes   the nodes to interleave over
+std::shared_ptr<float> allocate_interleaved(const size_t count, const std::vector<Node> & nodes);
+
+
+//! @brief  Allocate memory whose pages are placed on one node, as allocate_interleaved
+//!
+//! @param[in]  count   the number of floats
+//! @param[in]  node    the node to place the pages on
+std::shared_ptr<float> allocate_on_node(const size_t count, const Node & node);
+
+
+//! @brief  Pin the calling thread to a set of CPUs
+//!
+//! @return whether the thread was pinned
+bool pin_thread(const std::vector<unsigned> & cpus);
+
+}
+}
@@ -0,0 +1,160 @@
+//! @file       numa_range_calculator.h
+//! @brief      Declares an implementation of Range_Calculator that renders on the CPU with
+//!             NUMA-aware terrain placement and pinned threads
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+#pragma once
+
+// CLarity Imports
+#include "buffer.h"
+#include "camera.h"
+#include "cpu_range_calculator.h"
+#include "numa.h"
+#include "range_calculator.h"
+#include "terrain.h"
+#include "thread_pool.h"
+
+// Standard Imports
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Third-Party Imports
+
+
+namespace clarity
+{
+
+//! @brief  Implementation of Range_Calculator that keeps each NUMA node's threads on memory
+//!         local to that node.
+//!
+//! @detail Each node has a Thread_Pool with one worker pinned to each of its CPUs. The rows of
+//!         a frame are split into one contiguous tile per node, in proportion to its CPUs, and
+//!         each node renders its tile in bands with its own threads.
+//!
+//!         The terrain is copied into memory placed by numa::Placement: either one copy per
+//!         node, or one copy interleaved over every node. Each copy is first written by the
+//!         pinned threads of the nodes that will read it, in parallel, so its pages land where
+//!         they are used. The copy is made when a Terrain's height map is first seen, and again
+//!         whenever a different height map is used; call invalidate() after editing a height
+//!         map in place. A procedural Terrain is rendered as it is.
+//!
+//!         Every ray is walked at full detail, so the image matches CPU_Range_Calculator with
+//!         LOD disabled. Entry points other than Calculate and Calculate_Region run on the
+//!         calling thread with the caller's Terrain.
+class NUMA_Range_Calculator : public Range_Calculator
+{
+public:
+    //! @brief  Constructor
+    //!
+    //! @param[in]  placement   how to place the terrain
+    explicit NUMA_Range_Calculator(const numa::Placement placement = numa::REPLICATE);
+
+
+    //! @brief  Destructor
+    ~NUMA_Range_Calculator();
+
+
+    //! @brief  Deleted copy constructor
+    NUMA_Range_Calculator(const NUMA_Range_Calculator & other) = delete;
+
+
+    //! @brief  Deleted assignment operator
+    NUMA_Range_Calculator & operator=(const NUMA_Range_Calculator & other) = delete;
+
+
+    //! @brief  See Range_Calculator::Calculate
+    void Calculate(const Camera & cam, const Terrain & t, Buffer & rng);
+
+
+    //! @brief  See Range_Calculator::Convert_Pixel_To_Camera_Coordinates
+    void Convert_Pixel_To_Camera_Coordinates(const Camera & cam, Buffer & cam_coords);
+
+
+    //! @brief  See Range_Calculator::Convert_Camera_To_World_Coordinates
+    void Convert_Camera_To_World_Coordinates(const Camera & cam, 
+                                             const Buffer & cam_coords, 
+                                             Buffer & world_coords);
+
+
+    //! @brief  See Range_Calculator::Compute_Range
+    void Compute_Range(const Camera & cam, 
+                       const Terrain & t, 
+                       const Buffer & world_coords, 
+                       Buffer & rng);
+
+
+    //! @brief  See Range_Calculator::Calculate_Hits
+    void Calculate_Hits(const Camera & cam, const Terrain & t, Buffer & hits);
+
+
+    //! @brief  See Range_Calculator::Calculate_Pixels
+    void Calculate_Pixels(const Camera & cam, 
+                          const Terrain & t, 
+                          const std::vector<Pixel> & pixels, 
+                          std::vector<float> & ranges);
+
+
+    //! @brief  See Range_Calculator::Calculate_Pixels
+    void Calculate_Pixels(const Camera & cam, 
+                          const Terrain & t, 
+                          const std::vector<Pixel> & pixels, 
+                          const std::vector<float> & start,
+                          std::vector<float> & ranges);
+
+
+    //! @brief  See Range_Calculator::Calculate_Region. The rows are split over the nodes, as
+    //!         for Calculate.
+    void Calculate_Region(const Camera & cam, 
+                          const Terrain & t, 
+                          const uint32_t row0, 
+                          const uint32_t col0, 
+                          Buffer & rng);
+
+
+    //! @brief  Drop the placed copies of the terrain, so the next frame copies it again
+    void invalidate();
+
+
+    //! @brief  Get the NUMA nodes in use
+    const std::vector<numa::Node> & nodes() const;
+
+private:
+
+    //! @brief  Run a function once for each node, on a thread pinned to that node, and wait
+    //!
+    //! @param[in]  fn  called with the index of each node in m_nodes
+    void run_on_nodes(const std::function<void(const size_t node)> & fn);
+
+
+    //! @brief  Copy a height map into memory placed for the nodes, if it is not already
+    void place(const Terrain & t);
+
+
+    //! @brief  Get the Terrain that the threads of a node should read
+    const Terrain & terrain_for(const Terrain & t, const size_t node) const;
+
+    //! How the terrain is placed
+    numa::Placement m_placement;
+
+    //! The nodes in use
+    std::vector<numa::Node> m_nodes;
+
+    //! The pinned threads of each node
+    std::vector<std::unique_ptr<Thread_Pool>> m_pools;
+
+    //! Walks the rays. Each band is a separate call from a pool.
+    CPU_Range_Calculator m_cpu;
+
+    //! The Terrain that was last placed. Holding it keeps its height map from being freed, so
+    //! a new height map cannot reuse its address.
+    std::unique_ptr<Terrain> m_source;
+
+    //! The placed copies of the terrain: one per node, or one shared by every node
+    std::vector<Terrain> m_placed;
+};
+
+}
@@ -0,0 +1,171 @@
+//! @file       procedural_terrain.h
+//! @brief      Declares the Procedural_Terrain type, an unbounded terrain whose tiles are
+//!             generated on demand
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+#pragma once
+
+// CLarity Imports
+#include "buffer.h"
+#include "noise.h"
+
+// Standard Imports
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <utility>
+
+// Third-Party Imports
+
+namespace clarity
+{
+
+//! @brief  Parameters of a Procedural_Terrain
+struct Procedural_Terrain_Params
+{
+    //! The noise that defines the heights
+    Noise_Params noise;
+
+    //! The scale of a cell, in meters per cell
+    float scale;
+
+    //! The number of rows and cols in each tile
+    uint32_t tile_size;
+
+    //! The maximum number of tiles kept in memory. Must be at least 1.
+    size_t max_tiles;
+
+    //! The maximum range of a ray through the terrain, in meters
+    float view_distance;
+};
+
+
+//! @brief  An unbounded terrain made of square tiles generated the first time they are needed.
+//!
+//! @detail Tiles are a pure function of the seed and their coordinates, so a tile that has been
+//!         evicted is regenerated identically. At most max_tiles tiles are cached; the least
+//!         recently used tile is evicted first. All methods may be called from several threads.
+//!
+//!         Wrap a Procedural_Terrain in a Terrain to render it - the range calculators query
+//!         the tiles along each ray instead of a Buffer.
+class Procedural_Terrain
+{
+public:
+
+    //! @brief  Reads heights with a reference to the last tile used, so that walking a ray
+    //!         only visits the cache when it crosses into another tile.
+    //!
+    //! @detail A Cursor is not thread safe; use one per thread.
+    class Cursor
+    {
+    public:
+
+        //! @brief  Constructor
+        //!
+        //! @param[in]  source  the terrain to read
+        explicit Cursor(Procedural_Terrain & source);
+
+
+        //! @brief  Get the height of a cell, in meters
+        float height(const int64_t row, const int64_t col);
+
+    private:
+
+        //! The terrain to read
+        Procedural_Terrain & m_source;
+
+        //! The last tile used. Holding it keeps it alive if it is evicted.
+        Buffer m_tile;
+
+        //! The tile row of m_tile
+        int64_t m_tile_row;
+
+        //! The tile col of m_tile
+        int64_t m_tile_col;
+
+        //! Whether m_tile holds a tile
+        bool m_valid;
+    };
+
+
+    //! @brief  Constructor
+    //!
+    //! @param[in]  params  the terrain parameters
+    explicit Procedural_Terrain(const Procedural_Terrain_Params & params);
+
+
+    //! @brief  Destructor
+    ~Procedural_Terrain();
+
+
+    //! @brief  Deleted copy constructor
+    Procedural_Terrain(const Procedural_Terrain & other) = delete;
+
+
+    //! @brief  Deleted assignment operator
+    Procedural_Terrain & operator=(const Procedural_Terrain & other) = delete;
+
+
+    //! @brief  Get the terrain parameters
+    const Procedural_Terrain_Params & params() const;
+
+
+    //! @brief  Get a tile, generating it if it is not cached
+    //!
+    //! @param[in]  tile_row    the tile row. Tile (0, 0) starts at cell (0, 0).
+    //! @param[in]  tile_col    the tile col
+    Buffer tile(const int64_t tile_row, const int64_t tile_col);
+
+
+    //! @brief  Get the height of a cell, in meters
+    float height(const int64_t row, const int64_t col);
+
+
+    //! @brief  Copy a rectangular region of the terrain into a Buffer
+    //!
+    //! @param[in]  row0    the global row of the first row of the Buffer
+    //! @param[in]  col0    the global col of the first col of the Buffer
+    //! @param[out] out     the Buffer to fill. Its size sets the size of the region.
+    void copy_region(const int64_t row0, const int64_t col0, Buffer & out);
+
+
+    //! @brief  Get the number of tiles currently cached
+    size_t cached_tiles() const;
+
+
+    //! @brief  Get the number of tiles generated so far, including regenerated tiles
+    uint64_t tiles_generated() const;
+
+private:
+
+    //! The key of a cached tile
+    typedef std::pair<int64_t, int64_t> Tile_Key;
+
+    //! @brief  A cached tile and its position in the LRU list
+    struct Cache_Entry
+    {
+        Buffer tile;
+        std::list<Tile_Key>::iterator lru;
+    };
+
+    //! The terrain parameters
+    Procedural_Terrain_Params m_params;
+
+    //! Guards the cache
+    mutable std::mutex m_mutex;
+
+    //! The cached tiles
+    std::map<Tile_Key, Cache_Entry> m_cache;
+
+    //! The cached tile keys, most recently used first
+    std::list<Tile_Key> m_lru;
+
+    //! The number of tiles generated
+    uint64_t m_generated;
+};
+
+}
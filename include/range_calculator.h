@@ -9,9 +9,15 @@
 // CLarity Imports
 #include "buffer.h"
 #include "camera.h"
+#include "range_quantization.h"
 #include "terrain.h"
 
 // Standard Imports
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
 
 // Third-Party Imports
 
@@ -20,6 +26,32 @@ namespace clarity
 {
 
 
+//! @brief  The channels of each pixel of a hit image. See Range_Calculator::Calculate_Hits.
+enum Hit_Channel
+{
+    //! The range to the terrain, in meters
+    HIT_RANGE = 0,
+
+    //! The world position of the end of the ray, in meters
+    HIT_X = 1,
+    HIT_Y = 2,
+    HIT_Z = 3,
+
+    //! The terrain cell under the end of the ray
+    HIT_ROW = 4,
+    HIT_COL = 5,
+
+    //! The unit normal of the terrain at the hit, from the height gradient. Zero if the ray
+    //! reached the maximum range without hitting the terrain.
+    HIT_NORMAL_X = 6,
+    HIT_NORMAL_Y = 7,
+    HIT_NORMAL_Z = 8,
+
+    //! The depth of a hit image
+    HIT_DEPTH = 9
+};
+
+
 //! @brief  The interface for the CLarity Range Calculation.
 //!
 //! @detail This is a pure-virtual class that defines the interface for the Range_Calcuator.
@@ -28,6 +60,25 @@ namespace clarity
 class Range_Calculator
 {
 public:
+    //! @brief      The (row, col) of a pixel in the focal plane of a Camera
+    typedef std::pair<uint32_t, uint32_t> Pixel;
+
+
+    //! @brief      Receives each pass of Calculate_Progressive
+    //!
+    //! @param[in]  stride  the spacing of the pixels computed so far: 8, 4, 2, then 1
+    //! @param[in]  rng     the range image at that resolution, each computed pixel filling
+    //!                     the stride x stride block below and to the right of it
+    typedef std::function<void(const uint32_t stride, const Buffer & rng)> Progress_Callback;
+
+
+    //! @brief      Destructor
+    virtual ~Range_Calculator()
+    {
+        // No-op
+    }
+
+
     //! @brief      Compute the range image from the given Camera and Terrain
     //!
     //! @detail     This is a convenience function that, at it's simplest, calls the other methods
@@ -40,6 +91,46 @@ public:
     virtual void Calculate(const Camera & cam, const Terrain & t, Buffer & rng) = 0;
 
 
+    //! @brief      Check whether the rows of the range image run from the bottom of the
+    //!             focal plane up
+    //!
+    //! @detail     Row 0 of the image produced by Calculate is the top row of the Camera unless
+    //!             this returns true. Every other method lays out and addresses the rows of
+    //!             its pixels the same way as Calculate.
+    virtual bool rows_bottom_up() const
+    {
+        return false;
+    }
+
+
+    //! @brief      Get the largest range any calculator returns over a Terrain
+    //!
+    //! @detail     Every ray is clamped to it: the view distance of a procedural Terrain, and
+    //!             otherwise the size of the height map times sqrt(3), which reaches its far
+    //!             corner from a Camera above it. A Range_Quantization covering [0, max_range]
+    //!             therefore holds every range of the Terrain.
+    //!
+    //! @param[in]  t   the Terrain in the scene
+    static float max_range(const Terrain & t);
+
+
+    //! @brief      Compute the range image packed into 16 bit codes
+    //!
+    //! @detail     The codes hold half the bytes of the range image. The default
+    //!             implementation packs the result of Calculate on the host; an implementation
+    //!             that renders elsewhere can pack the image there and copy back only the codes.
+    //!
+    //! @param[in]  cam     the Camera in the scene
+    //! @param[in]  t       the Terrain in the scene
+    //! @param[in]  q       the quantization to pack the ranges with
+    //! @param[out] codes   the code of each pixel, laid out as the range image produced by
+    //!                     Calculate. Resized to fit.
+    virtual void Calculate_Quantized(const Camera & cam, 
+                                     const Terrain & t, 
+                                     const Range_Quantization & q,
+                                     std::vector<uint16_t> & codes);
+
+
     //! @brief      Compute the Camera coordinates of each pixel in the Camera.
     //!
     //! @detail     This function uses the instrisic paramaters of the Camera to compute the
@@ -77,6 +168,107 @@ public:
                                const Buffer & world_coords, 
                                Buffer & rng) = 0;
 
+
+    //! @brief      Compute the range image, along with where and how each ray met the terrain
+    //!
+    //! @detail     Every channel comes from the same walk of each ray, so a consumer of both
+    //!             the range and the ground intersection does not trace twice. The walk is
+    //!             always made at full detail. Pixels are laid out as in the range image
+    //!             produced by Calculate.
+    //!
+    //! @param[in]  cam     the Camera in the scene
+    //! @param[in]  t       the Terrain in the scene
+    //! @param[out] hits    a Buffer of depth HIT_DEPTH into which the channels of each pixel
+    //!                     will be placed. See Hit_Channel.
+    virtual void Calculate_Hits(const Camera & cam, const Terrain & t, Buffer & hits) = 0;
+
+
+    //! @brief      Compute the range at a few pixels of the Camera
+    //!
+    //! @detail     Only the rays of the given pixels are walked, so a handful of lookups costs
+    //!             a handful of rays rather than a frame. Pixels are addressed as in the range
+    //!             image produced by Calculate. The walk is always made at full detail.
+    //!
+    //! @param[in]  cam     the Camera in the scene
+    //! @param[in]  t       the Terrain in the scene
+    //! @param[in]  pixels  the pixels to compute. Throws std::out_of_range if any is outside
+    //!                     the focal plane.
+    //! @param[out] ranges  the range of each pixel, in the same order. Resized to fit.
+    virtual void Calculate_Pixels(const Camera & cam, 
+                                  const Terrain & t, 
+                                  const std::vector<Pixel> & pixels, 
+                                  std::vector<float> & ranges) = 0;
+
+
+    //! @brief      Compute the range over a rectangle of the Camera's pixels
+    //!
+    //! @detail     Equivalent to the same rectangle of the image produced by Calculate, but
+    //!             only its rays are walked. The walk is always made at full detail.
+    //!
+    //! @param[in]  cam     the Camera in the scene
+    //! @param[in]  t       the Terrain in the scene
+    //! @param[in]  row0    the row of the first pixel of the rectangle
+    //! @param[in]  col0    the col of the first pixel of the rectangle
+    //! @param[out] rng     a Buffer into which the range of the rectangle will be placed. Its
+    //!                     size is the size of the rectangle. Throws std::out_of_range if the
+    //!                     rectangle does not fit in the focal plane.
+    virtual void Calculate_Region(const Camera & cam, 
+                                  const Terrain & t, 
+                                  const uint32_t row0, 
+                                  const uint32_t col0, 
+                                  Buffer & rng) = 0;
+
+
+    //! @brief      Compute the range at a few pixels, starting each walk partway along its ray
+    //!
+    //! @detail     As Calculate_Pixels, but the walk of each ray skips the whole steps that
+    //!             lie before its start range. A start beyond the terrain can skip the hit,
+    //!             so it should be a lower bound on the range.
+    //!
+    //! @param[in]  start   the range at which to start walking each pixel, in meters. Must be
+    //!                     the same length as pixels; throws std::invalid_argument otherwise.
+    virtual void Calculate_Pixels(const Camera & cam, 
+                                  const Terrain & t, 
+                                  const std::vector<Pixel> & pixels, 
+                                  const std::vector<float> & start,
+                                  std::vector<float> & ranges) = 0;
+
+
+    //! @brief      Compute the range image coarse-to-fine, delivering each pass as it completes
+    //!
+    //! @detail     The first pass computes every 8th pixel of every 8th row. Each later pass
+    //!             halves the spacing and computes only the new pixels, so the passes together
+    //!             walk each ray once. By default every ray is walked from the Camera, so the
+    //!             final pass completes the same image as Calculate.
+    //!
+    //!             A nonzero start margin reuses the coarse passes: each new ray starts its walk
+    //!             at that fraction of the nearest range the last pass found around it, skipping
+    //!             the steps before it. The nearest neighbouring range is not a true lower bound,
+    //!             so terrain that rises in front of all four neighbours, such as a thin ridge or
+    //!             a mast, can be skipped and the final pass may differ from Calculate. Use it
+    //!             where a faster refinement matters more than an exact image.
+    //!
+    //!             The cancel flag is checked between batches of rays, so a new Camera can
+    //!             abandon a refinement that is no longer wanted.
+    //!
+    //! @param[in]  cam             the Camera in the scene
+    //! @param[in]  t               the Terrain in the scene
+    //! @param[out] rng             a Buffer into which the range image will be placed, on the
+    //!                             host
+    //! @param[in]  callback        called with rng after each pass
+    //! @param[in]  cancel          if not null, stop as soon as it is set
+    //! @param[in]  start_margin    the fraction of the nearest coarse range at which each new
+    //!                             ray starts, in [0, 1). Zero, the default, walks every ray
+    //!                             from the Camera. Throws std::invalid_argument otherwise.
+    //!
+    //! @return     true if every pass completed, false if the render was cancelled
+    bool Calculate_Progressive(const Camera & cam, 
+                               const Terrain & t, 
+                               Buffer & rng, 
+                               const Progress_Callback & callback,
+                               const std::atomic<bool> * cancel = nullptr,
+                               const float start_margin = 0.0f);
+
 };
 
 
@@ -0,0 +1,199 @@
+//! @file       range_codec.h
+//! @brief      Declares the Range_Encoder and Range_Decoder types, which compress sequences of
+//!             range images with keyframes and quantized temporal residuals
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+#pragma once
+
+// CLarity Imports
+#include "buffer.h"
+#include "thread_pool.h"
+
+// Standard Imports
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Third-Party Imports
+
+namespace clarity
+{
+
+//! @brief  Parameters of the range sequence codec
+struct Range_Codec_Params
+{
+    //! The maximum absolute error of a decoded range, in meters. Must be positive.
+    float error_bound;
+
+    //! The number of frames from one keyframe to the next. 1 makes every frame a keyframe.
+    uint32_t keyframe_interval;
+
+    //! The number of threads to use. 0 selects the number of hardware threads.
+    unsigned num_threads;
+};
+
+
+//! @brief  Layout of an encoded frame.
+//!
+//! @detail An encoded frame is a Frame_Header, then num_bands uint32_t byte counts, then the
+//!         bands. Each band covers a contiguous run of rows and holds one zig-zag varint per
+//!         pixel, so bands can be encoded and decoded independently. A keyframe stores each
+//!         range quantized to a multiple of step; other frames store the quantized difference
+//!         from the previous decoded frame.
+namespace range_codec
+{
+
+//! Magic number at the start of every encoded frame ("CLDF")
+constexpr uint32_t FRAME_MAGIC = 0x46444c43;
+
+
+//! @brief  The header at the start of each encoded frame
+struct Frame_Header
+{
+    uint32_t magic;
+    uint8_t keyframe;
+    uint8_t reserved[3];
+    float step;
+    uint32_t rows;
+    uint32_t cols;
+    uint32_t num_bands;
+};
+
+}
+
+
+//! @brief  Encodes a sequence of range images.
+//!
+//! @detail Residuals are predicted from the encoder's own reconstruction of the previous frame,
+//!         exactly as the decoder will see it, so quantization error does not accumulate from
+//!         frame to frame. Every decoded range is within error_bound of the original, up to
+//!         float32 rounding of the reconstruction.
+class Range_Encoder
+{
+public:
+
+    //! @brief  Constructor
+    //!
+    //! @param[in]  rows        the number of rows in every frame
+    //! @param[in]  cols        the number of cols in every frame
+    //! @param[in]  params      the codec parameters
+    Range_Encoder(const uint32_t rows, const uint32_t cols, const Range_Codec_Params & params);
+
+
+    //! @brief  Destructor
+    ~Range_Encoder();
+
+
+    //! @brief  Deleted copy constructor
+    Range_Encoder(const Range_Encoder & other) = delete;
+
+
+    //! @brief  Deleted assignment operator
+    Range_Encoder & operator=(const Range_Encoder & other) = delete;
+
+
+    //! @brief  Encode the next frame of the sequence
+    //!
+    //! @param[in]  rng     the range image. Must match the size given at construction.
+    //! @param[out] out     the encoded frame. Replaces any existing contents.
+    //!
+    //! @return whether the frame was encoded as a keyframe
+    bool encode(const Buffer & rng, std::vector<uint8_t> & out);
+
+
+    //! @brief  Make the next frame a keyframe regardless of the keyframe interval
+    void force_keyframe();
+
+private:
+
+    //! The number of rows in each frame
+    uint32_t m_rows;
+
+    //! The number of cols in each frame
+    uint32_t m_cols;
+
+    //! The codec parameters
+    Range_Codec_Params m_params;
+
+    //! The decoder's view of the previous frame
+    std::vector<float> m_reference;
+
+    //! The number of frames encoded since the last keyframe, or 0 to force a keyframe
+    uint32_t m_since_keyframe;
+
+    //! The encoded bytes of each band, reused from frame to frame
+    std::vector<std::vector<uint8_t>> m_bands;
+
+    //! The threads that encode bands
+    Thread_Pool m_pool;
+};
+
+
+//! @brief  Decodes frames produced by Range_Encoder.
+//!
+//! @detail A keyframe can be decoded at any time, which is how callers seek. Any other frame
+//!         requires that the frame before it was the last one decoded.
+class Range_Decoder
+{
+public:
+
+    //! @brief  Constructor
+    //!
+    //! @param[in]  rows            the number of rows in every frame
+    //! @param[in]  cols            the number of cols in every frame
+    //! @param[in]  num_threads     the number of threads to use. 0 selects the number of
+    //!                             hardware threads.
+    Range_Decoder(const uint32_t rows, const uint32_t cols, const unsigned num_threads = 0);
+
+
+    //! @brief  Destructor
+    ~Range_Decoder();
+
+
+    //! @brief  Deleted copy constructor
+    Range_Decoder(const Range_Decoder & other) = delete;
+
+
+    //! @brief  Deleted assignment operator
+    Range_Decoder & operator=(const Range_Decoder & other) = delete;
+
+
+    //! @brief  Decode a frame
+    //!
+    //! @param[in]  bytes   the encoded frame
+    //! @param[in]  length  the size of the encoded frame, in bytes
+    //! @param[out] rng     a Buffer into which the range image will be placed
+    void decode(const uint8_t * bytes, const size_t length, Buffer & rng);
+
+
+    //! @brief  Forget the previous frame. Only a keyframe can be decoded next.
+    void reset();
+
+
+    //! @brief  Check whether an encoded frame is a keyframe
+    //!
+    //! @param[in]  bytes   the encoded frame
+    //! @param[in]  length  the size of the encoded frame, in bytes
+    static bool is_keyframe(const uint8_t * bytes, const size_t length);
+
+private:
+
+    //! The number of rows in each frame
+    uint32_t m_rows;
+
+    //! The number of cols in each frame
+    uint32_t m_cols;
+
+    //! The previous decoded frame
+    std::vector<float> m_reference;
+
+    //! Whether m_reference holds a decoded frame
+    bool m_has_reference;
+
+    //! The threads that decode bands
+    Thread_Pool m_pool;
+};
+
+}
@@ -0,0 +1,50 @@
+//! @file       range_display.h
+//! @brief      Declares the range display API, which turns a range image into 8-bit RGBA pixels
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+#pragma once
+
+// CLarity Imports
+#include "buffer.h"
+
+// Standard Imports
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Third-Party Imports
+
+
+namespace clarity
+{
+
+//! @brief  The interface for converting range images for display.
+//!
+//! @detail The ranges are scaled to gray levels between the smallest and the largest range in
+//!         the image: gray = (uint8_t) ((range - min) * (255 / (max - min))). The gray level is
+//!         written to the red, green and blue bytes of each pixel and the alpha byte is 255.
+//!         If every range is the same, every pixel is black.
+//!
+//!         This is a pure-virtual class; concrete implementations provide the conversion.
+class Range_Display
+{
+public:
+    //! @brief  Destructor
+    virtual ~Range_Display()
+    {
+        // No-op
+    }
+
+
+    //! @brief  Convert a range image to grayscale RGBA
+    //!
+    //! @param[in]  rng     the range image. Must not be empty.
+    //! @param[out] rgba    4 bytes per pixel, in row-major order. Resized to fit.
+    //!
+    //! @return the smallest and the largest range in the image
+    virtual std::pair<float, float> Convert(const Buffer & rng, std::vector<uint8_t> & rgba) = 0;
+};
+
+}
@@ -0,0 +1,77 @@
+//! @file       range_quantization.h
+//! @brief      Declares the Range_Quantization type and the functions that pack range images
+//!             into 16 bit codes
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+#pragma once
+
+// CLarity Imports
+#include "buffer.h"
+
+// Standard Imports
+#include <cstdint>
+
+// Third-Party Imports
+
+namespace clarity
+{
+
+//! @brief  The mapping between ranges and 16 bit codes.
+//!
+//! @detail A code c stands for the range offset + c * step. Ranges are rounded to the nearest
+//!         code, so a decoded range within [offset, offset + 65535 * step] is within step / 2 of
+//!         the original, and ranges outside it are clamped. A 1 cm step covers 655 m; covering
+//!         tens of kilometers takes a step of about half a meter.
+struct Range_Quantization
+{
+    //! The range of code 0, in meters
+    float offset;
+
+    //! The range between consecutive codes, in meters. Must be positive.
+    float step;
+};
+
+
+//! @brief  Packing and unpacking of 16 bit range codes
+namespace range_quantization
+{
+
+//! The largest code
+constexpr uint16_t MAX_CODE = 0xffff;
+
+
+//! @brief  Get the quantization with the finest step that covers a span of ranges
+//!
+//! @detail Throws std::invalid_argument unless max_range is greater than min_range.
+Range_Quantization covering(const float min_range, const float max_range);
+
+
+//! @brief  Get the code of a range
+uint16_t quantize(const float range, const Range_Quantization & q);
+
+
+//! @brief  Get the range of a code
+float dequantize(const uint16_t code, const Range_Quantization & q);
+
+
+//! @brief  Pack a range image into codes
+//!
+//! @param[in]  rng     the range image
+//! @param[in]  q       the quantization to use
+//! @param[out] codes   the code of each pixel, in the row-major order of rng. Must hold one
+//!                     code per pixel.
+void quantize(const Buffer & rng, const Range_Quantization & q, uint16_t * codes);
+
+
+//! @brief  Unpack codes into a range image
+//!
+//! @param[in]  codes   the code of each pixel of rng, in row-major order
+//! @param[in]  q       the quantization the codes were made with
+//! @param[out] rng     a Buffer of depth 1 into which the ranges will be placed
+void dequantize(const uint16_t * codes, const Range_Quantization & q, Buffer & rng);
+
+}
+
+}
@@ -0,0 +1,385 @@
+//! @file       range_sequence.h
+//! @brief      Declares the Range_Sequence_Writer and Range_Sequence_Reader types, which store
+//!             many range images and their Camera poses in a single indexed file
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+#pragma once
+
+// CLarity Imports
+#include "buffer.h"
+#include "camera.h"
+#include "range_codec.h"
+#include "range_quantization.h"
+
+// Standard Imports
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Third-Party Imports
+
+namespace clarity
+{
+
+//! @brief  Enumeration of the encodings a frame payload can be stored with
+enum Range_Encoding
+{
+    FLOAT32 = 0,
+    DELTA = 1,
+
+    //! 16 bit codes. See Range_Quantization.
+    UINT16 = 2
+};
+
+
+//! @brief  Layout of a range sequence file.
+//!
+//! @detail A sequence file is a File_Header followed by frame records. Each record is a
+//!         Frame_Header followed by its payload, padded to an 8 byte boundary. On close, the
+//!         offset of each record is appended as a uint64_t index and the File_Header is updated
+//!         to point at it. A file that was not closed cleanly has no index; readers recover the
+//!         frames by walking the records.
+//!
+//!         A UINT16 payload is a Quantization_Header followed by one code per pixel.
+//!
+//!         Pixels are stored in row-major order, and row 0 is the top row of the Camera. A
+//!         writer of frames from a calculator whose rows run bottom-up (see
+//!         Range_Calculator::rows_bottom_up) flips them first.
+namespace range_sequence
+{
+
+//! Magic number at the start of every sequence file ("CLRS")
+constexpr uint32_t FILE_MAGIC = 0x53524c43;
+
+//! Magic number at the start of every frame record ("FRME")
+constexpr uint32_t FRAME_MAGIC = 0x454d5246;
+
+//! The current version of the file format
+constexpr uint32_t VERSION = 1;
+
+
+//! @brief  The header at the start of a sequence file
+struct File_Header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t rows;
+    uint32_t cols;
+    uint64_t index_offset;
+    uint64_t frame_count;
+};
+
+
+//! @brief  The header at the start of each frame record
+struct Frame_Header
+{
+    uint32_t magic;
+    uint32_t encoding;
+    uint64_t payload_bytes;
+    double timestamp;
+    float position[3];
+    float yaw;
+    float pitch;
+    float fov;
+};
+
+
+//! @brief  The header at the start of each UINT16 payload
+struct Quantization_Header
+{
+    float offset;
+    float step;
+};
+
+}
+
+
+//! @brief  Streams range images into a sequence file from a background thread.
+//!
+//! @detail append() copies the frame and returns; the copy is written by a dedicated writer
+//!         thread so the caller can go on to render the next frame. At most max_pending frames
+//!         are buffered - append() blocks when the writer falls that far behind. When a codec
+//!         is given, frames are also compressed on the writer thread. When a quantization is
+//!         given, frames are packed into 16 bit codes, which halves the bytes written.
+class Range_Sequence_Writer
+{
+public:
+
+    //! @brief  Create a new sequence file, replacing any existing file at path
+    //!
+    //! @param[in]  path            the file to write
+    //! @param[in]  rows            the number of rows in every frame
+    //! @param[in]  cols            the number of cols in every frame
+    //! @param[in]  max_pending     the maximum number of frames buffered for the writer thread
+    Range_Sequence_Writer(const std::string & path,
+                          const uint32_t rows,
+                          const uint32_t cols,
+                          const size_t max_pending = 8);
+
+
+    //! @brief  Create a new sequence file of compressed frames
+    //!
+    //! @param[in]  path            the file to write
+    //! @param[in]  rows            the number of rows in every frame
+    //! @param[in]  cols            the number of cols in every frame
+    //! @param[in]  codec           the parameters of the Range_Encoder used to compress frames
+    //! @param[in]  max_pending     the maximum number of frames buffered for the writer thread
+    Range_Sequence_Writer(const std::string & path,
+                          const uint32_t rows,
+                          const uint32_t cols,
+                          const Range_Codec_Params & codec,
+                          const size_t max_pending = 8);
+
+
+    //! @brief  Create a new sequence file of frames packed into 16 bit codes
+    //!
+    //! @param[in]  path            the file to write
+    //! @param[in]  rows            the number of rows in every frame
+    //! @param[in]  cols            the number of cols in every frame
+    //! @param[in]  quantization    the quantization that append() packs range images with
+    //! @param[in]  max_pending     the maximum number of frames buffered for the writer thread
+    Range_Sequence_Writer(const std::string & path,
+                          const uint32_t rows,
+                          const uint32_t cols,
+                          const Range_Quantization & quantization,
+                          const size_t max_pending = 8);
+
+
+    //! @brief  Destructor. Closes the file if close() has not been called.
+    ~Range_Sequence_Writer();
+
+
+    //! @brief  Deleted copy constructor
+    Range_Sequence_Writer(const Range_Sequence_Writer & other) = delete;
+
+
+    //! @brief  Deleted assignment operator
+    Range_Sequence_Writer & operator=(const Range_Sequence_Writer & other) = delete;
+
+
+    //! @brief  Queue a frame to be written
+    //!
+    //! @param[in]  cam         the Camera that produced the frame
+    //! @param[in]  rng         the range image. Must match the size of the sequence.
+    //! @param[in]  timestamp   the time of the frame, in seconds
+    void append(const Camera & cam, const Buffer & rng, const double timestamp = 0.0);
+
+
+    //! @brief  Queue a frame that is already packed, such as one from
+    //!         Range_Calculator::Calculate_Quantized
+    //!
+    //! @detail Throws std::invalid_argument if the sequence is compressed with a codec.
+    //!
+    //! @param[in]  cam             the Camera that produced the frame
+    //! @param[in]  codes           the code of each pixel. Must match the size of the sequence.
+    //! @param[in]  quantization    the quantization the codes were made with
+    //! @param[in]  timestamp       the time of the frame, in seconds
+    void append(const Camera & cam,
+                const std::vector<uint16_t> & codes,
+                const Range_Quantization & quantization,
+                const double timestamp = 0.0);
+
+
+    //! @brief  Block until every queued frame has been written to disk
+    void flush();
+
+
+    //! @brief  Write the remaining frames and the index, then close the file
+    void close();
+
+
+    //! @brief  Get the number of frames appended so far
+    uint64_t size() const;
+
+private:
+
+    //! @brief  A frame waiting for the writer thread
+    struct Pending_Frame
+    {
+        range_sequence::Frame_Header header;
+
+        //! The ranges of a FLOAT32 or DELTA frame
+        std::vector<float> data;
+
+        //! The payload of a UINT16 frame
+        std::vector<uint8_t> packed;
+    };
+
+
+    //! @brief  The body of the writer thread
+    void run();
+
+
+    //! @brief  Make the header of a frame
+    range_sequence::Frame_Header frame_header(const Camera & cam,
+                                              const Range_Encoding encoding,
+                                              const uint64_t payload_bytes,
+                                              const double timestamp) const;
+
+
+    //! @brief  Queue a frame, blocking while the queue is full
+    void enqueue(Pending_Frame && frame);
+
+
+    //! @brief  Rethrow an error raised on the writer thread. m_mutex must be held.
+    void check_error() const;
+
+    //! The output file
+    std::ofstream m_out;
+
+    //! The number of rows in each frame
+    uint32_t m_rows;
+
+    //! The number of cols in each frame
+    uint32_t m_cols;
+
+    //! The maximum number of frames waiting to be written
+    size_t m_max_pending;
+
+    //! Compresses frames on the writer thread, if the sequence is compressed
+    std::unique_ptr<Range_Encoder> m_encoder;
+
+    //! Whether append() packs range images into codes
+    bool m_quantized;
+
+    //! The quantization append() packs range images with, if m_quantized is set
+    Range_Quantization m_quantization;
+
+    //! Guards all of the members below
+    mutable std::mutex m_mutex;
+
+    //! Signalled when a frame is queued or the writer should stop
+    std::condition_variable m_queued;
+
+    //! Signalled when the writer thread takes a frame off the queue
+    std::condition_variable m_dequeued;
+
+    //! Frames waiting to be written
+    std::deque<Pending_Frame> m_pending;
+
+    //! Whether the writer thread is currently writing a frame
+    bool m_busy;
+
+    //! Whether the writer thread should exit once the queue is empty
+    bool m_stopping;
+
+    //! Whether the file has been closed
+    bool m_closed;
+
+    //! The number of frames appended
+    uint64_t m_appended;
+
+    //! The offset of each written frame record
+    std::vector<uint64_t> m_index;
+
+    //! An error raised on the writer thread
+    std::exception_ptr m_error;
+
+    //! The writer thread
+    std::thread m_thread;
+};
+
+
+//! @brief  Random-access reader for a sequence file.
+//!
+//! @detail The file is memory mapped. Frames are returned as Buffers that reference the
+//!         mapping directly, so jumping to a frame costs no reads or copies. The mapping is
+//!         private - writing to a returned Buffer does not modify the file.
+//!
+//!         Compressed frames are decoded from the nearest keyframe at or before the requested
+//!         frame, or from the last frame returned when reading forward. They are returned as
+//!         copies, as are UINT16 frames, which are unpacked to meters.
+class Range_Sequence_Reader
+{
+public:
+
+    //! @brief  Open a sequence file
+    //!
+    //! @param[in]  path    the file to read
+    explicit Range_Sequence_Reader(const std::string & path);
+
+
+    //! @brief  Destructor
+    ~Range_Sequence_Reader();
+
+
+    //! @brief  Deleted copy constructor
+    Range_Sequence_Reader(const Range_Sequence_Reader & other) = delete;
+
+
+    //! @brief  Deleted assignment operator
+    Range_Sequence_Reader & operator=(const Range_Sequence_Reader & other) = delete;
+
+
+    //! @brief  Get the number of frames in the sequence
+    uint64_t size() const;
+
+
+    //! @brief  Get the size of each frame, in pixels
+    std::pair<uint32_t, uint32_t> frame_size() const;
+
+
+    //! @brief  Get the range image of a frame
+    //!
+    //! @param[in]  n   the index of the frame
+    Buffer frame(const uint64_t n) const;
+
+
+    //! @brief  Get the Camera that produced a frame
+    //!
+    //! @param[in]  n   the index of the frame
+    Camera camera(const uint64_t n) const;
+
+
+    //! @brief  Get the timestamp of a frame, in seconds
+    //!
+    //! @param[in]  n   the index of the frame
+    double timestamp(const uint64_t n) const;
+
+private:
+
+    //! @brief  Get the header of a frame record, checking the index
+    const range_sequence::Frame_Header & header(const uint64_t n) const;
+
+
+    //! @brief  Rebuild the index by walking the frame records of an unclosed file
+    void recover_index();
+
+
+    //! @brief  Decode a compressed frame. m_decode_mutex must be held.
+    Buffer decode(const uint64_t n) const;
+
+    //! The mapped file. The deleter unmaps it.
+    std::shared_ptr<char> m_mapping;
+
+    //! The size of the mapping, in bytes
+    size_t m_length;
+
+    //! The file header
+    range_sequence::File_Header m_header;
+
+    //! The offset of each frame record
+    std::vector<uint64_t> m_index;
+
+    //! Guards the decoder state below
+    mutable std::mutex m_decode_mutex;
+
+    //! Decodes compressed frames. Created on first use.
+    mutable std::unique_ptr<Range_Decoder> m_decoder;
+
+    //! The last frame decoded, or -1 if the decoder has no reference
+    mutable int64_t m_decoded;
+};
+
+}
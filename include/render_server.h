@@ -0,0 +1,347 @@
+//! @file       render_server.h
+//! @brief      Declares the Render_Server type, which keeps terrains and calculators warm and
+//!             answers requests over Unix domain sockets, and its wire protocol
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+#pragma once
+
+// CLarity Imports
+#include "buffer.h"
+#include "line_of_sight.h"
+#include "range_calculator.h"
+#include "terrain.h"
+
+// Standard Imports
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Third-Party Imports
+#include "cl.hpp"
+
+
+namespace clarity
+{
+
+//! @brief  The messages exchanged with a Render_Server.
+//!
+//! @detail Every message is a Message_Header followed by payload_bytes of payload. All values
+//!         are in the byte order of the host, as the socket never leaves it. A client may keep
+//!         a connection open and send any number of requests on it; each is answered in order,
+//!         with the id of the request. A reply has the status in the type field of its header.
+//!         An ERROR reply carries a message as its payload. A malformed header is answered with
+//!         an ERROR, and the connection is then closed.
+//!
+//!         - LOAD_TERRAIN: the payload is the path of a terrain file. The reply is a
+//!           Terrain_Info. Loading a path that is already loaded returns the same terrain.
+//!         - RENDER: the payload is a Render_Request. The reply is rows * cols floats of range
+//!           in row-major order. Row 0 is the top row of the camera, whichever calculator the
+//!           server renders with. If quantized is set, the reply is instead the offset and step
+//!           of a Range_Quantization, as two floats, followed by rows * cols uint16 codes in the
+//!           same order.
+//!         - LINE_OF_SIGHT: the payload is a Los_Request, followed by count observers and then
+//!           count targets, each three floats in meters. The reply is count floats of distance
+//!           followed by count bytes of visibility. See Line_Of_Sight::Check.
+namespace server_protocol
+{
+
+//! Magic number at the start of every message ("CLSV")
+constexpr uint32_t MAGIC = 0x56534c43;
+
+//! The largest payload the server accepts
+constexpr uint32_t MAX_PAYLOAD_BYTES = 256u << 20;
+
+
+//! @brief  The kinds of request
+enum Request_Type
+{
+    LOAD_TERRAIN = 1,
+    RENDER = 2,
+    LINE_OF_SIGHT = 3
+};
+
+
+//! @brief  The status of a reply
+enum Status
+{
+    OK = 0,
+    ERROR = 1
+};
+
+
+//! @brief  The header at the start of every request and reply
+struct Message_Header
+{
+    uint32_t magic;
+
+    //! A Request_Type in a request, a Status in a reply
+    uint32_t type;
+
+    //! Chosen by the client, and echoed in the reply
+    uint32_t id;
+
+    uint32_t payload_bytes;
+};
+
+
+//! @brief  The reply to LOAD_TERRAIN
+struct Terrain_Info
+{
+    //! The handle that later requests name the terrain by
+    uint32_t terrain;
+    uint32_t rows;
+    uint32_t cols;
+
+    //! Meters per cell
+    float scale;
+};
+
+
+//! @brief  The payload of RENDER
+struct Render_Request
+{
+    uint32_t terrain;
+    uint32_t rows;
+    uint32_t cols;
+
+    //! Nonzero to reply with 16 bit codes covering every range the terrain can produce
+    uint32_t quantized;
+
+    //! The field of view, in radians
+    float fov;
+
+    //! The position of the camera, in meters
+    float position[3];
+
+    //! The yaw and pitch of the camera, in radians
+    float yaw;
+    float pitch;
+};
+
+
+//! @brief  The start of the payload of LINE_OF_SIGHT
+struct Los_Request
+{
+    uint32_t terrain;
+    uint32_t count;
+};
+
+}
+
+
+//! @brief  Keeps terrains and calculators warm and serves requests for them. See
+//!         server_protocol for the messages.
+//!
+//! @detail Each connection is served by a thread of its own, which reads its requests and
+//!         writes its replies. Terrains are loaded on the connection thread, so a load does not
+//!         hold up renders of other terrains. Renders and line-of-sight queries are queued for
+//!         a single dispatcher thread, which owns the calculator and the line-of-sight walker.
+//!
+//!         The dispatcher takes every queued job at once and runs the jobs of each terrain
+//!         together. The line-of-sight queries of a terrain are joined into one batch and
+//!         walked by a single Check, so concurrent clients share one dispatch. Each render
+//!         still walks its own camera, as a dispatch covers one camera, but renders of one
+//!         terrain run back to back while its height map is resident.
+class Render_Server
+{
+public:
+
+    //! @brief  Constructor. Starts the dispatcher.
+    //!
+    //! @param[in]  calculator  renders every RENDER
+    //! @param[in]  los         walks every LINE_OF_SIGHT
+    //! @param[in]  ctx         the context of OpenCL calculators, or null for calculators that
+    //!                         run on the host. Terrains are uploaded to it once, when they
+    //!                         are loaded.
+    Render_Server(std::unique_ptr<Range_Calculator> calculator,
+                  std::unique_ptr<Line_Of_Sight> los,
+                  const std::shared_ptr<cl::Context> ctx = nullptr);
+
+
+    //! @brief  Destructor. Stops the dispatcher; connections must be closed first.
+    ~Render_Server();
+
+
+    //! @brief  Deleted copy constructor
+    Render_Server(const Render_Server & other) = delete;
+
+
+    //! @brief  Deleted assignment operator
+    Render_Server & operator=(const Render_Server & other) = delete;
+
+
+    //! @brief  Load a terrain file written by the terrain or noise tool, or find it if it is
+    //!         already loaded
+    //!
+    //! @return the handle and size of the terrain
+    server_protocol::Terrain_Info load(const std::string & path);
+
+
+    //! @brief  Answer the requests of one client until it closes the connection or sends a
+    //!         malformed header
+    //!
+    //! @detail Several connections may be served at once, each from its own thread.
+    //!
+    //! @param[in]  fd  a connected stream socket. The caller closes it afterwards.
+    void serve_connection(const int fd);
+
+
+    //! @brief  Listen on a Unix domain socket, serving each connection on a thread of its own,
+    //!         until stop is set
+    //!
+    //! @detail An existing socket at the path, left by a server that did not shut down
+    //!         cleanly, is replaced; any other file is not. The socket is removed on return.
+    //!
+    //! @param[in]  socket_path     the path to listen on
+    //! @param[in]  stop            checked a few times a second, and whenever a signal arrives
+    void serve(const std::string & socket_path, const std::atomic<bool> & stop);
+
+private:
+
+    //! @brief  A reply, waiting to be sent
+    struct Reply
+    {
+        //! The Status of the reply
+        uint32_t status;
+
+        //! The message. It starts with room for its header, which is filled in when it is sent,
+        //! so the whole message goes out in one write without another copy of the payload.
+        std::vector<char> bytes;
+
+        //! @brief  Get the start of the payload
+        char * payload();
+    };
+
+
+    //! @brief  A render or line-of-sight request waiting for the dispatcher
+    struct Job
+    {
+        uint32_t type;
+        uint32_t terrain;
+        server_protocol::Render_Request render;
+        std::vector<Line_Of_Sight::Point> observers;
+        std::vector<Line_Of_Sight::Point> targets;
+        std::promise<Reply> reply;
+    };
+
+
+    //! @brief  A client connection accepted by serve
+    struct Connection
+    {
+        //! The socket, or -1 once the connection thread has closed it
+        int fd;
+        std::thread thread;
+    };
+
+
+    //! @brief  Make an OK reply with room for a payload
+    static Reply make_reply(const size_t payload_bytes);
+
+
+    //! @brief  Make an ERROR reply
+    static Reply error_reply(const std::string & message);
+
+
+    //! @brief  Describe a terrain. m_terrain_mutex must be held.
+    server_protocol::Terrain_Info info(const uint32_t handle) const;
+
+
+    //! @brief  Get a loaded terrain
+    Terrain terrain(const uint32_t handle);
+
+
+    //! @brief  The body of a thread started by serve
+    void connection(const uint64_t id, const int fd);
+
+
+    //! @brief  Fill in the header of a reply and send it
+    bool send_reply(const int fd, const uint32_t id, Reply reply);
+
+
+    //! @brief  Answer one request
+    Reply request(const server_protocol::Message_Header & h, const std::vector<char> & payload);
+
+
+    //! @brief  The body of the dispatcher thread
+    void dispatch();
+
+
+    //! @brief  Run the jobs of one terrain, batch[first, end)
+    void run_terrain(const std::vector<std::shared_ptr<Job>> & batch,
+                     const size_t first,
+                     const size_t end);
+
+
+    //! @brief  Render one camera
+    Reply render(const Terrain & t, const server_protocol::Render_Request & r);
+
+
+    //! @brief  Join the connection threads that have finished
+    void reap();
+
+    //! The OpenCL context, if the server renders with OpenCL
+    std::shared_ptr<cl::Context> m_ctx;
+
+    //! Renders every RENDER. Only the dispatcher uses it.
+    std::unique_ptr<Range_Calculator> m_calculator;
+
+    //! Walks every LINE_OF_SIGHT. Only the dispatcher uses it.
+    std::unique_ptr<Line_Of_Sight> m_los;
+
+    //! The range image of the last float render, reused while the size stays the same
+    std::unique_ptr<Buffer> m_range;
+
+    //! The codes of the last quantized render
+    std::vector<uint16_t> m_codes;
+
+    //! Serializes terrain loads
+    std::mutex m_load_mutex;
+
+    //! Guards m_terrains and m_paths
+    std::mutex m_terrain_mutex;
+
+    //! The loaded terrains, by handle
+    std::vector<Terrain> m_terrains;
+
+    //! The handle of each loaded terrain file
+    std::map<std::string, uint32_t> m_paths;
+
+    //! Guards m_jobs and m_stopping
+    std::mutex m_job_mutex;
+
+    //! Signalled when a job is queued or the dispatcher should stop
+    std::condition_variable m_queued;
+
+    //! Jobs waiting for the dispatcher
+    std::deque<std::shared_ptr<Job>> m_jobs;
+
+    //! Whether the dispatcher should exit once the queue is empty
+    bool m_stopping;
+
+    //! Guards m_connections and m_finished
+    std::mutex m_connection_mutex;
+
+    //! The open connections, by id
+    std::map<uint64_t, Connection> m_connections;
+
+    //! The connections whose threads have finished, waiting to be joined
+    std::vector<uint64_t> m_finished;
+
+    //! The id of the next connection
+    uint64_t m_next_connection;
+
+    //! The dispatcher thread
+    std::thread m_dispatcher;
+};
+
+}
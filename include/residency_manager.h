@@ -0,0 +1,182 @@
+//! @file       residency_manager.h
+//! @brief      Declares the Residency_Manager type, which keeps device copies of host Buffers
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+#pragma once
+
+// CLarity Imports
+#include "buffer.h"
+#include "device_buffer.h"
+
+// Standard Imports
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+
+// Third-Party Imports
+#include "cl.hpp"
+
+
+namespace clarity
+{
+
+//! @brief  Keeps device copies of long-lived host Buffers, such as terrains, and tracks which
+//!         side of each holds the current data.
+//!
+//! @detail A Buffer is identified by its memory, so every copy of a Buffer shares one device
+//!         copy. acquire() uploads a Buffer the first time it is seen and after the host side
+//!         is marked dirty. Rectangles recorded with Buffer::mark_dirty, for example by
+//!         Terrain::edit, are uploaded on their own; every other acquire is free. A device
+//!         copy that is written by a kernel is marked device-dirty, and is copied back before
+//!         it is evicted or when the host asks for it.
+//!
+//!         The device copies are kept within a budget of device memory. When an upload would
+//!         go over it, the least recently acquired copies are evicted first. A copy that a
+//!         caller still holds stays alive until it is released, but no longer counts toward
+//!         the budget. A device copy also keeps its host memory alive, so copies whose host
+//!         Buffers have been released everywhere else are dropped on the next acquire.
+//!
+//!         All member functions are thread-safe.
+class Residency_Manager
+{
+public:
+
+    //! @brief  Constructor
+    //!
+    //! @param[in]  ctx             the context to make device copies in
+    //! @param[in]  budget_bytes    the most device memory to keep resident. 0 is unlimited.
+    explicit Residency_Manager(const std::shared_ptr<cl::Context> ctx,
+                               const size_t budget_bytes = 0);
+
+
+    //! @brief  Destructor. Device-dirty copies are not copied back.
+    ~Residency_Manager();
+
+
+    //! @brief  Deleted copy constructor
+    Residency_Manager(const Residency_Manager & other) = delete;
+
+
+    //! @brief  Deleted assignment operator
+    Residency_Manager & operator=(const Residency_Manager & other) = delete;
+
+
+    //! @brief  Get the device copy of a Buffer, uploading it if it is missing or host-dirty
+    //!
+    //! @param[in]  b       the host Buffer
+    //! @param[in]  queue   the queue to upload on. The default queue is used otherwise.
+    //!
+    //! @return the device copy. It shares the memory of b.
+    std::shared_ptr<Device_Buffer> acquire(const Buffer & b,
+                                           const cl::CommandQueue * queue = nullptr);
+
+
+    //! @brief  Record that the host data of a Buffer has changed. Does nothing if the Buffer
+    //!         is not resident.
+    void mark_host_dirty(const Buffer & b);
+
+
+    //! @brief  Record that a kernel has written the device copy of a Buffer. Does nothing if
+    //!         the Buffer is not resident.
+    void mark_device_dirty(const Buffer & b);
+
+
+    //! @brief  Copy the device copy of a Buffer to the host, if it is device-dirty
+    void to_host(const Buffer & b, const cl::CommandQueue * queue = nullptr);
+
+
+    //! @brief  Drop the device copy of a Buffer, copying it to the host first if it is
+    //!         device-dirty
+    void evict(const Buffer & b);
+
+
+    //! @brief  Check whether a Buffer has a device copy
+    bool is_resident(const Buffer & b) const;
+
+
+    //! @brief  Change the budget, evicting copies if it is now exceeded. 0 is unlimited.
+    void set_budget(const size_t budget_bytes);
+
+
+    //! @brief  Get the budget, in bytes
+    size_t budget() const;
+
+
+    //! @brief  Get the size of the device copies that count toward the budget, in bytes
+    size_t resident_bytes() const;
+
+
+    //! @brief  Get the number of uploads made since construction, whole or partial
+    uint64_t uploads() const;
+
+
+    //! @brief  Get the number of bytes uploaded since construction
+    uint64_t uploaded_bytes() const;
+
+private:
+
+    //! @brief  Which side of a resident Buffer holds the current data
+    enum State
+    {
+        CLEAN = 0,
+        HOST_DIRTY = 1,
+        DEVICE_DIRTY = 2
+    };
+
+    //! @brief  A resident Buffer
+    struct Entry
+    {
+        //! The device copy
+        std::shared_ptr<Device_Buffer> device;
+
+        //! The size of the device copy, in bytes
+        size_t bytes;
+
+        //! Which side holds the current data
+        State state;
+
+        //! The position of the Buffer in m_lru
+        std::list<const float *>::iterator lru;
+    };
+
+    //! @brief  Drop an entry, copying it back first if it is device-dirty. m_mutex must be held.
+    void drop(std::map<const float *, Entry>::iterator it);
+
+    //! @brief  Drop entries whose host memory is held by nothing else. m_mutex must be held.
+    void prune();
+
+    //! @brief  Evict least recently used entries until extra bytes fit in the budget, sparing
+    //!         keep. m_mutex must be held.
+    void make_room(const size_t extra, const float * keep);
+
+    //! The context to make device copies in
+    std::shared_ptr<cl::Context> m_ctx;
+
+    //! Guards the members below it
+    mutable std::mutex m_mutex;
+
+    //! The most device memory to keep resident, or 0 for no limit
+    size_t m_budget;
+
+    //! The total size of the entries
+    size_t m_resident;
+
+    //! The number of uploads made
+    uint64_t m_uploads;
+
+    //! The number of bytes uploaded
+    uint64_t m_uploaded_bytes;
+
+    //! The resident Buffers, by the address of their memory
+    std::map<const float *, Entry> m_entries;
+
+    //! The resident Buffers, from most to least recently acquired
+    std::list<const float *> m_lru;
+};
+
+}
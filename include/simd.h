@@ -0,0 +1,117 @@
+//! @file       simd.h
+//! @brief      Declares the fixed-width vector types used by the CPU implementations
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+#pragma once
+
+// CLarity Imports
+
+// Standard Imports
+#include <cstdint>
+#include <cstring>
+
+// Third-Party Imports
+
+namespace clarity
+{
+namespace simd
+{
+
+//! @brief  The number of lanes in each vector type.
+//!
+//! @detail Four 32-bit lanes is the SSE2 baseline every x86-64 target supports; the vector
+//!         extensions below lower to NEON on ARM and to scalar code elsewhere. Arithmetic on
+//!         these types is IEEE lane-by-lane, so a vector loop and its scalar tail produce
+//!         bit-identical results.
+constexpr uint32_t WIDTH = 4;
+
+//! Four single-precision floats
+typedef float f32x4 __attribute__((vector_size(16)));
+
+//! Four signed 32-bit integers. Also the result type of comparisons on f32x4.
+typedef int32_t i32x4 __attribute__((vector_size(16)));
+
+//! Four unsigned 32-bit integers
+typedef uint32_t u32x4 __attribute__((vector_size(16)));
+
+
+//! @brief  Load WIDTH floats from unaligned memory
+inline f32x4 load(const float * p)
+{
+    f32x4 v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+
+//! @brief  Load WIDTH signed integers from unaligned memory
+inline i32x4 load(const int32_t * p)
+{
+    i32x4 v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+
+//! @brief  Store WIDTH floats to unaligned memory
+inline void store(float * p, const f32x4 & v)
+{
+    std::memcpy(p, &v, sizeof(v));
+}
+
+
+//! @brief  Store WIDTH signed integers to unaligned memory
+inline void store(int32_t * p, const i32x4 & v)
+{
+    std::memcpy(p, &v, sizeof(v));
+}
+
+
+//! @brief  Broadcast a float to every lane
+inline f32x4 splat(const float x)
+{
+    return f32x4 { x, x, x, x };
+}
+
+
+//! @brief  Broadcast a signed integer to every lane
+inline i32x4 splat(const int32_t x)
+{
+    return i32x4 { x, x, x, x };
+}
+
+
+//! @brief  Broadcast an unsigned integer to every lane
+inline u32x4 splat(const uint32_t x)
+{
+    return u32x4 { x, x, x, x };
+}
+
+
+//! @brief  Lane-wise select: mask ? a : b. mask lanes must be 0 or -1 (a comparison result).
+inline f32x4 select(const i32x4 & mask, const f32x4 & a, const f32x4 & b)
+{
+    // A C-style cast between vector types of the same size reinterprets the bits
+    const i32x4 ai = (i32x4) a;
+    const i32x4 bi = (i32x4) b;
+    return (f32x4) ((ai & mask) | (bi & ~mask));
+}
+
+
+//! @brief  Lane-wise conversion from float to signed integer, truncating toward zero
+inline i32x4 to_int(const f32x4 & v)
+{
+    return __builtin_convertvector(v, i32x4);
+}
+
+
+//! @brief  Lane-wise conversion from signed integer to float
+inline f32x4 to_float(const i32x4 & v)
+{
+    return __builtin_convertvector(v, f32x4);
+}
+
+}
+}
@@ -8,9 +8,12 @@
 
 // CLarity Imports
 #include "buffer.h"
+#include "procedural_terrain.h"
+#include "terrain_pyramid.h"
 
 // Standard Imports
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <utility>
 
@@ -39,6 +42,12 @@ public:
     Terrain(std::shared_ptr<Buffer> buffer, const float scale_m_per_cell);
 
 
+    //! @brief Constructor for a Terrain whose tiles are generated on demand
+    //!
+    //! @param[in] source               the procedural terrain. Its scale is used.
+    explicit Terrain(std::shared_ptr<Procedural_Terrain> source);
+
+
     //! @brief Destructor for the Terrain type
     ~Terrain();
 
@@ -54,20 +63,61 @@ public:
 
 
     //! @brief      get a reference to the buffer
+    //! @detail     Throws std::runtime_error for a procedural Terrain, which has no buffer.
     const Buffer & data() const;
 
     //! @brief      get a reference to the buffer
+    //! @detail     Throws std::runtime_error for a procedural Terrain, which has no buffer.
     Buffer & data();
 
+    //! @brief      Get the procedural source of the Terrain, or null if it is backed by a buffer
+    std::shared_ptr<Procedural_Terrain> procedural() const;
+
     //! @brief      Get the scale of each Terrain map cell
     float scale() const;
 
+    //! @brief      Build a Terrain_Pyramid of the buffer, so that range calculators can walk
+    //!             distant rays at a coarser level of detail
+    //! @detail     Copies of the Terrain share the pyramid. Call again after modifying the
+    //!             buffer other than through edit(). Throws std::runtime_error for a
+    //!             procedural Terrain.
+    //!
+    //! @param[in] max_levels           the maximum number of levels. 0 builds every level.
+    void build_pyramid(const uint32_t max_levels = 0);
+
+    //! @brief      Get the pyramid of the buffer, or null if none has been built
+    std::shared_ptr<Terrain_Pyramid> pyramid() const;
+
+    //! @brief      A function that edits the height of one cell
+    //!
+    //! @param[in]      row     the row of the cell
+    //! @param[in]      col     the column of the cell
+    //! @param[in,out]  height  the height of the cell, in cells
+    typedef std::function<void(uint32_t row, uint32_t col, float & height)> Cell_Editor;
+
+    //! @brief      Edit a rectangle of the height map, such as to cut a crater or raise a berm
+    //!
+    //! @detail     The rectangle is recorded as dirty in the buffer, so a device copy of the
+    //!             Terrain only uploads the rectangle, and the pyramid, if there is one, is
+    //!             only refitted above the rectangle. Throws std::out_of_range if the rectangle
+    //!             is not inside the Terrain and std::runtime_error for a procedural Terrain.
+    //!
+    //! @param[in] region               the rectangle of cells to edit
+    //! @param[in] editor               called once for each cell of the rectangle
+    void edit(const Buffer::Region & region, const Cell_Editor & editor);
+
 private:
     //! The underlying buffer
     std::shared_ptr<Buffer> m_buffer;
 
+    //! The procedural source, if the Terrain has no buffer
+    std::shared_ptr<Procedural_Terrain> m_source;
+
     //! The scale of each cell, in meters per cell
-    uint32_t m_scale_m_per_cell;
+    float m_scale_m_per_cell;
+
+    //! The level-of-detail pyramid of the buffer, if one has been built
+    std::shared_ptr<Terrain_Pyramid> m_pyramid;
 };
 
 }
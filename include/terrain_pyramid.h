@@ -0,0 +1,143 @@
+//! @file       terrain_pyramid.h
+//! @brief      Declares the Terrain_Pyramid type, a stack of downsampled height maps used to
+//!             walk distant rays at a coarser level of detail
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+#pragma once
+
+// CLarity Imports
+#include "buffer.h"
+
+// Standard Imports
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Third-Party Imports
+
+namespace clarity
+{
+
+//! @brief  The minimum and maximum heights of a height map over successively larger blocks.
+//!
+//! @detail Level 0 is the height map itself and is not stored. Each cell of level L covers a
+//!         2^L x 2^L block of the height map, and holds the minimum and maximum height in the
+//!         block. Each level has half the rows and cols of the one below it, rounded up, down
+//!         to a single cell or the requested number of levels.
+//!
+//!         All levels are packed into one Buffer of depth 2 (min, max), level 1 first and each
+//!         level in row-major order, so the whole pyramid can be uploaded to a device at once.
+//!
+//!         After an edit of part of the height map, refit() recomputes only the cells above the
+//!         edit, which is the edited area plus a few cells on each of the log(n) levels. The
+//!         cells it writes are recorded as dirty rectangles of packed(), so a device copy only
+//!         uploads those.
+class Terrain_Pyramid
+{
+public:
+
+    //! @brief  Build the pyramid of a height map
+    //!
+    //! @param[in]  heights     the height map. Must have a depth of 1.
+    //! @param[in]  max_levels  the maximum number of levels above the height map. 0 builds
+    //!                         every level down to a single cell.
+    explicit Terrain_Pyramid(const Buffer & heights, const uint32_t max_levels = 0);
+
+
+    //! @brief  Destructor
+    ~Terrain_Pyramid();
+
+
+    //! @brief  Deleted copy constructor
+    Terrain_Pyramid(const Terrain_Pyramid & other) = delete;
+
+
+    //! @brief  Deleted assignment operator
+    Terrain_Pyramid & operator=(const Terrain_Pyramid & other) = delete;
+
+
+    //! @brief  Recompute every level from a height map of the same size
+    //!
+    //! @param[in]  heights     the height map
+    void rebuild(const Buffer & heights);
+
+
+    //! @brief  Recompute the cells above a rectangle of the height map that has changed
+    //!
+    //! @param[in]  heights     the height map, of the same size
+    //! @param[in]  region      the changed rectangle. Throws std::out_of_range if it is not
+    //!                         inside the height map.
+    void refit(const Buffer & heights, const Buffer::Region & region);
+
+
+    //! @brief  Get the cells of the next level up that cover a rectangle of cells
+    static Buffer::Region parent(const Buffer::Region & region);
+
+
+    //! @brief  Get the number of levels above the height map
+    uint32_t levels() const;
+
+
+    //! @brief  Get the (rows, cols) of a level. Level 0 is the height map.
+    std::pair<uint32_t, uint32_t> size(const uint32_t level) const;
+
+
+    //! @brief  Get the index of the first cell of a level in packed(). level must be at least 1.
+    size_t offset(const uint32_t level) const;
+
+
+    //! @brief  Get the minimum height of a cell. level must be in [1, levels()].
+    float min(const uint32_t level, const uint32_t row, const uint32_t col) const;
+
+
+    //! @brief  Get the maximum height of a cell. level must be in [1, levels()].
+    float max(const uint32_t level, const uint32_t row, const uint32_t col) const;
+
+
+    //! @brief  Get every level, packed into one Buffer with one (min, max) pair per row
+    const Buffer & packed() const;
+
+
+    //! @brief  Get the distance along a ray at which level 1 is within an error budget
+    //!
+    //! @detail A cell of level L spans 2^L cells of the height map, so walking level L can
+    //!         misplace a hit by up to its diagonal. That is within budget once the footprint of
+    //!         budget pixels has grown to the diagonal. Level L is within budget beyond 2^(L-1)
+    //!         times the returned distance.
+    //!
+    //! @param[in]  focal_length    the focal length of the Camera, in pixels
+    //! @param[in]  error_pixels    the error budget, in pixels. Must be positive.
+    //!
+    //! @return the distance, in height map cells
+    static float lod_distance(const float focal_length, const float error_pixels);
+
+
+    //! @brief  Get a counter that is incremented whenever the pyramid is modified, so that
+    //!         copies of it (e.g. on a device) can tell when they are stale
+    uint64_t version() const;
+
+private:
+
+    //! @brief  Recompute a rectangle of one level from the level below it
+    void fit(const Buffer & heights, const uint32_t level, const Buffer::Region & region);
+
+    //! @brief  Check that a height map has the size of level 0
+    void check_heights(const Buffer & heights) const;
+
+    //! The (rows, cols) of each level, including level 0
+    std::vector<std::pair<uint32_t, uint32_t>> m_sizes;
+
+    //! The index of the first cell of each level in m_packed. Entry 0 is unused.
+    std::vector<size_t> m_offsets;
+
+    //! Every level above the height map
+    Buffer m_packed;
+
+    //! Incremented on every modification
+    uint64_t m_version;
+};
+
+}
@@ -0,0 +1,141 @@
+//! @file       thread_pool.h
+//! @brief      Declares the Thread_Pool type, which spreads loops over a fixed set of threads
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+#pragma once
+
+// CLarity Imports
+
+// Standard Imports
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Third-Party Imports
+
+namespace clarity
+{
+
+//! @brief  A fixed set of worker threads for data-parallel loops.
+//!
+//! @detail The threads are created once and reused for every call to parallel_for, so a loop
+//!         costs a wake-up rather than a thread creation. The calling thread takes part in the
+//!         work. Calls from different threads are serialized. A parallel_for issued from
+//!         inside one of the pool's own tasks runs inline on the calling thread.
+class Thread_Pool
+{
+public:
+
+    //! @brief  The signature of a loop body. Called with a half-open range [begin, end).
+    typedef std::function<void(const uint32_t begin, const uint32_t end)> Task;
+
+
+    //! @brief  Constructor
+    //!
+    //! @param[in]  num_threads     the total number of threads to use, including the caller.
+    //!                             0 selects the number of hardware threads.
+    explicit Thread_Pool(const unsigned num_threads = 0);
+
+
+    //! @brief  Construct a pool whose workers are pinned to CPUs
+    //!
+    //! @detail There is one thread per CPU, and the worker for each CPU but the first is
+    //!         pinned to it. The caller stands in for the first CPU, so it should be pinned
+    //!         there (or to the same set) by whoever calls parallel_for.
+    //!
+    //! @param[in]  cpus    the CPUs to use. Must not be empty.
+    explicit Thread_Pool(const std::vector<unsigned> & cpus);
+
+
+    //! @brief  Destructor. Joins the worker threads.
+    ~Thread_Pool();
+
+
+    //! @brief  Deleted copy constructor
+    Thread_Pool(const Thread_Pool & other) = delete;
+
+
+    //! @brief  Deleted assignment operator
+    Thread_Pool & operator=(const Thread_Pool & other) = delete;
+
+
+    //! @brief  Get the number of threads that share the work, including the caller
+    unsigned size() const;
+
+
+    //! @brief  Run a loop body over [begin, end), blocking until it has completed
+    //!
+    //! @detail The range is split into chunks of at least grain iterations. If any chunk
+    //!         throws, the first exception is rethrown on the calling thread once all chunks
+    //!         have finished.
+    //!
+    //! @param[in]  begin   the first index
+    //! @param[in]  end     one past the last index
+    //! @param[in]  task    the loop body
+    //! @param[in]  grain   the minimum number of iterations per chunk
+    void parallel_for(const uint32_t begin,
+                      const uint32_t end,
+                      const Task & task,
+                      const uint32_t grain = 1);
+
+private:
+
+    //! @brief  The body of each worker thread
+    void run();
+
+
+    //! @brief  Claim and run chunks of the current loop until none are left
+    void work();
+
+    //! The worker threads
+    std::vector<std::thread> m_workers;
+
+    //! Serializes callers of parallel_for
+    std::mutex m_call_mutex;
+
+    //! Guards the loop state below
+    std::mutex m_mutex;
+
+    //! Signalled when a new loop is posted or the pool is stopping
+    std::condition_variable m_posted;
+
+    //! Signalled when a worker finishes its share of a loop
+    std::condition_variable m_finished;
+
+    //! Incremented for every loop so workers can tell a new loop from the last one
+    uint64_t m_generation;
+
+    //! The number of workers still working on the current loop
+    unsigned m_active;
+
+    //! Whether the workers should exit
+    bool m_stopping;
+
+    //! The body of the current loop
+    const Task * m_task;
+
+    //! The first index of the current loop
+    uint32_t m_begin;
+
+    //! One past the last index of the current loop
+    uint32_t m_end;
+
+    //! The number of iterations in each chunk of the current loop
+    uint32_t m_chunk;
+
+    //! The next unclaimed chunk of the current loop. Wide enough that claiming past the end
+    //! cannot wrap around.
+    std::atomic<uint64_t> m_next;
+
+    //! The first exception thrown by the current loop
+    std::exception_ptr m_error;
+};
+
+}
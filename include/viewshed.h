@@ -0,0 +1,61 @@
+//! @file       viewshed.h
+//! @brief      Declares the viewshed API, which finds every terrain cell visible from an observer
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+#pragma once
+
+// CLarity Imports
+#include "buffer.h"
+#include "terrain.h"
+
+// Standard Imports
+#include <tuple>
+
+// Third-Party Imports
+
+
+namespace clarity
+{
+
+//! @brief  The interface for viewshed computation.
+//!
+//! @detail The viewshed is found by horizon propagation (XDraw) rather than by a line of sight
+//!         per cell. The cells around the observer are swept in square rings of increasing
+//!         distance. Each cell carries the height that a line of sight must clear to pass over
+//!         it. A cell takes that height from where the line from the observer crosses the ring
+//!         inside it, interpolating between the two nearest cells there. Each ring therefore
+//!         costs time proportional to its length.
+//!
+//!         The rings are split into the 8 octants around the observer. The octants do not
+//!         depend on one another, so they are swept in parallel.
+//!
+//!         The horizon is interpolated, so a cell that a line of sight only just clears or only
+//!         just misses may be classified either way.
+//!
+//!         This is a pure-virtual class; concrete implementations provide the sweep.
+class Viewshed
+{
+public:
+    //! @brief  A position in world coordinates, in meters
+    typedef std::tuple<float, float, float> Position;
+
+
+    //! @brief  Destructor
+    virtual ~Viewshed()
+    {
+        // No-op
+    }
+
+
+    //! @brief  Find the cells of a Terrain that are visible from an observer
+    //!
+    //! @param[in]  t           the terrain. Must not be procedural.
+    //! @param[in]  observer    the position of the observer. Must be over the terrain.
+    //! @param[out] visible     1 for each visible cell and 0 for each hidden one. Must be the
+    //!                         size of the terrain.
+    virtual void Compute(const Terrain & t, const Position & observer, Buffer & visible) = 0;
+};
+
+}
@@ -5,28 +5,113 @@
 //! @copyright  MIT
 
 // Clarity Imports
+#include "buffer.h"
+#include "huge_pages.h"
 #include "terrain.h"
 
 // Standard Imports
 #include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <exception>
 #include <memory>
+#include <mutex>
 #include <sstream>
+#include <stdexcept>
+#include <vector>
 
 // Third-Party Imports
 
 namespace clarity
 {
 
-Buffer::Buffer(const uint32_t rows, const uint32_t cols, const uint8_t depth)
+//! @brief  The most dirty rectangles kept before they are collapsed into one
+static constexpr size_t _MAX_DIRTY_REGIONS = 32;
+
+
+//! @brief  Check whether two rectangles overlap or share an edge
+static bool _touches(const Buffer::Region & a, const Buffer::Region & b)
+{
+    return a.row <= b.row + b.rows && b.row <= a.row + a.rows
+        && a.col <= b.col + b.cols && b.col <= a.col + a.cols;
+}
+
+
+//! @brief  Get the smallest rectangle that holds two rectangles
+static Buffer::Region _bounds(const Buffer::Region & a, const Buffer::Region & b)
+{
+    const uint32_t row = std::min(a.row, b.row);
+    const uint32_t col = std::min(a.col, b.col);
+    const uint32_t row_end = std::max(a.row + a.rows, b.row + b.rows);
+    const uint32_t col_end = std::max(a.col + a.cols, b.col + b.cols);
+    return Buffer::Region { row, col, row_end - row, col_end - col };
+}
+
+
+//! @brief  The dirty rectangles of the memory of a Buffer, and the device copies reading them
+struct Buffer::Dirty_Log
+{
+    //! Guards the members below it
+    std::mutex mutex;
+
+    //! The generation of the last rectangle recorded
+    uint64_t generation = 0;
+
+    //! The rectangles, and the generation each was last written in
+    std::vector<Region> regions;
+    std::vector<uint64_t> generations;
+
+    //! The generation each device copy has uploaded
+    std::vector<std::weak_ptr<const std::atomic<uint64_t>>> readers;
+};
+
+
+//! @brief  Allocate the memory of a Buffer
+static std::shared_ptr<float> _allocate(const size_t count,
+                                        const Page_Policy pages,
+                                        huge_pages::Backing & backing)
+{
+    if (pages == HUGE_PAGES) {
+        return huge_pages::allocate(count, backing);
+    }
+
+    backing = huge_pages::STANDARD;
+    return std::shared_ptr<float>(new float[count], std::default_delete<float[]>());
+}
+
+
+Buffer::Buffer(const uint32_t rows,
+               const uint32_t cols,
+               const uint8_t depth,
+               const Page_Policy pages)
     : m_rows(rows)
     , m_cols(cols)
     , m_depth(depth)
-    , m_data(new float[m_rows * m_cols * m_depth])
+    , m_data()
+    , m_backing(huge_pages::STANDARD)
+    , m_dirty(std::make_shared<Dirty_Log>())
 {
-    // Zero the array on initialization
-    std::fill(m_data.get(), m_data.get() + (m_rows * m_cols * m_depth), 0.0);
+    m_data = _allocate(size_t(m_rows) * m_cols * m_depth, pages, m_backing);
+
+    // Zero the array on initialization. This is also the first touch that places huge pages.
+    std::fill(m_data.get(), m_data.get() + (size_t(m_rows) * m_cols * m_depth), 0.0);
+}
+
+
+Buffer::Buffer(std::shared_ptr<float> data, 
+               const uint32_t rows, 
+               const uint32_t cols, 
+               const uint8_t depth)
+    : m_rows(rows)
+    , m_cols(cols)
+    , m_depth(depth)
+    , m_data(data)
+    , m_backing(huge_pages::STANDARD)
+    , m_dirty(std::make_shared<Dirty_Log>())
+{
+    if (m_data == nullptr) {
+        throw std::invalid_argument("Cannot construct a Buffer around null memory");
+    }
 }
 
 
@@ -41,6 +126,8 @@ Buffer::Buffer(const Buffer & other)
     , m_cols(other.m_cols)
     , m_depth(other.m_depth)
     , m_data(other.m_data)
+    , m_backing(other.m_backing)
+    , m_dirty(other.m_dirty)
 {
     // No-op 
 }
@@ -57,6 +144,8 @@ Buffer & Buffer::operator=(const Buffer & other)
     m_cols = size.second;
     m_depth = other.depth();
     m_data = other.m_data;
+    m_backing = other.m_backing;
+    m_dirty = other.m_dirty;
 
     return *this;
 }
@@ -77,7 +166,7 @@ float & Buffer::at(const uint32_t row, const uint32_t col, uint8_t depth)
         throw std::out_of_range(msg.str());
     }
 
-    return *(m_data.get() + (row * m_cols + col * m_depth + depth));
+    return *(m_data.get() + ((size_t(row) * m_cols + col) * m_depth + depth));
 }
 
 
@@ -90,7 +179,7 @@ const float & Buffer::at(const uint32_t row, const uint32_t col, uint8_t depth)
         throw std::out_of_range(msg.str());
     }
 
-    return *(m_data.get() + (row * m_cols + col * m_depth + depth));
+    return *(m_data.get() + ((size_t(row) * m_cols + col) * m_depth + depth));
 }
 
 
@@ -105,4 +194,130 @@ uint8_t Buffer::depth() const
     return m_depth;
 }
 
+
+huge_pages::Backing Buffer::backing() const
+{
+    return m_backing;
+}
+
+
+void Buffer::mark_dirty(const Region & region)
+{
+    const uint64_t row_end = uint64_t(region.row) + region.rows;
+    const uint64_t col_end = uint64_t(region.col) + region.cols;
+    if (row_end > m_rows || col_end > m_cols) {
+        std::stringstream msg;
+        msg << "Region (" << region.row << ", " << region.col << ") of size (" << region.rows;
+        msg << ", " << region.cols << ") out of range for Buffer with size ";
+        msg << "(" << m_rows << ", " << m_cols << ")";
+        throw std::out_of_range(msg.str());
+    }
+
+    if (region.rows == 0 || region.cols == 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_dirty->mutex);
+    std::vector<Region> & dirty = m_dirty->regions;
+    std::vector<uint64_t> & generations = m_dirty->generations;
+
+    // Absorb every rectangle the new one touches; each merge can reach further ones. The
+    // result is new to every reader, so it takes the new generation.
+    Region merged = region;
+    for (bool grew = true; grew;) {
+        grew = false;
+        for (size_t i = 0; i < dirty.size(); i++) {
+            if (_touches(merged, dirty[i])) {
+                merged = _bounds(merged, dirty[i]);
+                dirty[i] = dirty.back();
+                dirty.pop_back();
+                generations[i] = generations.back();
+                generations.pop_back();
+                grew = true;
+                break;
+            }
+        }
+    }
+
+    if (dirty.size() >= _MAX_DIRTY_REGIONS) {
+        for (const auto & r : dirty) {
+            merged = _bounds(merged, r);
+        }
+        dirty.clear();
+        generations.clear();
+    }
+
+    dirty.push_back(merged);
+    generations.push_back(++m_dirty->generation);
+}
+
+
+std::vector<Buffer::Region> Buffer::dirty_regions() const
+{
+    std::lock_guard<std::mutex> lock(m_dirty->mutex);
+    return m_dirty->regions;
+}
+
+
+std::vector<Buffer::Region> Buffer::dirty_regions_since(const uint64_t generation) const
+{
+    std::lock_guard<std::mutex> lock(m_dirty->mutex);
+
+    std::vector<Region> regions;
+    for (size_t i = 0; i < m_dirty->regions.size(); i++) {
+        if (m_dirty->generations[i] > generation) {
+            regions.push_back(m_dirty->regions[i]);
+        }
+    }
+
+    return regions;
+}
+
+
+uint64_t Buffer::dirty_generation() const
+{
+    std::lock_guard<std::mutex> lock(m_dirty->mutex);
+    return m_dirty->generation;
+}
+
+
+void Buffer::clear_dirty()
+{
+    std::lock_guard<std::mutex> lock(m_dirty->mutex);
+
+    // Keep what the furthest behind of the live readers still needs
+    uint64_t oldest = m_dirty->generation;
+    std::vector<std::weak_ptr<const std::atomic<uint64_t>>> & readers = m_dirty->readers;
+    for (size_t i = 0; i < readers.size();) {
+        const std::shared_ptr<const std::atomic<uint64_t>> synced = readers[i].lock();
+        if (synced == nullptr) {
+            readers[i] = readers.back();
+            readers.pop_back();
+        } else {
+            oldest = std::min(oldest, synced->load());
+            i++;
+        }
+    }
+
+    std::vector<Region> & dirty = m_dirty->regions;
+    std::vector<uint64_t> & generations = m_dirty->generations;
+    for (size_t i = 0; i < dirty.size();) {
+        if (generations[i] <= oldest) {
+            dirty[i] = dirty.back();
+            dirty.pop_back();
+            generations[i] = generations.back();
+            generations.pop_back();
+        } else {
+            i++;
+        }
+    }
+}
+
+
+void Buffer::track_dirty(const std::shared_ptr<const std::atomic<uint64_t>> & synced)
+{
+    std::lock_guard<std::mutex> lock(m_dirty->mutex);
+    m_dirty->readers.push_back(synced);
+}
+
 }
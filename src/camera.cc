@@ -64,6 +64,20 @@ Camera & Camera::operator=(const Camera & other)
 }
 
 
+//! @brief  The dot product of two 3-vectors
+static float _dot(const float * a, const float * b)
+{
+    return (a[0] * b[0]) + (a[1] * b[1]) + (a[2] * b[2]);
+}
+
+
+//! @brief  The length of a 3-vector
+static float _length(const float * a)
+{
+    return std::sqrt(std::pow(a[0], 2) + std::pow(a[1], 2) + std::pow(a[2], 2));
+}
+
+
 // Reference: Francesco Callari https://stackoverflow.com/a/32530762
 float Camera::focal_length() const
 {
@@ -125,6 +139,24 @@ void Camera::set_pitch(const float pitch)
 }
 
 
+Camera::Position Camera::pixel_to_camera(const uint32_t row, const uint32_t col) const
+{
+    const float focal_length_pix = focal_length();
+    const uint16_t num_rows = m_focal_plane_size_pixels.first;
+    const uint16_t num_cols = m_focal_plane_size_pixels.second;
+
+    const float pix[3] = { static_cast<float>(row - (num_rows / 2.0f)), 
+                           static_cast<float>(col - (num_cols / 2.0f)), 
+                           focal_length_pix };
+    const float center[3] = { 0.0, 0.0, focal_length_pix };
+
+    const float ang = std::acos(_dot(center, pix) / (_length(pix) * _length(center)));
+    const float phi = std::atan2(pix[0], pix[1]);
+
+    return Position(std::cos(ang), std::sin(ang) * std::cos(phi), std::sin(ang) * std::sin(phi));
+}
+
+
 void Camera::get_rotation_matrix(std::shared_ptr<float> rot_buffer) const 
 {
     //const float r = 0.0; 
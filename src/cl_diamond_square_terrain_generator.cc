@@ -0,0 +1,201 @@
+//! @file       cl_diamond_square_terrain_generator.cc
+//! @brief      Defines an implementation of Terrain_Generator that runs the diamond-square
+//!             algorithm with OpenCL kernels
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "buffer.h"
+#include "clarity_config.h"
+#include "cl_diamond_square_terrain_generator.h"
+#include "cl_utils.h"
+#include "device_buffer.h"
+#include "terrain.h"
+#include "terrain_generator.h"
+
+// Standard Imports
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Third-Party Imports
+#include "cl.hpp"
+
+namespace clarity 
+{
+
+static std::map<std::string, std::string> _KERNEL_SOURCES {
+    { "ds_squares",     KERNEL_DIR + "/diamond_square.cl" },
+    { "ds_diamonds",    KERNEL_DIR + "/diamond_square.cl" }
+};
+
+
+CL_Diamond_Square_Generator::CL_Diamond_Square_Generator(const std::shared_ptr<cl::Context> ctx,
+                                                         const uint64_t seed)
+    : Terrain_Generator()
+    , m_ctx(ctx)
+    , m_queue()
+    , m_kernels()
+    , m_seed(seed)
+{
+    std::vector<cl::Device> devices;
+    m_ctx->getInfo(CL_CONTEXT_DEVICES, &devices);
+
+    if (devices.empty()) {
+        throw std::invalid_argument("The OpenCL context has no devices");
+    }
+
+    cl_int err = CL_SUCCESS;
+    m_queue = cl::CommandQueue(*m_ctx, devices[0], 0, &err);
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to create command queue (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+
+    m_kernels = std::unique_ptr<Kernel_Collection>(new Kernel_Collection(*m_ctx, _KERNEL_SOURCES));
+}
+
+
+CL_Diamond_Square_Generator::~CL_Diamond_Square_Generator()
+{
+    // No-op
+}
+
+
+uint64_t CL_Diamond_Square_Generator::seed() const
+{
+    return m_seed;
+}
+
+
+void CL_Diamond_Square_Generator::set_seed(const uint64_t seed)
+{
+    m_seed = seed;
+}
+
+
+//! @brief  Run one pass of the algorithm over a (num_rows, num_cols) grid of cells
+static void _run_pass(const cl::CommandQueue & queue,
+                      cl::Kernel & kernel,
+                      const char * name,
+                      const cl::Buffer & height_map,
+                      const uint32_t rows,
+                      const uint32_t cols,
+                      const uint32_t size,
+                      const uint64_t seed,
+                      const uint32_t level,
+                      const float feature_scale,
+                      const uint32_t num_rows,
+                      const uint32_t num_cols)
+{
+    cl_int err = CL_SUCCESS;
+    err |= kernel.setArg(0, height_map);
+    err |= kernel.setArg(1, static_cast<cl_uint>(rows));
+    err |= kernel.setArg(2, static_cast<cl_uint>(cols));
+    err |= kernel.setArg(3, static_cast<cl_uint>(size));
+    err |= kernel.setArg(4, static_cast<cl_ulong>(seed));
+    err |= kernel.setArg(5, static_cast<cl_uint>(level));
+    err |= kernel.setArg(6, feature_scale);
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to set " << name << " kernel args (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+
+    // Launches on one in-order queue, so each pass sees the results of the last
+    err = queue.enqueueNDRangeKernel(kernel, 
+                                     cl::NullRange, 
+                                     cl::NDRange(num_rows, num_cols), 
+                                     cl::NullRange);
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to enqueue " << name << " kernel (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+}
+
+
+Terrain CL_Diamond_Square_Generator::generate_terrain(std::shared_ptr<Buffer> buffer,
+                                                      const float scale, 
+                                                      const float roughness)
+{
+    Device_Buffer * device_buffer = dynamic_cast<Device_Buffer *>(buffer.get());
+    if (device_buffer == nullptr) {
+        throw std::invalid_argument("CL_Diamond_Square_Generator requires a Device_Buffer");
+    }
+
+    Terrain terrain(buffer, scale);
+    const cl::Buffer & height_map = device_buffer->get_cl_buffer();
+
+    const uint32_t rows = std::get<0>(buffer->size());
+    const uint32_t cols = std::get<1>(buffer->size());
+
+    // Initialize corners 
+    static const float _CORNER = CL_Diamond_Square_Generator::MAX_HEIGHT_M / 2;
+    const size_t corners[4] = { 0, cols - 1, (rows - 1) * cols, (rows - 1) * cols + cols - 1 };
+
+    for (const size_t corner : corners) {
+        const cl_int err = m_queue.enqueueWriteBuffer(height_map, 
+                                                      CL_FALSE, 
+                                                      corner * sizeof(float), 
+                                                      sizeof(float), 
+                                                      &_CORNER);
+        if (err != CL_SUCCESS) {
+            std::stringstream msg;
+            msg << "Failed to initialize terrain corners (cl error = " << err << ")";
+            throw std::runtime_error(msg.str());
+        }
+    }
+
+    cl::Kernel & squares = m_kernels->get("ds_squares");
+    cl::Kernel & diamonds = m_kernels->get("ds_diamonds");
+
+    uint32_t size = (rows - 1);
+    uint32_t half = size / 2;
+    uint32_t level = 0;
+
+    while (half >= 1) {
+        const float feature_scale = size * roughness;
+
+        _run_pass(m_queue, squares, "ds_squares", height_map, rows, cols, size, m_seed, level,
+                  feature_scale, (rows - half + size - 1) / size, (cols - half + size - 1) / size);
+
+        _run_pass(m_queue, diamonds, "ds_diamonds", height_map, rows, cols, size, m_seed, level,
+                  feature_scale, (rows + half - 1) / half, (cols + size - 1) / size);
+
+        size = size / 2;
+        half = size / 2;
+        level++;
+    }
+
+    const cl_int err = m_queue.finish();
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to generate terrain (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+
+    return terrain;
+}
+
+
+Terrain CL_Diamond_Square_Generator::generate_terrain(const uint32_t rows, 
+                                                      const uint32_t cols, 
+                                                      const float scale, 
+                                                      const float roughness)
+{
+    if (rows != cols) {
+        throw std::invalid_argument("Diamond-Square Generator requires that rows == cols");
+    }
+
+    std::shared_ptr<Buffer> buffer(new Device_Buffer(*m_ctx, rows, cols));
+    return generate_terrain(buffer, scale, roughness);
+}
+
+}
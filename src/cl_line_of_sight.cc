@@ -0,0 +1,294 @@
+//! @file       cl_line_of_sight.cc
+//! @brief      Defines an implementation of Line_Of_Sight that uses OpenCL kernels
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "clarity_config.h"
+#include "cl_line_of_sight.h"
+#include "cl_utils.h"
+#include "device_buffer.h"
+#include "line_of_sight.h"
+#include "residency_manager.h"
+#include "terrain.h"
+#include "terrain_pyramid.h"
+
+// Standard Imports
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Third-Party Imports
+#include "cl.hpp"
+
+
+namespace clarity
+{
+
+static std::map<std::string, std::string> _KERNEL_SOURCES {
+    { "line_of_sight",  KERNEL_DIR + "/line_of_sight.cl" }
+};
+
+
+CL_Line_Of_Sight::CL_Line_Of_Sight(const std::shared_ptr<cl::Context> ctx)
+    : m_ctx(ctx)
+    , m_queue()
+    , m_kernels()
+    , m_observers()
+    , m_targets()
+    , m_visible()
+    , m_distance()
+    , m_capacity(0)
+    , m_pyramid()
+    , m_levels()
+    , m_pyramid_source()
+    , m_pyramid_version(0)
+    , m_residency()
+    , m_terrain()
+{
+    std::vector<cl::Device> devices;
+    m_ctx->getInfo(CL_CONTEXT_DEVICES, &devices);
+
+    if (devices.empty()) {
+        throw std::invalid_argument("The OpenCL context has no devices");
+    }
+
+    cl_int err = CL_SUCCESS;
+    m_queue = cl::CommandQueue(*m_ctx, devices[0], 0, &err);
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to create command queue (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+
+    m_kernels = std::unique_ptr<Kernel_Collection>(new Kernel_Collection(*m_ctx, _KERNEL_SOURCES));
+    m_residency = std::make_shared<Residency_Manager>(m_ctx);
+}
+
+
+CL_Line_Of_Sight::~CL_Line_Of_Sight()
+{
+    // No-op
+}
+
+
+//! @brief  Throw if a batch of lines cannot be checked against a Terrain
+static void _check_query(const Terrain & t,
+                         const std::vector<Line_Of_Sight::Point> & observers,
+                         const std::vector<Line_Of_Sight::Point> & targets)
+{
+    if (t.procedural() != nullptr) {
+        throw std::invalid_argument("Line_Of_Sight does not support procedural terrain");
+    }
+
+    if (observers.size() != targets.size()) {
+        std::stringstream msg;
+        msg << "Mismatched line-of-sight query: (" << observers.size() << ") observers and ("
+            << targets.size() << ") targets";
+        throw std::invalid_argument(msg.str());
+    }
+}
+
+
+//! @brief  Pack a list of points as 4 floats each
+static std::vector<float> _pack(const std::vector<Line_Of_Sight::Point> & points)
+{
+    std::vector<float> packed;
+    packed.reserve(4 * points.size());
+
+    for (const auto & p : points) {
+        packed.push_back(std::get<0>(p));
+        packed.push_back(std::get<1>(p));
+        packed.push_back(std::get<2>(p));
+        packed.push_back(0.0f);
+    }
+
+    return packed;
+}
+
+
+void CL_Line_Of_Sight::upload_pyramid(const std::shared_ptr<Terrain_Pyramid> & pyramid)
+{
+    if (m_pyramid != nullptr && m_pyramid_source == pyramid) {
+        if (m_pyramid_version != pyramid->version()) {
+            // The device copy shares the packed levels, so only the cells refitted since the
+            // last upload need to be sent. A refit leaves the level table as it is.
+            m_pyramid->to_device_dirty(&m_queue);
+            m_pyramid_version = pyramid->version();
+        }
+
+        return;
+    }
+
+    m_pyramid = std::unique_ptr<Device_Buffer>(new Device_Buffer(pyramid->packed(), *m_ctx, true));
+    m_pyramid->to_device(&m_queue);
+
+    // The (offset, cols) of each level, so the kernel can index the packed levels
+    std::vector<cl_int> levels { 0, 0 };
+    for (uint32_t l = 1; l <= pyramid->levels(); l++) {
+        levels.push_back(static_cast<cl_int>(pyramid->offset(l)));
+        levels.push_back(static_cast<cl_int>(pyramid->size(l).second));
+    }
+
+    cl_int err = CL_SUCCESS;
+    m_levels = cl::Buffer(*m_ctx,
+                          CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                          levels.size() * sizeof(cl_int),
+                          levels.data(),
+                          &err);
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to create the pyramid level table (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+
+    m_pyramid_source = pyramid;
+    m_pyramid_version = pyramid->version();
+}
+
+
+void CL_Line_Of_Sight::Check(const Terrain & t,
+                             const std::vector<Point> & observers,
+                             const std::vector<Point> & targets,
+                             std::vector<uint8_t> & visible,
+                             std::vector<float> & distance)
+{
+    _check_query(t, observers, targets);
+
+    const uint32_t n = static_cast<uint32_t>(observers.size());
+    visible.resize(n);
+    distance.resize(n);
+    if (n == 0) {
+        return;
+    }
+
+    cl_int err = CL_SUCCESS;
+
+    // Grow the query buffers as needed; they are reused by later queries
+    if (m_capacity < n) {
+        m_observers = std::unique_ptr<Device_Buffer>(new Device_Buffer(*m_ctx, 1, n, 4, true));
+        m_targets = std::unique_ptr<Device_Buffer>(new Device_Buffer(*m_ctx, 1, n, 4, true));
+        m_distance = std::unique_ptr<Device_Buffer>(new Device_Buffer(*m_ctx, 1, n));
+        m_visible = cl::Buffer(*m_ctx, CL_MEM_WRITE_ONLY, n * sizeof(cl_uchar), nullptr, &err);
+        if (err != CL_SUCCESS) {
+            std::stringstream msg;
+            msg << "Failed to create the visibility buffer (cl error = " << err << ")";
+            throw std::runtime_error(msg.str());
+        }
+
+        m_capacity = n;
+    }
+
+    const std::vector<float> packed_observers = _pack(observers);
+    const std::vector<float> packed_targets = _pack(targets);
+
+    err = m_queue.enqueueWriteBuffer(m_observers->get_cl_buffer(),
+                                     CL_TRUE,
+                                     0,
+                                     packed_observers.size() * sizeof(float),
+                                     packed_observers.data());
+    err |= m_queue.enqueueWriteBuffer(m_targets->get_cl_buffer(),
+                                      CL_TRUE,
+                                      0,
+                                      packed_targets.size() * sizeof(float),
+                                      packed_targets.data());
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to write lines for line_of_sight (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+
+    // Without a pyramid the kernel never reads the pyramid arguments, but they must be set
+    const std::shared_ptr<Terrain_Pyramid> pyramid = t.pyramid();
+    cl_int num_levels = 0;
+    if (pyramid != nullptr) {
+        upload_pyramid(pyramid);
+        num_levels = static_cast<cl_int>(pyramid->levels());
+    }
+    const cl::Buffer & pyramid_buffer = pyramid != nullptr ? m_pyramid->get_cl_buffer()
+                                                           : m_observers->get_cl_buffer();
+    const cl::Buffer & levels_buffer = pyramid != nullptr ? m_levels
+                                                          : m_observers->get_cl_buffer();
+
+    const Device_Buffer & terrain_db = device_terrain(t);
+    const auto & terrain_size = t.data().size();
+    const cl_float2 bounds = {{ static_cast<float>(std::get<0>(terrain_size)),
+                                static_cast<float>(std::get<1>(terrain_size)) }};
+
+    cl::Kernel & kernel = m_kernels->get("line_of_sight");
+    err = kernel.setArg(0, m_observers->get_cl_buffer());
+    err |= kernel.setArg(1, m_targets->get_cl_buffer());
+    err |= kernel.setArg(2, terrain_db.get_cl_buffer());
+    err |= kernel.setArg(3, pyramid_buffer);
+    err |= kernel.setArg(4, levels_buffer);
+    err |= kernel.setArg(5, num_levels);
+    err |= kernel.setArg(6, t.scale());
+    err |= kernel.setArg(7, t.scale() / 5.0f);
+    err |= kernel.setArg(8, bounds);
+    err |= kernel.setArg(9, m_visible);
+    err |= kernel.setArg(10, m_distance->get_cl_buffer());
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to set line_of_sight kernel args (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+
+    err = m_queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(n), cl::NullRange);
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to enqueue line_of_sight kernel (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+
+    err = m_queue.enqueueReadBuffer(m_visible, CL_FALSE, 0, n * sizeof(cl_uchar), visible.data());
+    err |= m_queue.enqueueReadBuffer(m_distance->get_cl_buffer(),
+                                     CL_TRUE,
+                                     0,
+                                     n * sizeof(float),
+                                     distance.data());
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to read results from line_of_sight (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+}
+
+
+const Device_Buffer & CL_Line_Of_Sight::device_terrain(const Terrain & t)
+{
+    const Device_Buffer * db = dynamic_cast<const Device_Buffer *>(&t.data());
+    if (db != nullptr) {
+        // The caller's device copy is used as is, once the rectangles edited since its last
+        // upload are sent. Uploading leaves the heights themselves unchanged.
+        const_cast<Device_Buffer *>(db)->to_device_dirty(&m_queue);
+        return *db;
+    }
+
+    m_terrain = m_residency->acquire(t.data(), &m_queue);
+    return *m_terrain;
+}
+
+
+void CL_Line_Of_Sight::set_residency(const std::shared_ptr<Residency_Manager> residency)
+{
+    if (residency == nullptr) {
+        throw std::invalid_argument("Invalid argument. The residency manager cannot be null");
+    }
+
+    m_residency = residency;
+    m_terrain.reset();
+}
+
+
+std::shared_ptr<Residency_Manager> CL_Line_Of_Sight::residency() const
+{
+    return m_residency;
+}
+
+}
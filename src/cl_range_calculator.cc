@@ -12,16 +12,21 @@
 #include "cl_range_calculator.h"
 #include "cl_utils.h"
 #include "device_buffer.h"
+#include "procedural_terrain.h"
 #include "range_calculator.h"
+#include "range_quantization.h"
 #include "terrain.h"
+#include "terrain_pyramid.h"
 
 // Standard Imports
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <iostream>
 #include <map>
 #include <memory>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <tuple>
 #include <vector>
@@ -37,7 +42,11 @@ namespace clarity
 static std::map<std::string, std::string> _KERNEL_SOURCES {
     { "pix2cam",    KERNEL_DIR + "/pix_2_cam_coords.cl" },
     { "cam2world",  KERNEL_DIR + "/cam_2_world_coords.cl" },
-    { "map_range",  KERNEL_DIR + "/map_range.cl" }
+    { "map_range",  KERNEL_DIR + "/map_range.cl" },
+    { "map_range_lod", KERNEL_DIR + "/map_range.cl" },
+    { "map_hits",   KERNEL_DIR + "/map_range.cl" },
+    { "map_range_rays", KERNEL_DIR + "/map_range.cl" },
+    { "pack_range_u16", KERNEL_DIR + "/map_range.cl" }
 };
 
 
@@ -68,6 +77,38 @@ static void _check_buffer_size(const Buffer & b,
 }
 
 
+static void _check_pixel(const Camera & cam, const uint32_t row, const uint32_t col)
+{
+    const auto & sz = cam.focal_plane_dimensions();
+
+    if (row >= std::get<0>(sz) || col >= std::get<1>(sz)) {
+        std::stringstream msg;
+        msg << "Pixel (" << row << ", " << col << ") is outside of the focal plane of size ("
+            << std::get<0>(sz) << ", " << std::get<1>(sz) << ")";
+        throw std::out_of_range(msg.str());
+    }
+}
+
+
+//! @brief  Append the world pointing vector of a pixel, and the range at which to start
+//!         walking it, to a list of rays
+static void _append_ray(const Camera & cam, 
+                        const float * rot, 
+                        const uint32_t row, 
+                        const uint32_t col, 
+                        const float start,
+                        std::vector<float> & rays)
+{
+    const Camera::Position p = cam.pixel_to_camera(row, col);
+    const float v[3] = { std::get<0>(p), std::get<1>(p), std::get<2>(p) };
+
+    for (int i = 0; i < 3; i++) {
+        rays.push_back((rot[4 * i] * v[0]) + (rot[4 * i + 1] * v[1]) + (rot[4 * i + 2] * v[2]));
+    }
+    rays.push_back(start);
+}
+
+
 CL_Range_Calculator::CL_Range_Calculator()
     : m_ctx()
     , m_devices()
@@ -77,28 +118,29 @@ CL_Range_Calculator::CL_Range_Calculator()
     , m_kernels()
     , m_rot()
     , m_device_idx(0)
+    , m_window()
+    , m_window_source()
+    , m_window_origin(0, 0)
+    , m_lod_error(0.0f)
+    , m_pyramid()
+    , m_pyramid_source()
+    , m_pyramid_version(0)
+    , m_rays()
+    , m_ray_ranges()
+    , m_range()
+    , m_codes()
+    , m_codes_bytes(0)
+    , m_residency()
+    , m_terrain()
 {
-    cl_int err;
-
-    m_ctx = get_context();
-    m_ctx->getInfo(CL_CONTEXT_DEVICES, &m_devices);
+    // The context, its queues and the built kernels are shared by every default calculator
+    const std::shared_ptr<CL_Runtime> runtime = CL_Runtime::instance();
+    m_ctx = runtime->context();
+    m_devices = runtime->devices();
+    m_device_queues = runtime->queues();
 
     m_rot = std::unique_ptr<Device_Buffer>(new Device_Buffer(*m_ctx, 3, 4, 1, true));
-   
-    // Create a queue for each device
-    for (const auto & d : m_devices) {
-        m_device_queues.emplace_back(*m_ctx, d, 0, &err);
-
-        if (err != CL_SUCCESS) {
-            std::string device_name;
-            d.getInfo(CL_DEVICE_NAME, &device_name);
-
-            std::stringstream msg;
-            msg << "Failed to create command queue for device (" << device_name << ") ";
-            msg << "(cl error = " << err << ")";
-            throw std::runtime_error(msg.str());
-        }
-    }
+    m_residency = std::make_shared<Residency_Manager>(m_ctx);
 
     // Construct the kernel collection
     m_kernels = std::unique_ptr<Kernel_Collection>(new Kernel_Collection(*m_ctx, _KERNEL_SOURCES));
@@ -115,6 +157,20 @@ CL_Range_Calculator::CL_Range_Calculator(const std::shared_ptr<cl::Context> ctx)
     , m_kernels()
     , m_rot(new Device_Buffer(*m_ctx, 3, 4, 1))
     , m_device_idx(0)
+    , m_window()
+    , m_window_source()
+    , m_window_origin(0, 0)
+    , m_lod_error(0.0f)
+    , m_pyramid()
+    , m_pyramid_source()
+    , m_pyramid_version(0)
+    , m_rays()
+    , m_ray_ranges()
+    , m_range()
+    , m_codes()
+    , m_codes_bytes(0)
+    , m_residency()
+    , m_terrain()
 {
     // Get the devices for the context
     m_ctx->getInfo(CL_CONTEXT_DEVICES, &m_devices); 
@@ -135,6 +191,7 @@ CL_Range_Calculator::CL_Range_Calculator(const std::shared_ptr<cl::Context> ctx)
         }
     }
     
+    m_residency = std::make_shared<Residency_Manager>(m_ctx);
     m_kernels = std::unique_ptr<Kernel_Collection>(new Kernel_Collection(*m_ctx, _KERNEL_SOURCES));
 }
 
@@ -165,7 +222,289 @@ void CL_Range_Calculator::Calculate(const Camera & cam, const Terrain & t, Buffe
 
     run_cam2world(cam, *m_camera_coords, *m_world_coords, true);
 
-    run_map_range(cam, t, *m_world_coords, rng, true);
+    run_map_range(cam, t, *m_world_coords, rng, false, true);
+}
+
+
+void CL_Range_Calculator::Calculate_Quantized(const Camera & cam,
+                                              const Terrain & t,
+                                              const Range_Quantization & q,
+                                              std::vector<uint16_t> & codes)
+{
+    const auto & fp_size = cam.focal_plane_dimensions();
+    const auto rows = std::get<0>(fp_size);
+    const auto cols = std::get<1>(fp_size);
+    const size_t n = static_cast<size_t>(rows) * cols;
+
+    if (m_camera_coords == nullptr || _wrong_buffer_size(*m_camera_coords, fp_size, 4)) {
+        m_camera_coords = std::unique_ptr<Device_Buffer>(new Device_Buffer(*m_ctx, rows, cols, 4));
+    }
+
+    run_pix2cam(cam, *m_camera_coords, false);
+
+    if (m_world_coords == nullptr || _wrong_buffer_size(*m_world_coords, fp_size, 4)) {
+        m_world_coords = std::unique_ptr<Device_Buffer>(new Device_Buffer(*m_ctx, rows, cols, 4));
+    }
+
+    run_cam2world(cam, *m_camera_coords, *m_world_coords, false);
+
+    // The float ranges stay on the device; only the codes are copied back
+    if (m_range == nullptr || _wrong_buffer_size(*m_range, fp_size, 1)) {
+        m_range = std::unique_ptr<Device_Buffer>(new Device_Buffer(*m_ctx, rows, cols));
+    }
+
+    run_map_range(cam, t, *m_world_coords, *m_range, false, false);
+
+    cl_int err = CL_SUCCESS;
+    if (m_codes_bytes < n * sizeof(uint16_t)) {
+        m_codes_bytes = n * sizeof(uint16_t);
+        m_codes = cl::Buffer(*m_ctx, CL_MEM_WRITE_ONLY, m_codes_bytes, nullptr, &err);
+        if (err != CL_SUCCESS) {
+            m_codes_bytes = 0;
+            std::stringstream msg;
+            msg << "Failed to create range code buffer (cl error = " << err << ")";
+            throw std::runtime_error(msg.str());
+        }
+    }
+
+    cl::Kernel & kernel = m_kernels->get("pack_range_u16");
+    err = kernel.setArg(0, m_range->get_cl_buffer());
+    err |= kernel.setArg(1, q.offset);
+    err |= kernel.setArg(2, q.step);
+    err |= kernel.setArg(3, m_codes);
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to set kernel args for pack_range_u16 (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+
+    const cl::CommandQueue & queue = m_device_queues[m_device_idx];
+    err = queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(n), cl::NullRange);
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to enqueue pack_range_u16 kernel (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+
+    codes.resize(n);
+    err = queue.enqueueReadBuffer(m_codes, CL_TRUE, 0, n * sizeof(uint16_t), codes.data());
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to read range codes (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+}
+
+
+void CL_Range_Calculator::Calculate_Hits(const Camera & cam, const Terrain & t, Buffer & hits)
+{
+    const auto & fp_size = cam.focal_plane_dimensions();
+    const auto rows = std::get<0>(fp_size);
+    const auto cols = std::get<1>(fp_size);
+
+    _check_buffer_size(hits, fp_size, HIT_DEPTH);
+
+    if (m_camera_coords == nullptr || _wrong_buffer_size(*m_camera_coords, fp_size, 4)) {
+        m_camera_coords = std::unique_ptr<Device_Buffer>(new Device_Buffer(*m_ctx, rows, cols, 4));
+    }
+
+    // The coordinates stay on the device; only the hits are copied back
+    run_pix2cam(cam, *m_camera_coords, false);
+
+    if (m_world_coords == nullptr || _wrong_buffer_size(*m_world_coords, fp_size, 4)) {
+        m_world_coords = std::unique_ptr<Device_Buffer>(new Device_Buffer(*m_ctx, rows, cols, 4));
+    }
+
+    run_cam2world(cam, *m_camera_coords, *m_world_coords, false);
+
+    run_map_range(cam, t, *m_world_coords, hits, true, true);
+}
+
+
+void CL_Range_Calculator::Calculate_Pixels(const Camera & cam, 
+                                           const Terrain & t, 
+                                           const std::vector<Pixel> & pixels, 
+                                           std::vector<float> & ranges)
+{
+    Calculate_Pixels(cam, t, pixels, std::vector<float>(pixels.size(), 0.0f), ranges);
+}
+
+
+void CL_Range_Calculator::Calculate_Pixels(const Camera & cam, 
+                                           const Terrain & t, 
+                                           const std::vector<Pixel> & pixels, 
+                                           const std::vector<float> & start,
+                                           std::vector<float> & ranges)
+{
+    if (start.size() != pixels.size()) {
+        std::stringstream msg;
+        msg << "Invalid Argument. Expected a start range for each of (" << pixels.size()
+            << ") pixels but got (" << start.size() << ")";
+        throw std::invalid_argument(msg.str());
+    }
+
+    const uint32_t num_rows = std::get<0>(cam.focal_plane_dimensions());
+
+    Buffer rot(3, 4);
+    cam.get_rotation_matrix(rot.data());
+
+    // The rows of the range image run bottom-up, so flip them back to find each ray
+    std::vector<float> rays;
+    rays.reserve(4 * pixels.size());
+    for (size_t i = 0; i < pixels.size(); i++) {
+        const Pixel & p = pixels[i];
+        _check_pixel(cam, p.first, p.second);
+        _append_ray(cam, rot.data().get(), num_rows - 1 - p.first, p.second, start[i], rays);
+    }
+
+    ranges.resize(pixels.size());
+    run_rays(cam, t, rays, ranges.data());
+}
+
+
+void CL_Range_Calculator::Calculate_Region(const Camera & cam, 
+                                           const Terrain & t, 
+                                           const uint32_t row0, 
+                                           const uint32_t col0, 
+                                           Buffer & rng)
+{
+    const uint32_t num_rows = std::get<0>(cam.focal_plane_dimensions());
+    const uint32_t rows = rng.size().first;
+    const uint32_t cols = rng.size().second;
+    if (rows == 0 || cols == 0) {
+        return;
+    }
+
+    _check_pixel(cam, row0 + rows - 1, col0 + cols - 1);
+
+    Buffer rot(3, 4);
+    cam.get_rotation_matrix(rot.data());
+
+    std::vector<float> rays;
+    rays.reserve(4 * static_cast<size_t>(rows) * cols);
+    for (uint32_t r = 0; r < rows; r++) {
+        for (uint32_t c = 0; c < cols; c++) {
+            _append_ray(cam, rot.data().get(), num_rows - 1 - (row0 + r), col0 + c, 0.0f, rays);
+        }
+    }
+
+    // The ranges come back in the row-major order of the rectangle
+    run_rays(cam, t, rays, rng.data().get());
+}
+
+
+void CL_Range_Calculator::run_rays(const Camera & cam, 
+                                   const Terrain & t, 
+                                   const std::vector<float> & rays, 
+                                   float * ranges)
+{
+    const uint32_t n = static_cast<uint32_t>(rays.size() / 4);
+    if (n == 0) {
+        return;
+    }
+
+    const cl::CommandQueue & queue = m_device_queues[m_device_idx];
+    cl::Kernel & kernel = m_kernels->get("map_range_rays");
+
+    // Grow the ray buffers as needed; they are reused by later queries
+    if (m_rays == nullptr || std::get<1>(m_rays->size()) < n) {
+        m_rays = std::unique_ptr<Device_Buffer>(new Device_Buffer(*m_ctx, 1, n, 4, true));
+        m_ray_ranges = std::unique_ptr<Device_Buffer>(new Device_Buffer(*m_ctx, 1, n));
+    }
+
+    // Walk a procedural Terrain within its window, as Calculate does
+    Camera local_cam(cam);
+    Terrain terrain(t);
+    const float max_range = Range_Calculator::max_range(t);
+    if (t.procedural() != nullptr) {
+        terrain = procedural_window(cam, t, local_cam);
+    }
+
+    cl_int err = queue.enqueueWriteBuffer(m_rays->get_cl_buffer(), 
+                                          CL_TRUE, 
+                                          0, 
+                                          rays.size() * sizeof(float), 
+                                          rays.data());
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to write rays for map_range_rays (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+
+    const auto & pos = local_cam.position();
+    const cl_float3 origin = {{ std::get<0>(pos), std::get<1>(pos), std::get<2>(pos) }};
+    const Device_Buffer & terrain_db = device_terrain(terrain);
+    const auto & terrain_size = terrain.data().size();
+    const cl_float2 bounds = {{ static_cast<float>(std::get<0>(terrain_size)), 
+                                static_cast<float>(std::get<1>(terrain_size)) }};
+
+    err = kernel.setArg(0, origin);
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to set kernel arg 0 for map_range_rays (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+    err = kernel.setArg(1, m_rays->get_cl_buffer());
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to set kernel arg 1 for map_range_rays (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+    err = kernel.setArg(2, terrain_db.get_cl_buffer());
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to set kernel arg 2 for map_range_rays (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+    err = kernel.setArg(3, terrain.scale());
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to set kernel arg 3 for map_range_rays (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+    err = kernel.setArg(4, max_range);
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to set kernel arg 4 for map_range_rays (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+    err = kernel.setArg(5, terrain.scale() / 5.0f);
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to set kernel arg 5 for map_range_rays (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+    err = kernel.setArg(6, bounds);
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to set kernel arg 6 for map_range_rays (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+    err = kernel.setArg(7, m_ray_ranges->get_cl_buffer());
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to set kernel arg 7 for map_range_rays (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+
+    err = queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(n), cl::NullRange);
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to enqueue map_range_rays kernel (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+
+    // Read back only the ranges that were requested
+    err = queue.enqueueReadBuffer(m_ray_ranges->get_cl_buffer(), 
+                                  CL_TRUE, 
+                                  0, 
+                                  n * sizeof(float), 
+                                  ranges);
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to read ranges from map_range_rays (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
 }
 
 
@@ -316,7 +655,63 @@ void CL_Range_Calculator::Compute_Range(const Camera & cam,
                                         const Buffer & world_coords, 
                                         Buffer & rng)
 {
-    run_map_range(cam, t, world_coords, rng, true);
+    run_map_range(cam, t, world_coords, rng, false, true);
+}
+
+
+Terrain CL_Range_Calculator::procedural_window(const Camera & cam, 
+                                               const Terrain & t, 
+                                               Camera & local_cam)
+{
+    const std::shared_ptr<Procedural_Terrain> source = t.procedural();
+    const Procedural_Terrain_Params & params = source->params();
+    const int64_t tile = params.tile_size;
+
+    // Cover every cell within the view distance of the Camera, aligned to tiles
+    const int64_t radius = static_cast<int64_t>(std::ceil(params.view_distance / params.scale));
+    const auto & pos = cam.position();
+    const int64_t cam_row = static_cast<int64_t>(std::floor(std::get<0>(pos) / params.scale));
+    const int64_t cam_col = static_cast<int64_t>(std::floor(std::get<1>(pos) / params.scale));
+
+    auto align = [tile](const int64_t x) { return x >= 0 ? x / tile : -((tile - 1 - x) / tile); };
+    const int64_t row0 = align(cam_row - radius) * tile;
+    const int64_t col0 = align(cam_col - radius) * tile;
+    const int64_t rows = (align(cam_row + radius) + 1) * tile - row0;
+    const int64_t cols = (align(cam_col + radius) + 1) * tile - col0;
+
+    // The window is made of whole tiles, so it must fit in the tile cache
+    const uint64_t tiles = static_cast<uint64_t>(rows / tile) * static_cast<uint64_t>(cols / tile);
+    if (tiles > params.max_tiles) {
+        std::stringstream msg;
+        msg << "The view distance (" << params.view_distance << " m) needs a window of "
+            << tiles << " tiles, but max_tiles is " << params.max_tiles;
+        throw std::invalid_argument(msg.str());
+    }
+
+    const bool stale = m_window == nullptr
+                    || m_window_source != source
+                    || m_window_origin != std::make_pair(row0, col0)
+                    || std::get<0>(m_window->size()) != rows
+                    || std::get<1>(m_window->size()) != cols;
+
+    if (stale) {
+        if (m_window == nullptr
+            || std::get<0>(m_window->size()) != rows
+            || std::get<1>(m_window->size()) != cols) {
+            m_window = std::make_shared<Device_Buffer>(*m_ctx, rows, cols, 1, true);
+        }
+
+        source->copy_region(row0, col0, *m_window);
+        m_window->to_device(&m_device_queues[m_device_idx]);
+        m_window_source = source;
+        m_window_origin = std::make_pair(row0, col0);
+    }
+
+    local_cam.set_position(std::make_tuple(std::get<0>(pos) - row0 * params.scale,
+                                           std::get<1>(pos) - col0 * params.scale,
+                                           std::get<2>(pos)));
+
+    return Terrain(m_window, params.scale);
 }
 
 
@@ -324,8 +719,36 @@ void CL_Range_Calculator::Compute_Range(const Camera & cam,
 void CL_Range_Calculator::run_map_range(const Camera & cam, 
                                         const Terrain & t, 
                                         const Buffer & world_coords, 
-                                        Buffer & rng,
+                                        Buffer & out,
+                                        const bool hits,
                                         const bool copy)
+{
+    if (t.procedural() != nullptr) {
+        Camera local_cam(cam);
+        const Terrain window = procedural_window(cam, t, local_cam);
+        enqueue_map_range(local_cam, 
+                          window, 
+                          world_coords, 
+                          out, 
+                          max_range(t), 
+                          hits, 
+                          m_window_origin, 
+                          copy);
+    } else {
+        const std::pair<int64_t, int64_t> origin(0, 0);
+        enqueue_map_range(cam, t, world_coords, out, max_range(t), hits, origin, copy);
+    }
+}
+
+
+void CL_Range_Calculator::enqueue_map_range(const Camera & cam, 
+                                            const Terrain & t, 
+                                            const Buffer & world_coords, 
+                                            Buffer & out,
+                                            const float max_range,
+                                            const bool hits,
+                                            const std::pair<int64_t, int64_t> & cell_offset,
+                                            const bool copy)
 {
     const auto & fp_size = cam.focal_plane_dimensions();
     const auto rows = std::get<0>(fp_size);
@@ -335,14 +758,19 @@ void CL_Range_Calculator::run_map_range(const Camera & cam,
     _check_buffer_size(world_coords, sz, 4); 
 
     const cl::CommandQueue & queue = m_device_queues[m_device_idx];
-    cl::Kernel & kernel = m_kernels->get("map_range");
+
+    // Walk distant parts of each ray through the pyramid, if there is one and LOD is enabled.
+    // Hits are always walked at full detail.
+    const std::shared_ptr<Terrain_Pyramid> pyramid = t.pyramid();
+    const bool lod = pyramid != nullptr && m_lod_error > 0.0f && ! hits;
+    cl::Kernel & kernel = m_kernels->get(hits ? "map_hits" : lod ? "map_range_lod" : "map_range");
 
     // Set up args
     const auto & pos = cam.position();
     const cl_float3 origin = {{ std::get<0>(pos), std::get<1>(pos), std::get<2>(pos) }};
     const Device_Buffer & world_coords_db = dynamic_cast<const Device_Buffer &>(world_coords);
-    const Device_Buffer & terrain_db = dynamic_cast<const Device_Buffer &>(t.data());
-    Device_Buffer & range_db = dynamic_cast<Device_Buffer &>(rng);
+    const Device_Buffer & terrain_db = device_terrain(t);
+    Device_Buffer & range_db = dynamic_cast<Device_Buffer &>(out);
     const auto & terrain_size = t.data().size();
     const cl_float2 bounds = {{ static_cast<float>(std::get<0>(terrain_size)), 
                                 static_cast<float>(std::get<1>(terrain_size)) }};
@@ -372,7 +800,7 @@ void CL_Range_Calculator::run_map_range(const Camera & cam,
       msg << "Failed to set kernel arg 3 for map_range (cl error = " << err << ")";
       throw std::runtime_error(msg.str());
     }
-    err = kernel.setArg(4, t.scale() * std::get<0>(terrain_size) * std::sqrt(3.0f));
+    err = kernel.setArg(4, max_range);
     if (err != CL_SUCCESS) {
       std::stringstream msg;
       msg << "Failed to set kernel arg 4 for map_range (cl error = " << err << ")";
@@ -409,6 +837,38 @@ void CL_Range_Calculator::run_map_range(const Camera & cam,
       throw std::runtime_error(msg.str());
     }
 
+    if (hits) {
+        const cl_float2 offset = {{ static_cast<float>(cell_offset.first), 
+                                    static_cast<float>(cell_offset.second) }};
+        err = kernel.setArg(10, offset);
+        if (err != CL_SUCCESS) {
+            std::stringstream msg;
+            msg << "Failed to set kernel arg 10 for map_hits (cl error = " << err << ")";
+            throw std::runtime_error(msg.str());
+        }
+    }
+
+    if (lod) {
+        err = kernel.setArg(10, device_pyramid(pyramid).get_cl_buffer());
+        if (err != CL_SUCCESS) {
+            std::stringstream msg;
+            msg << "Failed to set kernel arg 10 for map_range_lod (cl error = " << err << ")";
+            throw std::runtime_error(msg.str());
+        }
+        err = kernel.setArg(11, Terrain_Pyramid::lod_distance(cam.focal_length(), m_lod_error));
+        if (err != CL_SUCCESS) {
+            std::stringstream msg;
+            msg << "Failed to set kernel arg 11 for map_range_lod (cl error = " << err << ")";
+            throw std::runtime_error(msg.str());
+        }
+        err = kernel.setArg(12, static_cast<int>(pyramid->levels()));
+        if (err != CL_SUCCESS) {
+            std::stringstream msg;
+            msg << "Failed to set kernel arg 12 for map_range_lod (cl error = " << err << ")";
+            throw std::runtime_error(msg.str());
+        }
+    }
+
     err = queue.enqueueNDRangeKernel(kernel, 
                                      cl::NullRange, 
                                      cl::NDRange(rows, cols), 
@@ -429,6 +889,42 @@ void CL_Range_Calculator::run_map_range(const Camera & cam,
 }
 
 
+const Device_Buffer & CL_Range_Calculator::device_pyramid(
+    const std::shared_ptr<Terrain_Pyramid> & pyramid)
+{
+    if (m_pyramid == nullptr || m_pyramid_source != pyramid) {
+        m_pyramid = std::unique_ptr<Device_Buffer>(
+            new Device_Buffer(pyramid->packed(), *m_ctx, true));
+        m_pyramid->to_device(&m_device_queues[m_device_idx]);
+        m_pyramid_source = pyramid;
+        m_pyramid_version = pyramid->version();
+    }
+    else if (m_pyramid_version != pyramid->version()) {
+        // The device copy shares the packed levels, so only the cells refitted since the last
+        // upload need to be sent
+        m_pyramid->to_device_dirty(&m_device_queues[m_device_idx]);
+        m_pyramid_version = pyramid->version();
+    }
+
+    return *m_pyramid;
+}
+
+
+const Device_Buffer & CL_Range_Calculator::device_terrain(const Terrain & t)
+{
+    const Device_Buffer * db = dynamic_cast<const Device_Buffer *>(&t.data());
+    if (db != nullptr) {
+        // The caller's device copy is used as is, once the rectangles edited since its last
+        // upload are sent. Uploading leaves the heights themselves unchanged.
+        const_cast<Device_Buffer *>(db)->to_device_dirty(&m_device_queues[m_device_idx]);
+        return *db;
+    }
+
+    m_terrain = m_residency->acquire(t.data(), &m_device_queues[m_device_idx]);
+    return *m_terrain;
+}
+
+
 //! @brief  Get the OpenCL devices that can be used
 std::vector<cl::Device> & CL_Range_Calculator::get_devices()
 {
@@ -450,4 +946,44 @@ void CL_Range_Calculator::use_device(const uint8_t device_idx)
 }
 
 
+void CL_Range_Calculator::set_lod_error_budget(const float pixels)
+{
+    if (! (pixels >= 0.0f)) {
+        std::stringstream msg;
+        msg << "Invalid level-of-detail error budget (" << pixels << "). Must be non-negative.";
+        throw std::invalid_argument(msg.str());
+    }
+
+    m_lod_error = pixels;
+}
+
+
+bool CL_Range_Calculator::rows_bottom_up() const
+{
+    return true;
+}
+
+
+float CL_Range_Calculator::lod_error_budget() const
+{
+    return m_lod_error;
+}
+
+
+void CL_Range_Calculator::set_residency(const std::shared_ptr<Residency_Manager> residency)
+{
+    if (residency == nullptr) {
+        throw std::invalid_argument("Invalid argument. The residency manager cannot be null");
+    }
+
+    m_residency = residency;
+    m_terrain.reset();
+}
+
+
+std::shared_ptr<Residency_Manager> CL_Range_Calculator::residency() const
+{
+    return m_residency;
+}
+
 }
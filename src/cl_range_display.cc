@@ -0,0 +1,189 @@
+//! @file       cl_range_display.cc
+//! @brief      Defines an implementation of Range_Display that uses OpenCL kernels
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "buffer.h"
+#include "clarity_config.h"
+#include "cl_range_display.h"
+#include "cl_utils.h"
+#include "device_buffer.h"
+#include "range_display.h"
+
+// Standard Imports
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Third-Party Imports
+#include "cl.hpp"
+
+
+namespace clarity
+{
+
+static std::map<std::string, std::string> _KERNEL_SOURCES {
+    { "range_min_max",          KERNEL_DIR + "/range_display.cl" },
+    { "range_min_max_merge",    KERNEL_DIR + "/range_display.cl" },
+    { "range_to_rgba",          KERNEL_DIR + "/range_display.cl" }
+};
+
+
+//! @brief  The number of work items in each group. Must match range_display.cl.
+static const size_t _GROUP_SIZE = 64;
+
+//! @brief  The number of work groups that share the first pass of the reduction
+static const size_t _NUM_GROUPS = 64;
+
+
+CL_Range_Display::CL_Range_Display(const std::shared_ptr<cl::Context> ctx)
+    : m_ctx(ctx)
+    , m_queue()
+    , m_kernels()
+    , m_range()
+    , m_partials()
+    , m_rgba()
+    , m_rgba_pixels(0)
+{
+    std::vector<cl::Device> devices;
+    m_ctx->getInfo(CL_CONTEXT_DEVICES, &devices);
+
+    if (devices.empty()) {
+        throw std::invalid_argument("The OpenCL context has no devices");
+    }
+
+    cl_int err = CL_SUCCESS;
+    m_queue = cl::CommandQueue(*m_ctx, devices[0], 0, &err);
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to create command queue (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+
+    m_partials = cl::Buffer(*m_ctx,
+                            CL_MEM_READ_WRITE,
+                            _NUM_GROUPS * sizeof(cl_float2),
+                            nullptr,
+                            &err);
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to create reduction buffer (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+
+    m_kernels = std::unique_ptr<Kernel_Collection>(new Kernel_Collection(*m_ctx, _KERNEL_SOURCES));
+}
+
+
+CL_Range_Display::~CL_Range_Display()
+{
+    // No-op
+}
+
+
+std::pair<float, float> CL_Range_Display::Convert(const Buffer & rng, std::vector<uint8_t> & rgba)
+{
+    const uint32_t rows = rng.size().first;
+    const uint32_t cols = rng.size().second;
+    const size_t count = static_cast<size_t>(rows) * cols;
+    if (count == 0 || rng.depth() != 1) {
+        std::stringstream msg;
+        msg << "Invalid range image of size (" << rows << ", " << cols << ") and depth "
+            << static_cast<int>(rng.depth());
+        throw std::invalid_argument(msg.str());
+    }
+
+    // A Device_Buffer is used where it is; anything else is uploaded first
+    const Device_Buffer * in = dynamic_cast<const Device_Buffer *>(&rng);
+    if (in == nullptr) {
+        if (m_range == nullptr || m_range->size() != rng.size()) {
+            m_range = std::unique_ptr<Device_Buffer>(new Device_Buffer(*m_ctx, rows, cols));
+        }
+
+        const cl_int err = m_queue.enqueueWriteBuffer(m_range->get_cl_buffer(),
+                                                      CL_FALSE,
+                                                      0,
+                                                      count * sizeof(float),
+                                                      &rng.at(0, 0));
+        if (err != CL_SUCCESS) {
+            std::stringstream msg;
+            msg << "Failed to upload range image (cl error = " << err << ")";
+            throw std::runtime_error(msg.str());
+        }
+        in = m_range.get();
+    }
+
+    if (m_rgba_pixels != count) {
+        cl_int err = CL_SUCCESS;
+        m_rgba = cl::Buffer(*m_ctx, CL_MEM_WRITE_ONLY, count * sizeof(cl_uchar4), nullptr, &err);
+        if (err != CL_SUCCESS) {
+            std::stringstream msg;
+            msg << "Failed to create RGBA buffer (cl error = " << err << ")";
+            throw std::runtime_error(msg.str());
+        }
+        m_rgba_pixels = count;
+    }
+
+    // Each group reduces a strided share of the image, then one group merges their results
+    cl::Kernel & min_max = m_kernels->get("range_min_max");
+    cl_int err = min_max.setArg(0, in->get_cl_buffer());
+    err |= min_max.setArg(1, static_cast<cl_int>(count));
+    err |= min_max.setArg(2, m_partials);
+
+    cl::Kernel & merge = m_kernels->get("range_min_max_merge");
+    err |= merge.setArg(0, m_partials);
+    err |= merge.setArg(1, static_cast<cl_int>(_NUM_GROUPS));
+
+    cl::Kernel & to_rgba = m_kernels->get("range_to_rgba");
+    err |= to_rgba.setArg(0, in->get_cl_buffer());
+    err |= to_rgba.setArg(1, m_partials);
+    err |= to_rgba.setArg(2, m_rgba);
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to set range display kernel args (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+
+    err = m_queue.enqueueNDRangeKernel(min_max,
+                                       cl::NullRange,
+                                       cl::NDRange(_NUM_GROUPS * _GROUP_SIZE),
+                                       cl::NDRange(_GROUP_SIZE));
+    if (err == CL_SUCCESS) {
+        err = m_queue.enqueueNDRangeKernel(merge,
+                                           cl::NullRange,
+                                           cl::NDRange(_GROUP_SIZE),
+                                           cl::NDRange(_GROUP_SIZE));
+    }
+    if (err == CL_SUCCESS) {
+        err = m_queue.enqueueNDRangeKernel(to_rgba, cl::NullRange, cl::NDRange(count));
+    }
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to enqueue range display kernels (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+
+    // Only the bytes and the (min, max) cross back to the host
+    cl_float2 range;
+    rgba.resize(4 * count);
+    err = m_queue.enqueueReadBuffer(m_partials, CL_FALSE, 0, sizeof(range), &range);
+    if (err == CL_SUCCESS) {
+        err = m_queue.enqueueReadBuffer(m_rgba, CL_TRUE, 0, rgba.size(), rgba.data());
+    }
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to read RGBA image (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+
+    return std::make_pair(range.s[0], range.s[1]);
+}
+
+}
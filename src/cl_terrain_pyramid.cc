@@ -0,0 +1,166 @@
+//! @file       cl_terrain_pyramid.cc
+//! @brief      Defines the CL_Terrain_Pyramid type, which fits a terrain pyramid on an OpenCL
+//!             device
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "buffer.h"
+#include "clarity_config.h"
+#include "cl_terrain_pyramid.h"
+#include "cl_utils.h"
+#include "device_buffer.h"
+#include "terrain_pyramid.h"
+
+// Standard Imports
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Third-Party Imports
+#include "cl.hpp"
+
+
+namespace clarity
+{
+
+static std::map<std::string, std::string> _KERNEL_SOURCES {
+    { "pyramid_fit",            KERNEL_DIR + "/terrain_pyramid.cl" }
+};
+
+
+CL_Terrain_Pyramid::CL_Terrain_Pyramid(const std::shared_ptr<cl::Context> ctx,
+                                       const Terrain_Pyramid & layout)
+    : m_ctx(ctx)
+    , m_queue()
+    , m_kernels()
+    , m_sizes()
+    , m_offsets { 0 }
+    , m_packed()
+{
+    std::vector<cl::Device> devices;
+    m_ctx->getInfo(CL_CONTEXT_DEVICES, &devices);
+
+    if (devices.empty()) {
+        throw std::invalid_argument("The OpenCL context has no devices");
+    }
+
+    cl_int err = CL_SUCCESS;
+    m_queue = cl::CommandQueue(*m_ctx, devices[0], 0, &err);
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to create command queue (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+
+    for (uint32_t l = 0; l <= layout.levels(); l++) {
+        m_sizes.push_back(layout.size(l));
+        if (l > 0) {
+            m_offsets.push_back(layout.offset(l));
+        }
+    }
+
+    const uint32_t cells = layout.packed().size().first;
+    m_packed = std::unique_ptr<Device_Buffer>(new Device_Buffer(*m_ctx, cells, 1, 2));
+
+    m_kernels = std::unique_ptr<Kernel_Collection>(new Kernel_Collection(*m_ctx, _KERNEL_SOURCES));
+}
+
+
+CL_Terrain_Pyramid::~CL_Terrain_Pyramid()
+{
+    // No-op
+}
+
+
+void CL_Terrain_Pyramid::build(const Device_Buffer & heights)
+{
+    fit(heights, Buffer::Region { 0, 0, m_sizes[0].first, m_sizes[0].second });
+}
+
+
+void CL_Terrain_Pyramid::refit(const Device_Buffer & heights, const Buffer::Region & region)
+{
+    const uint64_t row_end = uint64_t(region.row) + region.rows;
+    const uint64_t col_end = uint64_t(region.col) + region.cols;
+    if (row_end > m_sizes[0].first || col_end > m_sizes[0].second) {
+        std::stringstream msg;
+        msg << "Region (" << region.row << ", " << region.col << ") of size (" << region.rows
+            << ", " << region.cols << ") out of range for a pyramid of size ("
+            << m_sizes[0].first << ", " << m_sizes[0].second << ")";
+        throw std::out_of_range(msg.str());
+    }
+
+    if (region.rows == 0 || region.cols == 0) {
+        return;
+    }
+
+    fit(heights, region);
+}
+
+
+Device_Buffer & CL_Terrain_Pyramid::packed()
+{
+    return *m_packed;
+}
+
+
+void CL_Terrain_Pyramid::fit(const Device_Buffer & heights, const Buffer::Region & region)
+{
+    if (heights.size() != m_sizes[0] || heights.depth() != 1) {
+        std::stringstream msg;
+        msg << "Cannot fit a pyramid of size (" << m_sizes[0].first << ", "
+            << m_sizes[0].second << ") to a height map of size (" << heights.size().first
+            << ", " << heights.size().second << ")";
+        throw std::invalid_argument(msg.str());
+    }
+
+    cl::Kernel & kernel = m_kernels->get("pyramid_fit");
+
+    // The queue is in order, so each level sees the one below it complete
+    Buffer::Region cells = region;
+    for (uint32_t l = 1; l < m_sizes.size(); l++) {
+        cells = Terrain_Pyramid::parent(cells);
+
+        const bool first = l == 1;
+        const cl::Buffer & below = first ? heights.get_cl_buffer() : m_packed->get_cl_buffer();
+        cl_int err = kernel.setArg(0, below);
+        err |= kernel.setArg(1, static_cast<cl_uint>(first ? 0 : 2 * m_offsets[l - 1]));
+        err |= kernel.setArg(2, static_cast<cl_uint>(first ? 1 : 2));
+        err |= kernel.setArg(3, static_cast<cl_uint>(m_sizes[l - 1].first));
+        err |= kernel.setArg(4, static_cast<cl_uint>(m_sizes[l - 1].second));
+        err |= kernel.setArg(5, m_packed->get_cl_buffer());
+        err |= kernel.setArg(6, static_cast<cl_uint>(m_offsets[l]));
+        err |= kernel.setArg(7, static_cast<cl_uint>(m_sizes[l].second));
+        if (err != CL_SUCCESS) {
+            std::stringstream msg;
+            msg << "Failed to set pyramid_fit kernel args (cl error = " << err << ")";
+            throw std::runtime_error(msg.str());
+        }
+
+        err = m_queue.enqueueNDRangeKernel(kernel,
+                                           cl::NDRange(cells.row, cells.col),
+                                           cl::NDRange(cells.rows, cells.cols));
+        if (err != CL_SUCCESS) {
+            std::stringstream msg;
+            msg << "Failed to enqueue pyramid_fit for level " << l << " (cl error = " << err << ")";
+            throw std::runtime_error(msg.str());
+        }
+    }
+
+    const cl_int err = m_queue.finish();
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to fit pyramid (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+}
+
+}
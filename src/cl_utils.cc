@@ -10,12 +10,15 @@
 // Standard imports
 #include <algorithm>
 #include <fstream>
+#include <future>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
 #include <sstream>
+#include <utility>
 #include <vector>
 
 // Third-party imports
@@ -53,6 +56,13 @@ std::vector<cl::Platform> find_supported_platforms()
 
 
 std::shared_ptr<cl::Context> get_context()
+{
+    return CL_Runtime::instance()->context();
+}
+
+
+//! @brief  Create a context over the devices of the first supported platform
+static cl::Context * _create_context()
 {
     // Select a platform
     std::vector<cl::Platform> platforms = find_supported_platforms();
@@ -75,7 +85,7 @@ std::shared_ptr<cl::Context> get_context()
     }
 
     // Create a context
-    std::shared_ptr<cl::Context> ctx(new cl::Context(devices, 
+    std::unique_ptr<cl::Context> ctx(new cl::Context(devices, 
                                                      nullptr, 
                                                      nullptr, 
                                                      nullptr, 
@@ -87,7 +97,7 @@ std::shared_ptr<cl::Context> get_context()
         throw std::runtime_error(msg.str());
     }
 
-    return ctx;
+    return ctx.release();
 }
 
 
@@ -110,19 +120,12 @@ static std::string _read_source(const std::string & path)
 
 
 
-Kernel_Collection::Kernel_Collection(const cl::Context & ctx, 
-									 const std::map<std::string, std::string> & kernel_files)
-	: m_program(nullptr), m_kernels()
+//! @brief  Build a program, printing the build log of each device if it fails
+static cl::Program _build_program(const cl::Context & ctx, const std::string & src)
 {
-    // Collect the sources
-    std::stringstream src;
-	for (auto & entry : kernel_files) {
-        src << _read_source(entry.second) << std::endl;
-    }
-
     // Create and build the program
     cl_int err = CL_SUCCESS;
-    m_program = std::unique_ptr<cl::Program>(new cl::Program(ctx, src.str(), true, &err));
+    cl::Program program(ctx, src, true, &err);
 
     // Make sure it build successfully
     if (err != CL_SUCCESS) {
@@ -139,7 +142,7 @@ Kernel_Collection::Kernel_Collection(const cl::Context & ctx,
 
             // Get build log for device
             std::string build_log;
-            m_program->getBuildInfo<std::string>(d, CL_PROGRAM_BUILD_LOG, &build_log);
+            program.getBuildInfo<std::string>(d, CL_PROGRAM_BUILD_LOG, &build_log);
 
             // Append meesage
             std::cerr << "Build Log: (" << device_name << ")" << std::endl;
@@ -149,16 +152,138 @@ Kernel_Collection::Kernel_Collection(const cl::Context & ctx,
         throw std::runtime_error(msg.str());
     }
 
-    err = CL_SUCCESS;
-    for (auto & entry : kernel_files) {
-        m_kernels[entry.first] = cl::Kernel(*m_program, entry.first.c_str(), &err);
+    return program;
+}
+
+
+//! @brief  The live runtime, if any
+static std::weak_ptr<CL_Runtime> _runtime;
+
+//! @brief  Guards _runtime
+static std::mutex _runtime_mutex;
+
+
+std::shared_ptr<CL_Runtime> CL_Runtime::instance()
+{
+    std::lock_guard<std::mutex> lock(_runtime_mutex);
+
+    std::shared_ptr<CL_Runtime> runtime = _runtime.lock();
+    if (runtime == nullptr) {
+        runtime = std::shared_ptr<CL_Runtime>(new CL_Runtime());
+        _runtime = runtime;
+    }
+
+    return runtime;
+}
+
+
+CL_Runtime::CL_Runtime()
+    : m_mutex()
+    , m_ctx()
+    , m_devices()
+    , m_queues()
+    , m_programs()
+{
+    // No-op
+}
+
+
+CL_Runtime::~CL_Runtime()
+{
+    // No-op
+}
+
+
+void CL_Runtime::init()
+{
+    if (m_ctx != nullptr) {
+        return;
+    }
+
+    std::unique_ptr<cl::Context> ctx(_create_context());
+
+    std::vector<cl::Device> devices;
+    ctx->getInfo(CL_CONTEXT_DEVICES, &devices);
+
+    // Create a queue for each device
+    std::vector<cl::CommandQueue> queues;
+    cl_int err = CL_SUCCESS;
+    for (const auto & d : devices) {
+        queues.emplace_back(*ctx, d, 0, &err);
 
         if (err != CL_SUCCESS) {
+            std::string device_name;
+            d.getInfo(CL_DEVICE_NAME, &device_name);
+
             std::stringstream msg;
-            msg << "Error - failed to construct Kernel from program (cl error = " << err << ")";
+            msg << "Failed to create command queue for device (" << device_name << ") ";
+            msg << "(cl error = " << err << ")";
             throw std::runtime_error(msg.str());
         }
     }
+
+    // Only publish a runtime that is complete, so a failure can be retried
+    m_devices = devices;
+    m_queues = queues;
+    m_ctx = std::move(ctx);
+}
+
+
+std::shared_ptr<cl::Context> CL_Runtime::context()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    init();
+
+    // Share ownership with the runtime, so the queues and programs outlive every user
+    return std::shared_ptr<cl::Context>(shared_from_this(), m_ctx.get());
+}
+
+
+const std::vector<cl::Device> & CL_Runtime::devices()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    init();
+    return m_devices;
+}
+
+
+const std::vector<cl::CommandQueue> & CL_Runtime::queues()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    init();
+    return m_queues;
+}
+
+
+std::shared_future<cl::Program> CL_Runtime::program(const cl::Context & ctx,
+                                                    const std::string & path)
+{
+    const std::pair<cl_context, std::string> key(ctx(), path);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_programs.find(key);
+    if (it == m_programs.end()) {
+        // Read now, so a missing file is reported to the caller rather than to a getter
+        const std::string src = _read_source(path);
+        std::shared_future<cl::Program> built = std::async(std::launch::async,
+                                                           _build_program,
+                                                           ctx,
+                                                           src).share();
+        it = m_programs.emplace(key, built).first;
+    }
+
+    return it->second;
+}
+
+
+Kernel_Collection::Kernel_Collection(const cl::Context & ctx, 
+									 const std::map<std::string, std::string> & kernel_files)
+	: m_runtime(CL_Runtime::instance()), m_pending(), m_kernels()
+{
+    // Every file starts building now; the kernels are only made when they are asked for
+	for (auto & entry : kernel_files) {
+        m_pending[entry.first] = m_runtime->program(ctx, entry.second);
+    }
 }
 
 
@@ -170,7 +295,31 @@ Kernel_Collection::~Kernel_Collection()
 
 cl::Kernel & Kernel_Collection::get(const std::string & kernel_name)
 {
-    return m_kernels.at(kernel_name);
+    auto it = m_kernels.find(kernel_name);
+    if (it != m_kernels.end()) {
+        return it->second;
+    }
+
+    const auto pending = m_pending.find(kernel_name);
+    if (pending == m_pending.end()) {
+        std::stringstream msg;
+        msg << "Unknown kernel (" << kernel_name << ")";
+        throw std::out_of_range(msg.str());
+    }
+
+    // Wait for this kernel's program alone
+    const cl::Program program = pending->second.get();
+
+    cl_int err = CL_SUCCESS;
+    cl::Kernel kernel(program, kernel_name.c_str(), &err);
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Error - failed to construct Kernel from program (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+
+    m_pending.erase(pending);
+    return m_kernels.emplace(kernel_name, kernel).first->second;
 }
 
 
@@ -0,0 +1,208 @@
+//! @file       cl_viewshed.cc
+//! @brief      Defines an implementation of Viewshed that uses OpenCL kernels
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "buffer.h"
+#include "clarity_config.h"
+#include "cl_utils.h"
+#include "cl_viewshed.h"
+#include "device_buffer.h"
+#include "residency_manager.h"
+#include "terrain.h"
+#include "viewshed.h"
+
+// Standard Imports
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// Third-Party Imports
+#include "cl.hpp"
+
+
+namespace clarity
+{
+
+static std::map<std::string, std::string> _KERNEL_SOURCES {
+    { "viewshed",   KERNEL_DIR + "/viewshed.cl" }
+};
+
+
+//! @brief  The number of work items that share each octant
+static const size_t _GROUP_SIZE = 64;
+
+
+CL_Viewshed::CL_Viewshed(const std::shared_ptr<cl::Context> ctx)
+    : m_ctx(ctx)
+    , m_queue()
+    , m_kernels()
+    , m_horizon()
+    , m_visible()
+    , m_residency()
+    , m_terrain()
+{
+    std::vector<cl::Device> devices;
+    m_ctx->getInfo(CL_CONTEXT_DEVICES, &devices);
+
+    if (devices.empty()) {
+        throw std::invalid_argument("The OpenCL context has no devices");
+    }
+
+    cl_int err = CL_SUCCESS;
+    m_queue = cl::CommandQueue(*m_ctx, devices[0], 0, &err);
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to create command queue (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+
+    m_kernels = std::unique_ptr<Kernel_Collection>(new Kernel_Collection(*m_ctx, _KERNEL_SOURCES));
+    m_residency = std::make_shared<Residency_Manager>(m_ctx);
+}
+
+
+CL_Viewshed::~CL_Viewshed()
+{
+    // No-op
+}
+
+
+//! @brief  Get the cell under an observer, throwing if the query is invalid
+static std::pair<int, int> _observer_cell(const Terrain & t,
+                                          const Viewshed::Position & observer,
+                                          const Buffer & visible)
+{
+    if (t.procedural() != nullptr) {
+        throw std::invalid_argument("Viewshed does not support procedural terrain");
+    }
+
+    const auto size = t.data().size();
+    if (visible.size() != size) {
+        std::stringstream msg;
+        msg << "Invalid viewshed buffer size (" << visible.size().first << ", "
+            << visible.size().second << "). Expected (" << size.first << ", " << size.second
+            << ")";
+        throw std::invalid_argument(msg.str());
+    }
+
+    const float row = std::floor(std::get<0>(observer) / t.scale());
+    const float col = std::floor(std::get<1>(observer) / t.scale());
+    if (! (row >= 0.0f && row < size.first && col >= 0.0f && col < size.second)) {
+        std::stringstream msg;
+        msg << "Viewshed observer (" << std::get<0>(observer) << ", " << std::get<1>(observer)
+            << ") is not over the terrain";
+        throw std::out_of_range(msg.str());
+    }
+
+    return std::make_pair(static_cast<int>(row), static_cast<int>(col));
+}
+
+
+void CL_Viewshed::Compute(const Terrain & t, const Position & observer, Buffer & visible)
+{
+    const std::pair<int, int> cell = _observer_cell(t, observer, visible);
+    const uint32_t rows = t.data().size().first;
+    const uint32_t cols = t.data().size().second;
+    const uint32_t stride = std::max(rows, cols) + 1;
+
+    // Two rings of scratch per octant, grown as needed
+    if (m_horizon == nullptr || std::get<1>(m_horizon->size()) < stride) {
+        m_horizon = std::unique_ptr<Device_Buffer>(new Device_Buffer(*m_ctx, 16, stride));
+    }
+
+    Device_Buffer * out = dynamic_cast<Device_Buffer *>(&visible);
+    if (out == nullptr) {
+        if (m_visible == nullptr || m_visible->size() != visible.size()) {
+            m_visible = std::unique_ptr<Device_Buffer>(new Device_Buffer(*m_ctx, rows, cols));
+        }
+        out = m_visible.get();
+    }
+
+    const Device_Buffer & terrain_db = device_terrain(t);
+    const cl_int2 observer_cell = {{ cell.first, cell.second }};
+
+    cl::Kernel & kernel = m_kernels->get("viewshed");
+    cl_int err = kernel.setArg(0, terrain_db.get_cl_buffer());
+    err |= kernel.setArg(1, static_cast<cl_int>(rows));
+    err |= kernel.setArg(2, static_cast<cl_int>(cols));
+    err |= kernel.setArg(3, observer_cell);
+    err |= kernel.setArg(4, std::get<2>(observer) / t.scale());
+    err |= kernel.setArg(5, m_horizon->get_cl_buffer());
+    err |= kernel.setArg(6, out->get_cl_buffer());
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to set viewshed kernel args (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+
+    // One work group per octant
+    err = m_queue.enqueueNDRangeKernel(kernel,
+                                       cl::NullRange,
+                                       cl::NDRange(8 * _GROUP_SIZE),
+                                       cl::NDRange(_GROUP_SIZE));
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to enqueue viewshed kernel (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+
+    if (out == m_visible.get()) {
+        err = m_queue.enqueueReadBuffer(out->get_cl_buffer(),
+                                        CL_TRUE,
+                                        0,
+                                        static_cast<size_t>(rows) * cols * sizeof(float),
+                                        &visible.at(0, 0));
+        if (err != CL_SUCCESS) {
+            std::stringstream msg;
+            msg << "Failed to read viewshed (cl error = " << err << ")";
+            throw std::runtime_error(msg.str());
+        }
+    } else {
+        out->from_device(&m_queue);
+    }
+}
+
+
+const Device_Buffer & CL_Viewshed::device_terrain(const Terrain & t)
+{
+    const Device_Buffer * db = dynamic_cast<const Device_Buffer *>(&t.data());
+    if (db != nullptr) {
+        // The caller's device copy is used as is, once the rectangles edited since its last
+        // upload are sent. Uploading leaves the heights themselves unchanged.
+        const_cast<Device_Buffer *>(db)->to_device_dirty(&m_queue);
+        return *db;
+    }
+
+    m_terrain = m_residency->acquire(t.data(), &m_queue);
+    return *m_terrain;
+}
+
+
+void CL_Viewshed::set_residency(const std::shared_ptr<Residency_Manager> residency)
+{
+    if (residency == nullptr) {
+        throw std::invalid_argument("Invalid argument. The residency manager cannot be null");
+    }
+
+    m_residency = residency;
+    m_terrain.reset();
+}
+
+
+std::shared_ptr<Residency_Manager> CL_Viewshed::residency() const
+{
+    return m_residency;
+}
+
+}
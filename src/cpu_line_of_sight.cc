@@ -0,0 +1,210 @@
+//! @file       cpu_line_of_sight.cc
+//! @brief      Defines an implementation of Line_Of_Sight that uses the CPU
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "buffer.h"
+#include "cpu_line_of_sight.h"
+#include "line_of_sight.h"
+#include "terrain.h"
+#include "terrain_pyramid.h"
+#include "thread_pool.h"
+
+// Standard Imports
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+// Third-Party Imports
+
+
+namespace clarity
+{
+
+//! @brief  The number of lines given to each task of the Thread_Pool
+static const uint32_t _LINES_PER_TASK = 64;
+
+
+CPU_Line_Of_Sight::CPU_Line_Of_Sight(const unsigned num_threads)
+    : m_pool(num_threads)
+{
+    // No-op
+}
+
+
+CPU_Line_Of_Sight::~CPU_Line_Of_Sight()
+{
+    // No-op
+}
+
+
+//! @brief  Throw if a batch of lines cannot be checked against a Terrain
+static void _check_query(const Terrain & t,
+                         const std::vector<Line_Of_Sight::Point> & observers,
+                         const std::vector<Line_Of_Sight::Point> & targets)
+{
+    if (t.procedural() != nullptr) {
+        throw std::invalid_argument("Line_Of_Sight does not support procedural terrain");
+    }
+
+    if (observers.size() != targets.size()) {
+        std::stringstream msg;
+        msg << "Mismatched line-of-sight query: (" << observers.size() << ") observers and ("
+            << targets.size() << ") targets";
+        throw std::invalid_argument(msg.str());
+    }
+}
+
+
+//! @brief  Get the distance along a line at which it leaves a block of cells
+//!
+//! @param[in]  p       the position on the line, in cells
+//! @param[in]  d       the unit direction of the line
+//! @param[in]  s       the distance of p along the line, in cells
+//! @param[in]  lo, hi  the (row, col) bounds of the block, lo inclusive and hi exclusive
+static float _block_exit(const float * p, const float * d, const float s,
+                         const float * lo, const float * hi)
+{
+    float exit = std::numeric_limits<float>::infinity();
+
+    for (int i = 0; i < 2; i++) {
+        if (d[i] > 0.0f) {
+            exit = std::min(exit, (hi[i] - p[i]) / d[i]);
+        } else if (d[i] < 0.0f) {
+            exit = std::min(exit, (lo[i] - p[i]) / d[i]);
+        }
+    }
+
+    return s + exit;
+}
+
+
+//! @brief  Walk a line from an observer to a target through a height map
+//!
+//! @param[in]  heights     the height map, row-major
+//! @param[in]  rows, cols  the size of the height map
+//! @param[in]  pyramid     the pyramid of the height map, or null
+//! @param[in]  o, target   the ends of the line, in cells
+//! @param[in]  step        the step along the line, in cells
+//! @param[out] clear       whether the line reached the target
+//!
+//! @return the distance walked, in cells
+static float _walk(const float * heights,
+                   const uint32_t rows,
+                   const uint32_t cols,
+                   const Terrain_Pyramid * pyramid,
+                   const float * o,
+                   const float * target,
+                   const float step,
+                   bool & clear)
+{
+    float d[3] = { target[0] - o[0], target[1] - o[1], target[2] - o[2] };
+    const float len = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+
+    clear = true;
+    if (len == 0.0f) {
+        return 0.0f;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        d[i] /= len;
+    }
+
+    // Steps are taken from their index rather than accumulated, so a walk that skips steps
+    // tests exactly the positions that a plain walk would
+    const float steps = std::min(std::floor(len / step), 4.0e9f);
+    const uint32_t last = steps >= 1.0f ? static_cast<uint32_t>(steps) - 1 : 0;
+    const uint32_t levels = pyramid != nullptr ? pyramid->levels() : 0;
+    uint32_t level = levels;
+    uint32_t k = 1;
+
+    while (k <= last) {
+        const float s = static_cast<float>(k) * step;
+        const float p[3] = { o[0] + d[0] * s, o[1] + d[1] * s, o[2] + d[2] * s };
+
+        const uint32_t r = static_cast<uint32_t>(std::min(std::max(p[0], 0.0f), rows - 1.0f));
+        const uint32_t c = static_cast<uint32_t>(std::min(std::max(p[1], 0.0f), cols - 1.0f));
+
+        if (p[2] <= heights[static_cast<size_t>(r) * cols + c]) {
+            clear = false;
+            return s;
+        }
+
+        uint32_t next = k + 1;
+        const bool inside = p[0] >= 0.0f && p[0] < rows && p[1] >= 0.0f && p[1] < cols;
+
+        // Skip to the end of the largest block that the line passes over, coming down a level
+        // each time the line dips into a block
+        for (; inside && level >= 1; level--) {
+            const uint32_t br = r >> level;
+            const uint32_t bc = c >> level;
+            const float lo[2] = { static_cast<float>(br << level),
+                                  static_cast<float>(bc << level) };
+            const float hi[2] = { static_cast<float>((br + 1) << level),
+                                  static_cast<float>((bc + 1) << level) };
+
+            const float exit = _block_exit(p, d, s, lo, hi);
+            const float exit_z = o[2] + d[2] * exit;
+
+            if (std::min(p[2], exit_z) > pyramid->max(level, br, bc)) {
+                const float skip = std::min(std::floor(exit / step), last + 1.0f);
+                next = std::max(next, static_cast<uint32_t>(skip));
+                break;
+            }
+        }
+
+        if (inside && levels > 0) {
+            level = std::min(std::max(level + 1, 1u), levels);
+        }
+
+        k = next;
+    }
+
+    return len;
+}
+
+
+void CPU_Line_Of_Sight::Check(const Terrain & t,
+                              const std::vector<Point> & observers,
+                              const std::vector<Point> & targets,
+                              std::vector<uint8_t> & visible,
+                              std::vector<float> & distance)
+{
+    _check_query(t, observers, targets);
+
+    const uint32_t n = static_cast<uint32_t>(observers.size());
+    visible.resize(n);
+    distance.resize(n);
+
+    const float scale = t.scale();
+    const float max_error = scale / 5.0f;
+    const float step = max_error / scale;
+    const float * heights = &t.data().at(0, 0);
+    const uint32_t rows = t.data().size().first;
+    const uint32_t cols = t.data().size().second;
+    const std::shared_ptr<Terrain_Pyramid> pyramid = t.pyramid();
+
+    m_pool.parallel_for(0, n, [&](const uint32_t begin, const uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            const float o[3] = { std::get<0>(observers[i]) / scale,
+                                 std::get<1>(observers[i]) / scale,
+                                 std::get<2>(observers[i]) / scale };
+            const float target[3] = { std::get<0>(targets[i]) / scale,
+                                      std::get<1>(targets[i]) / scale,
+                                      std::get<2>(targets[i]) / scale };
+
+            bool clear = true;
+            distance[i] = scale * _walk(heights, rows, cols, pyramid.get(), o, target, step, clear);
+            visible[i] = clear ? 1 : 0;
+        }
+    }, _LINES_PER_TASK);
+}
+
+}
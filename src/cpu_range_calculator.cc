@@ -8,12 +8,22 @@
 #include "buffer.h"
 #include "camera.h"
 #include "cpu_range_calculator.h"
+#include "procedural_terrain.h"
 #include "range_calculator.h"
 #include "terrain.h"
+#include "terrain_pyramid.h"
 
 // Standard Imports
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 // Third-Party Imports
 
@@ -23,6 +33,7 @@ namespace clarity
 
 
 CPU_Range_Calculator::CPU_Range_Calculator()
+    : m_lod_error(0.0f)
 {
    // No-op
 }
@@ -65,26 +76,17 @@ void CPU_Range_Calculator::Calculate(const Camera & cam, const Terrain & t, Buff
 void CPU_Range_Calculator::Convert_Pixel_To_Camera_Coordinates(const Camera & cam, 
                                                                Buffer & cam_coords)
 {
-    const auto focal_length_pix = cam.focal_length();
     const auto sz = cam.focal_plane_dimensions();
 
     const auto num_rows = std::get<0>(sz);
     const auto num_cols = std::get<1>(sz);
     for (auto r = 0; r < num_rows; r++) {
         for (auto c = 0; c < num_cols; c++) {
-            float pix[3] = { static_cast<float>(r - (num_rows / 2.0f)), 
-                             static_cast<float>(c - (num_cols / 2.0f)), 
-                             focal_length_pix };
-            float center[3] = { 0.0, 0.0, focal_length_pix };
+            const Camera::Position p = cam.pixel_to_camera(r, c);
 
-            const float ang = std::acos(_dot(center, pix) / 
-                                        (_length(pix) * _length(center)));
-
-            const float phi = std::atan2(pix[0], pix[1]);
-
-            cam_coords.at(r, c, 0) = std::cos(ang);
-            cam_coords.at(r, c, 1) = std::sin(ang) * std::cos(phi);
-            cam_coords.at(r, c, 2) = std::sin(ang) * std::sin(phi);
+            cam_coords.at(r, c, 0) = std::get<0>(p);
+            cam_coords.at(r, c, 1) = std::get<1>(p);
+            cam_coords.at(r, c, 2) = std::get<2>(p);
         }
     }
 }
@@ -115,6 +117,14 @@ void CPU_Range_Calculator::Convert_Camera_To_World_Coordinates(const Camera & ca
 }
 
 
+float _length(const std::tuple<float, float, float> & a)
+{
+    // A std::tuple does not store its elements in order, so it cannot be passed as an array
+    const float v[3] = { std::get<0>(a), std::get<1>(a), std::get<2>(a) };
+    return _length(v);
+}
+
+
 std::tuple<float, float, float> _sum(const std::tuple<float, float, float> & a, 
                                      const std::tuple<float, float, float> & b)
 {
@@ -145,33 +155,198 @@ float _clamp(const float val, const float low, const float hi)
 }
 
 
+//! @brief  Get the unit normal of a height field from the heights on either side of a cell
+//!
+//! @param[in]  row_lo, row_hi      the heights before and after the cell along the rows
+//! @param[in]  row_span            the number of cells from row_lo to row_hi
+//! @param[in]  col_lo, col_hi      the heights before and after the cell along the cols
+//! @param[in]  col_span            the number of cells from col_lo to col_hi
+std::tuple<float, float, float> _normal(const float row_lo, 
+                                        const float row_hi, 
+                                        const float row_span,
+                                        const float col_lo, 
+                                        const float col_hi, 
+                                        const float col_span)
+{
+    const float dr = row_span > 0.0f ? (row_hi - row_lo) / row_span : 0.0f;
+    const float dc = col_span > 0.0f ? (col_hi - col_lo) / col_span : 0.0f;
+    const float n[3] = { -dr, -dc, 1.0f };
+    const float len = _length(n);
+
+    return std::make_tuple(n[0] / len, n[1] / len, n[2] / len);
+}
+
+
+//! @brief  Write the Hit_Channels of a pixel
+void _store_hit(const std::tuple<float, float, float> & loc,
+                const float scale,
+                const float range,
+                const int64_t row,
+                const int64_t col,
+                const std::tuple<float, float, float> & normal,
+                float * hit)
+{
+    hit[HIT_RANGE] = range;
+    hit[HIT_X] = std::get<0>(loc) * scale;
+    hit[HIT_Y] = std::get<1>(loc) * scale;
+    hit[HIT_Z] = std::get<2>(loc) * scale;
+    hit[HIT_ROW] = static_cast<float>(row);
+    hit[HIT_COL] = static_cast<float>(col);
+    hit[HIT_NORMAL_X] = std::get<0>(normal);
+    hit[HIT_NORMAL_Y] = std::get<1>(normal);
+    hit[HIT_NORMAL_Z] = std::get<2>(normal);
+}
+
+
 float _compute_range_for_pixel(const std::tuple<float, float, float> origin, 
                                const std::tuple<float, float, float> pv, 
                                const std::pair<float, float> bounds,
                                const Terrain & t,
                                const float max_error,
-                               const float max_range)
+                               const float max_range,
+                               const float start,
+                               float * hit)
 {
     const float step = max_error / t.scale();
-    const int iterations = static_cast<int>(std::ceil(max_range / max_error));
+    const int skip = static_cast<int>(std::floor(std::max(start, 0.0f) / max_error));
+    const int iterations = static_cast<int>(std::ceil(max_range / max_error)) - skip;
 
     const std::tuple<float, float, float> origin_pix = _mult(origin, 1.0 / t.scale());
-    std::tuple<float, float, float> loc = origin_pix;
+    std::tuple<float, float, float> loc = _sum(origin_pix, _mult(pv, skip * step));
+    int r = 0;
+    int c = 0;
+    bool ground = false;
 
     for (auto i = 0; i < iterations; i++) {
         loc = _sum(loc, _mult(pv, step));
 
-        const int r = _clamp(std::get<0>(loc), 0.0f, bounds.second);
-        const int c = _clamp(std::get<1>(loc), 0.0f, bounds.first);
+        r = _clamp(std::get<0>(loc), 0.0f, bounds.first - 1.0f);
+        c = _clamp(std::get<1>(loc), 0.0f, bounds.second - 1.0f);
         const float height = t.data().at(r, c);
 
         if (std::get<2>(loc) <= height) {
+            ground = true;
             break;
         }
     }
 
     const std::tuple<float, float, float> diff_pix = _sum(loc, _mult(origin_pix, -1.0f));
-    const float range_pixels = _length(&std::get<0>(diff_pix));
+    const float range_pixels = _length(diff_pix);
+    const float range = _clamp(t.scale() * range_pixels, 0.0f, max_range);
+
+    if (hit != nullptr) {
+        std::tuple<float, float, float> normal(0.0f, 0.0f, 0.0f);
+
+        if (ground) {
+            const int r0 = std::max(r - 1, 0);
+            const int r1 = std::min(r + 1, static_cast<int>(bounds.first) - 1);
+            const int c0 = std::max(c - 1, 0);
+            const int c1 = std::min(c + 1, static_cast<int>(bounds.second) - 1);
+
+            normal = _normal(t.data().at(r0, c), t.data().at(r1, c), r1 - r0,
+                             t.data().at(r, c0), t.data().at(r, c1), c1 - c0);
+        }
+
+        _store_hit(loc, t.scale(), range, r, c, normal, hit);
+    }
+
+    return range;
+}
+
+
+float _compute_range_for_pixel(const std::tuple<float, float, float> origin, 
+                               const std::tuple<float, float, float> pv, 
+                               const float scale,
+                               Procedural_Terrain::Cursor & cursor,
+                               const float max_error,
+                               const float max_range,
+                               const float start,
+                               float * hit)
+{
+    const float step = max_error / scale;
+    const int skip = static_cast<int>(std::floor(std::max(start, 0.0f) / max_error));
+    const int iterations = static_cast<int>(std::ceil(max_range / max_error)) - skip;
+
+    const std::tuple<float, float, float> origin_pix = _mult(origin, 1.0 / scale);
+    std::tuple<float, float, float> loc = _sum(origin_pix, _mult(pv, skip * step));
+    int64_t r = 0;
+    int64_t c = 0;
+    bool ground = false;
+
+    // The terrain is unbounded, so the walk is only limited by the view distance
+    for (auto i = 0; i < iterations; i++) {
+        loc = _sum(loc, _mult(pv, step));
+
+        r = static_cast<int64_t>(std::floor(std::get<0>(loc)));
+        c = static_cast<int64_t>(std::floor(std::get<1>(loc)));
+
+        if (std::get<2>(loc) <= cursor.height(r, c)) {
+            ground = true;
+            break;
+        }
+    }
+
+    const std::tuple<float, float, float> diff_pix = _sum(loc, _mult(origin_pix, -1.0f));
+    const float range_pixels = _length(diff_pix);
+    const float range = _clamp(scale * range_pixels, 0.0f, max_range);
+
+    if (hit != nullptr) {
+        std::tuple<float, float, float> normal(0.0f, 0.0f, 0.0f);
+
+        if (ground) {
+            normal = _normal(cursor.height(r - 1, c), cursor.height(r + 1, c), 2.0f,
+                             cursor.height(r, c - 1), cursor.height(r, c + 1), 2.0f);
+        }
+
+        _store_hit(loc, scale, range, r, c, normal, hit);
+    }
+
+    return range;
+}
+
+
+float _compute_range_for_pixel(const std::tuple<float, float, float> origin, 
+                               const std::tuple<float, float, float> pv, 
+                               const std::pair<float, float> bounds,
+                               const Terrain & t,
+                               const Terrain_Pyramid & pyramid,
+                               const float lod_distance,
+                               const float max_error,
+                               const float max_range)
+{
+    const float max_distance = max_range / t.scale();
+    float step = max_error / t.scale();
+
+    const std::tuple<float, float, float> origin_pix = _mult(origin, 1.0 / t.scale());
+    std::tuple<float, float, float> loc = origin_pix;
+
+    // Move up a level, doubling the step, each time the distance walked doubles
+    uint32_t level = 0;
+    float next_level = lod_distance;
+    float distance = 0.0f;
+
+    while (distance < max_distance) {
+        while (level < pyramid.levels() && distance >= next_level) {
+            level++;
+            step *= 2.0f;
+            next_level *= 2.0f;
+        }
+
+        loc = _sum(loc, _mult(pv, step));
+        distance += step;
+
+        const int r = _clamp(std::get<0>(loc), 0.0f, bounds.first - 1.0f);
+        const int c = _clamp(std::get<1>(loc), 0.0f, bounds.second - 1.0f);
+        const float height = level == 0 ? t.data().at(r, c) 
+                                        : pyramid.max(level, r >> level, c >> level);
+
+        if (std::get<2>(loc) <= height) {
+            break;
+        }
+    }
+
+    const std::tuple<float, float, float> diff_pix = _sum(loc, _mult(origin_pix, -1.0f));
+    const float range_pixels = _length(diff_pix);
 
     return _clamp(t.scale() * range_pixels, 0.0f, max_range);
 }
@@ -181,36 +356,261 @@ void CPU_Range_Calculator::Compute_Range(const Camera & cam,
                                          const Terrain & t, 
                                          const Buffer & world_coords, 
                                          Buffer & rng)
+{
+    march(cam, t, world_coords, &rng, nullptr, true);
+}
+
+
+void CPU_Range_Calculator::Calculate_Hits(const Camera & cam, const Terrain & t, Buffer & hits)
 {
     const auto sz = cam.focal_plane_dimensions();
     const auto num_rows = std::get<0>(sz);
     const auto num_cols = std::get<1>(sz);
 
+    const bool same_size = hits.size() == std::make_pair(static_cast<uint32_t>(num_rows), 
+                                                         static_cast<uint32_t>(num_cols));
+    if (! same_size || hits.depth() != HIT_DEPTH) {
+        std::stringstream msg;
+        msg << "Invalid Argument. Expected a hit buffer with size of (" << num_rows << ", "
+            << num_cols << ", " << HIT_DEPTH << ") but got a buffer of size ("
+            << hits.size().first << ", " << hits.size().second << ", " 
+            << static_cast<int>(hits.depth()) << ")";
+        throw std::invalid_argument(msg.str());
+    }
+
+    Buffer cam_coords(num_rows, num_cols, 4);
+    Convert_Pixel_To_Camera_Coordinates(cam, cam_coords);
+
+    Buffer world_coords(num_rows, num_cols, 4);
+    Convert_Camera_To_World_Coordinates(cam, cam_coords, world_coords);
+
+    march(cam, t, world_coords, nullptr, &hits, false);
+}
+
+
+//! @brief  Throw if a pixel is outside the focal plane of a Camera
+void _check_pixel(const Camera & cam, const uint32_t row, const uint32_t col)
+{
+    const auto sz = cam.focal_plane_dimensions();
+
+    if (row >= std::get<0>(sz) || col >= std::get<1>(sz)) {
+        std::stringstream msg;
+        msg << "Pixel (" << row << ", " << col << ") is outside of the focal plane of size ("
+            << std::get<0>(sz) << ", " << std::get<1>(sz) << ")";
+        throw std::out_of_range(msg.str());
+    }
+}
+
+
+//! @brief  Compute the world pointing vector of one pixel, exactly as Calculate does
+void _pixel_to_world(const Camera & cam, 
+                     const float * rot, 
+                     const uint32_t row, 
+                     const uint32_t col, 
+                     float * world_coord)
+{
+    const Camera::Position p = cam.pixel_to_camera(row, col);
+    const float cam_coord[3] = { std::get<0>(p), std::get<1>(p), std::get<2>(p) };
+
+    world_coord[0] = _dot(rot, cam_coord);
+    world_coord[1] = _dot(rot + 4, cam_coord);
+    world_coord[2] = _dot(rot + 8, cam_coord);
+}
+
+
+void CPU_Range_Calculator::Calculate_Pixels(const Camera & cam, 
+                                            const Terrain & t, 
+                                            const std::vector<Pixel> & pixels, 
+                                            std::vector<float> & ranges)
+{
+    Calculate_Pixels(cam, t, pixels, std::vector<float>(pixels.size(), 0.0f), ranges);
+}
+
+
+void CPU_Range_Calculator::Calculate_Pixels(const Camera & cam, 
+                                            const Terrain & t, 
+                                            const std::vector<Pixel> & pixels, 
+                                            const std::vector<float> & start,
+                                            std::vector<float> & ranges)
+{
+    if (start.size() != pixels.size()) {
+        std::stringstream msg;
+        msg << "Invalid Argument. Expected a start range for each of (" << pixels.size()
+            << ") pixels but got (" << start.size() << ")";
+        throw std::invalid_argument(msg.str());
+    }
+
+    ranges.resize(pixels.size());
+    if (pixels.empty()) {
+        return;
+    }
+
+    Buffer rot(3, 4);
+    cam.get_rotation_matrix(rot.data());
+
+    // Lay the rays out as a single row, and walk only those
+    Buffer world_coords(1, pixels.size(), 4);
+    for (uint32_t i = 0; i < pixels.size(); i++) {
+        _check_pixel(cam, pixels[i].first, pixels[i].second);
+        _pixel_to_world(cam, 
+                        rot.data().get(), 
+                        pixels[i].first, 
+                        pixels[i].second, 
+                        &world_coords.at(0, i));
+    }
+
+    Buffer rng(std::shared_ptr<float>(ranges.data(), [](float *) {}), 1, pixels.size());
+    march(cam, t, world_coords, &rng, nullptr, false, start.data());
+}
+
+
+void CPU_Range_Calculator::Calculate_Region(const Camera & cam, 
+                                            const Terrain & t, 
+                                            const uint32_t row0, 
+                                            const uint32_t col0, 
+                                            Buffer & rng)
+{
+    const uint32_t rows = rng.size().first;
+    const uint32_t cols = rng.size().second;
+    if (rows == 0 || cols == 0) {
+        return;
+    }
+
+    _check_pixel(cam, row0 + rows - 1, col0 + cols - 1);
+
+    Buffer rot(3, 4);
+    cam.get_rotation_matrix(rot.data());
+
+    Buffer world_coords(rows, cols, 4);
+    for (uint32_t r = 0; r < rows; r++) {
+        for (uint32_t c = 0; c < cols; c++) {
+            _pixel_to_world(cam, rot.data().get(), row0 + r, col0 + c, &world_coords.at(r, c));
+        }
+    }
+
+    march(cam, t, world_coords, &rng, nullptr, false);
+}
+
+
+void CPU_Range_Calculator::march(const Camera & cam, 
+                                 const Terrain & t, 
+                                 const Buffer & world_coords, 
+                                 Buffer * rng,
+                                 Buffer * hits,
+                                 const bool lod,
+                                 const float * start)
+{
+    const auto sz = world_coords.size();
+    const auto num_rows = std::get<0>(sz);
+    const auto num_cols = std::get<1>(sz);
+
     const std::tuple<float, float, float> origin = cam.position();
+
+    if (t.procedural() != nullptr) {
+        Procedural_Terrain::Cursor cursor(*t.procedural());
+        const float max_range = Range_Calculator::max_range(t);
+        const float max_error = t.scale() / 5.0f;
+
+        for (uint32_t r = 0; r < num_rows; r++) {
+            for (uint32_t c = 0; c < num_cols; c++) {
+                const auto pv = std::make_tuple(
+                    world_coords.at(r, c, 0),
+                    world_coords.at(r, c, 1),
+                    world_coords.at(r, c, 2)
+                );
+                const float begin = start != nullptr ? start[r * num_cols + c] : 0.0f;
+
+                const float range = _compute_range_for_pixel(origin, 
+                                                             pv, 
+                                                             t.scale(), 
+                                                             cursor, 
+                                                             max_error, 
+                                                             max_range,
+                                                             begin,
+                                                             hits ? &hits->at(r, c) : nullptr);
+                if (rng != nullptr) {
+                    rng->at(r, c) = range;
+                }
+            }
+        }
+
+        return;
+    }
+
     const auto bounds = std::make_pair<float, float>(
         static_cast<float>(std::get<0>(t.data().size())),
         static_cast<float>(std::get<1>(t.data().size()))
     );
 
-    const float max_range = t.scale() * std::get<0>(t.data().size()) * std::sqrt(3.0f);
+    const float max_range = Range_Calculator::max_range(t);
     const float max_error = t.scale() / 5.0f;
 
-    for (auto r = 0; r < num_rows; r++) {
-        for (auto c = 0; c < num_cols; c++) {
+    const std::shared_ptr<Terrain_Pyramid> pyramid = t.pyramid();
+    if (pyramid != nullptr && m_lod_error > 0.0f && lod) {
+        const float lod_distance = Terrain_Pyramid::lod_distance(cam.focal_length(), m_lod_error);
+
+        for (uint32_t r = 0; r < num_rows; r++) {
+            for (uint32_t c = 0; c < num_cols; c++) {
+                const auto pv = std::make_tuple(
+                    world_coords.at(r, c, 0),
+                    world_coords.at(r, c, 1),
+                    world_coords.at(r, c, 2)
+                );
+
+                rng->at(r, c) = _compute_range_for_pixel(origin, 
+                                                         pv, 
+                                                         bounds, 
+                                                         t, 
+                                                         *pyramid,
+                                                         lod_distance,
+                                                         max_error, 
+                                                         max_range);
+            }
+        }
+
+        return;
+    }
+
+    for (uint32_t r = 0; r < num_rows; r++) {
+        for (uint32_t c = 0; c < num_cols; c++) {
             const auto pv = std::make_tuple(
                 world_coords.at(r, c, 0),
                 world_coords.at(r, c, 1),
                 world_coords.at(r, c, 2)
             );
-
-            rng.at(r, c) = _compute_range_for_pixel(origin, 
-                                                    pv, 
-                                                    bounds, 
-                                                    t, 
-                                                    max_error, 
-                                                    max_range);
+            const float begin = start != nullptr ? start[r * num_cols + c] : 0.0f;
+
+            const float range = _compute_range_for_pixel(origin, 
+                                                         pv, 
+                                                         bounds, 
+                                                         t, 
+                                                         max_error, 
+                                                         max_range,
+                                                         begin,
+                                                         hits ? &hits->at(r, c) : nullptr);
+            if (rng != nullptr) {
+                rng->at(r, c) = range;
+            }
         }
     }
 }
 
+
+void CPU_Range_Calculator::set_lod_error_budget(const float pixels)
+{
+    if (! (pixels >= 0.0f)) {
+        std::stringstream msg;
+        msg << "Invalid level-of-detail error budget (" << pixels << "). Must be non-negative.";
+        throw std::invalid_argument(msg.str());
+    }
+
+    m_lod_error = pixels;
+}
+
+
+float CPU_Range_Calculator::lod_error_budget() const
+{
+    return m_lod_error;
+}
+
 }
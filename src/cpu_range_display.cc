@@ -0,0 +1,143 @@
+//! @file       cpu_range_display.cc
+//! @brief      Defines an implementation of Range_Display that runs on the CPU
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "buffer.h"
+#include "cpu_range_display.h"
+#include "range_display.h"
+#include "simd.h"
+#include "thread_pool.h"
+
+// Standard Imports
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Third-Party Imports
+
+
+namespace clarity
+{
+
+//! The minimum number of pixels each thread takes at a time
+static constexpr uint32_t _GRAIN = 16384;
+
+//! The bits of a pixel that hold its gray level, and its alpha, as a native-endian word
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+static constexpr int32_t _GRAY_BITS = 0x00010101;
+static constexpr uint32_t _ALPHA_BITS = 0xff000000u;
+#else
+static constexpr int32_t _GRAY_BITS = 0x01010100;
+static constexpr uint32_t _ALPHA_BITS = 0x000000ffu;
+#endif
+
+
+CPU_Range_Display::CPU_Range_Display(const unsigned num_threads)
+    : m_pool(num_threads)
+{
+    // No-op
+}
+
+
+CPU_Range_Display::~CPU_Range_Display()
+{
+    // No-op
+}
+
+
+//! @brief  Find the smallest and largest of a run of values
+static std::pair<float, float> _min_max(const float * values, const uint32_t count)
+{
+    using namespace simd;
+    f32x4 lo = splat(values[0]);
+    f32x4 hi = lo;
+
+    uint32_t i = 0;
+    for (; i + WIDTH <= count; i += WIDTH) {
+        const f32x4 v = load(values + i);
+        lo = select(v < lo, v, lo);
+        hi = select(v > hi, v, hi);
+    }
+
+    float min = std::min(std::min(lo[0], lo[1]), std::min(lo[2], lo[3]));
+    float max = std::max(std::max(hi[0], hi[1]), std::max(hi[2], hi[3]));
+    for (; i < count; i++) {
+        min = std::min(min, values[i]);
+        max = std::max(max, values[i]);
+    }
+
+    return std::make_pair(min, max);
+}
+
+
+//! @brief  Convert a run of ranges to RGBA pixels, 4 bytes each
+static void _to_rgba(const float * values,
+                     const uint32_t count,
+                     const float min,
+                     const float scale,
+                     uint8_t * out)
+{
+    using namespace simd;
+    const f32x4 v_min = splat(min);
+    const f32x4 v_scale = splat(scale);
+    const i32x4 v_gray_bits = splat(_GRAY_BITS);
+    const i32x4 v_alpha_bits = splat(static_cast<int32_t>(_ALPHA_BITS));
+
+    uint32_t i = 0;
+    for (; i + WIDTH <= count; i += WIDTH) {
+        const i32x4 gray = to_int((load(values + i) - v_min) * v_scale);
+        const i32x4 pixels = (gray * v_gray_bits) | v_alpha_bits;
+        std::memcpy(out + 4 * i, &pixels, sizeof(pixels));
+    }
+
+    for (; i < count; i++) {
+        const int32_t gray = static_cast<int32_t>((values[i] - min) * scale);
+        const uint32_t pixel = static_cast<uint32_t>(gray * _GRAY_BITS) | _ALPHA_BITS;
+        std::memcpy(out + 4 * i, &pixel, sizeof(pixel));
+    }
+}
+
+
+std::pair<float, float> CPU_Range_Display::Convert(const Buffer & rng, std::vector<uint8_t> & rgba)
+{
+    const uint32_t count = rng.size().first * rng.size().second;
+    if (count == 0 || rng.depth() != 1) {
+        std::stringstream msg;
+        msg << "Invalid range image of size (" << rng.size().first << ", " << rng.size().second
+            << ") and depth " << static_cast<int>(rng.depth());
+        throw std::invalid_argument(msg.str());
+    }
+
+    const float * values = &rng.at(0, 0);
+    std::pair<float, float> range = std::make_pair(values[0], values[0]);
+    std::mutex mutex;
+
+    m_pool.parallel_for(0, count, [&](const uint32_t begin, const uint32_t end) {
+        const std::pair<float, float> part = _min_max(values + begin, end - begin);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        range.first = std::min(range.first, part.first);
+        range.second = std::max(range.second, part.second);
+    }, _GRAIN);
+
+    const float scale = range.second > range.first ? 255.0f / (range.second - range.first)
+                                                   : 0.0f;
+
+    rgba.resize(4 * static_cast<size_t>(count));
+    uint8_t * out = rgba.data();
+    m_pool.parallel_for(0, count, [&](const uint32_t begin, const uint32_t end) {
+        _to_rgba(values + begin, end - begin, range.first, scale, out + 4 * begin);
+    }, _GRAIN);
+
+    return range;
+}
+
+}
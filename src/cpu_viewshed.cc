@@ -0,0 +1,184 @@
+//! @file       cpu_viewshed.cc
+//! @brief      Defines an implementation of Viewshed that uses the CPU
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "buffer.h"
+#include "cpu_viewshed.h"
+#include "terrain.h"
+#include "thread_pool.h"
+#include "viewshed.h"
+
+// Standard Imports
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// Third-Party Imports
+
+
+namespace clarity
+{
+
+//! @brief  The octants around the observer, as (row, col) steps along their axis and along their
+//!         diagonal. Cell j of ring i of an octant is i steps along the axis and j steps toward
+//!         the diagonal. Each axis and each diagonal is shared by two octants; the even octants
+//!         write the visibility of both of their edges and the odd octants of neither.
+static const int _OCTANTS[8][4] = {
+    {  1,  0,  1,  1 },
+    {  0,  1,  1,  1 },
+    {  0,  1, -1,  1 },
+    { -1,  0, -1,  1 },
+    { -1,  0, -1, -1 },
+    {  0, -1, -1, -1 },
+    {  0, -1,  1, -1 },
+    {  1,  0,  1, -1 }
+};
+
+
+CPU_Viewshed::CPU_Viewshed(const unsigned num_threads)
+    : m_pool(num_threads)
+{
+    // No-op
+}
+
+
+CPU_Viewshed::~CPU_Viewshed()
+{
+    // No-op
+}
+
+
+//! @brief  Get the cell under an observer, throwing if the query is invalid
+static std::pair<int, int> _observer_cell(const Terrain & t,
+                                          const Viewshed::Position & observer,
+                                          const Buffer & visible)
+{
+    if (t.procedural() != nullptr) {
+        throw std::invalid_argument("Viewshed does not support procedural terrain");
+    }
+
+    const auto size = t.data().size();
+    if (visible.size() != size) {
+        std::stringstream msg;
+        msg << "Invalid viewshed buffer size (" << visible.size().first << ", "
+            << visible.size().second << "). Expected (" << size.first << ", " << size.second
+            << ")";
+        throw std::invalid_argument(msg.str());
+    }
+
+    const float row = std::floor(std::get<0>(observer) / t.scale());
+    const float col = std::floor(std::get<1>(observer) / t.scale());
+    if (! (row >= 0.0f && row < size.first && col >= 0.0f && col < size.second)) {
+        std::stringstream msg;
+        msg << "Viewshed observer (" << std::get<0>(observer) << ", " << std::get<1>(observer)
+            << ") is not over the terrain";
+        throw std::out_of_range(msg.str());
+    }
+
+    return std::make_pair(static_cast<int>(row), static_cast<int>(col));
+}
+
+
+//! @brief  Get the number of cells from a cell to the edge of a dimension, in one direction
+static int _extent(const int step, const int pos, const int dim)
+{
+    return step > 0 ? dim - 1 - pos : (step < 0 ? pos : 0);
+}
+
+
+//! @brief  Sweep the rings of one octant
+//!
+//! @param[in]  heights     the height map, row-major
+//! @param[in]  rows, cols  the size of the height map
+//! @param[in]  cell        the (row, col) of the observer
+//! @param[in]  z           the height of the observer, in cells
+//! @param[in]  octant      the index of the octant in _OCTANTS
+//! @param[out] visible     the visibility of each cell, row-major
+static void _sweep_octant(const float * heights,
+                          const int rows,
+                          const int cols,
+                          const std::pair<int, int> cell,
+                          const float z,
+                          const int octant,
+                          float * visible)
+{
+    const int * steps = _OCTANTS[octant];
+    const int axis_r = steps[0];
+    const int axis_c = steps[1];
+    const int minor_r = steps[2] - steps[0];
+    const int minor_c = steps[3] - steps[1];
+    const bool owns_edges = octant % 2 == 0;
+
+    const int rings = std::max(_extent(axis_r, cell.first, rows),
+                               _extent(axis_c, cell.second, cols));
+    const int width = std::max(_extent(minor_r, cell.first, rows),
+                               _extent(minor_c, cell.second, cols));
+
+    // The horizon of the previous ring and of the current one
+    std::vector<float> inner(width + 1, 0.0f);
+    std::vector<float> outer(width + 1, 0.0f);
+
+    for (int i = 1; i <= rings; i++) {
+        const int last = std::min(i, width);
+
+        for (int j = 0; j <= last; j++) {
+            const int r = cell.first + i * axis_r + j * minor_r;
+            const int c = cell.second + i * axis_c + j * minor_c;
+            const float h = heights[static_cast<size_t>(r) * cols + c];
+
+            // The first ring is visible; each later one must clear the horizon inside it
+            float horizon = h;
+            bool seen = true;
+
+            if (i > 1) {
+                const float pos = static_cast<float>(j * (i - 1)) / i;
+                const int j0 = static_cast<int>(pos);
+                const float w = pos - j0;
+                const int j1 = w > 0.0f ? j0 + 1 : j0;
+
+                const float crossing = inner[j0] * (1.0f - w) + inner[j1] * w;
+                const float required = z + (crossing - z) * i / (i - 1);
+
+                seen = h >= required;
+                horizon = std::max(h, required);
+            }
+
+            outer[j] = horizon;
+            if (owns_edges || (j > 0 && j < i)) {
+                visible[static_cast<size_t>(r) * cols + c] = seen ? 1.0f : 0.0f;
+            }
+        }
+
+        std::swap(inner, outer);
+    }
+}
+
+
+void CPU_Viewshed::Compute(const Terrain & t, const Position & observer, Buffer & visible)
+{
+    const std::pair<int, int> cell = _observer_cell(t, observer, visible);
+    const int rows = static_cast<int>(t.data().size().first);
+    const int cols = static_cast<int>(t.data().size().second);
+    const float z = std::get<2>(observer) / t.scale();
+
+    const float * heights = &t.data().at(0, 0);
+    float * out = &visible.at(0, 0);
+
+    m_pool.parallel_for(0, 8, [&](const uint32_t begin, const uint32_t end) {
+        for (uint32_t octant = begin; octant < end; octant++) {
+            _sweep_octant(heights, rows, cols, cell, z, static_cast<int>(octant), out);
+        }
+    });
+
+    visible.at(cell.first, cell.second) = 1.0f;
+}
+
+}
@@ -10,8 +10,13 @@
 #include "device_buffer.h"
 
 // Standard Imports
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <sstream>
 #include <stdexcept>
+#include <vector>
 
 // Third-Party Imports
 #include "cl.hpp"
@@ -28,14 +33,18 @@ Device_Buffer::Device_Buffer(const cl::Context & ctx,
     , m_ctor_err(CL_SUCCESS)
     , m_cl_buffer(ctx, 
                   m_data.get(), 
-                  m_data.get() + (m_rows * m_cols * m_depth),
+                  m_data.get() + (size_t(m_rows) * m_cols * m_depth),
                   read_only, true, &m_ctor_err)
+    , m_synced(std::make_shared<std::atomic<uint64_t>>(dirty_generation()))
 {
     if (m_ctor_err != CL_SUCCESS) {
         std::stringstream msg;
         msg << "Failed to allocated buffer (cl error = " << m_ctor_err << ")";
         throw std::runtime_error(msg.str());
     }
+
+    // The device memory starts as a copy of the host memory
+    track_dirty(m_synced);
 }
 
 
@@ -46,14 +55,18 @@ Device_Buffer::Device_Buffer(const Buffer & b,
     , m_ctor_err(CL_SUCCESS)
     , m_cl_buffer(ctx, 
                   m_data.get(), 
-                  m_data.get() + (m_rows * m_cols * m_depth),
+                  m_data.get() + (size_t(m_rows) * m_cols * m_depth),
                   read_only, true, &m_ctor_err)
+    , m_synced(std::make_shared<std::atomic<uint64_t>>(dirty_generation()))
 {
     if (m_ctor_err != CL_SUCCESS) {
         std::stringstream msg;
         msg << "Failed to allocated buffer (cl error = " << m_ctor_err << ")";
         throw std::runtime_error(msg.str());
     }
+
+    // The device memory starts as a copy of the host memory
+    track_dirty(m_synced);
 }
 
 
@@ -67,6 +80,7 @@ Device_Buffer::Device_Buffer(const Device_Buffer & other)
     : Buffer(other)
     , m_ctor_err(CL_SUCCESS)
     , m_cl_buffer(other.m_cl_buffer)
+    , m_synced(other.m_synced)
 {
     // No-op
 }
@@ -81,6 +95,7 @@ Device_Buffer & Device_Buffer::operator=(const Device_Buffer & other)
     Buffer::operator=(other);
     m_ctor_err = other.m_ctor_err;
     m_cl_buffer = other.m_cl_buffer;
+    m_synced = other.m_synced;
 
     return *this;
 }
@@ -92,10 +107,10 @@ void Device_Buffer::from_device(const cl::CommandQueue * queue)
     if (queue == nullptr) {
         err = cl::copy(m_cl_buffer, 
                        m_data.get(),  
-                       m_data.get() + (m_rows * m_cols * m_depth));
+                       m_data.get() + (size_t(m_rows) * m_cols * m_depth));
     } else {
         const auto start = m_data.get();
-        const auto end = m_data.get() + (m_rows * m_cols * m_depth);
+        const auto end = m_data.get() + (size_t(m_rows) * m_cols * m_depth);
         err = cl::copy(*queue,
                        m_cl_buffer, 
                        start,
@@ -112,15 +127,18 @@ void Device_Buffer::from_device(const cl::CommandQueue * queue)
 
 void Device_Buffer::to_device(const cl::CommandQueue * queue)
 {
+    // Rectangles recorded during the copy may be missed, so they stay dirty
+    const uint64_t generation = dirty_generation();
+
     cl_int err = CL_SUCCESS;
     if (queue == nullptr) {
         err = cl::copy(m_data.get(),  
-                       m_data.get() + (m_rows * m_cols * m_depth), 
+                       m_data.get() + (size_t(m_rows) * m_cols * m_depth), 
                        m_cl_buffer);
     } else {
         err = cl::copy(*queue,
                        m_data.get(),  
-                       m_data.get() + (m_rows * m_cols * m_depth), 
+                       m_data.get() + (size_t(m_rows) * m_cols * m_depth), 
                        m_cl_buffer);
     }
 
@@ -129,6 +147,73 @@ void Device_Buffer::to_device(const cl::CommandQueue * queue)
         msg << "Failed to send buffer to device (cl error = " << err << ")";
         throw std::runtime_error(msg.str());
     }
+
+    m_synced->store(generation);
+    clear_dirty();
+}
+
+
+size_t Device_Buffer::to_device_dirty(const cl::CommandQueue * queue)
+{
+    const uint64_t generation = dirty_generation();
+    const std::vector<Region> dirty = dirty_regions_since(m_synced->load());
+    if (dirty.empty()) {
+        return 0;
+    }
+
+    cl_int err = CL_SUCCESS;
+    const cl::CommandQueue q = queue != nullptr ? *queue : cl::CommandQueue::getDefault(&err);
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to get the default command queue (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+
+    // The host and the device buffer have the same layout, so both use the same offsets
+    const size_t cell_bytes = m_depth * sizeof(float);
+    const size_t row_pitch = m_cols * cell_bytes;
+    size_t cells = 0;
+    for (const auto & r : dirty) {
+        cl::size_t<3> origin;
+        origin[0] = r.col * cell_bytes;
+        origin[1] = r.row;
+        origin[2] = 0;
+
+        cl::size_t<3> region;
+        region[0] = r.cols * cell_bytes;
+        region[1] = r.rows;
+        region[2] = 1;
+
+        err = q.enqueueWriteBufferRect(m_cl_buffer, 
+                                       CL_FALSE, 
+                                       origin, 
+                                       origin, 
+                                       region, 
+                                       row_pitch, 
+                                       0, 
+                                       row_pitch, 
+                                       0, 
+                                       m_data.get());
+        if (err != CL_SUCCESS) {
+            std::stringstream msg;
+            msg << "Failed to send region (" << r.row << ", " << r.col << ") to device ";
+            msg << "(cl error = " << err << ")";
+            throw std::runtime_error(msg.str());
+        }
+
+        cells += size_t(r.rows) * r.cols;
+    }
+
+    err = q.finish();
+    if (err != CL_SUCCESS) {
+        std::stringstream msg;
+        msg << "Failed to finish sending regions to device (cl error = " << err << ")";
+        throw std::runtime_error(msg.str());
+    }
+
+    m_synced->store(generation);
+    clear_dirty();
+    return cells;
 }
 
 }
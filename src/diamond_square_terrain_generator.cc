@@ -7,12 +7,16 @@
 
 // CLarity Imports
 #include "buffer.h"
+#include "counter_rng.h"
 #include "device_buffer.h"
 #include "diamond_square_terrain_generator.h"
 #include "terrain.h"
 #include "terrain_generator.h"
+#include "thread_pool.h"
 
 // Standard Imports
+#include <algorithm>
+#include <cstdint>
 #include <memory>
 #include <random>
 #include <stdexcept>
@@ -23,9 +27,20 @@ namespace clarity
 {
 
 Diamond_Square_Generator::Diamond_Square_Generator()
+    : Diamond_Square_Generator(
+        (static_cast<uint64_t>(std::random_device()()) << 32) | std::random_device()())
+{
+    // No-op
+}
+
+
+Diamond_Square_Generator::Diamond_Square_Generator(const uint64_t seed,
+                                                   const unsigned num_threads)
     : Terrain_Generator()
+    , m_seed(seed)
+    , m_pool(num_threads)
 {
-    // No-op, no state needed
+    // No-op
 }
 
 
@@ -35,96 +50,129 @@ Diamond_Square_Generator::~Diamond_Square_Generator()
 }
 
 
-void _process_squares(const uint32_t rows, 
-                      const uint32_t cols, 
-                      const uint32_t size, 
-                      const uint32_t half, 
-                      std::mt19937 & gen, 
-                      std::uniform_real_distribution<> & rng, 
-                      Buffer & tbuffer)
+uint64_t Diamond_Square_Generator::seed() const
 {
-    for (uint32_t r = half; r < rows; r += size) {
-        for (uint32_t c = half; c < cols; c += size) {
-            const bool lower_row_valid = r >= half;
+    return m_seed;
+}
+
+
+void Diamond_Square_Generator::set_seed(const uint64_t seed)
+{
+    m_seed = seed;
+}
+
+
+//! @brief  The reciprocal of each neighbour count. Averages multiply by these rather than
+//!         divide, so that the OpenCL kernels (which may not divide exactly) match bit for bit.
+static const float _INV_COUNT[5] = { 0.0f, 1.0f, 1.0f / 2, 1.0f / 3, 1.0f / 4 };
+
+
+//! @brief  The number of rows each thread claims at a time, aiming for ~16K cells per chunk
+static uint32_t _grain(const uint32_t cells_per_row)
+{
+    return std::max<uint32_t>(1, (1 << 14) / std::max<uint32_t>(cells_per_row, 1));
+}
+
+
+static void _process_squares(const uint32_t rows, 
+                             const uint32_t cols, 
+                             const uint32_t size, 
+                             const uint32_t half, 
+                             const uint64_t seed,
+                             const uint32_t level,
+                             const float feature_scale,
+                             float * const t,
+                             Thread_Pool & pool)
+{
+    // Every square centre depends only on corners set by earlier levels, so rows are independent
+    const uint32_t num_rows = (rows - half + size - 1) / size;
+
+    pool.parallel_for(0, num_rows, [&](const uint32_t begin, const uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            const uint32_t r = half + i * size;
             const bool upper_row_valid = (r + half) < rows;
-            
-            const bool lower_col_valid = c >= half;
-            const bool upper_col_valid = (c + half) < cols;
 
-            float sum = 0.0f;
-            int valid_ct = 0;
+            for (uint32_t c = half; c < cols; c += size) {
+                const bool upper_col_valid = (c + half) < cols;
 
-            if (lower_row_valid && lower_col_valid) {
-                sum += tbuffer.at(r - half, c - half);
-                valid_ct++;
-            }
+                // Square centres always have their lower corners
+                float sum = t[(r - half) * cols + (c - half)];
+                int valid_ct = 1;
 
-            if (lower_row_valid && upper_col_valid) {
-                sum += tbuffer.at(r - half, c + half);
-                valid_ct++;
-            }
-            
-            if (upper_row_valid && lower_col_valid) {
-                sum += tbuffer.at(r + half, c - half);
-                valid_ct++;
-            }
+                if (upper_col_valid) {
+                    sum += t[(r - half) * cols + (c + half)];
+                    valid_ct++;
+                }
+
+                if (upper_row_valid) {
+                    sum += t[(r + half) * cols + (c - half)];
+                    valid_ct++;
+                }
 
-            if (upper_row_valid && upper_col_valid) {
-                sum += tbuffer.at(r + half, c + half);
-                valid_ct++;
+                if (upper_row_valid && upper_col_valid) {
+                    sum += t[(r + half) * cols + (c + half)];
+                    valid_ct++;
+                }
+
+                const float offset = feature_scale * counter_rng::uniform(seed, level, r, c);
+                t[r * cols + c] = sum * _INV_COUNT[valid_ct] + offset;
             }
-            
-            const float offset = rng(gen);
-            tbuffer.at(r, c) = (sum / valid_ct) + offset;
         }
-    }
+    }, _grain(cols / size));
 }
 
 
-void _process_diamonds(const uint32_t rows, 
-                       const uint32_t cols, 
-                       const uint32_t size, 
-                       const uint32_t half, 
-                       std::mt19937 & gen, 
-                       std::uniform_real_distribution<> & rng, 
-                       Buffer & tbuffer)
+static void _process_diamonds(const uint32_t rows, 
+                              const uint32_t cols, 
+                              const uint32_t size, 
+                              const uint32_t half, 
+                              const uint64_t seed,
+                              const uint32_t level,
+                              const float feature_scale,
+                              float * const t,
+                              Thread_Pool & pool)
 {
-    for (uint32_t r = 0; r < rows; r += half) {
-        uint32_t start_col = (r + half) % size;
-        for (uint32_t c = start_col; c < cols; c += size) {
+    // Diamond points depend only on square centres and corners, so rows are independent
+    const uint32_t num_rows = (rows + half - 1) / half;
+
+    pool.parallel_for(0, num_rows, [&](const uint32_t begin, const uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            const uint32_t r = i * half;
             const bool lower_row_valid = r >= half;
             const bool upper_row_valid = (r + half) < rows;
-            
-            const bool lower_col_valid = c >= half;
-            const bool upper_col_valid = (c + half) < cols;
-
-            float sum = 0.0f;
-            int valid_ct = 0;
-           
-            if (lower_col_valid) {
-                sum += tbuffer.at(r, c - half);
-                valid_ct++;
-            }
-            
-            if (upper_row_valid) {
-                sum += tbuffer.at(r + half, c);
-                valid_ct++;
-            }
-            
-            if (upper_col_valid) {
-                sum += tbuffer.at(r, c + half);
-                valid_ct++;
-            }
-            
-            if (lower_row_valid) {
-                sum += tbuffer.at(r - half, c);
-                valid_ct++;
-            }
 
-            const float offset = rng(gen);
-            tbuffer.at(r, c) = (sum / valid_ct) + offset;
+            for (uint32_t c = (r + half) % size; c < cols; c += size) {
+                const bool lower_col_valid = c >= half;
+                const bool upper_col_valid = (c + half) < cols;
+
+                float sum = 0.0f;
+                int valid_ct = 0;
+               
+                if (lower_col_valid) {
+                    sum += t[r * cols + (c - half)];
+                    valid_ct++;
+                }
+                
+                if (upper_row_valid) {
+                    sum += t[(r + half) * cols + c];
+                    valid_ct++;
+                }
+                
+                if (upper_col_valid) {
+                    sum += t[r * cols + (c + half)];
+                    valid_ct++;
+                }
+                
+                if (lower_row_valid) {
+                    sum += t[(r - half) * cols + c];
+                    valid_ct++;
+                }
+
+                const float offset = feature_scale * counter_rng::uniform(seed, level, r, c);
+                t[r * cols + c] = sum * _INV_COUNT[valid_ct] + offset;
+            }
         }
-    }
+    }, _grain(cols / size));
 }
 
 
@@ -148,22 +196,21 @@ Terrain Diamond_Square_Generator::generate_terrain(std::shared_ptr<Buffer> buffe
     uint32_t size = (rows - 1);
     uint32_t half = size / 2;
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    float * const t = tbuffer.data().get();
+    uint32_t level = 0;
 
     while (half >= 1) {
         const float feature_scale = size * roughness;
 
-        auto rng = std::uniform_real_distribution<>(-feature_scale, feature_scale);
-
         // Process squares
-        _process_squares(rows, cols, size, half, gen, rng, tbuffer);
+        _process_squares(rows, cols, size, half, m_seed, level, feature_scale, t, m_pool);
 
         // Process diamonds
-        _process_diamonds(rows, cols, size, half, gen, rng, tbuffer);
+        _process_diamonds(rows, cols, size, half, m_seed, level, feature_scale, t, m_pool);
         
         size = size / 2;
         half = size / 2;
+        level++;
     }
 
     return terrain;
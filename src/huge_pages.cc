@@ -0,0 +1,182 @@
+//! @file       huge_pages.cc
+//! @brief      Defines utilities for backing large allocations with huge pages
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "huge_pages.h"
+
+// Standard Imports
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+
+// Third-Party Imports
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace clarity
+{
+namespace huge_pages
+{
+
+#ifdef __linux__
+
+//! @brief  Wrap a mapping in a shared_ptr that unmaps it
+static std::shared_ptr<float> _own_mapping(void * p, const size_t bytes)
+{
+    return std::shared_ptr<float>(static_cast<float *>(p), [bytes](float * q) {
+        munmap(q, bytes);
+    });
+}
+
+
+//! @brief  Check whether transparent huge pages can be asked for with madvise
+static bool _transparent_enabled()
+{
+    std::ifstream in("/sys/kernel/mm/transparent_hugepage/enabled");
+    std::string modes;
+    std::getline(in, modes);
+
+    // The active mode is bracketed, e.g. "always [madvise] never"
+    return in.good() && modes.find("[never]") == std::string::npos;
+}
+
+
+//! @brief  Map memory aligned to a huge page and ask for transparent huge pages on it
+//!
+//! @return the memory, or null if the kernel refused
+static std::shared_ptr<float> _allocate_transparent(const size_t bytes)
+{
+    if (! _transparent_enabled()) {
+        return nullptr;
+    }
+
+    // Over-allocate by a page, then trim the ends so the mapping starts on a huge page
+    const size_t padded = bytes + PAGE_BYTES;
+    void * p = mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        return nullptr;
+    }
+
+    const uintptr_t start = reinterpret_cast<uintptr_t>(p);
+    const uintptr_t aligned = (start + PAGE_BYTES - 1) & ~(uintptr_t(PAGE_BYTES) - 1);
+    if (aligned > start) {
+        munmap(p, aligned - start);
+    }
+    if (start + padded > aligned + bytes) {
+        munmap(reinterpret_cast<void *>(aligned + bytes), start + padded - aligned - bytes);
+    }
+
+    void * q = reinterpret_cast<void *>(aligned);
+    if (madvise(q, bytes, MADV_HUGEPAGE) != 0) {
+        munmap(q, bytes);
+        return nullptr;
+    }
+
+    return _own_mapping(q, bytes);
+}
+
+#endif
+
+
+std::shared_ptr<float> allocate(const size_t count, Backing & backing)
+{
+    const size_t bytes = std::max<size_t>(1, count) * sizeof(float);
+
+#ifdef __linux__
+    if (bytes >= PAGE_BYTES) {
+        // The reserved pool needs whole pages
+        const size_t rounded = (bytes + PAGE_BYTES - 1) / PAGE_BYTES * PAGE_BYTES;
+        void * p = mmap(nullptr,
+                        rounded,
+                        PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+                        -1,
+                        0);
+        if (p != MAP_FAILED) {
+            backing = EXPLICIT;
+            return _own_mapping(p, rounded);
+        }
+
+        std::shared_ptr<float> transparent = _allocate_transparent(bytes);
+        if (transparent != nullptr) {
+            backing = TRANSPARENT;
+            return transparent;
+        }
+    }
+#endif
+
+    backing = STANDARD;
+    return std::shared_ptr<float>(new float[bytes / sizeof(float)], std::default_delete<float[]>());
+}
+
+
+size_t resident_bytes(const void * addr, const size_t bytes)
+{
+    size_t total = 0;
+
+#ifdef __linux__
+    const uintptr_t first = reinterpret_cast<uintptr_t>(addr);
+    const uintptr_t last = first + bytes;
+
+    std::ifstream in("/proc/self/smaps");
+    std::string line;
+    bool overlaps = false;
+    while (std::getline(in, line)) {
+        std::stringstream fields(line);
+        std::string key;
+        fields >> key;
+
+        if (key.empty()) {
+            continue;
+        }
+
+        if (key.back() != ':') {
+            // A mapping header, such as "7f0000000000-7f0000200000 rw-p ..."
+            const size_t dash = key.find('-');
+            try {
+                const uintptr_t start = std::stoull(key.substr(0, dash), nullptr, 16);
+                const uintptr_t end = std::stoull(key.substr(dash + 1), nullptr, 16);
+                overlaps = start < last && first < end;
+            } catch (const std::exception &) {
+                overlaps = false;
+            }
+        } else if (overlaps && (key == "AnonHugePages:" ||
+                                key == "Private_Hugetlb:" ||
+                                key == "Shared_Hugetlb:")) {
+            size_t kb = 0;
+            fields >> kb;
+            total += kb * 1024;
+        }
+    }
+#else
+    (void) addr;
+    (void) bytes;
+#endif
+
+    return total;
+}
+
+
+const char * name(const Backing backing)
+{
+    switch (backing) {
+        case TRANSPARENT:
+            return "transparent huge pages";
+        case EXPLICIT:
+            return "explicit huge pages";
+        default:
+            return "standard pages";
+    }
+}
+
+}
+}
@@ -0,0 +1,339 @@
+//! @file       hybrid_range_calculator.cc
+//! @brief      Defines an implementation of Range_Calculator that splits each frame between
+//!             CPU threads and a device calculator
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "buffer.h"
+#include "camera.h"
+#include "cl_utils.h"
+#include "cpu_range_calculator.h"
+#include "device_buffer.h"
+#include "hybrid_range_calculator.h"
+#include "range_calculator.h"
+#include "terrain.h"
+#include "thread_pool.h"
+
+// Standard Imports
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+// Third-Party Imports
+
+
+namespace clarity
+{
+
+//! @brief  The smallest fraction of the rows either side is given, so both stay measured
+static constexpr float _MIN_SHARE = 1.0f / 32.0f;
+
+//! @brief  The weight of the latest frame when the share is rebalanced
+static constexpr float _REBALANCE_WEIGHT = 0.5f;
+
+//! @brief  The number of rows in each band of the CPU side
+static constexpr uint32_t _BAND_ROWS = 4;
+
+//! @brief  The number of pixels in each chunk of the CPU side of Calculate_Pixels
+static constexpr uint32_t _PIXEL_GRAIN = 256;
+
+
+Hybrid_Range_Calculator::Hybrid_Range_Calculator(std::unique_ptr<Range_Calculator> device,
+                                                 const unsigned num_threads)
+    : m_device(std::move(device))
+    , m_cpu()
+    , m_pool(num_threads)
+    , m_device_share(0.5f)
+{
+    if (m_device == nullptr) {
+        throw std::invalid_argument("Hybrid_Range_Calculator requires a device calculator");
+    }
+}
+
+
+Hybrid_Range_Calculator::~Hybrid_Range_Calculator()
+{
+    // No-op
+}
+
+
+//! @brief  Get the number of items out of count that go to the device
+static uint32_t _device_count(const uint32_t count, const float share)
+{
+    return std::min(count, static_cast<uint32_t>(std::lround(share * count)));
+}
+
+
+//! @brief  Get a Buffer that views rows [row0, row0 + rows) of another Buffer
+static Buffer _rows_of(Buffer & b, const uint32_t row0, const uint32_t rows)
+{
+    const size_t offset = static_cast<size_t>(row0) * b.size().second * b.depth();
+    const std::shared_ptr<float> data(b.data(), b.data().get() + offset);
+    return Buffer(data, rows, b.size().second, b.depth());
+}
+
+
+//! @brief  Reverse the order of the rows of a Buffer
+static void _flip_rows(Buffer & b)
+{
+    const size_t pitch = static_cast<size_t>(b.size().second) * b.depth();
+    float * const data = b.data().get();
+    for (uint32_t r = 0, s = b.size().first; r + 1 < s; r++, s--) {
+        std::swap_ranges(data + r * pitch, data + (r + 1) * pitch, data + (s - 1) * pitch);
+    }
+}
+
+
+void Hybrid_Range_Calculator::Calculate(const Camera & cam, const Terrain & t, Buffer & rng)
+{
+    const auto sz = cam.focal_plane_dimensions();
+    const uint32_t rows = std::get<0>(sz);
+    const uint32_t cols = std::get<1>(sz);
+
+    if (rng.size().first != rows || rng.size().second != cols || rng.depth() != 1) {
+        std::stringstream msg;
+        msg << "Invalid Argument. Expected a range buffer of size (" << rows << ", " << cols
+            << ") but got a buffer of size (" << rng.size().first << ", "
+            << rng.size().second << ")";
+        throw std::invalid_argument(msg.str());
+    }
+
+    Calculate_Region(cam, t, 0, 0, rng);
+
+    Device_Buffer * db = dynamic_cast<Device_Buffer *>(&rng);
+    if (db != nullptr) {
+        db->to_device();
+    }
+}
+
+
+void Hybrid_Range_Calculator::Calculate_Region(const Camera & cam, 
+                                               const Terrain & t, 
+                                               const uint32_t row0, 
+                                               const uint32_t col0, 
+                                               Buffer & rng)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    const uint32_t rows = rng.size().first;
+    const uint32_t cols = rng.size().second;
+    if (rows == 0 || cols == 0) {
+        return;
+    }
+
+    const auto sz = cam.focal_plane_dimensions();
+    const uint32_t num_rows = std::get<0>(sz);
+    if (row0 + rows > num_rows || col0 + cols > std::get<1>(sz)) {
+        std::stringstream msg;
+        msg << "Region (" << row0 << ", " << col0 << ") + (" << rows << ", " << cols
+            << ") is outside the focal plane (" << num_rows << ", " << std::get<1>(sz) << ")";
+        throw std::out_of_range(msg.str());
+    }
+
+    const uint32_t device_rows = _device_count(rows, m_device_share);
+    const uint32_t cpu_rows = rows - device_rows;
+
+    // The device takes the top rows on a thread of its own, as its calls block on the queue
+    double device_seconds = 0.0;
+    std::exception_ptr device_error;
+    std::thread device_thread;
+    if (device_rows > 0) {
+        device_thread = std::thread([&]() {
+            try {
+                const auto begin = Clock::now();
+                Buffer part = _rows_of(rng, 0, device_rows);
+                if (m_device->rows_bottom_up()) {
+                    // Ask for the same rows in the order of the device, and flip them
+                    const uint32_t device_row0 = num_rows - row0 - device_rows;
+                    m_device->Calculate_Region(cam, t, device_row0, col0, part);
+                    _flip_rows(part);
+                } else {
+                    m_device->Calculate_Region(cam, t, row0, col0, part);
+                }
+                device_seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+            } catch (...) {
+                device_error = std::current_exception();
+            }
+        });
+    }
+
+    // The CPU takes the rest in bands
+    double cpu_seconds = 0.0;
+    std::exception_ptr cpu_error;
+    try {
+        const auto begin = Clock::now();
+        const uint32_t num_bands = (cpu_rows + _BAND_ROWS - 1) / _BAND_ROWS;
+        m_pool.parallel_for(0, num_bands, [&](const uint32_t first, const uint32_t last) {
+            for (uint32_t b = first; b < last; b++) {
+                const uint32_t r = device_rows + b * _BAND_ROWS;
+                const uint32_t n = std::min(_BAND_ROWS, rows - r);
+                Buffer part = _rows_of(rng, r, n);
+                m_cpu.Calculate_Region(cam, t, row0 + r, col0, part);
+            }
+        });
+        cpu_seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+    } catch (...) {
+        cpu_error = std::current_exception();
+    }
+
+    if (device_thread.joinable()) {
+        device_thread.join();
+    }
+    if (device_error) {
+        std::rethrow_exception(device_error);
+    }
+    if (cpu_error) {
+        std::rethrow_exception(cpu_error);
+    }
+
+    // Move the split toward the measured ratio of rows per second
+    if (device_rows > 0 && cpu_rows > 0 && device_seconds > 0.0 && cpu_seconds > 0.0) {
+        const double device_rate = device_rows / device_seconds;
+        const double cpu_rate = cpu_rows / cpu_seconds;
+        const float measured = static_cast<float>(device_rate / (device_rate + cpu_rate));
+
+        const float share = (1.0f - _REBALANCE_WEIGHT) * m_device_share
+                          + _REBALANCE_WEIGHT * measured;
+        m_device_share = std::min(std::max(share, _MIN_SHARE), 1.0f - _MIN_SHARE);
+    }
+}
+
+
+void Hybrid_Range_Calculator::split_pixels(const Camera & cam, 
+                                           const Terrain & t, 
+                                           const std::vector<Pixel> & pixels, 
+                                           const std::vector<float> * start,
+                                           std::vector<float> & ranges)
+{
+    if (start != nullptr && start->size() != pixels.size()) {
+        std::stringstream msg;
+        msg << "Invalid Argument. Expected " << pixels.size() << " start ranges but got "
+            << start->size();
+        throw std::invalid_argument(msg.str());
+    }
+
+    const uint32_t count = static_cast<uint32_t>(pixels.size());
+    const uint32_t device_count = _device_count(count, m_device_share);
+    ranges.resize(count);
+
+    // Each side gets copies of its own pixels, and writes its results back into place
+    std::exception_ptr device_error;
+    std::thread device_thread;
+    if (device_count > 0) {
+        device_thread = std::thread([&]() {
+            try {
+                std::vector<Pixel> part(pixels.begin(), pixels.begin() + device_count);
+                if (m_device->rows_bottom_up()) {
+                    const uint32_t num_rows = std::get<0>(cam.focal_plane_dimensions());
+                    for (auto & p : part) {
+                        p.first = num_rows - 1 - p.first;
+                    }
+                }
+                std::vector<float> out;
+                if (start != nullptr) {
+                    const std::vector<float> s(start->begin(), start->begin() + device_count);
+                    m_device->Calculate_Pixels(cam, t, part, s, out);
+                } else {
+                    m_device->Calculate_Pixels(cam, t, part, out);
+                }
+                std::copy(out.begin(), out.end(), ranges.begin());
+            } catch (...) {
+                device_error = std::current_exception();
+            }
+        });
+    }
+
+    std::exception_ptr cpu_error;
+    try {
+        m_pool.parallel_for(device_count, count, [&](const uint32_t first, const uint32_t last) {
+            const std::vector<Pixel> part(pixels.begin() + first, pixels.begin() + last);
+            std::vector<float> out;
+            if (start != nullptr) {
+                const std::vector<float> s(start->begin() + first, start->begin() + last);
+                m_cpu.Calculate_Pixels(cam, t, part, s, out);
+            } else {
+                m_cpu.Calculate_Pixels(cam, t, part, out);
+            }
+            std::copy(out.begin(), out.end(), ranges.begin() + first);
+        }, _PIXEL_GRAIN);
+    } catch (...) {
+        cpu_error = std::current_exception();
+    }
+
+    if (device_thread.joinable()) {
+        device_thread.join();
+    }
+    if (device_error) {
+        std::rethrow_exception(device_error);
+    }
+    if (cpu_error) {
+        std::rethrow_exception(cpu_error);
+    }
+}
+
+
+void Hybrid_Range_Calculator::Calculate_Pixels(const Camera & cam, 
+                                               const Terrain & t, 
+                                               const std::vector<Pixel> & pixels, 
+                                               std::vector<float> & ranges)
+{
+    split_pixels(cam, t, pixels, nullptr, ranges);
+}
+
+
+void Hybrid_Range_Calculator::Calculate_Pixels(const Camera & cam, 
+                                               const Terrain & t, 
+                                               const std::vector<Pixel> & pixels, 
+                                               const std::vector<float> & start,
+                                               std::vector<float> & ranges)
+{
+    split_pixels(cam, t, pixels, &start, ranges);
+}
+
+
+void Hybrid_Range_Calculator::Convert_Pixel_To_Camera_Coordinates(const Camera & cam, 
+                                                                  Buffer & cam_coords)
+{
+    m_cpu.Convert_Pixel_To_Camera_Coordinates(cam, cam_coords);
+}
+
+
+void Hybrid_Range_Calculator::Convert_Camera_To_World_Coordinates(const Camera & cam, 
+                                                                  const Buffer & cam_coords, 
+                                                                  Buffer & world_coords)
+{
+    m_cpu.Convert_Camera_To_World_Coordinates(cam, cam_coords, world_coords);
+}
+
+
+void Hybrid_Range_Calculator::Compute_Range(const Camera & cam, 
+                                            const Terrain & t, 
+                                            const Buffer & world_coords, 
+                                            Buffer & rng)
+{
+    m_cpu.Compute_Range(cam, t, world_coords, rng);
+}
+
+
+void Hybrid_Range_Calculator::Calculate_Hits(const Camera & cam, const Terrain & t, Buffer & hits)
+{
+    m_cpu.Calculate_Hits(cam, t, hits);
+}
+
+
+float Hybrid_Range_Calculator::share(const Execution_Target target) const
+{
+    return target == Execution_Target::GPU ? m_device_share : 1.0f - m_device_share;
+}
+
+}
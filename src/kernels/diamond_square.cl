@@ -0,0 +1,140 @@
+//! @file       diamond_square.cl
+//! @brief      Defines OpenCL kernels for the square and diamond passes of the diamond-square
+//!             terrain generation algorithm
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// Results must match Diamond_Square_Generator bit for bit, so a*b+c may not become an fma
+#pragma OPENCL FP_CONTRACT OFF
+
+//! @brief  The reciprocal of each neighbour count. Matches _INV_COUNT in
+//!         diamond_square_terrain_generator.cc.
+__constant float _DS_INV_COUNT[5] = { 0.0f, 1.0f, 1.0f / 2, 1.0f / 3, 1.0f / 4 };
+
+
+//! @brief  The SplitMix64 finalizer. Matches counter_rng::mix.
+inline ulong ds_mix(ulong x)
+{
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9UL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebUL;
+    return x ^ (x >> 31);
+}
+
+
+//! @brief  A uniform float in [-1, 1) keyed by the cell. Matches counter_rng::uniform.
+inline float ds_uniform(const ulong seed, const uint level, const uint row, const uint col)
+{
+    const ulong cell = ((ulong) level << 58) ^ ((ulong) row << 29) ^ (ulong) col;
+    const ulong h = ds_mix(seed ^ ds_mix(cell + 0x9e3779b97f4a7c15UL));
+    const int bits = (int) (h >> 40);
+    return (float) (bits - (1 << 23)) * (1.0f / (1 << 23));
+}
+
+
+//! @brief  Set the centre of each square at one level of the algorithm.
+//!
+//! @detail The global size is (square rows, square cols).
+//!
+//! @param[in,out]  height_map      the terrain height map
+//! @param[in]      rows            the number of rows in the height map
+//! @param[in]      cols            the number of cols in the height map
+//! @param[in]      size            the side length of each square, in cells
+//! @param[in]      seed            the seed of the random offsets
+//! @param[in]      level           the level of the algorithm
+//! @param[in]      feature_scale   the magnitude of the random offsets
+__kernel void ds_squares(__global float * height_map,
+                         const uint rows,
+                         const uint cols,
+                         const uint size,
+                         const ulong seed,
+                         const uint level,
+                         const float feature_scale)
+{
+    const uint half = size / 2;
+    const uint r = half + get_global_id(0) * size;
+    const uint c = half + get_global_id(1) * size;
+
+    if (r >= rows || c >= cols) {
+        return;
+    }
+
+    const int upper_row_valid = (r + half) < rows;
+    const int upper_col_valid = (c + half) < cols;
+
+    float sum = height_map[(r - half) * cols + (c - half)];
+    int valid_ct = 1;
+
+    if (upper_col_valid) {
+        sum += height_map[(r - half) * cols + (c + half)];
+        valid_ct++;
+    }
+
+    if (upper_row_valid) {
+        sum += height_map[(r + half) * cols + (c - half)];
+        valid_ct++;
+    }
+
+    if (upper_row_valid && upper_col_valid) {
+        sum += height_map[(r + half) * cols + (c + half)];
+        valid_ct++;
+    }
+
+    const float offset = feature_scale * ds_uniform(seed, level, r, c);
+    height_map[r * cols + c] = sum * _DS_INV_COUNT[valid_ct] + offset;
+}
+
+
+//! @brief  Set the centre of each diamond at one level of the algorithm.
+//!
+//! @detail The global size is (diamond rows, diamonds in the longest row).
+//!
+//! @param[in,out]  height_map      the terrain height map
+//! @param[in]      rows            the number of rows in the height map
+//! @param[in]      cols            the number of cols in the height map
+//! @param[in]      size            the side length of each square, in cells
+//! @param[in]      seed            the seed of the random offsets
+//! @param[in]      level           the level of the algorithm
+//! @param[in]      feature_scale   the magnitude of the random offsets
+__kernel void ds_diamonds(__global float * height_map,
+                          const uint rows,
+                          const uint cols,
+                          const uint size,
+                          const ulong seed,
+                          const uint level,
+                          const float feature_scale)
+{
+    const uint half = size / 2;
+    const uint r = get_global_id(0) * half;
+    const uint c = (r + half) % size + get_global_id(1) * size;
+
+    if (r >= rows || c >= cols) {
+        return;
+    }
+
+    float sum = 0.0f;
+    int valid_ct = 0;
+
+    if (c >= half) {
+        sum += height_map[r * cols + (c - half)];
+        valid_ct++;
+    }
+
+    if ((r + half) < rows) {
+        sum += height_map[(r + half) * cols + c];
+        valid_ct++;
+    }
+
+    if ((c + half) < cols) {
+        sum += height_map[r * cols + (c + half)];
+        valid_ct++;
+    }
+
+    if (r >= half) {
+        sum += height_map[(r - half) * cols + c];
+        valid_ct++;
+    }
+
+    const float offset = feature_scale * ds_uniform(seed, level, r, c);
+    height_map[r * cols + c] = sum * _DS_INV_COUNT[valid_ct] + offset;
+}
@@ -0,0 +1,110 @@
+//! @file       line_of_sight.cl
+//! @brief      Defines an OpenCL kernel to test batches of lines of sight against a height map
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+//! @brief  Get the distance along a line at which it leaves a block of cells
+float block_exit(const float3 p, const float3 d, const float s, const float2 lo, const float2 hi)
+{
+    float exit = INFINITY;
+
+    if (d.x > 0.0f) {
+        exit = min(exit, (hi.x - p.x) / d.x);
+    } else if (d.x < 0.0f) {
+        exit = min(exit, (lo.x - p.x) / d.x);
+    }
+
+    if (d.y > 0.0f) {
+        exit = min(exit, (hi.y - p.y) / d.y);
+    } else if (d.y < 0.0f) {
+        exit = min(exit, (lo.y - p.y) / d.y);
+    }
+
+    return s + exit;
+}
+
+
+//! @brief  Test whether each target can be seen from its observer. See CPU_Line_Of_Sight.
+//!
+//! @param[in]  observers   the start of each line, in world coordinates
+//! @param[in]  targets     the end of each line, in world coordinates
+//! @param[in]  height_map  the terrain height map
+//! @param[in]  pyramid     the (min, max) of every level of the Terrain_Pyramid, packed
+//! @param[in]  levels      the (offset into pyramid, cols) of each level. Entry 0 is unused.
+//! @param[in]  num_levels  the number of levels in the pyramid. 0 walks every step.
+//! @param[in]  scale       the scale of the terrain map, in meters-per-pixel
+//! @param[in]  max_error   the step along each line, in meters
+//! @param[in]  bounds      the (rows, cols) of the heightmap, pixels
+//! @param[out] visible     1 if the line is clear, 0 if it is blocked
+//! @param[out] distance    the distance to the first blocking step or the target, in meters
+__kernel void line_of_sight(__global float4 * observers,
+                            __global float4 * targets,
+                            __global float * height_map,
+                            __global float2 * pyramid,
+                            __global int2 * levels,
+                            const int num_levels,
+                            const float scale,
+                            const float max_error,
+                            const float2 bounds,
+                            __global uchar * visible,
+                            __global float * distance)
+{
+    const int i = get_global_id(0);
+    const float step = max_error / scale;
+    const float3 o = observers[i].xyz / scale;
+    float3 d = targets[i].xyz / scale - o;
+    const float len = length(d);
+
+    visible[i] = 1;
+    distance[i] = scale * len;
+    if (len == 0.0f) {
+        return;
+    }
+    d = d / len;
+
+    // Steps are taken from their index, as on the CPU, so skipping steps changes nothing
+    const float steps = min(floor(len / step), 4.0e9f);
+    const uint last = steps >= 1.0f ? (uint) steps - 1 : 0;
+    int level = num_levels;
+    uint k = 1;
+
+    while (k <= last) {
+        const float s = (float) k * step;
+        const float3 p = o + d * s;
+
+        const int r = clamp(p.x, 0.0f, bounds.x - 1.0f);
+        const int c = clamp(p.y, 0.0f, bounds.y - 1.0f);
+
+        if (p.z <= height_map[r * (int) bounds.y + c]) {
+            visible[i] = 0;
+            distance[i] = scale * s;
+            return;
+        }
+
+        uint next = k + 1;
+        const int inside = p.x >= 0.0f && p.x < bounds.x && p.y >= 0.0f && p.y < bounds.y;
+
+        for (; inside && level >= 1; level--) {
+            const int br = r >> level;
+            const int bc = c >> level;
+            const float2 lo = { (float) (br << level), (float) (bc << level) };
+            const float2 hi = { (float) ((br + 1) << level), (float) ((bc + 1) << level) };
+
+            const float exit = block_exit(p, d, s, lo, hi);
+            const float exit_z = o.z + d.z * exit;
+            const int2 info = levels[level];
+
+            if (min(p.z, exit_z) > pyramid[info.x + br * info.y + bc].y) {
+                next = max(next, (uint) min(floor(exit / step), (float) last + 1.0f));
+                break;
+            }
+        }
+
+        if (inside && num_levels > 0) {
+            level = clamp(level + 1, 1, num_levels);
+        }
+
+        k = next;
+    }
+}
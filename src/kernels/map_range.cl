@@ -4,6 +4,54 @@
 //! @author     Jeffrey Wallace
 //! @copyright  MIT
 
+//! @brief  Walk a ray through the height map until it meets the terrain, skipping the whole
+//!         steps before a start range
+//!
+//! @return the range to the terrain, in meters
+float walk_range(const float3 origin,
+                 const float3 pv,
+                 __global float * height_map,
+                 const float scale,
+                 const float max_range,
+                 const float max_error,
+                 const float2 bounds,
+                 const float start)
+{
+    // Determine parameters of the walk
+    float step = max_error / scale;
+    const int skip = floor(max(start, 0.0f) / max_error);
+    const int iterations = (int) ceil(max_range / max_error) - skip;
+
+    // Perform the walk
+    float3 origin_pix = origin / scale;
+    float3 loc = origin_pix + (skip * step) * pv;
+    int keep_going = 1;
+
+    for (int i = 0; i < iterations; i++) {
+        loc = loc + (step * pv);
+
+        const int r = clamp(loc.x, 0.0f, bounds.x - 1.0f);
+        const int c = clamp(loc.y, 0.0f, bounds.y - 1.0f);
+
+        const float height = height_map[r * (int) bounds.y + c];
+        if (loc.z <= height) {
+          keep_going = 0;
+        }
+
+        // setup the next step
+        // If we have hit the ground, keep_going will be 0, and we won't move forward anymore
+        // Otherwise, it will be 1 and step will remain the same for the next iteration
+        step = step * keep_going;
+    }
+
+    // After all iterations, the range is the length of the vector difference of our current
+    // location and the origin
+    const float range_pixels = length(loc - origin_pix);
+
+    return clamp(scale * range_pixels, 0.0f, max_range);
+}
+
+
 //! @brief  Compute the range at each pixel in the image.
 //!
 //! @param[in]  origin          the location of the camera, in world coordinates
@@ -12,7 +60,7 @@
 //! @param[in]  scale           the scale of the terrain map, in meters-per-pixel
 //! @param[in]  max_range       the maximum range allowed, in meters
 //! @param[in]  max_error       the maximum error of the image, in meters
-//! @param[in]  bounds          the bounds of the heightmap, pixels
+//! @param[in]  bounds          the (rows, cols) of the heightmap, pixels
 //! @param[in]  pitch           the pitch of the image
 //! @param[out] range           the output buffer of range-per-pixel
 __kernel void map_range(const float3 origin,
@@ -29,40 +77,223 @@ __kernel void map_range(const float3 origin,
     // Get location and corresponding input values
     const int2 pos = { get_global_id(0), get_global_id(1) };
     const int offset = pos.x * pitch + pos.y;
-    const int output_offset = (num_rows - pos.x) * pitch + pos.y;
+    const int output_offset = (num_rows - 1 - pos.x) * pitch + pos.y;
+    const float3 pv = world_coords[offset].xyz;
+
+    range[output_offset] = walk_range(origin, 
+                                      pv, 
+                                      height_map, 
+                                      scale, 
+                                      max_range, 
+                                      max_error, 
+                                      bounds,
+                                      0.0f);
+}
+
+
+//! @brief  Compute the range along a list of rays.
+//!
+//! @detail The arguments are those of map_range, except that the rays are given directly,
+//!         one per work item, rather than as an image.
+//!
+//! @param[in]  rays            the pointing vector of each ray, in world coordinates, with
+//!                             the range at which to start walking it, in meters, in w
+//! @param[out] range           the output buffer of range-per-ray
+__kernel void map_range_rays(const float3 origin,
+                             __global float4 * rays,
+                             __global float * height_map,
+                             const float scale,
+                             const float max_range,
+                             const float max_error,
+                             const float2 bounds,
+                             __global float * range)
+{
+    const int i = get_global_id(0);
+
+    const float4 ray = rays[i];
+
+    range[i] = walk_range(origin, ray.xyz, height_map, scale, max_range, max_error, bounds, ray.w);
+}
+
+
+//! @brief  Compute the range at each pixel in the image, walking distant parts of each ray
+//!         through a coarser level of the terrain pyramid.
+//!
+//! @detail The first ten arguments are those of map_range. Level L of the pyramid is used once
+//!         the ray has travelled 2^(L-1) * lod_distance cells, with a step 2^L times as long.
+//!         Heights are the maximum of each pyramid cell.
+//!
+//! @param[in]  pyramid         the (min, max) of every pyramid level, packed from level 1 up
+//! @param[in]  lod_distance    the distance at which level 1 may be used, in cells
+//! @param[in]  num_levels      the number of levels in the pyramid
+__kernel void map_range_lod(const float3 origin,
+                            __global float4 * world_coords,
+                            __global float * height_map,
+                            const float scale,
+                            const float max_range,
+                            const float max_error,
+                            const float2 bounds,
+                            const int pitch,
+                            const int num_rows,
+                            __global float * range,
+                            __global float2 * pyramid,
+                            const float lod_distance,
+                            const int num_levels)
+{
+    // Get location and corresponding input values
+    const int2 pos = { get_global_id(0), get_global_id(1) };
+    const int offset = pos.x * pitch + pos.y;
+    const int output_offset = (num_rows - 1 - pos.x) * pitch + pos.y;
     const float3 pv = world_coords[offset].xyz;
 
     // Determine parameters of the walk
+    const float max_distance = max_range / scale;
     float step = max_error / scale;
-    float original_step = step;
-    const int iterations = ceil(max_range / max_error);
+
+    // The current pyramid level, its size, and the index of its first cell
+    int level = 0;
+    int level_rows = (int) bounds.x;
+    int level_cols = (int) bounds.y;
+    int level_offset = 0;
+    float next_level = lod_distance;
 
     // Perform the walk
     float3 origin_pix = origin / scale;
     float3 loc = origin_pix;
-    int keep_going = 1;
+    float distance = 0.0f;
+
+    while (distance < max_distance) {
+        while (level < num_levels && distance >= next_level) {
+            if (level > 0) {
+                level_offset += level_rows * level_cols;
+            }
+
+            level_rows = (level_rows + 1) >> 1;
+            level_cols = (level_cols + 1) >> 1;
+            level++;
+            step *= 2.0f;
+            next_level *= 2.0f;
+        }
 
-    for (int i = 0; i < iterations; i++) {
         loc = loc + (step * pv);
+        distance += step;
 
-        const int r = clamp(loc.x, 0.0f, bounds.y);
-        const int c = clamp(bounds.x - loc.y, 0.0f, bounds.x);
+        const int r = clamp(loc.x, 0.0f, bounds.x - 1.0f);
+        const int c = clamp(loc.y, 0.0f, bounds.y - 1.0f);
 
-        const float height = height_map[r * pitch + c];
+        const float height = level == 0
+                           ? height_map[r * (int) bounds.y + c]
+                           : pyramid[level_offset + (r >> level) * level_cols + (c >> level)].y;
         if (loc.z <= height) {
-          keep_going = 0;
+            break;
         }
-
-        // setup the next step
-        // If we have hit the ground, keep_going will be 0, and we won't move forward anymore
-        // Otherwise, it will be 1 and step will remain the same for the next iteration
-        step = step * keep_going;
     }
 
-    // After all iterations, the range is the length of the vector difference of our current
-    // location and the origin
     const float range_pixels = length(loc - origin_pix);
 
     range[output_offset] = clamp(scale * range_pixels, 0.0f, max_range);
 }
 
+//! @brief  Compute the range at each pixel in the image, along with the hit position, the
+//!         terrain cell and the terrain normal, in a single walk.
+//!
+//! @detail The first nine arguments are those of map_range. Each pixel is written as the nine
+//!         channels of clarity::Hit_Channel.
+//!
+//! @param[out] hits            the output buffer of channels-per-pixel
+//! @param[in]  cell_offset     the (row, col) of the first cell of height_map in the terrain
+__kernel void map_hits(const float3 origin,
+                       __global float4 * world_coords,
+                       __global float * height_map,
+                       const float scale,
+                       const float max_range,
+                       const float max_error,
+                       const float2 bounds,
+                       const int pitch,
+                       const int num_rows,
+                       __global float * hits,
+                       const float2 cell_offset)
+{
+    // Get location and corresponding input values
+    const int2 pos = { get_global_id(0), get_global_id(1) };
+    const int offset = pos.x * pitch + pos.y;
+    const int output_offset = (num_rows - 1 - pos.x) * pitch + pos.y;
+    const float3 pv = world_coords[offset].xyz;
+
+    // Determine parameters of the walk
+    const float step = max_error / scale;
+    const int iterations = ceil(max_range / max_error);
+    const int rows = (int) bounds.x;
+    const int cols = (int) bounds.y;
+
+    // Perform the walk
+    float3 origin_pix = origin / scale;
+    float3 loc = origin_pix;
+    int r = 0;
+    int c = 0;
+    int ground = 0;
+
+    for (int i = 0; i < iterations; i++) {
+        loc = loc + (step * pv);
+
+        r = clamp(loc.x, 0.0f, bounds.x - 1.0f);
+        c = clamp(loc.y, 0.0f, bounds.y - 1.0f);
+
+        if (loc.z <= height_map[r * cols + c]) {
+            ground = 1;
+            break;
+        }
+    }
+
+    const float range_pixels = length(loc - origin_pix);
+
+    // Take the normal from the height gradient across the cell
+    float3 normal = (float3)(0.0f, 0.0f, 0.0f);
+    if (ground) {
+        const int r0 = max(r - 1, 0);
+        const int r1 = min(r + 1, rows - 1);
+        const int c0 = max(c - 1, 0);
+        const int c1 = min(c + 1, cols - 1);
+
+        const float dr = r1 > r0 ? (height_map[r1 * cols + c] - height_map[r0 * cols + c])
+                                   / (float) (r1 - r0)
+                                 : 0.0f;
+        const float dc = c1 > c0 ? (height_map[r * cols + c1] - height_map[r * cols + c0])
+                                   / (float) (c1 - c0)
+                                 : 0.0f;
+        normal = normalize((float3)(-dr, -dc, 1.0f));
+    }
+
+    const float3 world = (loc + (float3)(cell_offset, 0.0f)) * scale;
+
+    __global float * hit = hits + output_offset * 9;
+    hit[0] = clamp(scale * range_pixels, 0.0f, max_range);
+    hit[1] = world.x;
+    hit[2] = world.y;
+    hit[3] = world.z;
+    hit[4] = r + cell_offset.x;
+    hit[5] = c + cell_offset.y;
+    hit[6] = normal.x;
+    hit[7] = normal.y;
+    hit[8] = normal.z;
+}
+
+
+//! @brief  Pack a range image into 16 bit codes, so only half as many bytes leave the device.
+//!
+//! @detail Each range becomes the nearest code of offset + code * step, clamped to the codes
+//!         that exist. See clarity::Range_Quantization.
+//!
+//! @param[in]  range           the range image, in meters
+//! @param[in]  offset          the range of code 0, in meters
+//! @param[in]  step            the range between consecutive codes, in meters
+//! @param[out] codes           the code of each pixel
+__kernel void pack_range_u16(__global const float * range,
+                             const float offset,
+                             const float step,
+                             __global ushort * codes)
+{
+    const int i = get_global_id(0);
+
+    codes[i] = convert_ushort_sat_rte((range[i] - offset) / step);
+}
@@ -0,0 +1,86 @@
+//! @file       range_display.cl
+//! @brief      Defines OpenCL kernels to reduce a range image and convert it to RGBA
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+//! The number of work items in each group. Must match CL_Range_Display.
+#define GROUP_SIZE 64
+
+
+//! @brief  Reduce (min, max) pairs held in local memory to the first of them
+void reduce_local(__local float2 * scratch, const int lid)
+{
+    for (int half = GROUP_SIZE / 2; half > 0; half /= 2) {
+        barrier(CLK_LOCAL_MEM_FENCE);
+        if (lid < half) {
+            scratch[lid] = (float2)(min(scratch[lid].x, scratch[lid + half].x),
+                                    max(scratch[lid].y, scratch[lid + half].y));
+        }
+    }
+}
+
+
+//! @brief  Find the (min, max) of the part of a range image covered by each work group
+//!
+//! @param[in]  rng         the range image
+//! @param[in]  count       the number of pixels in the range image
+//! @param[out] partials    the (min, max) found by each work group
+__kernel void range_min_max(__global const float * rng,
+                            const int count,
+                            __global float2 * partials)
+{
+    __local float2 scratch[GROUP_SIZE];
+    const int lid = get_local_id(0);
+
+    float2 m = (float2)(rng[0], rng[0]);
+    for (int i = get_global_id(0); i < count; i += get_global_size(0)) {
+        m = (float2)(min(m.x, rng[i]), max(m.y, rng[i]));
+    }
+    scratch[lid] = m;
+
+    reduce_local(scratch, lid);
+    if (lid == 0) {
+        partials[get_group_id(0)] = scratch[0];
+    }
+}
+
+
+//! @brief  Reduce the partial results of range_min_max to the first of them. Run as one group.
+//!
+//! @param[in,out]  partials        the (min, max) of each group of range_min_max
+//! @param[in]      num_partials    the number of partial results
+__kernel void range_min_max_merge(__global float2 * partials, const int num_partials)
+{
+    __local float2 scratch[GROUP_SIZE];
+    const int lid = get_local_id(0);
+
+    float2 m = partials[0];
+    for (int i = lid; i < num_partials; i += GROUP_SIZE) {
+        m = (float2)(min(m.x, partials[i].x), max(m.y, partials[i].y));
+    }
+    scratch[lid] = m;
+
+    reduce_local(scratch, lid);
+    if (lid == 0) {
+        partials[0] = scratch[0];
+    }
+}
+
+
+//! @brief  Convert a range image to grayscale RGBA. See Range_Display.
+//!
+//! @param[in]  rng         the range image
+//! @param[in]  range       the (min, max) of the range image, from range_min_max_merge
+//! @param[out] rgba        one pixel per range, with red in the lowest byte
+__kernel void range_to_rgba(__global const float * rng,
+                            __global const float2 * range,
+                            __global uchar4 * rgba)
+{
+    const int i = get_global_id(0);
+    const float2 m = range[0];
+    const float scale = m.y > m.x ? 255.0f / (m.y - m.x) : 0.0f;
+
+    const uchar gray = (uchar) ((int) ((rng[i] - m.x) * scale));
+    rgba[i] = (uchar4)(gray, gray, gray, 255);
+}
@@ -0,0 +1,57 @@
+//! @file       terrain_pyramid.cl
+//! @brief      Defines an OpenCL kernel to fit the levels of a terrain pyramid
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+
+//! @brief  Fit the (min, max) of cells of one pyramid level from the 2x2 blocks below them
+//!
+//! @detail Run over the (row, col) of the cells to fit, using the global offset to place a
+//!         rectangle. Cells of the last row or column of a level with an odd number of rows or
+//!         columns below them cover a partial block.
+//!
+//! @param[in]  below           the level below: the height map for level 1, otherwise the
+//!                             packed pyramid. May be the same buffer as pyramid.
+//! @param[in]  below_offset    the index of the first value of the level below in below
+//! @param[in]  below_depth     1 if below is the height map, 2 if it holds (min, max) pairs
+//! @param[in]  below_rows      the number of rows of the level below
+//! @param[in]  below_cols      the number of columns of the level below
+//! @param[out] pyramid         the packed pyramid
+//! @param[in]  offset          the index of the first cell of the level in pyramid
+//! @param[in]  cols            the number of columns of the level
+__kernel void pyramid_fit(__global const float * below,
+                          const uint below_offset,
+                          const uint below_depth,
+                          const uint below_rows,
+                          const uint below_cols,
+                          __global float2 * pyramid,
+                          const uint offset,
+                          const uint cols)
+{
+    const uint r = get_global_id(0);
+    const uint c = get_global_id(1);
+
+    const uint r0 = 2 * r;
+    const uint r1 = min(r0 + 1, below_rows - 1);
+    const uint c0 = 2 * c;
+    const uint c1 = min(c0 + 1, below_cols - 1);
+    const uint cells[4] = { r0 * below_cols + c0,
+                            r0 * below_cols + c1,
+                            r1 * below_cols + c0,
+                            r1 * below_cols + c1 };
+
+    // The min is the first value of a cell and the max the last, which is the same height for
+    // the height map
+    float lo = 0.0f;
+    float hi = 0.0f;
+    for (int i = 0; i < 4; i++) {
+        const uint v = below_offset + below_depth * cells[i];
+        const float cell_lo = below[v];
+        const float cell_hi = below[v + below_depth - 1];
+        lo = i == 0 ? cell_lo : min(lo, cell_lo);
+        hi = i == 0 ? cell_hi : max(hi, cell_hi);
+    }
+
+    pyramid[offset + r * cols + c] = (float2)(lo, hi);
+}
@@ -0,0 +1,102 @@
+//! @file       viewshed.cl
+//! @brief      Defines an OpenCL kernel to find the terrain cells visible from an observer
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+//! The (row, col) steps along the axis and the diagonal of each octant. See CPU_Viewshed.
+__constant int4 OCTANTS[8] = {
+    (int4)( 1,  0,  1,  1),
+    (int4)( 0,  1,  1,  1),
+    (int4)( 0,  1, -1,  1),
+    (int4)(-1,  0, -1,  1),
+    (int4)(-1,  0, -1, -1),
+    (int4)( 0, -1, -1, -1),
+    (int4)( 0, -1,  1, -1),
+    (int4)( 1,  0,  1, -1)
+};
+
+
+//! @brief  Get the number of cells from a cell to the edge of a dimension, in one direction
+int extent(const int step, const int pos, const int dim)
+{
+    return step > 0 ? dim - 1 - pos : (step < 0 ? pos : 0);
+}
+
+
+//! @brief  Sweep the rings of each octant around an observer. Each work group sweeps one
+//!         octant, with its work items sharing the cells of each ring.
+//!
+//! @param[in]  height_map  the terrain height map
+//! @param[in]  rows        the number of rows in the height map
+//! @param[in]  cols        the number of cols in the height map
+//! @param[in]  cell        the (row, col) of the observer
+//! @param[in]  z           the height of the observer, in cells
+//! @param[in]  horizon     scratch space for two rings of each octant, each max(rows, cols) + 1
+//! @param[out] visible     1 for each visible cell and 0 for each hidden one
+__kernel void viewshed(__global float * height_map,
+                       const int rows,
+                       const int cols,
+                       const int2 cell,
+                       const float z,
+                       __global float * horizon,
+                       __global float * visible)
+{
+    const int octant = get_group_id(0);
+    const int lid = get_local_id(0);
+    const int group_size = get_local_size(0);
+
+    const int4 steps = OCTANTS[octant];
+    const int2 axis = steps.xy;
+    const int2 minor = steps.zw - steps.xy;
+    const int owns_edges = octant % 2 == 0;
+
+    const int rings = max(extent(axis.x, cell.x, rows), extent(axis.y, cell.y, cols));
+    const int width = max(extent(minor.x, cell.x, rows), extent(minor.y, cell.y, cols));
+
+    const int stride = max(rows, cols) + 1;
+    __global float * inner = horizon + octant * 2 * stride;
+    __global float * outer = inner + stride;
+
+    if (octant == 0 && lid == 0) {
+        visible[cell.x * cols + cell.y] = 1.0f;
+    }
+
+    for (int i = 1; i <= rings; i++) {
+        const int last = min(i, width);
+
+        for (int j = lid; j <= last; j += group_size) {
+            const int r = cell.x + i * axis.x + j * minor.x;
+            const int c = cell.y + i * axis.y + j * minor.y;
+            const float h = height_map[r * cols + c];
+
+            float ring_horizon = h;
+            int seen = 1;
+
+            if (i > 1) {
+                const float pos = (float) (j * (i - 1)) / i;
+                const int j0 = (int) pos;
+                const float w = pos - j0;
+                const int j1 = w > 0.0f ? j0 + 1 : j0;
+
+                const float crossing = inner[j0] * (1.0f - w) + inner[j1] * w;
+                const float required = z + (crossing - z) * i / (i - 1);
+
+                seen = h >= required;
+                ring_horizon = max(h, required);
+            }
+
+            outer[j] = ring_horizon;
+            if (owns_edges || (j > 0 && j < i)) {
+                visible[r * cols + c] = seen ? 1.0f : 0.0f;
+            }
+        }
+
+        // Every item sees the whole ring before moving on to the next
+        barrier(CLK_GLOBAL_MEM_FENCE);
+
+        __global float * swap = inner;
+        inner = outer;
+        outer = swap;
+    }
+}
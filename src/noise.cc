@@ -0,0 +1,302 @@
+//! @file       noise.cc
+//! @brief      Defines gradient noise functions for procedural terrain
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "buffer.h"
+#include "counter_rng.h"
+#include "noise.h"
+#include "simd.h"
+
+// Standard Imports
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+#include <vector>
+#include <stdexcept>
+
+// Third-Party Imports
+
+namespace clarity
+{
+namespace noise
+{
+
+//! @brief  Get log2 of the feature size
+static uint32_t _log2(uint32_t x)
+{
+    uint32_t k = 0;
+    while (x > 1) {
+        x >>= 1;
+        k++;
+    }
+    return k;
+}
+
+
+//! @brief  The quintic fade curve 6t^5 - 15t^4 + 10t^3
+static inline float _fade(const float t)
+{
+    return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+
+//! @brief  Dot a diagonal gradient chosen by the low bits of h with the offset (x, y)
+static inline float _grad(const uint32_t h, const float x, const float y)
+{
+    return ((h & 1) ? -x : x) + ((h & 2) ? -y : y);
+}
+
+
+//! @brief  Gradient noise for one octave. The period is 2^k cells.
+static float _octave(const uint32_t key, const uint32_t k, const int64_t row, const int64_t col)
+{
+    const int64_t mask = (static_cast<int64_t>(1) << k) - 1;
+    const float inv_period = 1.0f / static_cast<float>(static_cast<int64_t>(1) << k);
+
+    // Arithmetic shifts floor negative coordinates, so the lattice is continuous through 0
+    const uint32_t r0 = static_cast<uint32_t>(row >> k);
+    const uint32_t c0 = static_cast<uint32_t>(col >> k);
+    const float x = static_cast<float>(row & mask) * inv_period;
+    const float y = static_cast<float>(col & mask) * inv_period;
+
+    const float n00 = _grad(counter_rng::mix32(counter_rng::mix32(key ^ r0) + c0), x, y);
+    const float n10 = _grad(counter_rng::mix32(counter_rng::mix32(key ^ (r0 + 1)) + c0),
+                            x - 1.0f, y);
+    const float n01 = _grad(counter_rng::mix32(counter_rng::mix32(key ^ r0) + (c0 + 1)),
+                            x, y - 1.0f);
+    const float n11 = _grad(counter_rng::mix32(counter_rng::mix32(key ^ (r0 + 1)) + (c0 + 1)),
+                            x - 1.0f, y - 1.0f);
+
+    const float u = _fade(x);
+    const float v = _fade(y);
+    const float a = n00 + u * (n10 - n00);
+    const float b = n01 + u * (n11 - n01);
+    return a + v * (b - a);
+}
+
+
+//! @brief  The per-octave key. Matches counter_rng::hash32 with the row and col folded out.
+static uint32_t _octave_key(const uint64_t seed, const uint32_t octave)
+{
+    return counter_rng::mix32(static_cast<uint32_t>(seed ^ (seed >> 32)) ^ (octave * 0x9e3779b9u));
+}
+
+
+void validate(const Noise_Params & params)
+{
+    const uint32_t f = params.feature_size;
+    if (f < 2 || (f & (f - 1)) != 0) {
+        std::stringstream msg;
+        msg << "Noise feature size must be a power of two of at least 2 (got " << f << ")";
+        throw std::invalid_argument(msg.str());
+    }
+}
+
+
+float height(const Noise_Params & params, const int64_t row, const int64_t col)
+{
+    const uint32_t k0 = _log2(params.feature_size);
+
+    float sum = 0.0f;
+    float amplitude = params.amplitude;
+    for (uint32_t o = 0; o < params.octaves && o < k0; o++) {
+        sum += amplitude * _octave(_octave_key(params.seed, o), k0 - o, row, col);
+        amplitude *= params.persistence;
+    }
+
+    return sum;
+}
+
+
+//! @brief  The per-octave values that are constant along a row
+struct _Row_Octave
+{
+    uint32_t key;
+    uint32_t k;
+    float amplitude;
+    float inv_period;
+    uint32_t h0;
+    uint32_t h1;
+    float x;
+    float u;
+};
+
+
+//! @brief  Vector mix32
+static inline simd::u32x4 _mix32(simd::u32x4 x)
+{
+    x = (x ^ (x >> 16)) * simd::splat(0x7feb352du);
+    x = (x ^ (x >> 15)) * simd::splat(0x846ca68bu);
+    return x ^ (x >> 16);
+}
+
+
+//! @brief  Vector _grad. Negation is exact, so selecting between x and -x matches the scalar.
+static inline simd::f32x4 _grad(const simd::u32x4 & h, const simd::f32x4 & x, const simd::f32x4 & y)
+{
+    const simd::i32x4 flip_x = (simd::i32x4) ((h & simd::splat(1u)) != simd::splat(0u));
+    const simd::i32x4 flip_y = (simd::i32x4) ((h & simd::splat(2u)) != simd::splat(0u));
+    return simd::select(flip_x, -x, x) + simd::select(flip_y, -y, y);
+}
+
+
+//! @brief  Vector _fade
+static inline simd::f32x4 _fade(const simd::f32x4 & t)
+{
+    return t * t * t * (t * (t * simd::splat(6.0f) - simd::splat(15.0f)) + simd::splat(10.0f));
+}
+
+
+void fill_row(const Noise_Params & params,
+              const int64_t row,
+              const int64_t col0,
+              const uint32_t count,
+              float * const out)
+{
+    // Everything that depends only on the row is hoisted out of the column loop
+    const uint32_t k0 = _log2(params.feature_size);
+    std::vector<_Row_Octave> octaves;
+    float amplitude = params.amplitude;
+    for (uint32_t o = 0; o < params.octaves && o < k0; o++) {
+        _Row_Octave oct;
+        oct.key = _octave_key(params.seed, o);
+        oct.k = k0 - o;
+        oct.amplitude = amplitude;
+        oct.inv_period = 1.0f / static_cast<float>(static_cast<int64_t>(1) << oct.k);
+
+        const int64_t mask = (static_cast<int64_t>(1) << oct.k) - 1;
+        const uint32_t r0 = static_cast<uint32_t>(row >> oct.k);
+        oct.h0 = counter_rng::mix32(oct.key ^ r0);
+        oct.h1 = counter_rng::mix32(oct.key ^ (r0 + 1));
+        oct.x = static_cast<float>(row & mask) * oct.inv_period;
+        oct.u = _fade(oct.x);
+
+        octaves.push_back(oct);
+        amplitude *= params.persistence;
+    }
+
+    const simd::u32x4 lanes = { 0, 1, 2, 3 };
+    std::fill(out, out + count, 0.0f);
+
+    // Accumulate one octave at a time, in the same order as height()
+    for (const _Row_Octave & oct : octaves) {
+        const uint32_t period = 1u << oct.k;
+        const uint32_t mask = period - 1;
+        const simd::f32x4 amp = simd::splat(oct.amplitude);
+        const simd::f32x4 inv_period = simd::splat(oct.inv_period);
+        const simd::f32x4 u = simd::splat(oct.u);
+        const simd::f32x4 x = simd::splat(oct.x);
+        const simd::f32x4 x1 = simd::splat(oct.x - 1.0f);
+        uint32_t c = 0;
+
+        if (period >= 2 * simd::WIDTH) {
+            // Lattice cells span several vectors, so hash each corner once per cell
+            while (c < count) {
+                const int64_t col = col0 + c;
+                const uint32_t start = c;
+                const uint32_t f0 = static_cast<uint32_t>(col & mask);
+                const uint32_t end = static_cast<uint32_t>(
+                    std::min<uint64_t>(count, static_cast<uint64_t>(start) + period - f0));
+
+                const uint32_t c0 = static_cast<uint32_t>(col >> oct.k);
+                const uint32_t h00 = counter_rng::mix32(oct.h0 + c0);
+                const uint32_t h10 = counter_rng::mix32(oct.h1 + c0);
+                const uint32_t h01 = counter_rng::mix32(oct.h0 + (c0 + 1));
+                const uint32_t h11 = counter_rng::mix32(oct.h1 + (c0 + 1));
+
+                // The x half of each gradient is constant across the lattice cell
+                const float gx00 = (h00 & 1) ? -oct.x : oct.x;
+                const float gx10 = (h10 & 1) ? -(oct.x - 1.0f) : (oct.x - 1.0f);
+                const float gx01 = (h01 & 1) ? -oct.x : oct.x;
+                const float gx11 = (h11 & 1) ? -(oct.x - 1.0f) : (oct.x - 1.0f);
+
+                const simd::i32x4 m00 = simd::splat((h00 & 2) ? -1 : 0);
+                const simd::i32x4 m10 = simd::splat((h10 & 2) ? -1 : 0);
+                const simd::i32x4 m01 = simd::splat((h01 & 2) ? -1 : 0);
+                const simd::i32x4 m11 = simd::splat((h11 & 2) ? -1 : 0);
+
+                for (; c + simd::WIDTH <= end; c += simd::WIDTH) {
+                    const simd::u32x4 f = simd::splat(f0 + (c - start)) + lanes;
+                    const simd::f32x4 y = simd::to_float((simd::i32x4) f) * inv_period;
+                    const simd::f32x4 y1 = y - simd::splat(1.0f);
+
+                    const simd::f32x4 n00 = simd::splat(gx00) + simd::select(m00, -y, y);
+                    const simd::f32x4 n10 = simd::splat(gx10) + simd::select(m10, -y, y);
+                    const simd::f32x4 n01 = simd::splat(gx01) + simd::select(m01, -y1, y1);
+                    const simd::f32x4 n11 = simd::splat(gx11) + simd::select(m11, -y1, y1);
+
+                    const simd::f32x4 v = _fade(y);
+                    const simd::f32x4 a = n00 + u * (n10 - n00);
+                    const simd::f32x4 b = n01 + u * (n11 - n01);
+                    simd::store(out + c, simd::load(out + c) + amp * (a + v * (b - a)));
+                }
+
+                for (; c < end; c++) {
+                    const float y = static_cast<float>(f0 + (c - start)) * oct.inv_period;
+                    const float y1 = y - 1.0f;
+
+                    const float n00 = gx00 + ((h00 & 2) ? -y : y);
+                    const float n10 = gx10 + ((h10 & 2) ? -y : y);
+                    const float n01 = gx01 + ((h01 & 2) ? -y1 : y1);
+                    const float n11 = gx11 + ((h11 & 2) ? -y1 : y1);
+
+                    const float v = _fade(y);
+                    const float a = n00 + oct.u * (n10 - n00);
+                    const float b = n01 + oct.u * (n11 - n01);
+                    out[c] += oct.amplitude * (a + v * (b - a));
+                }
+            }
+
+            continue;
+        }
+
+        // Short periods put several lattice cells in each vector, so hash per lane
+        for (; c + simd::WIDTH <= count; c += simd::WIDTH) {
+            const int64_t col = col0 + c;
+
+            // Split the first col into a lattice cell and an offset, then step the lanes
+            const simd::u32x4 offset = simd::splat(static_cast<uint32_t>(col & mask)) + lanes;
+            const simd::u32x4 c0 = simd::splat(static_cast<uint32_t>(col >> oct.k))
+                                 + (offset >> oct.k);
+            const simd::u32x4 c1 = c0 + simd::splat(1u);
+
+            const simd::f32x4 y = simd::to_float((simd::i32x4) (offset & simd::splat(mask)))
+                                * inv_period;
+            const simd::f32x4 y1 = y - simd::splat(1.0f);
+
+            const simd::f32x4 n00 = _grad(_mix32(simd::splat(oct.h0) + c0), x, y);
+            const simd::f32x4 n10 = _grad(_mix32(simd::splat(oct.h1) + c0), x1, y);
+            const simd::f32x4 n01 = _grad(_mix32(simd::splat(oct.h0) + c1), x, y1);
+            const simd::f32x4 n11 = _grad(_mix32(simd::splat(oct.h1) + c1), x1, y1);
+
+            const simd::f32x4 v = _fade(y);
+            const simd::f32x4 a = n00 + u * (n10 - n00);
+            const simd::f32x4 b = n01 + u * (n11 - n01);
+            simd::store(out + c, simd::load(out + c) + amp * (a + v * (b - a)));
+        }
+
+        for (; c < count; c++) {
+            out[c] += oct.amplitude * _octave(oct.key, oct.k, row, col0 + c);
+        }
+    }
+}
+
+
+void fill(const Noise_Params & params, const int64_t row0, const int64_t col0, Buffer & out)
+{
+    validate(params);
+
+    const uint32_t rows = std::get<0>(out.size());
+    const uint32_t cols = std::get<1>(out.size());
+    float * const data = out.data().get();
+
+    for (uint32_t r = 0; r < rows; r++) {
+        fill_row(params, row0 + r, col0, cols, data + static_cast<size_t>(r) * cols);
+    }
+}
+
+}
+}
@@ -0,0 +1,98 @@
+//! @file       noise_terrain_generator.cc
+//! @brief      Defines an implementation of Terrain_Generator that samples fractal gradient
+//!             noise
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "buffer.h"
+#include "noise.h"
+#include "noise_terrain_generator.h"
+#include "terrain.h"
+#include "terrain_generator.h"
+#include "thread_pool.h"
+
+// Standard Imports
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Third-Party Imports
+
+namespace clarity 
+{
+
+Noise_Terrain_Generator::Noise_Terrain_Generator(const Noise_Params & params,
+                                                 const unsigned num_threads)
+    : Terrain_Generator()
+    , m_params(params)
+    , m_pool(num_threads)
+{
+    noise::validate(m_params);
+}
+
+
+Noise_Terrain_Generator::~Noise_Terrain_Generator()
+{
+    // No-op
+}
+
+
+const Noise_Params & Noise_Terrain_Generator::params() const
+{
+    return m_params;
+}
+
+
+void Noise_Terrain_Generator::fill(const Noise_Params & params,
+                                   const int64_t row0,
+                                   const int64_t col0,
+                                   Buffer & out)
+{
+    const uint32_t rows = std::get<0>(out.size());
+    const uint32_t cols = std::get<1>(out.size());
+    float * const data = out.data().get();
+
+    // Aim for ~16K cells per chunk so short rows are still worth a wake-up
+    const uint32_t grain = std::max<uint32_t>(1, (1 << 14) / std::max<uint32_t>(cols, 1));
+
+    m_pool.parallel_for(0, rows, [&](const uint32_t begin, const uint32_t end) {
+        for (uint32_t r = begin; r < end; r++) {
+            noise::fill_row(params, row0 + r, col0, cols, data + static_cast<size_t>(r) * cols);
+        }
+    }, grain);
+}
+
+
+void Noise_Terrain_Generator::generate_tile(const int64_t row0, const int64_t col0, Buffer & out)
+{
+    fill(m_params, row0, col0, out);
+}
+
+
+Terrain Noise_Terrain_Generator::generate_terrain(std::shared_ptr<Buffer> buffer,
+                                                  const float scale, 
+                                                  const float roughness)
+{
+    Noise_Params params = m_params;
+    params.persistence = std::min(std::max(roughness, 0.0f), 1.0f);
+
+    Terrain terrain(buffer, scale);
+    fill(params, 0, 0, terrain.data());
+
+    return terrain;
+}
+
+
+Terrain Noise_Terrain_Generator::generate_terrain(const uint32_t rows, 
+                                                  const uint32_t cols, 
+                                                  const float scale, 
+                                                  const float roughness)
+{
+    std::shared_ptr<Buffer> buffer(new Buffer(rows, cols));
+    return generate_terrain(buffer, scale, roughness);
+}
+
+}
@@ -0,0 +1,180 @@
+//! @file       numa.cc
+//! @brief      Defines utilities for placing memory and threads on the NUMA nodes of a machine
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "numa.h"
+
+// Standard Imports
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Third-Party Imports
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace clarity
+{
+namespace numa
+{
+
+//! @brief  The highest node id looked for in sysfs
+static constexpr unsigned _MAX_NODES = 64;
+
+
+//! @brief  Parse a sysfs CPU list such as "0-3,8-11"
+static std::vector<unsigned> _parse_cpu_list(const std::string & list)
+{
+    std::vector<unsigned> cpus;
+    std::stringstream in(list);
+    std::string range;
+
+    while (std::getline(in, range, ',')) {
+        const size_t dash = range.find('-');
+        try {
+            const unsigned first = std::stoul(range.substr(0, dash));
+            const unsigned last = dash == std::string::npos ? first
+                                                            : std::stoul(range.substr(dash + 1));
+            for (unsigned c = first; c <= last; c++) {
+                cpus.push_back(c);
+            }
+        } catch (const std::exception &) {
+            // Skip anything that is not a CPU range, such as the trailing newline
+        }
+    }
+
+    return cpus;
+}
+
+
+std::vector<Node> topology()
+{
+    std::vector<Node> nodes;
+
+#ifdef __linux__
+    for (unsigned id = 0; id < _MAX_NODES; id++) {
+        std::ifstream in("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+        if (! in.good()) {
+            continue;
+        }
+
+        std::string list;
+        std::getline(in, list);
+        const std::vector<unsigned> cpus = _parse_cpu_list(list);
+        if (! cpus.empty()) {
+            nodes.push_back(Node { id, cpus });
+        }
+    }
+#endif
+
+    if (nodes.empty()) {
+        Node all { 0, {} };
+        const unsigned count = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned c = 0; c < count; c++) {
+            all.cpus.push_back(c);
+        }
+        nodes.push_back(all);
+    }
+
+    return nodes;
+}
+
+
+//! @brief  Map untouched memory and apply a placement policy to it
+//!
+//! @param[in]  count   the number of floats
+//! @param[in]  mode    the memory policy, as for mbind(2)
+//! @param[in]  nodes   the nodes the policy refers to
+static std::shared_ptr<float> _allocate(const size_t count,
+                                        const int mode,
+                                        const std::vector<Node> & nodes)
+{
+    const size_t bytes = std::max<size_t>(1, count) * sizeof(float);
+
+#ifdef __linux__
+    void * p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+
+    unsigned max_id = 0;
+    for (const auto & n : nodes) {
+        max_id = std::max(max_id, n.id);
+    }
+
+    const size_t bits = 8 * sizeof(unsigned long);
+    std::vector<unsigned long> mask(max_id / bits + 1, 0);
+    for (const auto & n : nodes) {
+        mask[n.id / bits] |= 1ul << (n.id % bits);
+    }
+
+    // A failure leaves the default policy in place, which is still correct
+    syscall(SYS_mbind, p, bytes, mode, mask.data(), mask.size() * bits + 1, 0);
+
+    return std::shared_ptr<float>(static_cast<float *>(p), [bytes](float * q) {
+        munmap(q, bytes);
+    });
+#else
+    (void) mode;
+    (void) nodes;
+    return std::shared_ptr<float>(new float[bytes / sizeof(float)], std::default_delete<float[]>());
+#endif
+}
+
+
+std::shared_ptr<float> allocate_interleaved(const size_t count, const std::vector<Node> & nodes)
+{
+#ifdef __linux__
+    return _allocate(count, MPOL_INTERLEAVE, nodes);
+#else
+    return _allocate(count, 0, nodes);
+#endif
+}
+
+
+std::shared_ptr<float> allocate_on_node(const size_t count, const Node & node)
+{
+#ifdef __linux__
+    return _allocate(count, MPOL_PREFERRED, { node });
+#else
+    return _allocate(count, 0, { node });
+#endif
+}
+
+
+bool pin_thread(const std::vector<unsigned> & cpus)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const unsigned c : cpus) {
+        if (c < CPU_SETSIZE) {
+            CPU_SET(c, &set);
+        }
+    }
+
+    return CPU_COUNT(&set) > 0 && pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void) cpus;
+    return false;
+#endif
+}
+
+}
+}
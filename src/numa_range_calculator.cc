@@ -0,0 +1,278 @@
+//! @file       numa_range_calculator.cc
+//! @brief      Defines an implementation of Range_Calculator that renders on the CPU with
+//!             NUMA-aware terrain placement and pinned threads
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "buffer.h"
+#include "camera.h"
+#include "cpu_range_calculator.h"
+#include "numa.h"
+#include "numa_range_calculator.h"
+#include "range_calculator.h"
+#include "terrain.h"
+#include "thread_pool.h"
+
+// Standard Imports
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+// Third-Party Imports
+
+
+namespace clarity
+{
+
+//! @brief  The number of rows in each band of a node's tile
+static constexpr uint32_t _BAND_ROWS = 4;
+
+//! @brief  The number of terrain rows each thread copies at a time when placing a terrain
+static constexpr uint32_t _COPY_ROWS = 64;
+
+
+NUMA_Range_Calculator::NUMA_Range_Calculator(const numa::Placement placement)
+    : m_placement(placement)
+    , m_nodes(numa::topology())
+    , m_pools()
+    , m_cpu()
+    , m_source()
+    , m_placed()
+{
+    for (const auto & node : m_nodes) {
+        m_pools.emplace_back(new Thread_Pool(node.cpus));
+    }
+}
+
+
+NUMA_Range_Calculator::~NUMA_Range_Calculator()
+{
+    // No-op
+}
+
+
+void NUMA_Range_Calculator::run_on_nodes(const std::function<void(const size_t node)> & fn)
+{
+    std::vector<std::exception_ptr> errors(m_nodes.size());
+    std::vector<std::thread> threads;
+
+    for (size_t n = 0; n < m_nodes.size(); n++) {
+        threads.emplace_back([this, &fn, &errors, n]() {
+            // This thread stands in for the first CPU of its node's pool
+            numa::pin_thread(m_nodes[n].cpus);
+            try {
+                fn(n);
+            } catch (...) {
+                errors[n] = std::current_exception();
+            }
+        });
+    }
+
+    for (auto & t : threads) {
+        t.join();
+    }
+
+    for (auto & e : errors) {
+        if (e) {
+            std::rethrow_exception(e);
+        }
+    }
+}
+
+
+void NUMA_Range_Calculator::place(const Terrain & t)
+{
+    const Buffer & src = t.data();
+    const uint32_t rows = src.size().first;
+    const uint32_t cols = src.size().second;
+
+    const bool placed = m_source != nullptr
+                     && &m_source->data().at(0, 0) == &src.at(0, 0)
+                     && m_source->data().size() == src.size()
+                     && m_source->scale() == t.scale();
+    if (placed || rows == 0 || cols == 0) {
+        return;
+    }
+
+    // Allocate untouched memory with the right policy; the copy below is the first touch
+    const size_t count = static_cast<size_t>(rows) * cols;
+    std::vector<std::shared_ptr<float>> copies;
+    if (m_placement == numa::REPLICATE) {
+        for (const auto & node : m_nodes) {
+            copies.push_back(numa::allocate_on_node(count, node));
+        }
+    } else {
+        copies.push_back(numa::allocate_interleaved(count, m_nodes));
+    }
+
+    const float * from = &src.at(0, 0);
+    run_on_nodes([&](const size_t node) {
+        // A replica is written entirely by its own node. An interleaved copy is written by
+        // every node in turn, each taking a slice, which is only for speed.
+        const bool replica = m_placement == numa::REPLICATE;
+        float * to = copies[replica ? node : 0].get();
+        const uint32_t first = replica ? 0 : rows * node / m_nodes.size();
+        const uint32_t last = replica ? rows : rows * (node + 1) / m_nodes.size();
+
+        m_pools[node]->parallel_for(first, last, [&](const uint32_t begin, const uint32_t end) {
+            const size_t offset = static_cast<size_t>(begin) * cols;
+            std::copy(from + offset, from + static_cast<size_t>(end) * cols, to + offset);
+        }, _COPY_ROWS);
+    });
+
+    m_placed.clear();
+    for (const auto & copy : copies) {
+        m_placed.emplace_back(std::make_shared<Buffer>(copy, rows, cols), t.scale());
+    }
+    m_source = std::unique_ptr<Terrain>(new Terrain(t));
+}
+
+
+const Terrain & NUMA_Range_Calculator::terrain_for(const Terrain & t, const size_t node) const
+{
+    if (m_placed.empty()) {
+        return t;
+    }
+
+    return m_placed[m_placement == numa::REPLICATE ? node : 0];
+}
+
+
+void NUMA_Range_Calculator::invalidate()
+{
+    m_source.reset();
+    m_placed.clear();
+}
+
+
+const std::vector<numa::Node> & NUMA_Range_Calculator::nodes() const
+{
+    return m_nodes;
+}
+
+
+void NUMA_Range_Calculator::Calculate(const Camera & cam, const Terrain & t, Buffer & rng)
+{
+    const auto sz = cam.focal_plane_dimensions();
+    const uint32_t rows = std::get<0>(sz);
+    const uint32_t cols = std::get<1>(sz);
+
+    if (rng.size().first != rows || rng.size().second != cols || rng.depth() != 1) {
+        std::stringstream msg;
+        msg << "Invalid Argument. Expected a range buffer of size (" << rows << ", " << cols
+            << ") but got a buffer of size (" << rng.size().first << ", "
+            << rng.size().second << ")";
+        throw std::invalid_argument(msg.str());
+    }
+
+    Calculate_Region(cam, t, 0, 0, rng);
+}
+
+
+void NUMA_Range_Calculator::Calculate_Region(const Camera & cam, 
+                                             const Terrain & t, 
+                                             const uint32_t row0, 
+                                             const uint32_t col0, 
+                                             Buffer & rng)
+{
+    const uint32_t rows = rng.size().first;
+    const uint32_t cols = rng.size().second;
+    if (rows == 0 || cols == 0) {
+        return;
+    }
+
+    if (t.procedural() == nullptr) {
+        place(t);
+    }
+
+    // Each node owns a contiguous tile of rows, in proportion to its CPUs
+    size_t total_cpus = 0;
+    for (const auto & node : m_nodes) {
+        total_cpus += node.cpus.size();
+    }
+
+    std::vector<uint32_t> tile_start(1, 0);
+    size_t cpus_so_far = 0;
+    for (const auto & node : m_nodes) {
+        cpus_so_far += node.cpus.size();
+        tile_start.push_back(static_cast<uint32_t>(rows * cpus_so_far / total_cpus));
+    }
+
+    run_on_nodes([&](const size_t node) {
+        const Terrain & local = terrain_for(t, node);
+        const uint32_t first = tile_start[node];
+        const uint32_t num_bands = (tile_start[node + 1] - first + _BAND_ROWS - 1) / _BAND_ROWS;
+
+        m_pools[node]->parallel_for(0, num_bands, [&](const uint32_t begin, const uint32_t end) {
+            for (uint32_t b = begin; b < end; b++) {
+                const uint32_t r = first + b * _BAND_ROWS;
+                const uint32_t n = std::min(_BAND_ROWS, tile_start[node + 1] - r);
+
+                // A view of the band's rows of the output
+                const size_t offset = static_cast<size_t>(r) * cols;
+                Buffer band(std::shared_ptr<float>(rng.data(), rng.data().get() + offset), n, cols);
+                m_cpu.Calculate_Region(cam, local, row0 + r, col0, band);
+            }
+        });
+    });
+}
+
+
+void NUMA_Range_Calculator::Convert_Pixel_To_Camera_Coordinates(const Camera & cam, 
+                                                                Buffer & cam_coords)
+{
+    m_cpu.Convert_Pixel_To_Camera_Coordinates(cam, cam_coords);
+}
+
+
+void NUMA_Range_Calculator::Convert_Camera_To_World_Coordinates(const Camera & cam, 
+                                                                const Buffer & cam_coords, 
+                                                                Buffer & world_coords)
+{
+    m_cpu.Convert_Camera_To_World_Coordinates(cam, cam_coords, world_coords);
+}
+
+
+void NUMA_Range_Calculator::Compute_Range(const Camera & cam, 
+                                          const Terrain & t, 
+                                          const Buffer & world_coords, 
+                                          Buffer & rng)
+{
+    m_cpu.Compute_Range(cam, t, world_coords, rng);
+}
+
+
+void NUMA_Range_Calculator::Calculate_Hits(const Camera & cam, const Terrain & t, Buffer & hits)
+{
+    m_cpu.Calculate_Hits(cam, t, hits);
+}
+
+
+void NUMA_Range_Calculator::Calculate_Pixels(const Camera & cam, 
+                                             const Terrain & t, 
+                                             const std::vector<Pixel> & pixels, 
+                                             std::vector<float> & ranges)
+{
+    m_cpu.Calculate_Pixels(cam, t, pixels, ranges);
+}
+
+
+void NUMA_Range_Calculator::Calculate_Pixels(const Camera & cam, 
+                                             const Terrain & t, 
+                                             const std::vector<Pixel> & pixels, 
+                                             const std::vector<float> & start,
+                                             std::vector<float> & ranges)
+{
+    m_cpu.Calculate_Pixels(cam, t, pixels, start, ranges);
+}
+
+}
@@ -0,0 +1,186 @@
+//! @file       procedural_terrain.cc
+//! @brief      Defines the Procedural_Terrain type, an unbounded terrain whose tiles are
+//!             generated on demand
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "buffer.h"
+#include "noise.h"
+#include "procedural_terrain.h"
+
+// Standard Imports
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+// Third-Party Imports
+
+namespace clarity
+{
+
+//! @brief  Integer division rounding toward negative infinity
+static int64_t _floor_div(const int64_t a, const int64_t b)
+{
+    const int64_t q = a / b;
+    return (a % b != 0 && a < 0) ? q - 1 : q;
+}
+
+
+Procedural_Terrain::Cursor::Cursor(Procedural_Terrain & source)
+    : m_source(source)
+    , m_tile(1, 1)
+    , m_tile_row(0)
+    , m_tile_col(0)
+    , m_valid(false)
+{
+    // No-op
+}
+
+
+float Procedural_Terrain::Cursor::height(const int64_t row, const int64_t col)
+{
+    const int64_t size = m_source.m_params.tile_size;
+    const int64_t tile_row = _floor_div(row, size);
+    const int64_t tile_col = _floor_div(col, size);
+
+    if (! m_valid || tile_row != m_tile_row || tile_col != m_tile_col) {
+        m_tile = m_source.tile(tile_row, tile_col);
+        m_tile_row = tile_row;
+        m_tile_col = tile_col;
+        m_valid = true;
+    }
+
+    const int64_t r = row - tile_row * size;
+    const int64_t c = col - tile_col * size;
+    return m_tile.data().get()[r * size + c];
+}
+
+
+Procedural_Terrain::Procedural_Terrain(const Procedural_Terrain_Params & params)
+    : m_params(params)
+    , m_mutex()
+    , m_cache()
+    , m_lru()
+    , m_generated(0)
+{
+    noise::validate(m_params.noise);
+
+    if (m_params.tile_size == 0 || m_params.max_tiles == 0) {
+        throw std::invalid_argument("Procedural terrain requires a tile size and cache size > 0");
+    }
+
+    if (! (m_params.scale > 0.0f) || ! (m_params.view_distance > 0.0f)) {
+        std::stringstream msg;
+        msg << "Procedural terrain requires a positive scale and view distance (got scale = "
+            << m_params.scale << ", view distance = " << m_params.view_distance << ")";
+        throw std::invalid_argument(msg.str());
+    }
+}
+
+
+Procedural_Terrain::~Procedural_Terrain()
+{
+    // No-op
+}
+
+
+const Procedural_Terrain_Params & Procedural_Terrain::params() const
+{
+    return m_params;
+}
+
+
+Buffer Procedural_Terrain::tile(const int64_t tile_row, const int64_t tile_col)
+{
+    const Tile_Key key(tile_row, tile_col);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_cache.find(key);
+        if (it != m_cache.end()) {
+            m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+            return it->second.tile;
+        }
+    }
+
+    // Generate outside the lock so other threads can keep reading cached tiles
+    const int64_t size = m_params.tile_size;
+    Buffer tile(m_params.tile_size, m_params.tile_size);
+    noise::fill(m_params.noise, tile_row * size, tile_col * size, tile);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_generated++;
+
+    // Another thread may have generated the same tile meanwhile. Both are identical.
+    auto it = m_cache.find(key);
+    if (it != m_cache.end()) {
+        m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+        return it->second.tile;
+    }
+
+    while (m_cache.size() >= m_params.max_tiles) {
+        m_cache.erase(m_lru.back());
+        m_lru.pop_back();
+    }
+
+    m_lru.push_front(key);
+    m_cache.emplace(key, Cache_Entry { tile, m_lru.begin() });
+
+    return tile;
+}
+
+
+float Procedural_Terrain::height(const int64_t row, const int64_t col)
+{
+    Cursor cursor(*this);
+    return cursor.height(row, col);
+}
+
+
+void Procedural_Terrain::copy_region(const int64_t row0, const int64_t col0, Buffer & out)
+{
+    const int64_t size = m_params.tile_size;
+    const int64_t rows = std::get<0>(out.size());
+    const int64_t cols = std::get<1>(out.size());
+    float * const data = out.data().get();
+
+    // Copy the overlap with each tile a row at a time
+    for (int64_t tr = _floor_div(row0, size); tr * size < row0 + rows; tr++) {
+        for (int64_t tc = _floor_div(col0, size); tc * size < col0 + cols; tc++) {
+            Buffer t = tile(tr, tc);
+            const float * const tdata = t.data().get();
+
+            const int64_t r_begin = std::max(row0, tr * size);
+            const int64_t r_end = std::min(row0 + rows, (tr + 1) * size);
+            const int64_t c_begin = std::max(col0, tc * size);
+            const int64_t c_end = std::min(col0 + cols, (tc + 1) * size);
+
+            for (int64_t r = r_begin; r < r_end; r++) {
+                std::memcpy(data + (r - row0) * cols + (c_begin - col0),
+                            tdata + (r - tr * size) * size + (c_begin - tc * size),
+                            (c_end - c_begin) * sizeof(float));
+            }
+        }
+    }
+}
+
+
+size_t Procedural_Terrain::cached_tiles() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_cache.size();
+}
+
+
+uint64_t Procedural_Terrain::tiles_generated() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_generated;
+}
+
+}
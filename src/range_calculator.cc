@@ -0,0 +1,169 @@
+//! @file       range_calculator.cc
+//! @brief      Defines the parts of the range-calculation API shared by every implementation
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "buffer.h"
+#include "camera.h"
+#include "procedural_terrain.h"
+#include "range_calculator.h"
+#include "range_quantization.h"
+#include "terrain.h"
+
+// Standard Imports
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+// Third-Party Imports
+
+
+namespace clarity
+{
+
+//! @brief  The spacing of the pixels of the first pass of a progressive render
+static const uint32_t _COARSEST_STRIDE = 8;
+
+//! @brief  The number of rays walked between checks of the cancel flag
+static const size_t _RAYS_PER_BATCH = 4096;
+
+
+//! @brief  Get the nearest range among the pixels of the last pass around a pixel
+static float _nearest_neighbour(const Buffer & rng,
+                                const uint32_t row,
+                                const uint32_t col,
+                                const uint32_t spacing)
+{
+    const uint32_t r0 = row - row % spacing;
+    const uint32_t c0 = col - col % spacing;
+    const uint32_t r1 = r0 + spacing < rng.size().first ? r0 + spacing : r0;
+    const uint32_t c1 = c0 + spacing < rng.size().second ? c0 + spacing : c0;
+
+    return std::min(std::min(rng.at(r0, c0), rng.at(r0, c1)),
+                    std::min(rng.at(r1, c0), rng.at(r1, c1)));
+}
+
+
+float Range_Calculator::max_range(const Terrain & t)
+{
+    if (t.procedural() != nullptr) {
+        return t.procedural()->params().view_distance;
+    }
+
+    return t.scale() * std::get<0>(t.data().size()) * std::sqrt(3.0f);
+}
+
+
+void Range_Calculator::Calculate_Quantized(const Camera & cam,
+                                           const Terrain & t,
+                                           const Range_Quantization & q,
+                                           std::vector<uint16_t> & codes)
+{
+    const auto sz = cam.focal_plane_dimensions();
+    const uint32_t rows = std::get<0>(sz);
+    const uint32_t cols = std::get<1>(sz);
+
+    Buffer rng(rows, cols);
+    Calculate(cam, t, rng);
+
+    codes.resize(static_cast<size_t>(rows) * cols);
+    range_quantization::quantize(rng, q, codes.data());
+}
+
+
+bool Range_Calculator::Calculate_Progressive(const Camera & cam,
+                                             const Terrain & t,
+                                             Buffer & rng,
+                                             const Progress_Callback & callback,
+                                             const std::atomic<bool> * cancel,
+                                             const float start_margin)
+{
+    const auto sz = cam.focal_plane_dimensions();
+    const uint32_t rows = std::get<0>(sz);
+    const uint32_t cols = std::get<1>(sz);
+
+    if (rng.size().first != rows || rng.size().second != cols) {
+        std::stringstream msg;
+        msg << "Invalid Argument. Expected a range buffer of size (" << rows << ", " << cols
+            << ") but got a buffer of size (" << rng.size().first << ", "
+            << rng.size().second << ")";
+        throw std::invalid_argument(msg.str());
+    }
+
+    if (! (start_margin >= 0.0f && start_margin < 1.0f)) {
+        std::stringstream msg;
+        msg << "Invalid Argument. Expected a start margin in [0, 1) but got " << start_margin;
+        throw std::invalid_argument(msg.str());
+    }
+
+    const bool reuse = start_margin > 0.0f;
+    std::vector<Pixel> pixels;
+    std::vector<float> start;
+    std::vector<Pixel> batch_pixels;
+    std::vector<float> batch_start;
+    std::vector<float> ranges;
+
+    for (uint32_t stride = _COARSEST_STRIDE; stride >= 1; stride /= 2) {
+        const uint32_t spacing = 2 * stride;
+        const bool first = stride == _COARSEST_STRIDE;
+
+        // Only the pixels that the last pass did not cover
+        pixels.clear();
+        start.clear();
+        for (uint32_t r = 0; r < rows; r += stride) {
+            for (uint32_t c = 0; c < cols; c += stride) {
+                if (! first && r % spacing == 0 && c % spacing == 0) {
+                    continue;
+                }
+
+                pixels.emplace_back(r, c);
+                if (reuse) {
+                    start.push_back(first ? 0.0f
+                                          : start_margin * _nearest_neighbour(rng, r, c, spacing));
+                }
+            }
+        }
+
+        for (size_t b = 0; b < pixels.size(); b += _RAYS_PER_BATCH) {
+            if (cancel != nullptr && cancel->load()) {
+                return false;
+            }
+
+            const size_t end = std::min(b + _RAYS_PER_BATCH, pixels.size());
+            batch_pixels.assign(pixels.begin() + b, pixels.begin() + end);
+            if (reuse) {
+                batch_start.assign(start.begin() + b, start.begin() + end);
+                Calculate_Pixels(cam, t, batch_pixels, batch_start, ranges);
+            } else {
+                Calculate_Pixels(cam, t, batch_pixels, ranges);
+            }
+
+            // Fill the block of each pixel until a later pass refines it
+            for (size_t i = 0; i < batch_pixels.size(); i++) {
+                const uint32_t r_end = std::min(batch_pixels[i].first + stride, rows);
+                const uint32_t c_end = std::min(batch_pixels[i].second + stride, cols);
+
+                for (uint32_t r = batch_pixels[i].first; r < r_end; r++) {
+                    for (uint32_t c = batch_pixels[i].second; c < c_end; c++) {
+                        rng.at(r, c) = ranges[i];
+                    }
+                }
+            }
+        }
+
+        if (callback) {
+            callback(stride, rng);
+        }
+    }
+
+    return true;
+}
+
+}
@@ -0,0 +1,408 @@
+//! @file       range_codec.cc
+//! @brief      Defines the Range_Encoder and Range_Decoder types, which compress sequences of
+//!             range images with keyframes and quantized temporal residuals
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "buffer.h"
+#include "range_codec.h"
+#include "simd.h"
+#include "thread_pool.h"
+
+// Standard Imports
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+// Third-Party Imports
+
+namespace clarity
+{
+
+using range_codec::Frame_Header;
+
+//! Residuals are clamped to this magnitude so the float-to-int conversion is always defined
+static constexpr float _MAX_RESIDUAL = 1073741824.0f;
+
+//! The target number of rows in each band
+static constexpr uint32_t _BAND_ROWS = 16;
+
+
+//! @brief  Quantize a run of ranges against a prediction and reconstruct them.
+//!
+//! @detail The vector body and the scalar tail perform the same IEEE operations in the same
+//!         order, so the reconstruction is identical no matter how a row is split.
+//!
+//! @param[in]      values      the ranges to encode
+//! @param[in,out]  reference   the prediction for each range. Replaced with the reconstruction.
+//!                             Ignored (treated as zero) for keyframes.
+//! @param[in]      keyframe    whether to quantize against zero rather than the reference
+//! @param[in]      step        the quantization step
+//! @param[out]     residuals   the quantized residuals
+//! @param[in]      count       the number of ranges
+static void _quantize(const float * values,
+                      float * reference,
+                      const bool keyframe,
+                      const float step,
+                      int32_t * residuals,
+                      const uint32_t count)
+{
+    const float inv_step = 1.0f / step;
+
+    using namespace simd;
+    const f32x4 v_step = splat(step);
+    const f32x4 v_inv_step = splat(inv_step);
+    const f32x4 v_max = splat(_MAX_RESIDUAL);
+    const f32x4 v_min = splat(-_MAX_RESIDUAL);
+    const f32x4 v_zero = splat(0.0f);
+    const f32x4 v_half = splat(0.5f);
+    const f32x4 v_neg_half = splat(-0.5f);
+
+    uint32_t i = 0;
+    for (; i + WIDTH <= count; i += WIDTH) {
+        const f32x4 prediction = keyframe ? v_zero : load(reference + i);
+
+        f32x4 d = (load(values + i) - prediction) * v_inv_step;
+        d = select(d == d, d, v_zero);
+        d = select(d > v_max, v_max, d);
+        d = select(d < v_min, v_min, d);
+
+        const i32x4 q = to_int(d + select(d >= v_zero, v_half, v_neg_half));
+        store(residuals + i, q);
+        store(reference + i, prediction + to_float(q) * v_step);
+    }
+
+    for (; i < count; i++) {
+        const float prediction = keyframe ? 0.0f : reference[i];
+
+        float d = (values[i] - prediction) * inv_step;
+        d = (d == d) ? d : 0.0f;
+        d = (d > _MAX_RESIDUAL) ? _MAX_RESIDUAL : d;
+        d = (d < -_MAX_RESIDUAL) ? -_MAX_RESIDUAL : d;
+
+        const int32_t q = static_cast<int32_t>(d + ((d >= 0.0f) ? 0.5f : -0.5f));
+        residuals[i] = q;
+        reference[i] = prediction + static_cast<float>(q) * step;
+    }
+}
+
+
+//! @brief  Reconstruct a run of ranges from quantized residuals. The inverse of _quantize.
+static void _reconstruct(const int32_t * residuals,
+                         float * reference,
+                         const bool keyframe,
+                         const float step,
+                         float * out,
+                         const uint32_t count)
+{
+    using namespace simd;
+    const f32x4 v_step = splat(step);
+    const f32x4 v_zero = splat(0.0f);
+
+    uint32_t i = 0;
+    for (; i + WIDTH <= count; i += WIDTH) {
+        const f32x4 prediction = keyframe ? v_zero : load(reference + i);
+        const f32x4 value = prediction + to_float(load(residuals + i)) * v_step;
+        store(reference + i, value);
+        store(out + i, value);
+    }
+
+    for (; i < count; i++) {
+        const float prediction = keyframe ? 0.0f : reference[i];
+        const float value = prediction + static_cast<float>(residuals[i]) * step;
+        reference[i] = value;
+        out[i] = value;
+    }
+}
+
+
+//! @brief  Append residuals to a byte stream as zig-zag varints
+static void _write_varints(const int32_t * residuals,
+                           const uint32_t count,
+                           std::vector<uint8_t> & out)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        const uint32_t q = static_cast<uint32_t>(residuals[i]);
+        uint32_t z = (q << 1) ^ static_cast<uint32_t>(residuals[i] >> 31);
+
+        while (z >= 0x80) {
+            out.push_back(static_cast<uint8_t>(z | 0x80));
+            z >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(z));
+    }
+}
+
+
+//! @brief  Read zig-zag varints from a byte stream. Returns the position after the last one.
+static const uint8_t * _read_varints(const uint8_t * in,
+                                     const uint8_t * end,
+                                     int32_t * residuals,
+                                     const uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t z = 0;
+        uint32_t shift = 0;
+
+        while (true) {
+            if (in == end || shift > 28) {
+                throw std::runtime_error("Encoded range frame is corrupt (truncated band)");
+            }
+
+            const uint8_t byte = *in++;
+            z |= static_cast<uint32_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                break;
+            }
+            shift += 7;
+        }
+
+        residuals[i] = static_cast<int32_t>((z >> 1) ^ (0u - (z & 1)));
+    }
+
+    return in;
+}
+
+
+//! @brief  Get the number of bands a frame is split into
+static uint32_t _num_bands(const uint32_t rows)
+{
+    return std::max(1u, (rows + _BAND_ROWS - 1) / _BAND_ROWS);
+}
+
+
+//! @brief  Get the first row of a band
+static uint32_t _band_start(const uint32_t band, const uint32_t num_bands, const uint32_t rows)
+{
+    return static_cast<uint32_t>((static_cast<uint64_t>(band) * rows) / num_bands);
+}
+
+
+static void _check_frame_size(const Buffer & rng, const uint32_t rows, const uint32_t cols)
+{
+    const auto sz = rng.size();
+    if (std::get<0>(sz) != rows || std::get<1>(sz) != cols || rng.depth() != 1) {
+        std::stringstream msg;
+        msg << "Invalid Argument. Expected a range image of size (" << rows << ", " << cols
+            << ") but got one of size (" << std::get<0>(sz) << ", " << std::get<1>(sz) << ")";
+        throw std::invalid_argument(msg.str());
+    }
+}
+
+
+Range_Encoder::Range_Encoder(const uint32_t rows,
+                             const uint32_t cols,
+                             const Range_Codec_Params & params)
+    : m_rows(rows)
+    , m_cols(cols)
+    , m_params(params)
+    , m_reference(static_cast<size_t>(rows) * cols, 0.0f)
+    , m_since_keyframe(0)
+    , m_bands(_num_bands(rows))
+    , m_pool(params.num_threads)
+{
+    if (! (params.error_bound > 0.0f)) {
+        throw std::invalid_argument("Range codec error bound must be positive");
+    }
+
+    if (params.keyframe_interval == 0) {
+        throw std::invalid_argument("Range codec keyframe interval must be at least 1");
+    }
+}
+
+
+Range_Encoder::~Range_Encoder()
+{
+    // No-op
+}
+
+
+bool Range_Encoder::encode(const Buffer & rng, std::vector<uint8_t> & out)
+{
+    _check_frame_size(rng, m_rows, m_cols);
+
+    const bool keyframe = (m_since_keyframe == 0);
+    m_since_keyframe = (m_since_keyframe + 1) % m_params.keyframe_interval;
+
+    // Rounding to the nearest multiple of step bounds the error by step / 2
+    const float step = 2.0f * m_params.error_bound;
+    const float * values = &rng.at(0, 0);
+    const uint32_t num_bands = m_bands.size();
+
+    m_pool.parallel_for(0, num_bands, [&](const uint32_t first, const uint32_t last) {
+        std::vector<int32_t> residuals(m_cols);
+
+        for (uint32_t b = first; b < last; b++) {
+            std::vector<uint8_t> & band = m_bands[b];
+            band.clear();
+
+            const uint32_t row_end = _band_start(b + 1, num_bands, m_rows);
+            for (uint32_t r = _band_start(b, num_bands, m_rows); r < row_end; r++) {
+                const size_t offset = static_cast<size_t>(r) * m_cols;
+                _quantize(values + offset,
+                          m_reference.data() + offset,
+                          keyframe,
+                          step,
+                          residuals.data(),
+                          m_cols);
+                _write_varints(residuals.data(), m_cols, band);
+            }
+        }
+    });
+
+    // Assemble the header, the band sizes and the bands
+    const Frame_Header header { range_codec::FRAME_MAGIC,
+                                static_cast<uint8_t>(keyframe),
+                                { 0, 0, 0 },
+                                step,
+                                m_rows,
+                                m_cols,
+                                num_bands };
+
+    size_t total = sizeof(header) + num_bands * sizeof(uint32_t);
+    for (const auto & band : m_bands) {
+        total += band.size();
+    }
+
+    out.resize(total);
+    uint8_t * dst = out.data();
+    std::memcpy(dst, &header, sizeof(header));
+    dst += sizeof(header);
+
+    for (const auto & band : m_bands) {
+        const uint32_t band_bytes = band.size();
+        std::memcpy(dst, &band_bytes, sizeof(band_bytes));
+        dst += sizeof(band_bytes);
+    }
+
+    for (const auto & band : m_bands) {
+        std::memcpy(dst, band.data(), band.size());
+        dst += band.size();
+    }
+
+    return keyframe;
+}
+
+
+void Range_Encoder::force_keyframe()
+{
+    m_since_keyframe = 0;
+}
+
+
+Range_Decoder::Range_Decoder(const uint32_t rows, const uint32_t cols, const unsigned num_threads)
+    : m_rows(rows)
+    , m_cols(cols)
+    , m_reference(static_cast<size_t>(rows) * cols, 0.0f)
+    , m_has_reference(false)
+    , m_pool(num_threads)
+{
+    // No-op
+}
+
+
+Range_Decoder::~Range_Decoder()
+{
+    // No-op
+}
+
+
+void Range_Decoder::decode(const uint8_t * bytes, const size_t length, Buffer & rng)
+{
+    _check_frame_size(rng, m_rows, m_cols);
+
+    Frame_Header header;
+    if (length < sizeof(header)) {
+        throw std::runtime_error("Encoded range frame is corrupt (truncated header)");
+    }
+    std::memcpy(&header, bytes, sizeof(header));
+
+    if (header.magic != range_codec::FRAME_MAGIC) {
+        throw std::runtime_error("Encoded range frame is corrupt (bad magic)");
+    }
+
+    if (header.rows != m_rows || header.cols != m_cols) {
+        std::stringstream msg;
+        msg << "Encoded range frame has size (" << header.rows << ", " << header.cols
+            << ") but the decoder expects (" << m_rows << ", " << m_cols << ")";
+        throw std::invalid_argument(msg.str());
+    }
+
+    const bool keyframe = header.keyframe != 0;
+    if (! keyframe && ! m_has_reference) {
+        throw std::runtime_error("Cannot decode a delta frame without its reference. "
+                                 "Start decoding at a keyframe.");
+    }
+
+    // Locate each band
+    const uint32_t num_bands = header.num_bands;
+    const size_t table_end = sizeof(header) + static_cast<size_t>(num_bands) * sizeof(uint32_t);
+    if (num_bands == 0 || num_bands > m_rows || length < table_end) {
+        throw std::runtime_error("Encoded range frame is corrupt (bad band table)");
+    }
+
+    std::vector<size_t> band_offsets(num_bands + 1);
+    band_offsets[0] = table_end;
+    for (uint32_t b = 0; b < num_bands; b++) {
+        uint32_t band_bytes;
+        std::memcpy(&band_bytes, bytes + sizeof(header) + b * sizeof(uint32_t), sizeof(band_bytes));
+        band_offsets[b + 1] = band_offsets[b] + band_bytes;
+    }
+
+    if (band_offsets[num_bands] > length) {
+        throw std::runtime_error("Encoded range frame is corrupt (truncated bands)");
+    }
+
+    // A failed decode leaves the reference half-updated
+    m_has_reference = false;
+
+    float * out = rng.data().get();
+    m_pool.parallel_for(0, num_bands, [&](const uint32_t first, const uint32_t last) {
+        std::vector<int32_t> residuals(m_cols);
+
+        for (uint32_t b = first; b < last; b++) {
+            const uint8_t * in = bytes + band_offsets[b];
+            const uint8_t * end = bytes + band_offsets[b + 1];
+
+            const uint32_t row_end = _band_start(b + 1, num_bands, m_rows);
+            for (uint32_t r = _band_start(b, num_bands, m_rows); r < row_end; r++) {
+                const size_t offset = static_cast<size_t>(r) * m_cols;
+                in = _read_varints(in, end, residuals.data(), m_cols);
+                _reconstruct(residuals.data(),
+                             m_reference.data() + offset,
+                             keyframe,
+                             header.step,
+                             out + offset,
+                             m_cols);
+            }
+        }
+    });
+
+    m_has_reference = true;
+}
+
+
+void Range_Decoder::reset()
+{
+    m_has_reference = false;
+}
+
+
+bool Range_Decoder::is_keyframe(const uint8_t * bytes, const size_t length)
+{
+    Frame_Header header;
+    if (length < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, bytes, sizeof(header));
+
+    return header.magic == range_codec::FRAME_MAGIC && header.keyframe != 0;
+}
+
+}
@@ -0,0 +1,88 @@
+//! @file       range_quantization.cc
+//! @brief      Defines the functions that pack range images into 16 bit codes
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "buffer.h"
+#include "range_quantization.h"
+
+// Standard Imports
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+
+// Third-Party Imports
+
+namespace clarity
+{
+namespace range_quantization
+{
+
+Range_Quantization covering(const float min_range, const float max_range)
+{
+    if (! (max_range > min_range)) {
+        std::stringstream msg;
+        msg << "Invalid Argument. Cannot quantize the ranges from (" << min_range << ") to ("
+            << max_range << ")";
+        throw std::invalid_argument(msg.str());
+    }
+
+    return Range_Quantization { min_range, (max_range - min_range) / MAX_CODE };
+}
+
+
+uint16_t quantize(const float range, const Range_Quantization & q)
+{
+    // Round half to even, as convert_ushort_sat_rte does on the device
+    const float code = std::nearbyint((range - q.offset) / q.step);
+    if (! (code > 0.0f)) {
+        return 0;
+    }
+
+    return code >= MAX_CODE ? MAX_CODE : static_cast<uint16_t>(code);
+}
+
+
+float dequantize(const uint16_t code, const Range_Quantization & q)
+{
+    return q.offset + code * q.step;
+}
+
+
+void quantize(const Buffer & rng, const Range_Quantization & q, uint16_t * codes)
+{
+    if (rng.depth() != 1) {
+        throw std::invalid_argument("Invalid Argument. Only a Buffer of depth 1 can be packed");
+    }
+
+    const size_t n = static_cast<size_t>(rng.size().first) * rng.size().second;
+    if (n == 0) {
+        return;
+    }
+
+    const float * ranges = &rng.at(0, 0);
+    for (size_t i = 0; i < n; i++) {
+        codes[i] = quantize(ranges[i], q);
+    }
+}
+
+
+void dequantize(const uint16_t * codes, const Range_Quantization & q, Buffer & rng)
+{
+    if (rng.depth() != 1) {
+        throw std::invalid_argument("Invalid Argument. Codes unpack into a Buffer of depth 1");
+    }
+
+    const size_t n = static_cast<size_t>(rng.size().first) * rng.size().second;
+    float * ranges = rng.data().get();
+    for (size_t i = 0; i < n; i++) {
+        ranges[i] = dequantize(codes[i], q);
+    }
+}
+
+}
+}
@@ -0,0 +1,601 @@
+//! @file       range_sequence.cc
+//! @brief      Defines the Range_Sequence_Writer and Range_Sequence_Reader types, which store
+//!             many range images and their Camera poses in a single indexed file
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "buffer.h"
+#include "camera.h"
+#include "range_codec.h"
+#include "range_quantization.h"
+#include "range_sequence.h"
+
+// Standard Imports
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Third-Party Imports
+
+namespace clarity
+{
+
+using range_sequence::File_Header;
+using range_sequence::Frame_Header;
+using range_sequence::Quantization_Header;
+
+static_assert(sizeof(File_Header) % 8 == 0, "File_Header must keep records 8 byte aligned");
+static_assert(sizeof(Frame_Header) % 8 == 0, "Frame_Header must keep payloads 8 byte aligned");
+static_assert(sizeof(Quantization_Header) % 4 == 0,
+              "Quantization_Header must keep codes 4 byte aligned");
+
+
+//! @brief  Round a file offset up to the next 8 byte boundary
+static uint64_t _align(const uint64_t offset)
+{
+    return (offset + 7) & ~static_cast<uint64_t>(7);
+}
+
+
+Range_Sequence_Writer::Range_Sequence_Writer(const std::string & path,
+                                             const uint32_t rows,
+                                             const uint32_t cols,
+                                             const size_t max_pending)
+    : m_out(path, std::ios::out | std::ios::binary | std::ios::trunc)
+    , m_rows(rows)
+    , m_cols(cols)
+    , m_max_pending(std::max<size_t>(max_pending, 1))
+    , m_encoder()
+    , m_quantized(false)
+    , m_quantization()
+    , m_mutex()
+    , m_queued()
+    , m_dequeued()
+    , m_pending()
+    , m_busy(false)
+    , m_stopping(false)
+    , m_closed(false)
+    , m_appended(0)
+    , m_index()
+    , m_error()
+    , m_thread()
+{
+    if (! m_out.good()) {
+        std::stringstream msg;
+        msg << "Failed to open range sequence file (" << path << ") for writing";
+        throw std::invalid_argument(msg.str());
+    }
+
+    // The index is filled in by close()
+    const File_Header header { range_sequence::FILE_MAGIC, range_sequence::VERSION,
+                               m_rows, m_cols, 0, 0 };
+    m_out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    m_thread = std::thread(&Range_Sequence_Writer::run, this);
+}
+
+
+Range_Sequence_Writer::Range_Sequence_Writer(const std::string & path,
+                                             const uint32_t rows,
+                                             const uint32_t cols,
+                                             const Range_Codec_Params & codec,
+                                             const size_t max_pending)
+    : Range_Sequence_Writer(path, rows, cols, max_pending)
+{
+    // The writer thread only reads m_encoder once a frame has been queued
+    m_encoder = std::unique_ptr<Range_Encoder>(new Range_Encoder(rows, cols, codec));
+}
+
+
+Range_Sequence_Writer::Range_Sequence_Writer(const std::string & path,
+                                             const uint32_t rows,
+                                             const uint32_t cols,
+                                             const Range_Quantization & quantization,
+                                             const size_t max_pending)
+    : Range_Sequence_Writer(path, rows, cols, max_pending)
+{
+    if (! (quantization.step > 0.0f)) {
+        std::stringstream msg;
+        msg << "Invalid Argument. The quantization step must be positive, but got ("
+            << quantization.step << ")";
+        throw std::invalid_argument(msg.str());
+    }
+
+    m_quantized = true;
+    m_quantization = quantization;
+}
+
+
+Range_Sequence_Writer::~Range_Sequence_Writer()
+{
+    try {
+        close();
+    } catch (const std::exception &) {
+        // Destructors must not throw. Callers that care about errors should call close().
+    }
+}
+
+
+void Range_Sequence_Writer::append(const Camera & cam, const Buffer & rng, const double timestamp)
+{
+    const auto sz = rng.size();
+    if (std::get<0>(sz) != m_rows || std::get<1>(sz) != m_cols || rng.depth() != 1) {
+        std::stringstream msg;
+        msg << "Invalid Argument. Expected a range image of size (" << m_rows << ", " << m_cols
+            << ") but got one of size (" << std::get<0>(sz) << ", " << std::get<1>(sz) << ")";
+        throw std::invalid_argument(msg.str());
+    }
+
+    // Copy the frame before queueing it - the caller is free to reuse rng once we return
+    Pending_Frame frame;
+    const size_t n = static_cast<size_t>(m_rows) * m_cols;
+    if (m_quantized) {
+        const Quantization_Header q { m_quantization.offset, m_quantization.step };
+        frame.packed.resize(sizeof(q) + n * sizeof(uint16_t));
+        std::memcpy(frame.packed.data(), &q, sizeof(q));
+        range_quantization::quantize(rng, 
+                                     m_quantization, 
+                                     reinterpret_cast<uint16_t *>(frame.packed.data() + sizeof(q)));
+        frame.header = frame_header(cam, Range_Encoding::UINT16, frame.packed.size(), timestamp);
+    } else {
+        const float * data = &rng.at(0, 0);
+        frame.data.assign(data, data + n);
+        frame.header = frame_header(cam, Range_Encoding::FLOAT32, n * sizeof(float), timestamp);
+    }
+
+    enqueue(std::move(frame));
+}
+
+
+void Range_Sequence_Writer::append(const Camera & cam,
+                                   const std::vector<uint16_t> & codes,
+                                   const Range_Quantization & quantization,
+                                   const double timestamp)
+{
+    const size_t n = static_cast<size_t>(m_rows) * m_cols;
+    if (codes.size() != n) {
+        std::stringstream msg;
+        msg << "Invalid Argument. Expected (" << n << ") codes but got (" << codes.size() << ")";
+        throw std::invalid_argument(msg.str());
+    }
+
+    if (m_encoder != nullptr) {
+        throw std::invalid_argument("Cannot append packed frames to a compressed range sequence");
+    }
+
+    Pending_Frame frame;
+    const Quantization_Header q { quantization.offset, quantization.step };
+    frame.packed.resize(sizeof(q) + n * sizeof(uint16_t));
+    std::memcpy(frame.packed.data(), &q, sizeof(q));
+    std::memcpy(frame.packed.data() + sizeof(q), codes.data(), n * sizeof(uint16_t));
+    frame.header = frame_header(cam, Range_Encoding::UINT16, frame.packed.size(), timestamp);
+
+    enqueue(std::move(frame));
+}
+
+
+Frame_Header Range_Sequence_Writer::frame_header(const Camera & cam,
+                                                 const Range_Encoding encoding,
+                                                 const uint64_t payload_bytes,
+                                                 const double timestamp) const
+{
+    const auto & pos = cam.position();
+    return Frame_Header { range_sequence::FRAME_MAGIC,
+                          encoding,
+                          payload_bytes,
+                          timestamp,
+                          { std::get<0>(pos), std::get<1>(pos), std::get<2>(pos) },
+                          cam.yaw(),
+                          cam.pitch(),
+                          cam.fov() };
+}
+
+
+void Range_Sequence_Writer::enqueue(Pending_Frame && frame)
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_closed || m_stopping) {
+            throw std::runtime_error("Cannot append to a closed range sequence");
+        }
+
+        m_dequeued.wait(lock, [this] {
+            return m_pending.size() < m_max_pending || m_error != nullptr;
+        });
+        check_error();
+
+        m_pending.push_back(std::move(frame));
+        m_appended++;
+    }
+
+    m_queued.notify_one();
+}
+
+
+void Range_Sequence_Writer::flush()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_dequeued.wait(lock, [this] {
+        return (m_pending.empty() && ! m_busy) || m_error != nullptr;
+    });
+    check_error();
+
+    // The writer thread is idle and cannot pick up new work while we hold the lock
+    if (! m_closed) {
+        m_out.flush();
+    }
+}
+
+
+void Range_Sequence_Writer::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_closed) {
+            return;
+        }
+        m_stopping = true;
+    }
+
+    m_queued.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_closed = true;
+    check_error();
+
+    // Append the index and point the header at it
+    const uint64_t index_offset = m_out.tellp();
+    m_out.write(reinterpret_cast<const char *>(m_index.data()), m_index.size() * sizeof(uint64_t));
+
+    const File_Header header { range_sequence::FILE_MAGIC, range_sequence::VERSION,
+                               m_rows, m_cols, index_offset, m_index.size() };
+    m_out.seekp(0);
+    m_out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    m_out.close();
+
+    if (m_out.fail()) {
+        throw std::runtime_error("Failed to write range sequence index");
+    }
+}
+
+
+uint64_t Range_Sequence_Writer::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_appended;
+}
+
+
+void Range_Sequence_Writer::run()
+{
+    static const char _PADDING[8] = { 0 };
+    std::vector<uint8_t> encoded;
+
+    while (true) {
+        Pending_Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_queued.wait(lock, [this] { return m_stopping || ! m_pending.empty(); });
+
+            if (m_pending.empty()) {
+                return;
+            }
+
+            frame = std::move(m_pending.front());
+            m_pending.pop_front();
+            m_busy = true;
+        }
+        m_dequeued.notify_all();
+
+        // Only this thread touches m_out and m_index until close() joins it
+        try {
+            const char * payload = reinterpret_cast<const char *>(frame.data.data());
+
+            if (frame.header.encoding == Range_Encoding::UINT16) {
+                payload = reinterpret_cast<const char *>(frame.packed.data());
+            } else if (m_encoder != nullptr) {
+                // Frames reach this thread in order, as the encoder requires
+                std::shared_ptr<float> data(frame.data.data(), [](float *) {});
+                m_encoder->encode(Buffer(data, m_rows, m_cols), encoded);
+
+                frame.header.encoding = Range_Encoding::DELTA;
+                frame.header.payload_bytes = encoded.size();
+                payload = reinterpret_cast<const char *>(encoded.data());
+            }
+
+            const uint64_t offset = m_out.tellp();
+            m_out.write(reinterpret_cast<const char *>(&frame.header), sizeof(frame.header));
+            m_out.write(payload, frame.header.payload_bytes);
+
+            const uint64_t end = offset + sizeof(frame.header) + frame.header.payload_bytes;
+            m_out.write(_PADDING, _align(end) - end);
+
+            if (m_out.fail()) {
+                std::stringstream msg;
+                msg << "Failed to write frame " << m_index.size() << " of range sequence";
+                throw std::runtime_error(msg.str());
+            }
+
+            m_index.push_back(offset);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_error = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_busy = false;
+        }
+        m_dequeued.notify_all();
+    }
+}
+
+
+void Range_Sequence_Writer::check_error() const
+{
+    if (m_error != nullptr) {
+        std::rethrow_exception(m_error);
+    }
+}
+
+
+Range_Sequence_Reader::Range_Sequence_Reader(const std::string & path)
+    : m_mapping()
+    , m_length(0)
+    , m_header()
+    , m_index()
+    , m_decode_mutex()
+    , m_decoder()
+    , m_decoded(-1)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::stringstream msg;
+        msg << "Failed to open range sequence file (" << path << ")";
+        throw std::invalid_argument(msg.str());
+    }
+
+    struct stat results;
+    if (fstat(fd, &results) != 0 || static_cast<size_t>(results.st_size) < sizeof(File_Header)) {
+        ::close(fd);
+        std::stringstream msg;
+        msg << "Invalid argument, (" << path << ") is not a range sequence file (too small)";
+        throw std::invalid_argument(msg.str());
+    }
+
+    // A private, writable mapping lets frames be handed out as ordinary Buffers. Pages are only
+    // copied if a caller writes to one.
+    const size_t length = results.st_size;
+    void * addr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if (addr == MAP_FAILED) {
+        std::stringstream msg;
+        msg << "Failed to map range sequence file (" << path << ")";
+        throw std::runtime_error(msg.str());
+    }
+
+    m_length = length;
+    m_mapping = std::shared_ptr<char>(static_cast<char *>(addr),
+                                      [length](char * p) { munmap(p, length); });
+
+    std::memcpy(&m_header, m_mapping.get(), sizeof(m_header));
+    if (m_header.magic != range_sequence::FILE_MAGIC) {
+        std::stringstream msg;
+        msg << "Invalid argument, (" << path << ") is not a range sequence file (bad magic)";
+        throw std::invalid_argument(msg.str());
+    }
+
+    if (m_header.version != range_sequence::VERSION) {
+        std::stringstream msg;
+        msg << "Unsupported range sequence version (" << m_header.version << ")";
+        throw std::invalid_argument(msg.str());
+    }
+
+    const uint64_t index_end = m_header.index_offset + m_header.frame_count * sizeof(uint64_t);
+    if (m_header.index_offset != 0 && index_end <= m_length) {
+        const uint64_t * index = reinterpret_cast<const uint64_t *>(
+            m_mapping.get() + m_header.index_offset);
+        m_index.assign(index, index + m_header.frame_count);
+    } else {
+        // The writer did not close the file. Recover whatever frames made it to disk.
+        recover_index();
+    }
+}
+
+
+Range_Sequence_Reader::~Range_Sequence_Reader()
+{
+    // No-op
+}
+
+
+uint64_t Range_Sequence_Reader::size() const
+{
+    return m_index.size();
+}
+
+
+std::pair<uint32_t, uint32_t> Range_Sequence_Reader::frame_size() const
+{
+    return std::make_pair(m_header.rows, m_header.cols);
+}
+
+
+Buffer Range_Sequence_Reader::frame(const uint64_t n) const
+{
+    const Frame_Header & h = header(n);
+    const uint64_t expected_bytes = static_cast<uint64_t>(m_header.rows) * m_header.cols * 4;
+
+    if (h.encoding == Range_Encoding::DELTA) {
+        std::lock_guard<std::mutex> lock(m_decode_mutex);
+        return decode(n);
+    }
+
+    if (h.encoding == Range_Encoding::UINT16) {
+        const uint64_t pixels = static_cast<uint64_t>(m_header.rows) * m_header.cols;
+        if (h.payload_bytes != sizeof(Quantization_Header) + pixels * sizeof(uint16_t)) {
+            std::stringstream msg;
+            msg << "Range sequence is corrupt - frame " << n << " has the wrong size";
+            throw std::runtime_error(msg.str());
+        }
+
+        const char * payload = m_mapping.get() + m_index[n] + sizeof(Frame_Header);
+        Quantization_Header q;
+        std::memcpy(&q, payload, sizeof(q));
+
+        Buffer rng(m_header.rows, m_header.cols);
+        range_quantization::dequantize(
+            reinterpret_cast<const uint16_t *>(payload + sizeof(q)),
+            Range_Quantization { q.offset, q.step },
+            rng);
+        return rng;
+    }
+
+    if (h.encoding != Range_Encoding::FLOAT32 || h.payload_bytes != expected_bytes) {
+        std::stringstream msg;
+        msg << "Frame " << n << " has an unsupported encoding (" << h.encoding << ")";
+        throw std::runtime_error(msg.str());
+    }
+
+    // Share ownership of the mapping so the frame outlives the reader if needed
+    char * payload = m_mapping.get() + m_index[n] + sizeof(Frame_Header);
+    std::shared_ptr<float> data(m_mapping, reinterpret_cast<float *>(payload));
+
+    return Buffer(data, m_header.rows, m_header.cols);
+}
+
+
+Camera Range_Sequence_Reader::camera(const uint64_t n) const
+{
+    const Frame_Header & h = header(n);
+
+    Camera cam(h.fov, m_header.rows, m_header.cols);
+    cam.set_position(std::make_tuple(h.position[0], h.position[1], h.position[2]));
+    cam.set_yaw(h.yaw);
+    cam.set_pitch(h.pitch);
+
+    return cam;
+}
+
+
+double Range_Sequence_Reader::timestamp(const uint64_t n) const
+{
+    return header(n).timestamp;
+}
+
+
+const Frame_Header & Range_Sequence_Reader::header(const uint64_t n) const
+{
+    if (n >= m_index.size()) {
+        std::stringstream msg;
+        msg << "Frame " << n << " out of range for sequence with " << m_index.size() << " frames";
+        throw std::out_of_range(msg.str());
+    }
+
+    const uint64_t offset = m_index[n];
+    const Frame_Header * h = reinterpret_cast<const Frame_Header *>(m_mapping.get() + offset);
+    if (offset + sizeof(Frame_Header) > m_length
+            || h->magic != range_sequence::FRAME_MAGIC
+            || offset + sizeof(Frame_Header) + h->payload_bytes > m_length) {
+        std::stringstream msg;
+        msg << "Range sequence is corrupt - frame " << n << " is invalid";
+        throw std::runtime_error(msg.str());
+    }
+
+    return *h;
+}
+
+
+Buffer Range_Sequence_Reader::decode(const uint64_t n) const
+{
+    if (m_decoder == nullptr) {
+        m_decoder = std::unique_ptr<Range_Decoder>(
+            new Range_Decoder(m_header.rows, m_header.cols));
+    }
+
+    // Walk back to a keyframe, unless the last frame decoded gets us there sooner
+    uint64_t start = n;
+    while (true) {
+        if (m_decoded >= 0 && static_cast<uint64_t>(m_decoded) + 1 == start) {
+            break;
+        }
+
+        const Frame_Header & h = header(start);
+        const uint8_t * payload = reinterpret_cast<const uint8_t *>(
+            m_mapping.get() + m_index[start] + sizeof(Frame_Header));
+
+        if (h.encoding == Range_Encoding::DELTA
+                && Range_Decoder::is_keyframe(payload, h.payload_bytes)) {
+            break;
+        }
+
+        if (start == 0) {
+            std::stringstream msg;
+            msg << "Range sequence is corrupt - no keyframe precedes frame " << n;
+            throw std::runtime_error(msg.str());
+        }
+        start--;
+    }
+
+    Buffer rng(m_header.rows, m_header.cols);
+    m_decoded = -1;
+    for (uint64_t f = start; f <= n; f++) {
+        const Frame_Header & h = header(f);
+        if (h.encoding != Range_Encoding::DELTA) {
+            std::stringstream msg;
+            msg << "Range sequence is corrupt - frame " << f << " interrupts a run of "
+                << "compressed frames";
+            throw std::runtime_error(msg.str());
+        }
+
+        const uint8_t * payload = reinterpret_cast<const uint8_t *>(
+            m_mapping.get() + m_index[f] + sizeof(Frame_Header));
+        m_decoder->decode(payload, h.payload_bytes, rng);
+    }
+    m_decoded = n;
+
+    return rng;
+}
+
+
+void Range_Sequence_Reader::recover_index()
+{
+    m_index.clear();
+
+    uint64_t offset = sizeof(File_Header);
+    while (offset + sizeof(Frame_Header) <= m_length) {
+        const Frame_Header * h = reinterpret_cast<const Frame_Header *>(m_mapping.get() + offset);
+        const uint64_t end = offset + sizeof(Frame_Header) + h->payload_bytes;
+
+        // Stop at the first record that was only partially written
+        if (h->magic != range_sequence::FRAME_MAGIC || end > m_length) {
+            break;
+        }
+
+        m_index.push_back(offset);
+        offset = _align(end);
+    }
+}
+
+}
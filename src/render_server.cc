@@ -0,0 +1,597 @@
+//! @file       render_server.cc
+//! @brief      Defines the Render_Server type, which keeps terrains and calculators warm and
+//!             answers requests over Unix domain sockets
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "buffer.h"
+#include "camera.h"
+#include "device_buffer.h"
+#include "line_of_sight.h"
+#include "range_calculator.h"
+#include "range_quantization.h"
+#include "render_server.h"
+#include "terrain.h"
+
+// Standard Imports
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Third-Party Imports
+#include "cl.hpp"
+
+
+namespace clarity
+{
+
+using namespace server_protocol;
+
+//! @brief  How often the accept loop checks for a stop, in milliseconds
+static constexpr int _POLL_MS = 200;
+
+//! @brief  The largest focal plane a RENDER may ask for, in pixels on a side
+static constexpr uint32_t _MAX_RENDER_DIM = 8192;
+
+
+//! @brief  Read exactly n bytes
+//!
+//! @return false at the end of the stream or on an error
+static bool _read_full(const int fd, void * dst, size_t n)
+{
+    char * p = static_cast<char *>(dst);
+    while (n > 0) {
+        const ssize_t got = ::read(fd, p, n);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return false;
+        }
+
+        p += got;
+        n -= got;
+    }
+
+    return true;
+}
+
+
+//! @brief  Write all of a buffer
+//!
+//! @return false if the peer has gone
+static bool _write_full(const int fd, const std::vector<char> & bytes)
+{
+    const char * p = bytes.data();
+    size_t n = bytes.size();
+    while (n > 0) {
+        const ssize_t sent = ::send(fd, p, n, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+
+        p += sent;
+        n -= sent;
+    }
+
+    return true;
+}
+
+
+//! @brief  Copy an image of rows rows, turning it upside down if it runs bottom-up
+static void _copy_rows(const void * src,
+                       char * dst,
+                       const uint32_t rows,
+                       const size_t row_bytes,
+                       const bool bottom_up)
+{
+    if (! bottom_up) {
+        std::memcpy(dst, src, rows * row_bytes);
+        return;
+    }
+
+    const char * from = static_cast<const char *>(src);
+    for (uint32_t r = 0; r < rows; r++) {
+        std::memcpy(dst + (rows - 1 - r) * row_bytes, from + r * row_bytes, row_bytes);
+    }
+}
+
+
+//! @brief  Read a terrain file written by the terrain or noise tool
+static Terrain _read_terrain(const std::string & path)
+{
+    struct stat results;
+    if (stat(path.c_str(), &results) != 0) {
+        throw std::invalid_argument("Terrain file (" + path + ") does not exist");
+    }
+
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    uint32_t size = 0;
+    float scale = 0.0f;
+    in.read(reinterpret_cast<char *>(&size), 4);
+    in.read(reinterpret_cast<char *>(&scale), 4);
+
+    const uint64_t expected = static_cast<uint64_t>(size) * size * 4 + 8;
+    if (! in.good() || static_cast<uint64_t>(results.st_size) != expected || size == 0) {
+        throw std::invalid_argument("(" + path + ") is not a terrain file (inconsistent size)");
+    }
+
+    auto b = std::make_shared<Buffer>(size, size);
+    in.read(reinterpret_cast<char *>(b->data().get()),
+            static_cast<std::streamsize>(expected - 8));
+    if (! in.good()) {
+        throw std::runtime_error("Failed to read terrain file (" + path + ")");
+    }
+
+    return Terrain(b, scale);
+}
+
+
+char * Render_Server::Reply::payload()
+{
+    return bytes.data() + sizeof(Message_Header);
+}
+
+
+Render_Server::Render_Server(std::unique_ptr<Range_Calculator> calculator,
+                             std::unique_ptr<Line_Of_Sight> los,
+                             const std::shared_ptr<cl::Context> ctx)
+    : m_ctx(ctx)
+    , m_calculator(std::move(calculator))
+    , m_los(std::move(los))
+    , m_range()
+    , m_codes()
+    , m_load_mutex()
+    , m_terrain_mutex()
+    , m_terrains()
+    , m_paths()
+    , m_job_mutex()
+    , m_queued()
+    , m_jobs()
+    , m_stopping(false)
+    , m_connection_mutex()
+    , m_connections()
+    , m_finished()
+    , m_next_connection(0)
+    , m_dispatcher()
+{
+    if (m_calculator == nullptr || m_los == nullptr) {
+        throw std::invalid_argument("Render_Server requires a calculator and a line of sight");
+    }
+
+    m_dispatcher = std::thread(&Render_Server::dispatch, this);
+}
+
+
+Render_Server::~Render_Server()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_job_mutex);
+        m_stopping = true;
+    }
+    m_queued.notify_all();
+    m_dispatcher.join();
+}
+
+
+Terrain_Info Render_Server::load(const std::string & path)
+{
+    // Loads are serialized, so two clients asking for one path load it once
+    std::lock_guard<std::mutex> lock(m_load_mutex);
+    {
+        std::lock_guard<std::mutex> terrain_lock(m_terrain_mutex);
+        const auto it = m_paths.find(path);
+        if (it != m_paths.end()) {
+            return info(it->second);
+        }
+    }
+
+    Terrain t = _read_terrain(path);
+    if (m_ctx != nullptr) {
+        // The OpenCL walkers read the height map where it lives, so it is uploaded once here
+        auto db = std::make_shared<Device_Buffer>(t.data(), *m_ctx, true);
+        db->to_device();
+        t = Terrain(db, t.scale());
+    }
+    t.build_pyramid();
+
+    std::lock_guard<std::mutex> terrain_lock(m_terrain_mutex);
+    m_terrains.push_back(t);
+    m_paths[path] = static_cast<uint32_t>(m_terrains.size() - 1);
+    return info(static_cast<uint32_t>(m_terrains.size() - 1));
+}
+
+
+void Render_Server::serve_connection(const int fd)
+{
+    Message_Header h;
+    std::vector<char> payload;
+    while (_read_full(fd, &h, sizeof(h))) {
+        if (h.magic != MAGIC || h.payload_bytes > MAX_PAYLOAD_BYTES) {
+            // The stream cannot be resynchronized, so answer once and hang up
+            send_reply(fd, h.id, error_reply("Malformed message header"));
+            return;
+        }
+
+        payload.resize(h.payload_bytes);
+        if (! _read_full(fd, payload.data(), payload.size())) {
+            return;
+        }
+
+        if (! send_reply(fd, h.id, request(h, payload))) {
+            return;
+        }
+    }
+}
+
+
+void Render_Server::serve(const std::string & socket_path, const std::atomic<bool> & stop)
+{
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(addr.sun_path)) {
+        throw std::invalid_argument("Socket path (" + socket_path + ") is too long");
+    }
+    std::memcpy(addr.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    // Replace the socket of a server that did not shut down cleanly, but nothing else
+    struct stat results;
+    if (lstat(socket_path.c_str(), &results) == 0) {
+        if (! S_ISSOCK(results.st_mode)) {
+            throw std::invalid_argument("(" + socket_path + ") exists and is not a socket");
+        }
+        ::unlink(socket_path.c_str());
+    }
+
+    const int listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listener < 0
+        || ::bind(listener, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0
+        || ::listen(listener, SOMAXCONN) != 0) {
+        std::stringstream msg;
+        msg << "Failed to listen on (" << socket_path << ") (" << std::strerror(errno) << ")";
+        if (listener >= 0) {
+            ::close(listener);
+        }
+        throw std::runtime_error(msg.str());
+    }
+
+    while (! stop) {
+        pollfd p { listener, POLLIN, 0 };
+        const int ready = ::poll(&p, 1, _POLL_MS);
+        reap();
+
+        if (ready <= 0) {
+            continue;
+        }
+
+        const int fd = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(m_connection_mutex);
+        const uint64_t id = m_next_connection++;
+        Connection & c = m_connections[id];
+        c.fd = fd;
+        c.thread = std::thread(&Render_Server::connection, this, id, fd);
+    }
+
+    ::close(listener);
+    ::unlink(socket_path.c_str());
+
+    // Wake the connection threads blocked on their clients
+    {
+        std::lock_guard<std::mutex> lock(m_connection_mutex);
+        for (auto & entry : m_connections) {
+            if (entry.second.fd >= 0) {
+                ::shutdown(entry.second.fd, SHUT_RDWR);
+            }
+        }
+    }
+
+    for (auto & entry : m_connections) {
+        entry.second.thread.join();
+    }
+    m_connections.clear();
+    m_finished.clear();
+}
+
+
+Render_Server::Reply Render_Server::make_reply(const size_t payload_bytes)
+{
+    return Reply { Status::OK, std::vector<char>(sizeof(Message_Header) + payload_bytes) };
+}
+
+
+Render_Server::Reply Render_Server::error_reply(const std::string & message)
+{
+    Reply reply = make_reply(message.size());
+    reply.status = Status::ERROR;
+    std::memcpy(reply.payload(), message.data(), message.size());
+    return reply;
+}
+
+
+Terrain_Info Render_Server::info(const uint32_t handle) const
+{
+    const Terrain & t = m_terrains[handle];
+    return Terrain_Info { handle, t.data().size().first, t.data().size().second, t.scale() };
+}
+
+
+Terrain Render_Server::terrain(const uint32_t handle)
+{
+    std::lock_guard<std::mutex> lock(m_terrain_mutex);
+    if (handle >= m_terrains.size()) {
+        std::stringstream msg;
+        msg << "Unknown terrain (" << handle << ")";
+        throw std::out_of_range(msg.str());
+    }
+
+    return m_terrains[handle];
+}
+
+
+void Render_Server::connection(const uint64_t id, const int fd)
+{
+    serve_connection(fd);
+
+    std::lock_guard<std::mutex> lock(m_connection_mutex);
+    ::close(fd);
+    m_connections[id].fd = -1;
+    m_finished.push_back(id);
+}
+
+
+bool Render_Server::send_reply(const int fd, const uint32_t id, Reply reply)
+{
+    const Message_Header h { MAGIC,
+                             reply.status,
+                             id,
+                             static_cast<uint32_t>(reply.bytes.size() - sizeof(Message_Header)) };
+    std::memcpy(reply.bytes.data(), &h, sizeof(h));
+    return _write_full(fd, reply.bytes);
+}
+
+
+Render_Server::Reply Render_Server::request(const Message_Header & h,
+                                            const std::vector<char> & payload)
+{
+    try {
+        if (h.type == Request_Type::LOAD_TERRAIN) {
+            const Terrain_Info terrain_info = load(std::string(payload.begin(), payload.end()));
+            Reply reply = make_reply(sizeof(terrain_info));
+            std::memcpy(reply.payload(), &terrain_info, sizeof(terrain_info));
+            return reply;
+        }
+
+        auto job = std::make_shared<Job>();
+        job->type = h.type;
+        if (h.type == Request_Type::RENDER) {
+            if (payload.size() != sizeof(Render_Request)) {
+                throw std::invalid_argument("RENDER payload has the wrong size");
+            }
+            std::memcpy(&job->render, payload.data(), sizeof(Render_Request));
+            job->terrain = job->render.terrain;
+
+            const Render_Request & r = job->render;
+            if (r.rows == 0 || r.cols == 0 || r.rows > _MAX_RENDER_DIM || r.cols > _MAX_RENDER_DIM
+                || ! (r.fov > 0.0f && r.fov < M_PI)) {
+                throw std::invalid_argument("RENDER size or field of view is out of range");
+            }
+        } else if (h.type == Request_Type::LINE_OF_SIGHT) {
+            Los_Request los;
+            if (payload.size() < sizeof(los)) {
+                throw std::invalid_argument("LINE_OF_SIGHT payload is too short");
+            }
+            std::memcpy(&los, payload.data(), sizeof(los));
+            const uint64_t points_bytes = static_cast<uint64_t>(los.count) * 6 * sizeof(float);
+            if (payload.size() != sizeof(los) + points_bytes) {
+                throw std::invalid_argument("LINE_OF_SIGHT payload does not match its count");
+            }
+            job->terrain = los.terrain;
+
+            std::vector<float> points(static_cast<size_t>(los.count) * 6);
+            std::memcpy(points.data(), payload.data() + sizeof(los), points_bytes);
+            for (uint32_t i = 0; i < los.count; i++) {
+                const float * o = points.data() + 3 * i;
+                const float * t = points.data() + 3 * (los.count + i);
+                job->observers.emplace_back(o[0], o[1], o[2]);
+                job->targets.emplace_back(t[0], t[1], t[2]);
+            }
+        } else {
+            std::stringstream msg;
+            msg << "Unknown request type (" << h.type << ")";
+            throw std::invalid_argument(msg.str());
+        }
+
+        // Fail fast on a bad handle, rather than in the middle of a batch
+        terrain(job->terrain);
+
+        std::future<Reply> reply = job->reply.get_future();
+        {
+            std::lock_guard<std::mutex> lock(m_job_mutex);
+            m_jobs.push_back(job);
+        }
+        m_queued.notify_one();
+
+        return reply.get();
+    } catch (const std::exception & e) {
+        return error_reply(e.what());
+    }
+}
+
+
+void Render_Server::dispatch()
+{
+    std::vector<std::shared_ptr<Job>> batch;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_job_mutex);
+            m_queued.wait(lock, [this] { return m_stopping || ! m_jobs.empty(); });
+            if (m_jobs.empty()) {
+                return;
+            }
+
+            batch.assign(m_jobs.begin(), m_jobs.end());
+            m_jobs.clear();
+        }
+
+        // Jobs for one terrain run together, in the order they arrived
+        std::stable_sort(batch.begin(), batch.end(),
+                         [](const std::shared_ptr<Job> & a, const std::shared_ptr<Job> & b) {
+                             return a->terrain < b->terrain;
+                         });
+
+        size_t first = 0;
+        while (first < batch.size()) {
+            size_t end = first;
+            while (end < batch.size() && batch[end]->terrain == batch[first]->terrain) {
+                end++;
+            }
+
+            run_terrain(batch, first, end);
+            first = end;
+        }
+
+        batch.clear();
+    }
+}
+
+
+void Render_Server::run_terrain(const std::vector<std::shared_ptr<Job>> & batch,
+                                const size_t first,
+                                const size_t end)
+{
+    std::vector<Job *> los_jobs;
+    std::vector<Line_Of_Sight::Point> observers;
+    std::vector<Line_Of_Sight::Point> targets;
+    for (size_t i = first; i < end; i++) {
+        Job & job = *batch[i];
+        if (job.type == Request_Type::LINE_OF_SIGHT) {
+            los_jobs.push_back(&job);
+            observers.insert(observers.end(), job.observers.begin(), job.observers.end());
+            targets.insert(targets.end(), job.targets.begin(), job.targets.end());
+            continue;
+        }
+
+        try {
+            job.reply.set_value(render(terrain(job.terrain), job.render));
+        } catch (const std::exception & e) {
+            job.reply.set_value(error_reply(e.what()));
+        }
+    }
+
+    if (los_jobs.empty()) {
+        return;
+    }
+
+    // Every query of the terrain goes to the walker as one batch
+    std::vector<uint8_t> visible;
+    std::vector<float> distance;
+    try {
+        m_los->Check(terrain(batch[first]->terrain), observers, targets, visible, distance);
+    } catch (const std::exception & e) {
+        for (Job * job : los_jobs) {
+            job->reply.set_value(error_reply(e.what()));
+        }
+        return;
+    }
+
+    size_t offset = 0;
+    for (Job * job : los_jobs) {
+        const size_t n = job->observers.size();
+        Reply reply = make_reply(n * (sizeof(float) + 1));
+        char * out = reply.payload();
+        std::memcpy(out, distance.data() + offset, n * sizeof(float));
+        std::memcpy(out + n * sizeof(float), visible.data() + offset, n);
+        job->reply.set_value(std::move(reply));
+        offset += n;
+    }
+}
+
+
+Render_Server::Reply Render_Server::render(const Terrain & t, const Render_Request & r)
+{
+    Camera cam(r.fov, r.rows, r.cols);
+    cam.set_position(std::make_tuple(r.position[0], r.position[1], r.position[2]));
+    cam.set_yaw(r.yaw);
+    cam.set_pitch(r.pitch);
+
+    // Every reply runs top-down, whichever way the calculator keeps its image
+    const bool bottom_up = m_calculator->rows_bottom_up();
+
+    const size_t n = static_cast<size_t>(r.rows) * r.cols;
+    if (r.quantized) {
+        // Cover every range the calculator can return
+        const Range_Quantization q =
+            range_quantization::covering(0.0f, Range_Calculator::max_range(t));
+        m_calculator->Calculate_Quantized(cam, t, q, m_codes);
+
+        Reply reply = make_reply(sizeof(q) + n * sizeof(uint16_t));
+        char * out = reply.payload();
+        std::memcpy(out, &q.offset, sizeof(float));
+        std::memcpy(out + sizeof(float), &q.step, sizeof(float));
+        _copy_rows(m_codes.data(), out + sizeof(q), r.rows, r.cols * sizeof(uint16_t), bottom_up);
+        return reply;
+    }
+
+    if (m_range == nullptr || m_range->size() != std::make_pair(r.rows, r.cols)) {
+        m_range = m_ctx != nullptr
+                ? std::unique_ptr<Buffer>(new Device_Buffer(*m_ctx, r.rows, r.cols))
+                : std::unique_ptr<Buffer>(new Buffer(r.rows, r.cols));
+    }
+    m_calculator->Calculate(cam, t, *m_range);
+
+    Reply reply = make_reply(n * sizeof(float));
+    _copy_rows(m_range->data().get(), reply.payload(), r.rows, r.cols * sizeof(float), bottom_up);
+    return reply;
+}
+
+
+void Render_Server::reap()
+{
+    std::vector<std::thread> done;
+    {
+        std::lock_guard<std::mutex> lock(m_connection_mutex);
+        for (const uint64_t id : m_finished) {
+            done.push_back(std::move(m_connections[id].thread));
+            m_connections.erase(id);
+        }
+        m_finished.clear();
+    }
+
+    for (auto & t : done) {
+        t.join();
+    }
+}
+
+}
@@ -0,0 +1,249 @@
+//! @file       residency_manager.cc
+//! @brief      Defines the Residency_Manager type, which keeps device copies of host Buffers
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "buffer.h"
+#include "device_buffer.h"
+#include "residency_manager.h"
+
+// Standard Imports
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+
+// Third-Party Imports
+#include "cl.hpp"
+
+
+namespace clarity
+{
+
+//! @brief  Get the address that identifies the memory of a Buffer
+static const float * _key(const Buffer & b)
+{
+    return const_cast<Buffer &>(b).data().get();
+}
+
+
+//! @brief  Get the size of a Buffer, in bytes
+static size_t _bytes(const Buffer & b)
+{
+    return size_t(b.size().first) * b.size().second * b.depth() * sizeof(float);
+}
+
+
+//! @brief  Check whether two Buffers have the same shape
+static bool _same_shape(const Buffer & a, const Buffer & b)
+{
+    return a.size() == b.size() && a.depth() == b.depth();
+}
+
+
+Residency_Manager::Residency_Manager(const std::shared_ptr<cl::Context> ctx,
+                                     const size_t budget_bytes)
+    : m_ctx(ctx)
+    , m_mutex()
+    , m_budget(budget_bytes)
+    , m_resident(0)
+    , m_uploads(0)
+    , m_uploaded_bytes(0)
+    , m_entries()
+    , m_lru()
+{
+    // No-op
+}
+
+
+Residency_Manager::~Residency_Manager()
+{
+    // No-op
+}
+
+
+std::shared_ptr<Device_Buffer> Residency_Manager::acquire(const Buffer & b,
+                                                          const cl::CommandQueue * queue)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    prune();
+
+    const float * key = _key(b);
+    auto it = m_entries.find(key);
+
+    // A view of the same memory with another shape needs its own copy
+    if (it != m_entries.end() && ! _same_shape(*it->second.device, b)) {
+        drop(it);
+        it = m_entries.end();
+    }
+
+    if (it == m_entries.end()) {
+        const size_t bytes = _bytes(b);
+        make_room(bytes, key);
+
+        std::shared_ptr<Device_Buffer> device = std::make_shared<Device_Buffer>(b, *m_ctx);
+        m_lru.push_front(key);
+        it = m_entries.emplace(key, Entry { device, bytes, HOST_DIRTY, m_lru.begin() }).first;
+        m_resident += bytes;
+    } else {
+        m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+    }
+
+    Entry & entry = it->second;
+    if (entry.state == HOST_DIRTY) {
+        entry.device->to_device(queue);
+        entry.state = CLEAN;
+        m_uploads++;
+        m_uploaded_bytes += entry.bytes;
+    } else {
+        // Only the rectangles this device copy has not seen are sent
+        const size_t cells = entry.device->to_device_dirty(queue);
+        if (cells > 0) {
+            m_uploads++;
+            m_uploaded_bytes += cells * entry.device->depth() * sizeof(float);
+        }
+    }
+
+    return entry.device;
+}
+
+
+void Residency_Manager::mark_host_dirty(const Buffer & b)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(_key(b));
+    if (it != m_entries.end()) {
+        it->second.state = HOST_DIRTY;
+    }
+}
+
+
+void Residency_Manager::mark_device_dirty(const Buffer & b)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(_key(b));
+    if (it != m_entries.end()) {
+        it->second.state = DEVICE_DIRTY;
+    }
+}
+
+
+void Residency_Manager::to_host(const Buffer & b, const cl::CommandQueue * queue)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(_key(b));
+    if (it != m_entries.end() && it->second.state == DEVICE_DIRTY) {
+        it->second.device->from_device(queue);
+        it->second.state = CLEAN;
+    }
+}
+
+
+void Residency_Manager::evict(const Buffer & b)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(_key(b));
+    if (it != m_entries.end()) {
+        drop(it);
+    }
+}
+
+
+bool Residency_Manager::is_resident(const Buffer & b) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.count(_key(b)) > 0;
+}
+
+
+void Residency_Manager::set_budget(const size_t budget_bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_budget = budget_bytes;
+    make_room(0, nullptr);
+}
+
+
+size_t Residency_Manager::budget() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_budget;
+}
+
+
+size_t Residency_Manager::resident_bytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_resident;
+}
+
+
+uint64_t Residency_Manager::uploads() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_uploads;
+}
+
+
+uint64_t Residency_Manager::uploaded_bytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_uploaded_bytes;
+}
+
+
+void Residency_Manager::drop(std::map<const float *, Entry>::iterator it)
+{
+    Entry & entry = it->second;
+    if (entry.state == DEVICE_DIRTY) {
+        entry.device->from_device();
+    }
+
+    m_resident -= entry.bytes;
+    m_lru.erase(entry.lru);
+    m_entries.erase(it);
+}
+
+
+void Residency_Manager::prune()
+{
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        // One reference from the device copy, one from the temporary returned by data()
+        const bool orphaned = it->second.device.use_count() == 1
+                           && it->second.device->data().use_count() <= 2;
+        if (orphaned) {
+            m_resident -= it->second.bytes;
+            m_lru.erase(it->second.lru);
+            it = m_entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+
+void Residency_Manager::make_room(const size_t extra, const float * keep)
+{
+    if (m_budget == 0) {
+        return;
+    }
+
+    // Walk from the least recently acquired end. Dropping an entry leaves next valid.
+    auto next = m_lru.end();
+    while (m_resident + extra > m_budget && next != m_lru.begin()) {
+        const auto victim = std::prev(next);
+        if (*victim == keep) {
+            next = victim;
+            continue;
+        }
+
+        drop(m_entries.find(*victim));
+    }
+}
+
+}
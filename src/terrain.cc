@@ -6,14 +6,18 @@
 
 // Clarity Imports
 #include "buffer.h"
+#include "procedural_terrain.h"
 #include "terrain.h"
+#include "terrain_pyramid.h"
 
 // Standard Imports
 #include <algorithm>
 #include <cstdint>
 #include <exception>
+#include <functional>
 #include <memory>
 #include <sstream>
+#include <stdexcept>
 
 // Third-Party Imports
 
@@ -22,7 +26,9 @@ namespace clarity
 
 Terrain::Terrain(const uint32_t rows, const uint32_t cols, const float scale_m_per_cell)
     : m_buffer(new Buffer(rows, cols))
+    , m_source()
     , m_scale_m_per_cell(scale_m_per_cell)
+    , m_pyramid()
 {
     // No-op
 }
@@ -30,12 +36,28 @@ Terrain::Terrain(const uint32_t rows, const uint32_t cols, const float scale_m_p
 
 Terrain::Terrain(std::shared_ptr<Buffer> buffer, const float scale_m_per_cell)
     : m_buffer(buffer)
+    , m_source()
     , m_scale_m_per_cell(scale_m_per_cell)
+    , m_pyramid()
 {
     // No-op
 }
 
 
+Terrain::Terrain(std::shared_ptr<Procedural_Terrain> source)
+    : m_buffer()
+    , m_source(source)
+    , m_scale_m_per_cell(0.0f)
+    , m_pyramid()
+{
+    if (m_source == nullptr) {
+        throw std::invalid_argument("Cannot construct a Terrain around a null source");
+    }
+
+    m_scale_m_per_cell = m_source->params().scale;
+}
+
+
 Terrain::~Terrain()
 {
     // No-op
@@ -44,7 +66,9 @@ Terrain::~Terrain()
 
 Terrain::Terrain(const Terrain & other)
     : m_buffer(other.m_buffer)
+    , m_source(other.m_source)
     , m_scale_m_per_cell(other.scale())
+    , m_pyramid(other.m_pyramid)
 {
     // No-op 
 }
@@ -57,27 +81,78 @@ Terrain & Terrain::operator=(const Terrain & other)
     }
 
     m_buffer = other.m_buffer;
+    m_source = other.m_source;
     m_scale_m_per_cell = other.scale();
+    m_pyramid = other.m_pyramid;
 
     return *this;
 }
 
 
+//! @brief  Throw if a Terrain has no buffer
+static void _check_buffer(const std::shared_ptr<Buffer> & buffer)
+{
+    if (buffer == nullptr) {
+        throw std::runtime_error("A procedural Terrain has no buffer");
+    }
+}
+
+
 const Buffer & Terrain::data() const
 {
+    _check_buffer(m_buffer);
     return *m_buffer;
 }
 
 
 Buffer & Terrain::data()
 {
+    _check_buffer(m_buffer);
     return *m_buffer;
 }
 
 
+std::shared_ptr<Procedural_Terrain> Terrain::procedural() const
+{
+    return m_source;
+}
+
+
 float Terrain::scale() const
 {
     return m_scale_m_per_cell;
 }
 
+
+
+void Terrain::build_pyramid(const uint32_t max_levels)
+{
+    _check_buffer(m_buffer);
+    m_pyramid = std::make_shared<Terrain_Pyramid>(*m_buffer, max_levels);
+}
+
+
+std::shared_ptr<Terrain_Pyramid> Terrain::pyramid() const
+{
+    return m_pyramid;
+}
+
+
+void Terrain::edit(const Buffer::Region & region, const Cell_Editor & editor)
+{
+    _check_buffer(m_buffer);
+
+    // Recording the rectangle first also checks that it is inside the buffer
+    m_buffer->mark_dirty(region);
+    for (uint32_t r = region.row; r < region.row + region.rows; r++) {
+        for (uint32_t c = region.col; c < region.col + region.cols; c++) {
+            editor(r, c, m_buffer->at(r, c));
+        }
+    }
+
+    if (m_pyramid != nullptr) {
+        m_pyramid->refit(*m_buffer, region);
+    }
+}
+
 }
@@ -0,0 +1,260 @@
+//! @file       terrain_pyramid.cc
+//! @brief      Defines the Terrain_Pyramid type, a stack of downsampled height maps used to
+//!             walk distant rays at a coarser level of detail
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "buffer.h"
+#include "terrain_pyramid.h"
+
+// Standard Imports
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Third-Party Imports
+
+namespace clarity
+{
+
+//! @brief  Get the size of every level of a pyramid over a height map, including level 0
+static std::vector<std::pair<uint32_t, uint32_t>> _level_sizes(const Buffer & heights,
+                                                               const uint32_t max_levels)
+{
+    if (heights.depth() != 1) {
+        std::stringstream msg;
+        msg << "A Terrain_Pyramid requires a height map of depth 1 (got depth "
+            << static_cast<int>(heights.depth()) << ")";
+        throw std::invalid_argument(msg.str());
+    }
+
+    std::vector<std::pair<uint32_t, uint32_t>> sizes { heights.size() };
+
+    while (sizes.back().first > 1 || sizes.back().second > 1) {
+        if (max_levels != 0 && sizes.size() > max_levels) {
+            break;
+        }
+
+        sizes.emplace_back((sizes.back().first + 1) / 2, (sizes.back().second + 1) / 2);
+    }
+
+    return sizes;
+}
+
+
+//! @brief  Get the offset of each level in the packed buffer, followed by the total size
+static std::vector<size_t> _level_offsets(const std::vector<std::pair<uint32_t, uint32_t>> & sizes)
+{
+    std::vector<size_t> offsets { 0, 0 };
+
+    for (size_t l = 1; l < sizes.size(); l++) {
+        offsets.push_back(offsets.back() + static_cast<size_t>(sizes[l].first) * sizes[l].second);
+    }
+
+    return offsets;
+}
+
+
+Terrain_Pyramid::Terrain_Pyramid(const Buffer & heights, const uint32_t max_levels)
+    : m_sizes(_level_sizes(heights, max_levels))
+    , m_offsets(_level_offsets(m_sizes))
+    , m_packed(static_cast<uint32_t>(std::max<size_t>(m_offsets.back(), 1)), 1, 2)
+    , m_version(0)
+{
+    // The total size is only needed to allocate the packed buffer
+    m_offsets.pop_back();
+
+    rebuild(heights);
+}
+
+
+Terrain_Pyramid::~Terrain_Pyramid()
+{
+    // No-op
+}
+
+
+void Terrain_Pyramid::rebuild(const Buffer & heights)
+{
+    check_heights(heights);
+
+    for (uint32_t l = 1; l <= levels(); l++) {
+        fit(heights, l, Buffer::Region { 0, 0, m_sizes[l].first, m_sizes[l].second });
+    }
+
+    const uint32_t cells = m_packed.size().first;
+    m_packed.mark_dirty(Buffer::Region { 0, 0, cells, 1 });
+    m_version++;
+}
+
+
+void Terrain_Pyramid::refit(const Buffer & heights, const Buffer::Region & region)
+{
+    check_heights(heights);
+
+    const uint64_t row_end = uint64_t(region.row) + region.rows;
+    const uint64_t col_end = uint64_t(region.col) + region.cols;
+    if (row_end > m_sizes[0].first || col_end > m_sizes[0].second) {
+        std::stringstream msg;
+        msg << "Region (" << region.row << ", " << region.col << ") of size (" << region.rows
+            << ", " << region.cols << ") out of range for a Terrain_Pyramid of size ("
+            << m_sizes[0].first << ", " << m_sizes[0].second << ")";
+        throw std::out_of_range(msg.str());
+    }
+
+    if (region.rows == 0 || region.cols == 0) {
+        return;
+    }
+
+    Buffer::Region cells = region;
+    for (uint32_t l = 1; l <= levels(); l++) {
+        cells = parent(cells);
+        fit(heights, l, cells);
+
+        // The rows of the rectangle, and the columns between them, are one run of packed()
+        const size_t cols = m_sizes[l].second;
+        const size_t first = m_offsets[l] + cells.row * cols + cells.col;
+        const size_t last = m_offsets[l] + (cells.row + cells.rows - 1) * cols
+                          + cells.col + cells.cols - 1;
+        m_packed.mark_dirty(Buffer::Region { static_cast<uint32_t>(first),
+                                             0,
+                                             static_cast<uint32_t>(last - first + 1),
+                                             1 });
+    }
+
+    m_version++;
+}
+
+
+Buffer::Region Terrain_Pyramid::parent(const Buffer::Region & region)
+{
+    const uint32_t row = region.row / 2;
+    const uint32_t col = region.col / 2;
+    const uint32_t row_end = (region.row + region.rows + 1) / 2;
+    const uint32_t col_end = (region.col + region.cols + 1) / 2;
+    return Buffer::Region { row, col, row_end - row, col_end - col };
+}
+
+
+void Terrain_Pyramid::fit(const Buffer & heights, const uint32_t l, const Buffer::Region & region)
+{
+    const float * src = &heights.at(0, 0);
+    float * packed = m_packed.data().get();
+
+    const uint32_t src_rows = m_sizes[l - 1].first;
+    const uint32_t src_cols = m_sizes[l - 1].second;
+    const uint32_t cols = m_sizes[l].second;
+    const float * below = packed + 2 * m_offsets[l - 1];
+    float * out = packed + 2 * m_offsets[l];
+
+    for (uint32_t r = region.row; r < region.row + region.rows; r++) {
+        const uint32_t r0 = 2 * r;
+        const uint32_t r1 = std::min(r0 + 1, src_rows - 1);
+
+        for (uint32_t c = region.col; c < region.col + region.cols; c++) {
+            const uint32_t c0 = 2 * c;
+            const uint32_t c1 = std::min(c0 + 1, src_cols - 1);
+            const size_t cells[4] = { static_cast<size_t>(r0) * src_cols + c0,
+                                      static_cast<size_t>(r0) * src_cols + c1,
+                                      static_cast<size_t>(r1) * src_cols + c0,
+                                      static_cast<size_t>(r1) * src_cols + c1 };
+
+            float lo = 0.0f;
+            float hi = 0.0f;
+            for (int i = 0; i < 4; i++) {
+                // Level 1 reads the height map; the others read the (min, max) below them
+                const float cell_lo = l == 1 ? src[cells[i]] : below[2 * cells[i]];
+                const float cell_hi = l == 1 ? src[cells[i]] : below[2 * cells[i] + 1];
+                lo = i == 0 ? cell_lo : std::min(lo, cell_lo);
+                hi = i == 0 ? cell_hi : std::max(hi, cell_hi);
+            }
+
+            out[2 * (static_cast<size_t>(r) * cols + c)] = lo;
+            out[2 * (static_cast<size_t>(r) * cols + c) + 1] = hi;
+        }
+    }
+}
+
+
+void Terrain_Pyramid::check_heights(const Buffer & heights) const
+{
+    if (heights.size() != m_sizes[0] || heights.depth() != 1) {
+        std::stringstream msg;
+        msg << "Cannot fit a Terrain_Pyramid of size (" << m_sizes[0].first << ", "
+            << m_sizes[0].second << ") to a height map of size (" << heights.size().first
+            << ", " << heights.size().second << ")";
+        throw std::invalid_argument(msg.str());
+    }
+}
+
+
+uint32_t Terrain_Pyramid::levels() const
+{
+    return static_cast<uint32_t>(m_sizes.size() - 1);
+}
+
+
+std::pair<uint32_t, uint32_t> Terrain_Pyramid::size(const uint32_t level) const
+{
+    if (level >= m_sizes.size()) {
+        std::stringstream msg;
+        msg << "Invalid pyramid level (" << level << "). Only (" << levels() << ") are available.";
+        throw std::out_of_range(msg.str());
+    }
+
+    return m_sizes[level];
+}
+
+
+size_t Terrain_Pyramid::offset(const uint32_t level) const
+{
+    if (level == 0 || level >= m_sizes.size()) {
+        std::stringstream msg;
+        msg << "Invalid pyramid level (" << level << "). Only (" << levels() << ") are available.";
+        throw std::out_of_range(msg.str());
+    }
+
+    return m_offsets[level];
+}
+
+
+float Terrain_Pyramid::min(const uint32_t level, const uint32_t row, const uint32_t col) const
+{
+    const size_t cell = m_offsets[level] + static_cast<size_t>(row) * m_sizes[level].second + col;
+    return m_packed.at(static_cast<uint32_t>(cell), 0, 0);
+}
+
+
+float Terrain_Pyramid::max(const uint32_t level, const uint32_t row, const uint32_t col) const
+{
+    const size_t cell = m_offsets[level] + static_cast<size_t>(row) * m_sizes[level].second + col;
+    return m_packed.at(static_cast<uint32_t>(cell), 0, 1);
+}
+
+
+float Terrain_Pyramid::lod_distance(const float focal_length, const float error_pixels)
+{
+    // The diagonal of a level 1 cell, divided by the footprint of budget pixels at unit range
+    return 2.0f * std::sqrt(2.0f) * focal_length / error_pixels;
+}
+
+
+const Buffer & Terrain_Pyramid::packed() const
+{
+    return m_packed;
+}
+
+
+uint64_t Terrain_Pyramid::version() const
+{
+    return m_version;
+}
+
+}
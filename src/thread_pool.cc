@@ -0,0 +1,209 @@
+//! @file       thread_pool.cc
+//! @brief      Defines the Thread_Pool type, which spreads loops over a fixed set of threads
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "numa.h"
+#include "thread_pool.h"
+
+// Standard Imports
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Third-Party Imports
+
+namespace clarity
+{
+
+//! The pool whose task the current thread is running, if any
+static thread_local const Thread_Pool * _current_pool = nullptr;
+
+
+Thread_Pool::Thread_Pool(const unsigned num_threads)
+    : m_workers()
+    , m_call_mutex()
+    , m_mutex()
+    , m_posted()
+    , m_finished()
+    , m_generation(0)
+    , m_active(0)
+    , m_stopping(false)
+    , m_task(nullptr)
+    , m_begin(0)
+    , m_end(0)
+    , m_chunk(1)
+    , m_next(0)
+    , m_error()
+{
+    unsigned total = num_threads;
+    if (total == 0) {
+        total = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // The calling thread is the last member of the pool
+    for (unsigned i = 1; i < total; i++) {
+        m_workers.emplace_back(&Thread_Pool::run, this);
+    }
+}
+
+
+Thread_Pool::Thread_Pool(const std::vector<unsigned> & cpus)
+    : m_workers()
+    , m_call_mutex()
+    , m_mutex()
+    , m_posted()
+    , m_finished()
+    , m_generation(0)
+    , m_active(0)
+    , m_stopping(false)
+    , m_task(nullptr)
+    , m_begin(0)
+    , m_end(0)
+    , m_chunk(1)
+    , m_next(0)
+    , m_error()
+{
+    if (cpus.empty()) {
+        throw std::invalid_argument("A pinned Thread_Pool needs at least one CPU");
+    }
+
+    // The calling thread stands in for the first CPU
+    for (size_t i = 1; i < cpus.size(); i++) {
+        const unsigned cpu = cpus[i];
+        m_workers.emplace_back([this, cpu]() {
+            numa::pin_thread({ cpu });
+            run();
+        });
+    }
+}
+
+
+Thread_Pool::~Thread_Pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_posted.notify_all();
+
+    for (auto & t : m_workers) {
+        t.join();
+    }
+}
+
+
+unsigned Thread_Pool::size() const
+{
+    return m_workers.size() + 1;
+}
+
+
+void Thread_Pool::parallel_for(const uint32_t begin,
+                               const uint32_t end,
+                               const Task & task,
+                               const uint32_t grain)
+{
+    if (end <= begin) {
+        return;
+    }
+
+    // Small loops, single threaded pools and nested loops are not worth waking anyone for
+    const uint32_t count = end - begin;
+    const uint32_t min_chunk = std::max(1u, grain);
+    if (m_workers.empty() || count <= min_chunk || _current_pool == this) {
+        task(begin, end);
+        return;
+    }
+
+    std::lock_guard<std::mutex> call_lock(m_call_mutex);
+
+    // A few chunks per thread evens out imbalance between chunks
+    const uint32_t target_chunks = size() * 4;
+    const uint32_t chunk = std::max(min_chunk, (count + target_chunks - 1) / target_chunks);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = &task;
+        m_begin = begin;
+        m_end = end;
+        m_chunk = chunk;
+        m_next = begin;
+        m_error = nullptr;
+        m_active = m_workers.size();
+        m_generation++;
+    }
+    m_posted.notify_all();
+
+    work();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_finished.wait(lock, [this] { return m_active == 0; });
+    m_task = nullptr;
+
+    if (m_error != nullptr) {
+        std::rethrow_exception(m_error);
+    }
+}
+
+
+void Thread_Pool::run()
+{
+    uint64_t seen = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_posted.wait(lock, [this, seen] { return m_stopping || m_generation != seen; });
+
+            if (m_stopping) {
+                return;
+            }
+
+            seen = m_generation;
+        }
+
+        work();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_active--;
+        }
+        m_finished.notify_one();
+    }
+}
+
+
+void Thread_Pool::work()
+{
+    const Thread_Pool * outer = _current_pool;
+    _current_pool = this;
+
+    while (true) {
+        const uint64_t start = m_next.fetch_add(m_chunk);
+        if (start >= m_end) {
+            break;
+        }
+
+        const uint64_t stop = std::min<uint64_t>(m_end, start + m_chunk);
+        try {
+            (*m_task)(static_cast<uint32_t>(start), static_cast<uint32_t>(stop));
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_error == nullptr) {
+                m_error = std::current_exception();
+            }
+        }
+    }
+
+    _current_pool = outer;
+}
+
+}
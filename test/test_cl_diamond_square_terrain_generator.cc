@@ -0,0 +1,60 @@
+//! @file       test_cl_diamond_square_terrain_generator.cc
+//! @brief      Unit tests for the CL_Diamond_Square_Generator type
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "buffer.h"
+#include "cl_diamond_square_terrain_generator.h"
+#include "cl_utils.h"
+#include "device_buffer.h"
+#include "diamond_square_terrain_generator.h"
+#include "terrain.h"
+
+// Standard Imports
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+// Third-Party Imports
+#include "cl.hpp"
+#include "gtest/gtest.h"
+
+namespace
+{
+
+using namespace clarity;
+
+static const uint32_t _SIZE = 513;
+
+
+TEST(cl_diamond_square, matches_cpu_generator)
+{
+    std::shared_ptr<cl::Context> ctx = get_context();
+    CL_Diamond_Square_Generator cl_generator(ctx, 99);
+    Diamond_Square_Generator cpu_generator(99);
+
+    Terrain actual = cl_generator.generate_terrain(_SIZE, _SIZE, 25.0f, 0.5f);
+    Terrain expected = cpu_generator.generate_terrain(_SIZE, _SIZE, 25.0f, 0.5f);
+
+    // The host copy is only made on request
+    Device_Buffer & db = dynamic_cast<Device_Buffer &>(actual.data());
+    db.from_device();
+
+    ASSERT_EQ(0, std::memcmp(expected.data().data().get(), db.data().get(),
+                             _SIZE * _SIZE * sizeof(float)));
+}
+
+
+TEST(cl_diamond_square, requires_device_buffer)
+{
+    std::shared_ptr<cl::Context> ctx = get_context();
+    CL_Diamond_Square_Generator generator(ctx, 1);
+
+    std::shared_ptr<Buffer> host(new Buffer(_SIZE, _SIZE));
+    ASSERT_THROW(generator.generate_terrain(host, 25.0f, 0.5f), std::invalid_argument);
+}
+
+}
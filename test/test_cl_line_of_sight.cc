@@ -0,0 +1,173 @@
+//! @file       test_cl_line_of_sight.cc
+//! @brief      Unit tests for the CL_Line_Of_Sight type
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+
+// CLarity Imports
+#include "cl_line_of_sight.h"
+#include "cl_utils.h"
+#include "cpu_line_of_sight.h"
+#include "device_buffer.h"
+#include "line_of_sight.h"
+#include "residency_manager.h"
+#include "terrain.h"
+
+// Standard Imports
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <tuple>
+#include <vector>
+
+// Third-Party Imports
+#include "cl.hpp"
+#include "gtest/gtest.h"
+
+namespace
+{
+
+using namespace clarity;
+
+
+TEST(cl_line_of_sight, matches_cpu)
+{
+    std::shared_ptr<cl::Context> ctx = get_context();
+
+    auto b = std::make_shared<Device_Buffer>(*ctx, 300, 200);
+    for (auto i = 0; i < 300; i++) {
+        for (auto j = 0; j < 200; j++) {
+            b->at(i, j) = 20.0f * std::sin(i / 17.0f) * std::cos(j / 11.0f);
+        }
+    }
+    b->to_device();
+
+    Terrain plain(b, 1.0f);
+    Terrain accelerated(b, 1.0f);
+    accelerated.build_pyramid();
+
+    std::mt19937 gen(11);
+    std::uniform_real_distribution<float> row(0.0f, 299.0f);
+    std::uniform_real_distribution<float> col(0.0f, 199.0f);
+    std::vector<Line_Of_Sight::Point> observers;
+    std::vector<Line_Of_Sight::Point> targets;
+    for (auto i = 0; i < 1000; i++) {
+        observers.emplace_back(row(gen), col(gen), 25.0f);
+        targets.emplace_back(row(gen), col(gen), 10.0f);
+    }
+
+    CPU_Line_Of_Sight cpu;
+    std::vector<uint8_t> expected_visible;
+    std::vector<float> expected_distance;
+    cpu.Check(plain, observers, targets, expected_visible, expected_distance);
+
+    CL_Line_Of_Sight los(ctx);
+    for (const Terrain * t : { &plain, &accelerated }) {
+        std::vector<uint8_t> visible;
+        std::vector<float> distance;
+        los.Check(*t, observers, targets, visible, distance);
+
+        ASSERT_EQ(observers.size(), visible.size());
+
+        // The device may round the steps differently, so allow a line that grazes the terrain
+        // to go either way
+        uint32_t mismatches = 0;
+        for (size_t i = 0; i < observers.size(); i++) {
+            if (visible[i] != expected_visible[i]) {
+                mismatches++;
+            } else {
+                ASSERT_NEAR(expected_distance[i], distance[i], 0.5f) << i;
+            }
+        }
+        ASSERT_LE(mismatches, 10u);
+    }
+}
+
+
+
+TEST(cl_line_of_sight, host_terrain_is_uploaded_once)
+{
+    std::shared_ptr<cl::Context> ctx = get_context();
+
+    // A plain host Buffer, rather than a Device_Buffer, with a wall across the middle
+    auto b = std::make_shared<Buffer>(100, 100);
+    for (auto i = 0; i < 100; i++) {
+        for (auto j = 0; j < 100; j++) {
+            b->at(i, j) = i == 50 ? 40.0f : 0.0f;
+        }
+    }
+    Terrain t(b, 1.0f);
+
+    const std::vector<Line_Of_Sight::Point> observers { Line_Of_Sight::Point(10.0f, 20.0f, 10.0f),
+                                                        Line_Of_Sight::Point(10.0f, 20.0f, 10.0f) };
+    const std::vector<Line_Of_Sight::Point> targets { Line_Of_Sight::Point(90.0f, 20.0f, 10.0f),
+                                                      Line_Of_Sight::Point(30.0f, 20.0f, 10.0f) };
+
+    // A manager shared with another object counts every upload between them
+    auto residency = std::make_shared<Residency_Manager>(ctx);
+    CL_Line_Of_Sight los(ctx);
+    los.set_residency(residency);
+    ASSERT_EQ(residency, los.residency());
+
+    std::vector<uint8_t> visible;
+    std::vector<float> distance;
+    los.Check(t, observers, targets, visible, distance);
+    los.Check(t, observers, targets, visible, distance);
+
+    ASSERT_EQ(1u, residency->uploads());
+    ASSERT_EQ(std::vector<uint8_t>({ 0, 1 }), visible);
+
+    // Lowering the wall is seen once it is recorded by an edit
+    t.edit(Buffer::Region { 50, 0, 1, 100 }, [](uint32_t, uint32_t, float & h) { h = 0.0f; });
+    los.Check(t, observers, targets, visible, distance);
+
+    ASSERT_EQ(2u, residency->uploads());
+    ASSERT_EQ(std::vector<uint8_t>({ 1, 1 }), visible);
+}
+
+
+
+TEST(cl_line_of_sight, refitted_pyramid_is_uploaded)
+{
+    std::shared_ptr<cl::Context> ctx = get_context();
+
+    auto b = std::make_shared<Device_Buffer>(*ctx, 128, 128);
+    for (auto i = 0; i < 128; i++) {
+        for (auto j = 0; j < 128; j++) {
+            b->at(i, j) = 0.0f;
+        }
+    }
+    b->to_device();
+    Terrain t(b, 1.0f);
+    t.build_pyramid();
+
+    const std::vector<Line_Of_Sight::Point> observers { Line_Of_Sight::Point(10.0f, 20.0f, 10.0f),
+                                                        Line_Of_Sight::Point(10.0f, 90.0f, 10.0f) };
+    const std::vector<Line_Of_Sight::Point> targets { Line_Of_Sight::Point(110.0f, 20.0f, 10.0f),
+                                                      Line_Of_Sight::Point(110.0f, 90.0f, 10.0f) };
+
+    CL_Line_Of_Sight los(ctx);
+    std::vector<uint8_t> visible;
+    std::vector<float> distance;
+    los.Check(t, observers, targets, visible, distance);
+    ASSERT_EQ(std::vector<uint8_t>({ 1, 1 }), visible);
+
+    // A wall across the first line refits the pyramid above it, and the walk must see both
+    t.edit(Buffer::Region { 60, 10, 4, 20 }, [](uint32_t, uint32_t, float & h) { h = 50.0f; });
+    los.Check(t, observers, targets, visible, distance);
+    ASSERT_EQ(std::vector<uint8_t>({ 0, 1 }), visible);
+
+    // The same as a walker that uploads the edited pyramid whole
+    CL_Line_Of_Sight fresh(ctx);
+    std::vector<uint8_t> expected_visible;
+    std::vector<float> expected_distance;
+    fresh.Check(t, observers, targets, expected_visible, expected_distance);
+    ASSERT_EQ(expected_visible, visible);
+    for (size_t i = 0; i < observers.size(); i++) {
+        ASSERT_EQ(expected_distance[i], distance[i]) << i;
+    }
+}
+
+}
@@ -8,10 +8,18 @@
 #include "cl_range_calculator.h"
 #include "cl_utils.h"
 #include "device_buffer.h"
+#include "procedural_terrain.h"
+#include "range_calculator.h"
+#include "range_quantization.h"
+#include "residency_manager.h"
+#include "terrain.h"
 
 // Standard Imports
 #include <memory>
 #include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
 
 // Third-Party Imports
 #include "cl.hpp"
@@ -233,4 +241,340 @@ TEST(cl_range_calculator, calculate)
 
     ASSERT_NEAR(b.at(127, 127), 1000., 15.);
 }
+
+
+TEST(cl_range_calculator, quantized)
+{
+    std::shared_ptr<cl::Context> ctx = get_context();
+
+    Camera cam(90 * M_PI / 180, 64, 64);
+    cam.set_position(std::make_tuple(256*30.0, 256*30.0, 1000.0));
+    cam.set_pitch(M_PI * 60.0 / 180.0);
+
+    auto tb = std::make_shared<Device_Buffer>(*ctx, 512, 512);
+    for (auto i = 0; i < 512; i++) {
+        for (auto j = 0; j < 512; j++) {
+            tb->at(i, j) = 50.0f * std::sin(i * 0.05f) * std::cos(j * 0.03f);
+        }
+    }
+    tb->to_device();
+    Terrain t(tb, 30.0);
+
+    CL_Range_Calculator calculator(ctx);
+    Device_Buffer rng(*ctx, 64, 64);
+    calculator.Calculate(cam, t, rng);
+
+    // The device rounds as the host does, so the codes match to within one
+    const Range_Quantization q = range_quantization::covering(0.0f, 30000.0f);
+    std::vector<uint16_t> codes;
+    calculator.Calculate_Quantized(cam, t, q, codes);
+
+    ASSERT_EQ(64u * 64u, codes.size());
+    for (auto i = 0; i < 64; i++) {
+        for (auto j = 0; j < 64; j++) {
+            const int expected = range_quantization::quantize(rng.at(i, j), q);
+            ASSERT_NEAR(expected, codes[i * 64 + j], 1);
+        }
+    }
+}
+
+
+TEST(cl_range_calculator, host_terrain_is_uploaded_once)
+{
+    std::shared_ptr<cl::Context> ctx = get_context();
+
+    Camera cam(90 * M_PI / 180, 64, 64);
+    cam.set_position(std::make_tuple(128 * 30.0, 128 * 30.0, 1000.0));
+    cam.set_pitch(M_PI * 90.0 / 180.0);
+
+    // A plain host Buffer, rather than a Device_Buffer
+    auto tb = std::make_shared<Buffer>(256, 256);
+    Terrain t(tb, 30.0);
+
+    CL_Range_Calculator calculator(ctx);
+    Device_Buffer b(*ctx, 64, 64);
+    calculator.Calculate(cam, t, b);
+    calculator.Calculate(cam, t, b);
+
+    ASSERT_EQ(1u, calculator.residency()->uploads());
+    ASSERT_NEAR(b.at(31, 31), 1000., 15.);
+
+    // A raised terrain is only seen once it is marked dirty
+    for (auto i = 0; i < 256; i++) {
+        for (auto j = 0; j < 256; j++) {
+            tb->at(i, j) = 500.0f / 30.0f;
+        }
+    }
+    calculator.residency()->mark_host_dirty(*tb);
+    calculator.Calculate(cam, t, b);
+
+    ASSERT_EQ(2u, calculator.residency()->uploads());
+    ASSERT_NEAR(b.at(31, 31), 500., 15.);
+}
+
+
+TEST(cl_range_calculator, edits_reach_a_device_terrain)
+{
+    std::shared_ptr<cl::Context> ctx = get_context();
+
+    Camera cam(90 * M_PI / 180, 64, 64);
+    cam.set_position(std::make_tuple(128 * 30.0, 128 * 30.0, 1000.0));
+    cam.set_pitch(M_PI * 90.0 / 180.0);
+
+    // With and without a pyramid, which is refitted by the edit and walked over the heights
+    for (const bool pyramid : { false, true }) {
+        auto tb = std::make_shared<Device_Buffer>(*ctx, 256, 256);
+        for (auto i = 0; i < 256; i++) {
+            for (auto j = 0; j < 256; j++) {
+                tb->at(i, j) = 0.0f;
+            }
+        }
+        tb->to_device();
+        Terrain t(tb, 30.0);
+        if (pyramid) {
+            t.build_pyramid();
+        }
+
+        CL_Range_Calculator calculator(ctx);
+        Device_Buffer b(*ctx, 64, 64);
+        calculator.Calculate(cam, t, b);
+        ASSERT_NEAR(b.at(31, 31), 1000., 15.) << pyramid;
+
+        // A berm under the boresight is seen without any upload by the caller
+        t.edit(Buffer::Region { 112, 112, 32, 32 }, [](uint32_t, uint32_t, float & h) {
+            h = 500.0f / 30.0f;
+        });
+        calculator.Calculate(cam, t, b);
+        ASSERT_NEAR(b.at(31, 31), 500., 15.) << pyramid;
+    }
+}
+
+
+TEST(cl_range_calculator, procedural_terrain)
+{
+    std::shared_ptr<cl::Context> ctx = get_context();
+
+    Procedural_Terrain_Params params;
+    params.noise = { 5, 64, 4, 100.0f, 0.5f };
+    params.scale = 30.0f;
+    params.tile_size = 64;
+    params.max_tiles = 64;
+    params.view_distance = 3000.0f;
+
+    auto source = std::make_shared<Procedural_Terrain>(params);
+    Terrain t(source);
+
+    // camera is 1000.0 m above the terrain, far from the origin, looking straight down
+    Camera cam(10 * M_PI / 180, 16, 16);
+    cam.set_position(std::make_tuple(-40000 * 30.0, 70000 * 30.0, 1000.0));
+    cam.set_pitch(M_PI * 90.0 / 180.0);
+
+    Device_Buffer b(*ctx, 16, 16);
+    CL_Range_Calculator calculator(ctx);
+    calculator.Calculate(cam, t, b);
+
+    ASSERT_NEAR(b.at(8, 8), 1000.0f - source->height(-40000, 70000), 15.);
+
+    // Only the window around the camera was generated
+    ASSERT_LE(source->tiles_generated(), 16u);
+}
+
+
+TEST(cl_range_calculator, procedural_window_is_not_square)
+{
+    std::shared_ptr<cl::Context> ctx = get_context();
+
+    Procedural_Terrain_Params params;
+    params.noise = { 5, 64, 4, 100.0f, 0.5f };
+    params.scale = 30.0f;
+    params.tile_size = 64;
+    params.max_tiles = 64;
+    params.view_distance = 3000.0f;
+
+    auto source = std::make_shared<Procedural_Terrain>(params);
+    Terrain t(source);
+
+    // The view distance spans 4 tiles of rows, but 5 tiles of cols from this cell
+    const int64_t cam_row = -38300;
+    const int64_t cam_col = 64163;
+
+    // The same cells, copied into a host Terrain that holds all of them
+    const int64_t row0 = cam_row - 192;
+    const int64_t col0 = cam_col - 192;
+    auto ref = std::make_shared<Buffer>(384, 384);
+    source->copy_region(row0, col0, *ref);
+    Terrain local(ref, params.scale);
+
+    Camera cam(20 * M_PI / 180, 16, 16);
+    cam.set_pitch(M_PI * 20.0 / 180.0);
+    Camera local_cam(cam);
+
+    CL_Range_Calculator calculator(ctx);
+    Device_Buffer b(*ctx, 16, 16);
+    Device_Buffer expected(*ctx, 16, 16);
+
+    // Look in every direction, so the rays reach every edge of the window
+    for (auto yaw = 0; yaw < 360; yaw += 90) {
+        cam.set_yaw(M_PI * yaw / 180.0);
+        cam.set_position(std::make_tuple((cam_row + 0.5) * 30.0, (cam_col + 0.5) * 30.0, 1000.0));
+        local_cam.set_yaw(M_PI * yaw / 180.0);
+        local_cam.set_position(std::make_tuple((cam_row - row0 + 0.5) * 30.0,
+                                               (cam_col - col0 + 0.5) * 30.0,
+                                               1000.0));
+
+        calculator.Calculate(cam, t, b);
+        calculator.Calculate(local_cam, local, expected);
+
+        for (auto i = 0; i < 16; i++) {
+            for (auto j = 0; j < 16; j++) {
+                ASSERT_NEAR(expected.at(i, j), b.at(i, j), 1.0) << yaw << ": " << i << ", " << j;
+            }
+        }
+    }
+}
+
+
+TEST(cl_range_calculator, procedural_window_must_fit_in_tile_cache)
+{
+    std::shared_ptr<cl::Context> ctx = get_context();
+
+    Procedural_Terrain_Params params;
+    params.noise = { 5, 64, 4, 100.0f, 0.5f };
+    params.scale = 30.0f;
+    params.tile_size = 64;
+    params.max_tiles = 8;
+    params.view_distance = 3000.0f;
+
+    Terrain t(std::make_shared<Procedural_Terrain>(params));
+
+    Camera cam(10 * M_PI / 180, 16, 16);
+    cam.set_position(std::make_tuple(0.0, 0.0, 1000.0));
+
+    Device_Buffer b(*ctx, 16, 16);
+    CL_Range_Calculator calculator(ctx);
+    ASSERT_THROW(calculator.Calculate(cam, t, b), std::invalid_argument);
+}
+
+
+TEST(cl_range_calculator, hits)
+{
+    std::shared_ptr<cl::Context> ctx = get_context();
+
+    // A plane sloping up along the rows, seen from above. The heights are in cells, so the
+    // scale is 1.
+    auto tb = std::make_shared<Device_Buffer>(*ctx, 256, 256);
+    for (auto i = 0; i < 256; i++) {
+        for (auto j = 0; j < 256; j++) {
+            tb->at(i, j) = 0.25f * i;
+        }
+    }
+    tb->to_device();
+    Terrain t(tb, 1.0f);
+
+    Camera cam(20 * M_PI / 180, 32, 32);
+    cam.set_position(std::make_tuple(128.0, 128.0, 200.0));
+    cam.set_pitch(M_PI * 90.0 / 180.0);
+
+    CL_Range_Calculator calculator(ctx);
+    Device_Buffer rng(*ctx, 32, 32);
+    calculator.Calculate(cam, t, rng);
+
+    Device_Buffer hits(*ctx, 32, 32, HIT_DEPTH);
+    calculator.Calculate_Hits(cam, t, hits);
+
+    const float slope_len = std::sqrt(0.25f * 0.25f + 1.0f);
+    for (auto r = 0; r < 32; r++) {
+        for (auto c = 0; c < 32; c++) {
+            ASSERT_EQ(rng.at(r, c), hits.at(r, c, HIT_RANGE)) << r << ", " << c;
+            ASSERT_EQ(std::floor(hits.at(r, c, HIT_X)), hits.at(r, c, HIT_ROW));
+            ASSERT_EQ(std::floor(hits.at(r, c, HIT_Y)), hits.at(r, c, HIT_COL));
+            ASSERT_NEAR(-0.25f / slope_len, hits.at(r, c, HIT_NORMAL_X), 1e-5);
+            ASSERT_NEAR(1.0f / slope_len, hits.at(r, c, HIT_NORMAL_Z), 1e-5);
+        }
+    }
+}
+
+
+TEST(cl_range_calculator, pixels_and_region)
+{
+    std::shared_ptr<cl::Context> ctx = get_context();
+
+    auto tb = std::make_shared<Device_Buffer>(*ctx, 256, 256);
+    for (auto i = 0; i < 256; i++) {
+        for (auto j = 0; j < 256; j++) {
+            tb->at(i, j) = 10.0f * std::sin(i / 9.0f) * std::cos(j / 13.0f);
+        }
+    }
+    tb->to_device();
+    Terrain t(tb, 1.0f);
+
+    Camera cam(60 * M_PI / 180, 48, 64);
+    cam.set_position(std::make_tuple(100.0, 80.0, 40.0));
+    cam.set_pitch(M_PI * 20.0 / 180.0);
+    cam.set_yaw(M_PI * 30.0 / 180.0);
+
+    CL_Range_Calculator calculator(ctx);
+    Device_Buffer full(*ctx, 48, 64);
+    calculator.Calculate(cam, t, full);
+
+    // The host computes the rays, so allow for its rounding of the pointing vectors
+    const std::vector<Range_Calculator::Pixel> pixels { { 0, 0 }, { 47, 63 }, { 20, 5 } };
+    std::vector<float> ranges;
+    calculator.Calculate_Pixels(cam, t, pixels, ranges);
+
+    ASSERT_EQ(pixels.size(), ranges.size());
+    for (size_t i = 0; i < pixels.size(); i++) {
+        ASSERT_NEAR(full.at(pixels[i].first, pixels[i].second), ranges[i], 1.0) << i;
+    }
+
+    Buffer region(10, 7);
+    calculator.Calculate_Region(cam, t, 30, 40, region);
+    for (auto r = 0; r < 10; r++) {
+        for (auto c = 0; c < 7; c++) {
+            ASSERT_NEAR(full.at(30 + r, 40 + c), region.at(r, c), 1.0) << r << ", " << c;
+        }
+    }
+
+    ASSERT_THROW(calculator.Calculate_Region(cam, t, 40, 60, region), std::out_of_range);
+}
+
+
+TEST(cl_range_calculator, progressive)
+{
+    std::shared_ptr<cl::Context> ctx = get_context();
+
+    auto tb = std::make_shared<Device_Buffer>(*ctx, 256, 256);
+    for (auto i = 0; i < 256; i++) {
+        for (auto j = 0; j < 256; j++) {
+            tb->at(i, j) = 10.0f * std::sin(i / 9.0f) * std::cos(j / 13.0f);
+        }
+    }
+    tb->to_device();
+    Terrain t(tb, 1.0f);
+
+    Camera cam(60 * M_PI / 180, 50, 70);
+    cam.set_position(std::make_tuple(100.0, 80.0, 40.0));
+    cam.set_pitch(M_PI * 20.0 / 180.0);
+    cam.set_yaw(M_PI * 30.0 / 180.0);
+
+    CL_Range_Calculator calculator(ctx);
+    Device_Buffer full(*ctx, 50, 70);
+    calculator.Calculate(cam, t, full);
+
+    std::vector<uint32_t> strides;
+    Buffer rng(50, 70);
+    ASSERT_TRUE(calculator.Calculate_Progressive(cam, t, rng, 
+        [&](const uint32_t stride, const Buffer &) {
+            strides.push_back(stride);
+        }));
+    ASSERT_EQ(std::vector<uint32_t>({ 8, 4, 2, 1 }), strides);
+
+    // The complete image is the full render, allowing for the host's rounding of the rays
+    for (auto r = 0; r < 50; r++) {
+        for (auto c = 0; c < 70; c++) {
+            ASSERT_NEAR(full.at(r, c), rng.at(r, c), 1.0) << r << ", " << c;
+        }
+    }
+}
+
 }
@@ -0,0 +1,72 @@
+//! @file       test_cl_range_display.cc
+//! @brief      Unit tests for the CL_Range_Display type
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+
+// CLarity Imports
+#include "buffer.h"
+#include "cl_range_display.h"
+#include "cl_utils.h"
+#include "cpu_range_display.h"
+#include "device_buffer.h"
+#include "range_display.h"
+
+// Standard Imports
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Third-Party Imports
+#include "cl.hpp"
+#include "gtest/gtest.h"
+
+namespace
+{
+
+using namespace clarity;
+
+
+TEST(cl_range_display, matches_cpu)
+{
+    std::shared_ptr<cl::Context> ctx = get_context();
+
+    Device_Buffer rng(*ctx, 301, 257);
+    for (auto r = 0; r < 301; r++) {
+        for (auto c = 0; c < 257; c++) {
+            rng.at(r, c) = 1000.0f + 700.0f * std::sin(r / 23.0f) * std::cos(c / 7.0f);
+        }
+    }
+    rng.to_device();
+
+    CPU_Range_Display cpu;
+    std::vector<uint8_t> expected;
+    const std::pair<float, float> expected_range = cpu.Convert(rng, expected);
+
+    // Both a Device_Buffer and a host Buffer can be converted
+    CL_Range_Display display(ctx);
+    std::vector<uint8_t> device;
+    ASSERT_EQ(expected_range, display.Convert(rng, device));
+
+    Buffer host(301, 257);
+    for (auto r = 0; r < 301; r++) {
+        for (auto c = 0; c < 257; c++) {
+            host.at(r, c) = rng.at(r, c);
+        }
+    }
+    std::vector<uint8_t> uploaded;
+    ASSERT_EQ(expected_range, display.Convert(host, uploaded));
+    ASSERT_EQ(device, uploaded);
+
+    // The device may round the scale differently, so allow one gray level either way
+    ASSERT_EQ(expected.size(), device.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        ASSERT_LE(std::abs(expected[i] - device[i]), 1) << i;
+    }
+}
+
+}
@@ -0,0 +1,75 @@
+//! @file       test_cl_terrain_pyramid.cc
+//! @brief      Unit tests for the CL_Terrain_Pyramid type
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "buffer.h"
+#include "cl_terrain_pyramid.h"
+#include "cl_utils.h"
+#include "device_buffer.h"
+#include "terrain_pyramid.h"
+
+// Standard Imports
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+// Third-Party Imports
+#include "cl.hpp"
+#include "gtest/gtest.h"
+
+namespace
+{
+
+using namespace clarity;
+
+
+//! @brief  Check that the device levels match a pyramid built on the host
+static void _expect_matches(CL_Terrain_Pyramid & pyramid, const Buffer & heights)
+{
+    pyramid.packed().from_device();
+
+    const Terrain_Pyramid expected(heights);
+    const uint32_t cells = expected.packed().size().first;
+    for (uint32_t i = 0; i < cells; i++) {
+        ASSERT_EQ(expected.packed().at(i, 0, 0), pyramid.packed().at(i, 0, 0)) << i;
+        ASSERT_EQ(expected.packed().at(i, 0, 1), pyramid.packed().at(i, 0, 1)) << i;
+    }
+}
+
+
+TEST(cl_terrain_pyramid, refit_matches_rebuild)
+{
+    std::shared_ptr<cl::Context> ctx = get_context();
+
+    Device_Buffer heights(*ctx, 131, 77);
+    for (uint32_t r = 0; r < 131; r++) {
+        for (uint32_t c = 0; c < 77; c++) {
+            heights.at(r, c) = static_cast<float>((r * 37 + c * 101) % 257) - 128.0f;
+        }
+    }
+    heights.to_device();
+
+    CL_Terrain_Pyramid pyramid(ctx, Terrain_Pyramid(heights));
+    pyramid.build(heights);
+    _expect_matches(pyramid, heights);
+
+    // Edit the height map on the host, send only the edit, and refit on the device
+    const Buffer::Region region { 60, 70, 9, 7 };
+    for (uint32_t r = region.row; r < region.row + region.rows; r++) {
+        for (uint32_t c = region.col; c < region.col + region.cols; c++) {
+            heights.at(r, c) = 1000.0f - r;
+        }
+    }
+    heights.mark_dirty(region);
+    heights.to_device_dirty();
+
+    pyramid.refit(heights, region);
+    _expect_matches(pyramid, heights);
+
+    ASSERT_THROW(pyramid.refit(heights, Buffer::Region { 130, 0, 2, 1 }), std::out_of_range);
+}
+
+}
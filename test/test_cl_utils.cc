@@ -75,13 +75,42 @@ TEST(cl_utils, kernel_compliation)
 
     ASSERT_EQ(CL_SUCCESS, err) << "Failed to get context";
 
+    // Programs build in the background, so errors surface when the kernels are retrieved
     try {
         Kernel_Collection kcollect(ctx, files);
+        for (auto & entry : files) {
+            kcollect.get(entry.first);
+        }
     } catch(const std::exception & e) {
         std::cerr << e.what() << std::endl;
         FAIL();
     }
 }
 
+
+TEST(cl_utils, shared_runtime)
+{
+    // Contexts from the runtime are the same context while anyone holds one
+    std::shared_ptr<cl::Context> a = get_context();
+    std::shared_ptr<cl::Context> b = get_context();
+    ASSERT_EQ((*a)(), (*b)());
+    ASSERT_EQ(CL_Runtime::instance()->context().get(), a.get());
+
+    // Kernel collections over the same files share one build
+    std::map<std::string, std::string> files { 
+        { "simple_kernel", KERNEL_DIR + "/simple_kernel.cl" } 
+    };
+    Kernel_Collection first(*a, files);
+    Kernel_Collection second(*a, files);
+
+    cl_program p1 = nullptr;
+    cl_program p2 = nullptr;
+    first.get("simple_kernel").getInfo(CL_KERNEL_PROGRAM, &p1);
+    second.get("simple_kernel").getInfo(CL_KERNEL_PROGRAM, &p2);
+    ASSERT_EQ(p1, p2);
+
+    // But each has its own kernel object, so their arguments do not collide
+    ASSERT_NE(first.get("simple_kernel")(), second.get("simple_kernel")());
 }
 
+}
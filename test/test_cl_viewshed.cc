@@ -0,0 +1,107 @@
+//! @file       test_cl_viewshed.cc
+//! @brief      Unit tests for the CL_Viewshed type
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+
+// CLarity Imports
+#include "buffer.h"
+#include "cl_utils.h"
+#include "cl_viewshed.h"
+#include "cpu_viewshed.h"
+#include "device_buffer.h"
+#include "terrain.h"
+#include "viewshed.h"
+
+// Standard Imports
+#include <cmath>
+#include <cstdint>
+#include <memory>
+
+// Third-Party Imports
+#include "cl.hpp"
+#include "gtest/gtest.h"
+
+namespace
+{
+
+using namespace clarity;
+
+
+TEST(cl_viewshed, matches_cpu)
+{
+    std::shared_ptr<cl::Context> ctx = get_context();
+
+    auto b = std::make_shared<Device_Buffer>(*ctx, 150, 120);
+    for (auto i = 0; i < 150; i++) {
+        for (auto j = 0; j < 120; j++) {
+            b->at(i, j) = 20.0f * std::sin(i / 17.0f) * std::cos(j / 11.0f);
+        }
+    }
+    b->to_device();
+    Terrain t(b, 1.0f);
+
+    const Viewshed::Position observer(70.5f, 50.5f, 25.0f);
+
+    CPU_Viewshed cpu;
+    Buffer expected(150, 120);
+    cpu.Compute(t, observer, expected);
+
+    // Both a host Buffer and a Device_Buffer can receive the viewshed
+    CL_Viewshed viewshed(ctx);
+    Buffer host(150, 120);
+    viewshed.Compute(t, observer, host);
+    Device_Buffer device(*ctx, 150, 120);
+    viewshed.Compute(t, observer, device);
+
+    // The device may round the horizons differently, so allow a few cells on the edge of the
+    // viewshed to go either way
+    uint32_t mismatches = 0;
+    for (auto r = 0; r < 150; r++) {
+        for (auto c = 0; c < 120; c++) {
+            mismatches += host.at(r, c) != expected.at(r, c);
+            ASSERT_EQ(host.at(r, c), device.at(r, c)) << r << ", " << c;
+        }
+    }
+    ASSERT_LT(mismatches, 50u);
+}
+
+
+
+TEST(cl_viewshed, host_terrain_is_uploaded_once)
+{
+    std::shared_ptr<cl::Context> ctx = get_context();
+
+    // A plain host Buffer, rather than a Device_Buffer
+    auto b = std::make_shared<Buffer>(150, 120);
+    for (auto i = 0; i < 150; i++) {
+        for (auto j = 0; j < 120; j++) {
+            b->at(i, j) = 20.0f * std::sin(i / 17.0f) * std::cos(j / 11.0f);
+        }
+    }
+    Terrain t(b, 1.0f);
+
+    const Viewshed::Position observer(70.5f, 50.5f, 25.0f);
+
+    CPU_Viewshed cpu;
+    Buffer expected(150, 120);
+    cpu.Compute(t, observer, expected);
+
+    CL_Viewshed viewshed(ctx);
+    Buffer visible(150, 120);
+    viewshed.Compute(t, observer, visible);
+    viewshed.Compute(t, observer, visible);
+
+    ASSERT_EQ(1u, viewshed.residency()->uploads());
+
+    uint32_t mismatches = 0;
+    for (auto r = 0; r < 150; r++) {
+        for (auto c = 0; c < 120; c++) {
+            mismatches += visible.at(r, c) != expected.at(r, c);
+        }
+    }
+    ASSERT_LT(mismatches, 50u);
+}
+
+}
@@ -0,0 +1,174 @@
+//! @file       test_cpu_line_of_sight.cc
+//! @brief      Unit tests for the CPU_Line_Of_Sight type
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+
+// CLarity Imports
+#include "buffer.h"
+#include "cpu_line_of_sight.h"
+#include "line_of_sight.h"
+#include "terrain.h"
+
+// Standard Imports
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+// Third-Party Imports
+#include "gtest/gtest.h"
+
+namespace
+{
+
+using namespace clarity;
+
+
+//! @brief  Make random lines a few meters above a height map
+static void _random_lines(const Buffer & b,
+                          const uint32_t count,
+                          std::vector<Line_Of_Sight::Point> & observers,
+                          std::vector<Line_Of_Sight::Point> & targets)
+{
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<float> row(0.0f, b.size().first - 1.0f);
+    std::uniform_real_distribution<float> col(0.0f, b.size().second - 1.0f);
+    std::uniform_real_distribution<float> above(0.5f, 30.0f);
+
+    for (uint32_t i = 0; i < count; i++) {
+        const float r0 = row(gen);
+        const float c0 = col(gen);
+        const float r1 = row(gen);
+        const float c1 = col(gen);
+
+        observers.emplace_back(r0, c0, b.at(r0, c0) + above(gen));
+        targets.emplace_back(r1, c1, b.at(r1, c1) + above(gen));
+    }
+}
+
+
+TEST(cpu_line_of_sight, wall)
+{
+    // A flat plain with a wall across row 32
+    auto b = std::make_shared<Buffer>(64, 64);
+    for (auto c = 0; c < 64; c++) {
+        b->at(32, c) = 50.0f;
+    }
+    Terrain t(b, 1.0f);
+
+    const std::vector<Line_Of_Sight::Point> observers {
+        Line_Of_Sight::Point(10.0f, 20.0f, 5.0f),
+        Line_Of_Sight::Point(10.0f, 20.0f, 5.0f),
+        Line_Of_Sight::Point(10.0f, 20.0f, 60.0f),
+        Line_Of_Sight::Point(10.0f, 20.0f, 5.0f)
+    };
+    const std::vector<Line_Of_Sight::Point> targets {
+        Line_Of_Sight::Point(50.0f, 20.0f, 5.0f),
+        Line_Of_Sight::Point(20.0f, 50.0f, 5.0f),
+        Line_Of_Sight::Point(50.0f, 20.0f, 60.0f),
+        Line_Of_Sight::Point(10.0f, 30.0f, 0.0f)
+    };
+
+    CPU_Line_Of_Sight los;
+    std::vector<uint8_t> visible;
+    std::vector<float> distance;
+    los.Check(t, observers, targets, visible, distance);
+
+    ASSERT_EQ(4u, visible.size());
+    ASSERT_EQ(4u, distance.size());
+
+    // Through the wall: blocked at the wall
+    ASSERT_EQ(0, visible[0]);
+    ASSERT_NEAR(22.0f, distance[0], 0.25f);
+
+    // Alongside the wall, over it, and down to the ground: clear all the way
+    ASSERT_EQ(1, visible[1]);
+    ASSERT_NEAR(std::sqrt(10.0f * 10.0f + 30.0f * 30.0f), distance[1], 1e-4);
+    ASSERT_EQ(1, visible[2]);
+    ASSERT_NEAR(40.0f, distance[2], 1e-4);
+    ASSERT_EQ(1, visible[3]);
+
+    ASSERT_THROW(los.Check(t, observers, { targets[0] }, visible, distance),
+                 std::invalid_argument);
+}
+
+
+TEST(cpu_line_of_sight, pyramid_does_not_change_results)
+{
+    auto b = std::make_shared<Buffer>(300, 200);
+    for (auto i = 0; i < 300; i++) {
+        for (auto j = 0; j < 200; j++) {
+            b->at(i, j) = 20.0f * std::sin(i / 17.0f) * std::cos(j / 11.0f);
+        }
+    }
+
+    Terrain plain(b, 1.0f);
+    Terrain accelerated(b, 1.0f);
+    accelerated.build_pyramid();
+
+    std::vector<Line_Of_Sight::Point> observers;
+    std::vector<Line_Of_Sight::Point> targets;
+    _random_lines(*b, 2000, observers, targets);
+
+    // A line above the whole map, which the top level skips in one go
+    observers.emplace_back(0.0f, 0.0f, 100.0f);
+    targets.emplace_back(299.0f, 199.0f, 100.0f);
+
+    CPU_Line_Of_Sight los;
+    std::vector<uint8_t> plain_visible;
+    std::vector<float> plain_distance;
+    los.Check(plain, observers, targets, plain_visible, plain_distance);
+
+    std::vector<uint8_t> visible;
+    std::vector<float> distance;
+    los.Check(accelerated, observers, targets, visible, distance);
+
+    uint32_t num_visible = 0;
+    for (size_t i = 0; i < observers.size(); i++) {
+        ASSERT_EQ(plain_visible[i], visible[i]) << i;
+        ASSERT_EQ(plain_distance[i], distance[i]) << i;
+        num_visible += visible[i];
+    }
+
+    // Both outcomes are exercised
+    ASSERT_GT(num_visible, 100u);
+    ASSERT_LT(num_visible, observers.size() - 100u);
+    ASSERT_EQ(1, visible.back());
+}
+
+
+TEST(cpu_line_of_sight, thread_count_does_not_change_results)
+{
+    auto b = std::make_shared<Buffer>(128, 128);
+    for (auto i = 0; i < 128; i++) {
+        for (auto j = 0; j < 128; j++) {
+            b->at(i, j) = 15.0f * std::sin(i / 7.0f + j / 5.0f);
+        }
+    }
+    Terrain t(b, 1.0f);
+    t.build_pyramid();
+
+    std::vector<Line_Of_Sight::Point> observers;
+    std::vector<Line_Of_Sight::Point> targets;
+    _random_lines(*b, 1000, observers, targets);
+
+    CPU_Line_Of_Sight one(1);
+    std::vector<uint8_t> one_visible;
+    std::vector<float> one_distance;
+    one.Check(t, observers, targets, one_visible, one_distance);
+
+    CPU_Line_Of_Sight four(4);
+    std::vector<uint8_t> visible;
+    std::vector<float> distance;
+    four.Check(t, observers, targets, visible, distance);
+
+    ASSERT_EQ(one_visible, visible);
+    ASSERT_EQ(one_distance, distance);
+}
+
+}
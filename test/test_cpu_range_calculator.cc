@@ -8,10 +8,18 @@
 // CLarity Imports
 #include "cpu_range_calculator.h"
 #include "buffer.h"
+#include "noise_terrain_generator.h"
+#include "range_calculator.h"
+#include "range_quantization.h"
 #include "terrain.h"
 
 // Standard Imports
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
 
 // Third-Party Imports
 #include "gtest/gtest.h"
@@ -220,4 +228,334 @@ TEST(cpu_range_calculator, calculate)
 
     ASSERT_NEAR(b.at(127, 127), 1000., 15.);
 }
+
+
+TEST(cpu_range_calculator, lod_within_error_budget)
+{
+    // A low grazing angle over rolling terrain, where many rays travel a long way. The
+    // heights are in cells, so the scale is 1.
+    Noise_Terrain_Generator generator(Noise_Params { 7, 256, 6, 20.0f, 0.5f });
+    Terrain t = generator.generate_terrain(1024, 1024, 1.0f, 0.5f);
+
+    Camera cam(60 * M_PI / 180, 64, 64);
+    cam.set_position(std::make_tuple(512.0, 512.0, 60.0));
+    cam.set_pitch(M_PI * 2.0 / 180.0);
+
+    CPU_Range_Calculator calculator;
+    Buffer full(64, 64);
+    calculator.Calculate(cam, t, full);
+
+    // Without a pyramid the budget has no effect
+    calculator.set_lod_error_budget(1.0f);
+    Buffer no_pyramid(64, 64);
+    calculator.Calculate(cam, t, no_pyramid);
+
+    t.build_pyramid();
+    Buffer lod(64, 64);
+    calculator.Calculate(cam, t, lod);
+
+    std::vector<float> errors;
+    for (auto r = 0; r < 64; r++) {
+        for (auto c = 0; c < 64; c++) {
+            ASSERT_EQ(full.at(r, c), no_pyramid.at(r, c));
+
+            // Most errors are within twice the budget footprint at that range, plus a cell.
+            // Rays that graze a peak beside them can stop further from the true hit.
+            const float footprint = 2.0f * full.at(r, c) / cam.focal_length();
+            errors.push_back(std::abs(lod.at(r, c) - full.at(r, c)) / (footprint + 1.0f));
+        }
+    }
+
+    std::sort(errors.begin(), errors.end());
+    ASSERT_EQ(0.0f, errors[errors.size() / 2]);
+    ASSERT_LT(errors[errors.size() * 9 / 10], 1.0f);
+
+    ASSERT_THROW(calculator.set_lod_error_budget(-1.0f), std::invalid_argument);
+}
+
+
+TEST(cpu_range_calculator, quantized)
+{
+    Camera cam(90 * M_PI / 180, 64, 64);
+    cam.set_position(std::make_tuple(256*30.0, 256*30.0, 1000.0));
+    cam.set_pitch(M_PI * 60.0 / 180.0);
+
+    auto tb = std::make_shared<Buffer>(512, 512);
+    for (auto i = 0; i < 512; i++) {
+        for (auto j = 0; j < 512; j++) {
+            tb->at(i, j) = 50.0f * std::sin(i * 0.05f) * std::cos(j * 0.03f);
+        }
+    }
+    Terrain t(tb, 30.0);
+
+    CPU_Range_Calculator calculator;
+    Buffer rng(64, 64);
+    calculator.Calculate(cam, t, rng);
+
+    const Range_Quantization q = range_quantization::covering(0.0f, 30000.0f);
+    std::vector<uint16_t> codes;
+    calculator.Calculate_Quantized(cam, t, q, codes);
+
+    ASSERT_EQ(64u * 64u, codes.size());
+    for (auto i = 0; i < 64; i++) {
+        for (auto j = 0; j < 64; j++) {
+            ASSERT_EQ(range_quantization::quantize(rng.at(i, j), q), codes[i * 64 + j]);
+        }
+    }
+}
+
+
+TEST(cpu_range_calculator, max_range)
+{
+    // A flat terrain seen from just above it, looking at the horizon, so half the rays never
+    // hit it
+    auto tb = std::make_shared<Buffer>(128, 128);
+    for (auto i = 0; i < 128; i++) {
+        for (auto j = 0; j < 128; j++) {
+            tb->at(i, j) = 0.0f;
+        }
+    }
+    Terrain t(tb, 10.0);
+    const float max_range = Range_Calculator::max_range(t);
+    ASSERT_FLOAT_EQ(10.0f * 128 * std::sqrt(3.0f), max_range);
+
+    Camera cam(90 * M_PI / 180, 16, 16);
+    cam.set_position(std::make_tuple(64 * 10.0, 64 * 10.0, 20.0));
+
+    CPU_Range_Calculator calculator;
+    Buffer rng(16, 16);
+    calculator.Calculate(cam, t, rng);
+
+    // A quantization covering the maximum holds the clamped rays
+    const Range_Quantization q = range_quantization::covering(0.0f, max_range);
+    std::vector<uint16_t> codes;
+    calculator.Calculate_Quantized(cam, t, q, codes);
+
+    uint32_t clamped = 0;
+    for (auto i = 0; i < 16; i++) {
+        for (auto j = 0; j < 16; j++) {
+            ASSERT_LE(rng.at(i, j), max_range);
+            if (rng.at(i, j) == max_range) {
+                clamped++;
+                ASSERT_EQ(range_quantization::MAX_CODE, codes[i * 16 + j]);
+            }
+        }
+    }
+    ASSERT_GT(clamped, 0u);
+}
+
+
+TEST(cpu_range_calculator, hits)
+{
+    // A plane sloping up along the rows, seen from above. The heights are in cells, so the
+    // scale is 1.
+    auto tb = std::make_shared<Buffer>(256, 256);
+    for (auto i = 0; i < 256; i++) {
+        for (auto j = 0; j < 256; j++) {
+            tb->at(i, j) = 0.25f * i;
+        }
+    }
+    Terrain t(tb, 1.0f);
+
+    Camera cam(20 * M_PI / 180, 32, 32);
+    cam.set_position(std::make_tuple(128.0, 128.0, 200.0));
+    cam.set_pitch(M_PI * 90.0 / 180.0);
+
+    CPU_Range_Calculator calculator;
+    Buffer rng(32, 32);
+    calculator.Calculate(cam, t, rng);
+
+    Buffer hits(32, 32, HIT_DEPTH);
+    calculator.Calculate_Hits(cam, t, hits);
+
+    const float slope_len = std::sqrt(0.25f * 0.25f + 1.0f);
+    for (auto r = 0; r < 32; r++) {
+        for (auto c = 0; c < 32; c++) {
+            ASSERT_EQ(rng.at(r, c), hits.at(r, c, HIT_RANGE)) << r << ", " << c;
+
+            // The hit is at the range from the camera, in the cell it reports
+            const float dx = hits.at(r, c, HIT_X) - 128.0f;
+            const float dy = hits.at(r, c, HIT_Y) - 128.0f;
+            const float dz = hits.at(r, c, HIT_Z) - 200.0f;
+            ASSERT_NEAR(rng.at(r, c), std::sqrt(dx * dx + dy * dy + dz * dz), 1e-3);
+            ASSERT_EQ(std::floor(hits.at(r, c, HIT_X)), hits.at(r, c, HIT_ROW));
+            ASSERT_EQ(std::floor(hits.at(r, c, HIT_Y)), hits.at(r, c, HIT_COL));
+
+            // Every ray meets the plane, within a step and a cell of its surface
+            const float height = 0.25f * hits.at(r, c, HIT_ROW);
+            ASSERT_LE(hits.at(r, c, HIT_Z), height);
+            ASSERT_GT(hits.at(r, c, HIT_Z), height - 0.5f);
+
+            ASSERT_NEAR(-0.25f / slope_len, hits.at(r, c, HIT_NORMAL_X), 1e-5);
+            ASSERT_NEAR(0.0f, hits.at(r, c, HIT_NORMAL_Y), 1e-5);
+            ASSERT_NEAR(1.0f / slope_len, hits.at(r, c, HIT_NORMAL_Z), 1e-5);
+        }
+    }
+
+    Buffer wrong_depth(32, 32, 4);
+    ASSERT_THROW(calculator.Calculate_Hits(cam, t, wrong_depth), std::invalid_argument);
+}
+
+
+TEST(cpu_range_calculator, pixels_and_region)
+{
+    Noise_Terrain_Generator generator(Noise_Params { 3, 64, 4, 20.0f, 0.5f });
+    Terrain t = generator.generate_terrain(256, 256, 1.0f, 0.5f);
+
+    Camera cam(60 * M_PI / 180, 48, 64);
+    cam.set_position(std::make_tuple(100.0, 80.0, 40.0));
+    cam.set_pitch(M_PI * 20.0 / 180.0);
+    cam.set_yaw(M_PI * 30.0 / 180.0);
+
+    CPU_Range_Calculator calculator;
+    Buffer full(48, 64);
+    calculator.Calculate(cam, t, full);
+
+    // Each queried pixel matches the full frame exactly
+    const std::vector<Range_Calculator::Pixel> pixels { { 0, 0 }, { 47, 63 }, { 20, 5 }, 
+                                                        { 20, 5 }, { 33, 50 } };
+    std::vector<float> ranges;
+    calculator.Calculate_Pixels(cam, t, pixels, ranges);
+
+    ASSERT_EQ(pixels.size(), ranges.size());
+    for (size_t i = 0; i < pixels.size(); i++) {
+        ASSERT_EQ(full.at(pixels[i].first, pixels[i].second), ranges[i]) << i;
+    }
+
+    Buffer region(10, 7);
+    calculator.Calculate_Region(cam, t, 30, 40, region);
+    for (auto r = 0; r < 10; r++) {
+        for (auto c = 0; c < 7; c++) {
+            ASSERT_EQ(full.at(30 + r, 40 + c), region.at(r, c)) << r << ", " << c;
+        }
+    }
+
+    const std::vector<Range_Calculator::Pixel> outside { { 48, 0 } };
+    ASSERT_THROW(calculator.Calculate_Pixels(cam, t, outside, ranges), std::out_of_range);
+    ASSERT_THROW(calculator.Calculate_Region(cam, t, 40, 60, region), std::out_of_range);
+}
+
+
+TEST(cpu_range_calculator, progressive)
+{
+    Noise_Terrain_Generator generator(Noise_Params { 3, 64, 4, 20.0f, 0.5f });
+    Terrain t = generator.generate_terrain(256, 256, 1.0f, 0.5f);
+
+    // Neither dimension is a multiple of the coarsest spacing
+    Camera cam(60 * M_PI / 180, 50, 70);
+    cam.set_position(std::make_tuple(100.0, 80.0, 40.0));
+    cam.set_pitch(M_PI * 20.0 / 180.0);
+    cam.set_yaw(M_PI * 30.0 / 180.0);
+
+    CPU_Range_Calculator calculator;
+    Buffer full(50, 70);
+    calculator.Calculate(cam, t, full);
+
+    std::vector<uint32_t> strides;
+    Buffer rng(50, 70);
+    const bool done = calculator.Calculate_Progressive(cam, t, rng, 
+        [&](const uint32_t stride, const Buffer & b) {
+            strides.push_back(stride);
+
+            // Each computed pixel fills the block below and to the right of it
+            for (uint32_t r = 0; r < 50; r++) {
+                for (uint32_t c = 0; c < 70; c++) {
+                    ASSERT_EQ(b.at(r - r % stride, c - c % stride), b.at(r, c)) << r << ", " << c;
+                }
+            }
+        });
+
+    ASSERT_TRUE(done);
+    ASSERT_EQ(std::vector<uint32_t>({ 8, 4, 2, 1 }), strides);
+
+    // The complete image is the full render
+    for (auto r = 0; r < 50; r++) {
+        for (auto c = 0; c < 70; c++) {
+            ASSERT_EQ(full.at(r, c), rng.at(r, c)) << r << ", " << c;
+        }
+    }
+
+    // A render cancelled after its first pass stops there
+    std::atomic<bool> cancel(false);
+    strides.clear();
+    const bool cancelled = ! calculator.Calculate_Progressive(cam, t, rng, 
+        [&](const uint32_t stride, const Buffer &) {
+            strides.push_back(stride);
+            cancel = true;
+        }, &cancel);
+
+    ASSERT_TRUE(cancelled);
+    ASSERT_EQ(std::vector<uint32_t>({ 8 }), strides);
+
+    Buffer wrong_size(48, 64);
+    ASSERT_THROW(calculator.Calculate_Progressive(cam, t, wrong_size, nullptr), 
+                 std::invalid_argument);
+}
+
+
+TEST(cpu_range_calculator, progressive_start_margin)
+{
+    auto tb = std::make_shared<Buffer>(256, 256);
+    for (auto i = 0; i < 256; i++) {
+        for (auto j = 0; j < 256; j++) {
+            tb->at(i, j) = 10.0f * std::sin(i / 9.0f) * std::cos(j / 13.0f);
+        }
+    }
+    Terrain t(tb, 1.0f);
+
+    Camera cam(60 * M_PI / 180, 50, 70);
+    cam.set_position(std::make_tuple(100.0, 80.0, 40.0));
+    cam.set_pitch(M_PI * 20.0 / 180.0);
+    cam.set_yaw(M_PI * 30.0 / 180.0);
+
+    CPU_Range_Calculator calculator;
+    Buffer full(50, 70);
+    calculator.Calculate(cam, t, full);
+
+    // A start below the range walks the same steps, but jumps to the first of them, so the
+    // rounding of the walk can move a hit by one step, a fifth of a cell, and a little more
+    // over a long walk
+    const float one_step = 0.25f;
+    const std::vector<Range_Calculator::Pixel> pixels { { 0, 0 }, { 49, 69 }, { 25, 35 } };
+    std::vector<float> start;
+    for (const auto & p : pixels) {
+        start.push_back(0.5f * full.at(p.first, p.second));
+    }
+
+    std::vector<float> ranges;
+    calculator.Calculate_Pixels(cam, t, pixels, start, ranges);
+    for (size_t i = 0; i < pixels.size(); i++) {
+        ASSERT_NEAR(full.at(pixels[i].first, pixels[i].second), ranges[i], one_step) << i;
+    }
+
+    start.pop_back();
+    ASSERT_THROW(calculator.Calculate_Pixels(cam, t, pixels, start, ranges), 
+                 std::invalid_argument);
+
+    // Over smooth terrain the nearest coarse range is nearly always below each finer one, so
+    // the refinement only differs from Calculate by that rounding, but for the rare ray it
+    // starts beyond its hit
+    std::vector<uint32_t> strides;
+    Buffer rng(50, 70);
+    ASSERT_TRUE(calculator.Calculate_Progressive(cam, t, rng, 
+        [&](const uint32_t stride, const Buffer &) {
+            strides.push_back(stride);
+        }, nullptr, 0.9f));
+    ASSERT_EQ(std::vector<uint32_t>({ 8, 4, 2, 1 }), strides);
+
+    uint32_t skipped = 0;
+    for (auto r = 0; r < 50; r++) {
+        for (auto c = 0; c < 70; c++) {
+            ASSERT_GE(rng.at(r, c), full.at(r, c) - one_step) << r << ", " << c;
+            skipped += rng.at(r, c) > full.at(r, c) + one_step;
+        }
+    }
+    ASSERT_LT(skipped, 50 * 70 / 100);
+
+    ASSERT_THROW(calculator.Calculate_Progressive(cam, t, rng, nullptr, nullptr, 1.0f), 
+                 std::invalid_argument);
+    ASSERT_THROW(calculator.Calculate_Progressive(cam, t, rng, nullptr, nullptr, -0.5f), 
+                 std::invalid_argument);
+}
+
 }
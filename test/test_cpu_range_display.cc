@@ -0,0 +1,112 @@
+//! @file       test_cpu_range_display.cc
+//! @brief      Unit tests for the CPU_Range_Display type
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+
+// CLarity Imports
+#include "buffer.h"
+#include "cpu_range_display.h"
+#include "range_display.h"
+
+// Standard Imports
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Third-Party Imports
+#include "gtest/gtest.h"
+
+namespace
+{
+
+using namespace clarity;
+
+
+TEST(cpu_range_display, matches_scalar)
+{
+    // An odd number of columns leaves a scalar tail on every chunk
+    Buffer rng(301, 257);
+    for (auto r = 0; r < 301; r++) {
+        for (auto c = 0; c < 257; c++) {
+            rng.at(r, c) = 1000.0f + 700.0f * std::sin(r / 23.0f) * std::cos(c / 7.0f);
+        }
+    }
+    rng.at(150, 100) = 12.5f;
+    rng.at(300, 256) = 4000.0f;
+
+    CPU_Range_Display display;
+    std::vector<uint8_t> rgba;
+    const std::pair<float, float> range = display.Convert(rng, rgba);
+    ASSERT_EQ(12.5f, range.first);
+    ASSERT_EQ(4000.0f, range.second);
+    ASSERT_EQ(4u * 301 * 257, rgba.size());
+
+    const float scale = 255.0f / (4000.0f - 12.5f);
+    for (auto r = 0; r < 301; r++) {
+        for (auto c = 0; c < 257; c++) {
+            const uint8_t gray = static_cast<uint8_t>((rng.at(r, c) - 12.5f) * scale);
+            const size_t i = 4 * (r * 257 + c);
+            ASSERT_EQ(gray, rgba[i + 0]) << r << ", " << c;
+            ASSERT_EQ(gray, rgba[i + 1]) << r << ", " << c;
+            ASSERT_EQ(gray, rgba[i + 2]) << r << ", " << c;
+            ASSERT_EQ(255, rgba[i + 3]) << r << ", " << c;
+        }
+    }
+    ASSERT_EQ(0, rgba[4 * (150 * 257 + 100)]);
+    ASSERT_EQ(255, rgba[4 * (300 * 257 + 256)]);
+}
+
+
+TEST(cpu_range_display, thread_count_does_not_change_results)
+{
+    Buffer rng(200, 333);
+    for (auto r = 0; r < 200; r++) {
+        for (auto c = 0; c < 333; c++) {
+            rng.at(r, c) = static_cast<float>((r * 7919 + c * 104729) % 5000);
+        }
+    }
+
+    CPU_Range_Display one(1);
+    CPU_Range_Display four(4);
+    std::vector<uint8_t> expected;
+    std::vector<uint8_t> actual;
+    ASSERT_EQ(one.Convert(rng, expected), four.Convert(rng, actual));
+    ASSERT_EQ(expected, actual);
+}
+
+
+TEST(cpu_range_display, constant_image_is_black)
+{
+    Buffer rng(3, 5);
+    for (auto r = 0; r < 3; r++) {
+        for (auto c = 0; c < 5; c++) {
+            rng.at(r, c) = 42.0f;
+        }
+    }
+
+    CPU_Range_Display display(2);
+    std::vector<uint8_t> rgba;
+    ASSERT_EQ(std::make_pair(42.0f, 42.0f), display.Convert(rng, rgba));
+    for (size_t i = 0; i < rgba.size(); i++) {
+        ASSERT_EQ(i % 4 == 3 ? 255 : 0, rgba[i]) << i;
+    }
+}
+
+
+TEST(cpu_range_display, invalid_buffer_throws)
+{
+    CPU_Range_Display display;
+    std::vector<uint8_t> rgba;
+
+    Buffer empty(0, 10);
+    ASSERT_THROW(display.Convert(empty, rgba), std::invalid_argument);
+
+    Buffer deep(4, 4, 3);
+    ASSERT_THROW(display.Convert(deep, rgba), std::invalid_argument);
+}
+
+}
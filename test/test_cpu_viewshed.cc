@@ -0,0 +1,152 @@
+//! @file       test_cpu_viewshed.cc
+//! @brief      Unit tests for the CPU_Viewshed type
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+
+// CLarity Imports
+#include "buffer.h"
+#include "cpu_viewshed.h"
+#include "terrain.h"
+#include "viewshed.h"
+
+// Standard Imports
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+// Third-Party Imports
+#include "gtest/gtest.h"
+
+namespace
+{
+
+using namespace clarity;
+
+
+//! @brief  Fill a Buffer with rolling hills
+static void _hills(Buffer & b)
+{
+    for (uint32_t i = 0; i < b.size().first; i++) {
+        for (uint32_t j = 0; j < b.size().second; j++) {
+            b.at(i, j) = 20.0f * std::sin(i / 17.0f) * std::cos(j / 11.0f);
+        }
+    }
+}
+
+
+TEST(cpu_viewshed, wall)
+{
+    // A flat plain with a wall across row 40, seen from row 20
+    auto b = std::make_shared<Buffer>(64, 80);
+    for (auto c = 0; c < 80; c++) {
+        b->at(40, c) = 30.0f;
+    }
+    Terrain t(b, 2.0f);
+
+    CPU_Viewshed viewshed;
+    Buffer visible(64, 80);
+    viewshed.Compute(t, Viewshed::Position(41.0f, 81.0f, 10.0f), visible);
+
+    for (auto r = 0; r < 64; r++) {
+        for (auto c = 0; c < 80; c++) {
+            const float expected = r <= 40 ? 1.0f : 0.0f;
+            ASSERT_EQ(expected, visible.at(r, c)) << r << ", " << c;
+        }
+    }
+
+    Buffer wrong_size(64, 64);
+    ASSERT_THROW(viewshed.Compute(t, Viewshed::Position(41.0f, 81.0f, 10.0f), wrong_size),
+                 std::invalid_argument);
+    ASSERT_THROW(viewshed.Compute(t, Viewshed::Position(-1.0f, 81.0f, 10.0f), visible),
+                 std::out_of_range);
+}
+
+
+TEST(cpu_viewshed, matches_brute_force)
+{
+    auto b = std::make_shared<Buffer>(150, 120);
+    _hills(*b);
+    Terrain t(b, 1.0f);
+
+    const uint32_t row = 70;
+    const uint32_t col = 50;
+    const float z = b->at(row, col) + 5.0f;
+
+    CPU_Viewshed viewshed;
+    Buffer visible(150, 120);
+    viewshed.Compute(t, Viewshed::Position(row + 0.5f, col + 0.5f, z), visible);
+
+    // Walk a line from the observer to each cell over the bilinear surface through the cell
+    // centers, stopping a cell short of the target
+    auto reference = [&](const uint32_t r, const uint32_t c) {
+        const float dr = r - static_cast<float>(row);
+        const float dc = c - static_cast<float>(col);
+        const float dz = b->at(r, c) - z;
+        const float len = std::sqrt(dr * dr + dc * dc);
+        const int steps = static_cast<int>(10.0f * len);
+
+        for (int k = 1; k < steps && (steps - k) / 10.0f > 1.0f; k++) {
+            const float f = static_cast<float>(k) / steps;
+            const float sr = row + f * dr;
+            const float sc = col + f * dc;
+            const uint32_t r0 = static_cast<uint32_t>(sr);
+            const uint32_t c0 = static_cast<uint32_t>(sc);
+            const uint32_t r1 = std::min(r0 + 1, 149u);
+            const uint32_t c1 = std::min(c0 + 1, 119u);
+            const float wr = sr - r0;
+            const float wc = sc - c0;
+            const float h = (b->at(r0, c0) * (1 - wc) + b->at(r0, c1) * wc) * (1 - wr)
+                          + (b->at(r1, c0) * (1 - wc) + b->at(r1, c1) * wc) * wr;
+
+            if (z + f * dz < h) {
+                return 0.0f;
+            }
+        }
+        return 1.0f;
+    };
+
+    // The horizon is interpolated, so only cells near the edge of the viewshed may differ
+    uint32_t num_visible = 0;
+    uint32_t mismatches = 0;
+    for (uint32_t r = 0; r < 150; r++) {
+        for (uint32_t c = 0; c < 120; c++) {
+            num_visible += visible.at(r, c) == 1.0f;
+            mismatches += visible.at(r, c) != reference(r, c);
+        }
+    }
+
+    ASSERT_GT(num_visible, 1000u);
+    ASSERT_LT(num_visible, 150u * 120u - 1000u);
+    ASSERT_LT(mismatches, 150u * 120u / 100u);
+}
+
+
+TEST(cpu_viewshed, thread_count_does_not_change_results)
+{
+    auto b = std::make_shared<Buffer>(101, 77);
+    _hills(*b);
+    Terrain t(b, 1.0f);
+
+    const Viewshed::Position observer(30.0f, 60.0f, 25.0f);
+
+    CPU_Viewshed one(1);
+    Buffer expected(101, 77);
+    one.Compute(t, observer, expected);
+
+    CPU_Viewshed four(4);
+    Buffer visible(101, 77);
+    four.Compute(t, observer, visible);
+
+    for (auto r = 0; r < 101; r++) {
+        for (auto c = 0; c < 77; c++) {
+            ASSERT_EQ(expected.at(r, c), visible.at(r, c)) << r << ", " << c;
+        }
+    }
+}
+
+}
@@ -9,7 +9,9 @@
 #include "device_buffer.h"
 
 // Standard Imports
+#include <cstdint>
 #include <memory>
+#include <vector>
 
 // Third-Party Imports
 #include "cl.hpp"
@@ -36,4 +38,73 @@ TEST(device_buffer, copy)
     cl::finish();
 }
 
+
+TEST(device_buffer, dirty_regions)
+{
+    std::shared_ptr<cl::Context> ctx = get_context();
+
+    cl_int err = CL_SUCCESS;
+    cl::CommandQueue q(*ctx, 0, &err);
+    ASSERT_EQ(CL_SUCCESS, err);
+
+    Device_Buffer b(*ctx, 64, 48, 2);
+    b.to_device(&q);
+
+    // Change a patch and one cell outside it, but only record the patch
+    for (uint32_t r = 10; r < 20; r++) {
+        for (uint32_t c = 5; c < 9; c++) {
+            b.at(r, c, 1) = r * 100.0f + c;
+        }
+    }
+    b.at(40, 40) = 9.0f;
+    b.mark_dirty(Buffer::Region { 10, 5, 10, 4 });
+
+    ASSERT_EQ(40u, b.to_device_dirty(&q));
+    ASSERT_TRUE(b.dirty_regions().empty());
+    ASSERT_EQ(0u, b.to_device_dirty(&q));
+
+    // Read the device copy back into separate memory
+    std::vector<float> device(64 * 48 * 2);
+    cl::Buffer handle = b.get_cl_buffer();
+    ASSERT_EQ(CL_SUCCESS, cl::copy(q, handle, device.begin(), device.end()));
+
+    ASSERT_EQ(1507.0f, device[(15 * 48 + 7) * 2 + 1]);
+    ASSERT_EQ(0.0f, device[(15 * 48 + 7) * 2]);
+    ASSERT_EQ(0.0f, device[(15 * 48 + 9) * 2 + 1]);
+}
+
+
+
+TEST(device_buffer, dirty_regions_reach_every_copy)
+{
+    std::shared_ptr<cl::Context> ctx = get_context();
+
+    cl_int err = CL_SUCCESS;
+    cl::CommandQueue q(*ctx, 0, &err);
+    ASSERT_EQ(CL_SUCCESS, err);
+
+    // Two device copies of one host Buffer, as two calculators make
+    Buffer host(64, 48);
+    Device_Buffer first(host, *ctx);
+    Device_Buffer second(host, *ctx);
+    first.to_device(&q);
+    second.to_device(&q);
+
+    host.at(12, 6) = 3.0f;
+    host.mark_dirty(Buffer::Region { 12, 6, 1, 1 });
+
+    // The first upload leaves the rectangle for the second copy
+    ASSERT_EQ(1u, first.to_device_dirty(&q));
+    ASSERT_EQ(1u, host.dirty_regions().size());
+    ASSERT_EQ(0u, first.to_device_dirty(&q));
+
+    ASSERT_EQ(1u, second.to_device_dirty(&q));
+    ASSERT_TRUE(host.dirty_regions().empty());
+
+    std::vector<float> device(64 * 48);
+    cl::Buffer handle = second.get_cl_buffer();
+    ASSERT_EQ(CL_SUCCESS, cl::copy(q, handle, device.begin(), device.end()));
+    ASSERT_EQ(3.0f, device[12 * 48 + 6]);
+}
+
 }
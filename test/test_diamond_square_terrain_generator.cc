@@ -0,0 +1,96 @@
+//! @file       test_diamond_square_terrain_generator.cc
+//! @brief      Unit tests for the Diamond_Square_Generator type
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "buffer.h"
+#include "counter_rng.h"
+#include "diamond_square_terrain_generator.h"
+#include "terrain.h"
+
+// Standard Imports
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+// Third-Party Imports
+#include "gtest/gtest.h"
+
+namespace
+{
+
+using namespace clarity;
+
+static const uint32_t _SIZE = 257;
+
+
+TEST(diamond_square, independent_of_thread_count)
+{
+    Diamond_Square_Generator serial(1234, 1);
+    Terrain expected = serial.generate_terrain(_SIZE, _SIZE, 30.0f, 0.5f);
+
+    for (unsigned threads : { 2u, 3u, 8u }) {
+        Diamond_Square_Generator parallel(1234, threads);
+        Terrain actual = parallel.generate_terrain(_SIZE, _SIZE, 30.0f, 0.5f);
+
+        ASSERT_EQ(0, std::memcmp(expected.data().data().get(), actual.data().data().get(),
+                                 _SIZE * _SIZE * sizeof(float)))
+            << "Terrain differs with " << threads << " threads";
+    }
+}
+
+
+TEST(diamond_square, seeded)
+{
+    Diamond_Square_Generator generator(1, 2);
+    ASSERT_EQ(1u, generator.seed());
+
+    Terrain a = generator.generate_terrain(_SIZE, _SIZE, 30.0f, 0.5f);
+    generator.set_seed(2);
+    Terrain b = generator.generate_terrain(_SIZE, _SIZE, 30.0f, 0.5f);
+
+    uint32_t differences = 0;
+    for (uint32_t r = 0; r < _SIZE; r++) {
+        for (uint32_t c = 0; c < _SIZE; c++) {
+            differences += a.data().at(r, c) != b.data().at(r, c);
+        }
+    }
+
+    // Only the corners are fixed
+    ASSERT_EQ(_SIZE * _SIZE - 4, differences);
+    ASSERT_FLOAT_EQ(50.0f, a.data().at(_SIZE - 1, _SIZE - 1));
+    ASSERT_FLOAT_EQ(50.0f, b.data().at(0, _SIZE - 1));
+}
+
+
+TEST(diamond_square, requires_square_map)
+{
+    Diamond_Square_Generator generator(1);
+    ASSERT_THROW(generator.generate_terrain(129, 257, 30.0f, 0.5f), std::invalid_argument);
+}
+
+
+TEST(counter_rng, uniform_range)
+{
+    float lo = 1.0f;
+    float hi = -1.0f;
+    double sum = 0.0;
+
+    for (uint32_t i = 0; i < 100000; i++) {
+        const float u = counter_rng::uniform(42, i % 13, i / 7, i);
+        lo = std::min(lo, u);
+        hi = std::max(hi, u);
+        sum += u;
+    }
+
+    ASSERT_GE(lo, -1.0f);
+    ASSERT_LT(hi, 1.0f);
+    ASSERT_LT(lo, -0.999f);
+    ASSERT_GT(hi, 0.999f);
+    ASSERT_NEAR(0.0, sum / 100000, 0.01);
+}
+
+}
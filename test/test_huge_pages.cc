@@ -0,0 +1,59 @@
+//! @file       test_huge_pages.cc
+//! @brief      Unit tests for huge-page backed Buffers
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "buffer.h"
+#include "huge_pages.h"
+
+// Standard Imports
+#include <cstdint>
+
+// Third-Party Imports
+#include "gtest/gtest.h"
+
+namespace
+{
+
+using namespace clarity;
+
+
+TEST(huge_pages, small_buffers_use_standard_pages)
+{
+    Buffer b(16, 16, 1, HUGE_PAGES);
+    ASSERT_EQ(huge_pages::STANDARD, b.backing());
+    ASSERT_EQ(huge_pages::STANDARD, Buffer(16, 16).backing());
+}
+
+
+TEST(huge_pages, large_buffer_is_usable)
+{
+    // 8 MB, so several huge pages
+    Buffer b(1024, 1024, 2, HUGE_PAGES);
+
+    for (uint32_t r = 0; r < 1024; r += 7) {
+        for (uint32_t c = 0; c < 1024; c += 13) {
+            ASSERT_EQ(0.0f, b.at(r, c, 1));
+            b.at(r, c, 1) = float(r) - float(c);
+        }
+    }
+    ASSERT_EQ(22.0f, b.at(35, 13, 1));
+    ASSERT_EQ(-13.0f, b.at(0, 13, 1));
+
+    // Copies share the memory, so they share its backing
+    Buffer copy(b);
+    ASSERT_EQ(b.backing(), copy.backing());
+    ASSERT_EQ(b.data().get(), copy.data().get());
+
+    // Pages from the reserved pool are always huge
+    const size_t resident = huge_pages::resident_bytes(b.data().get(), 1024 * 1024 * 2 * 4);
+    if (b.backing() == huge_pages::EXPLICIT) {
+        ASSERT_GE(resident, 1024u * 1024 * 2 * 4);
+    } else if (b.backing() == huge_pages::STANDARD) {
+        ASSERT_EQ(0u, resident);
+    }
+}
+
+}
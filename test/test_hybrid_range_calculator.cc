@@ -0,0 +1,226 @@
+//! @file       test_hybrid_range_calculator.cc
+//! @brief      Unit tests for the Hybrid_Range_Calculator type
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+
+// CLarity Imports
+#include "buffer.h"
+#include "camera.h"
+#include "cl_utils.h"
+#include "cpu_range_calculator.h"
+#include "hybrid_range_calculator.h"
+#include "noise_terrain_generator.h"
+#include "range_calculator.h"
+#include "terrain.h"
+
+// Standard Imports
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+// Third-Party Imports
+#include "gtest/gtest.h"
+
+namespace
+{
+
+using namespace clarity;
+
+
+//! @brief  A CPU calculator that takes an extra 20 ms for every row
+class Slow_Range_Calculator : public CPU_Range_Calculator
+{
+public:
+    void Calculate_Region(const Camera & cam, 
+                          const Terrain & t, 
+                          const uint32_t row0, 
+                          const uint32_t col0, 
+                          Buffer & rng)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20 * rng.size().first));
+        CPU_Range_Calculator::Calculate_Region(cam, t, row0, col0, rng);
+    }
+};
+
+
+//! @brief  A CPU calculator whose range image runs bottom-up, as a CL_Range_Calculator's does
+class Bottom_Up_Range_Calculator : public CPU_Range_Calculator
+{
+public:
+    bool rows_bottom_up() const
+    {
+        return true;
+    }
+
+    void Calculate_Pixels(const Camera & cam, 
+                          const Terrain & t, 
+                          const std::vector<Pixel> & pixels, 
+                          std::vector<float> & ranges)
+    {
+        Calculate_Pixels(cam, t, pixels, std::vector<float>(pixels.size(), 0.0f), ranges);
+    }
+
+    void Calculate_Pixels(const Camera & cam, 
+                          const Terrain & t, 
+                          const std::vector<Pixel> & pixels, 
+                          const std::vector<float> & start,
+                          std::vector<float> & ranges)
+    {
+        CPU_Range_Calculator::Calculate_Pixels(cam, t, flipped(cam, pixels), start, ranges);
+    }
+
+    void Calculate_Region(const Camera & cam, 
+                          const Terrain & t, 
+                          const uint32_t row0, 
+                          const uint32_t col0, 
+                          Buffer & rng)
+    {
+        const uint32_t num_rows = std::get<0>(cam.focal_plane_dimensions());
+        const uint32_t rows = rng.size().first;
+        const uint32_t cols = rng.size().second;
+
+        Buffer top_down(rows, cols);
+        CPU_Range_Calculator::Calculate_Region(cam, t, num_rows - row0 - rows, col0, top_down);
+        for (uint32_t r = 0; r < rows; r++) {
+            for (uint32_t c = 0; c < cols; c++) {
+                rng.at(r, c) = top_down.at(rows - 1 - r, c);
+            }
+        }
+    }
+
+private:
+    static std::vector<Pixel> flipped(const Camera & cam, std::vector<Pixel> pixels)
+    {
+        const uint32_t num_rows = std::get<0>(cam.focal_plane_dimensions());
+        for (auto & p : pixels) {
+            p.first = num_rows - 1 - p.first;
+        }
+        return pixels;
+    }
+};
+
+
+//! @brief  Point a Camera over some noise terrain
+static Camera _camera(const uint32_t rows, const uint32_t cols)
+{
+    Camera cam(60 * M_PI / 180, rows, cols);
+    cam.set_position(std::make_tuple(100.0, 80.0, 40.0));
+    cam.set_pitch(M_PI * 20.0 / 180.0);
+    cam.set_yaw(M_PI * 30.0 / 180.0);
+    return cam;
+}
+
+
+TEST(hybrid_range_calculator, matches_cpu)
+{
+    Noise_Terrain_Generator generator(Noise_Params { 3, 64, 4, 20.0f, 0.5f });
+    Terrain t = generator.generate_terrain(256, 256, 1.0f, 0.5f);
+    const Camera cam = _camera(45, 64);
+
+    CPU_Range_Calculator cpu;
+    Buffer expected(45, 64);
+    cpu.Calculate(cam, t, expected);
+
+    // Every split of the rows gives the same image
+    std::unique_ptr<Range_Calculator> device(new CPU_Range_Calculator);
+    Hybrid_Range_Calculator hybrid(std::move(device), 3);
+    for (auto frame = 0; frame < 3; frame++) {
+        Buffer rng(45, 64);
+        hybrid.Calculate(cam, t, rng);
+        for (auto r = 0; r < 45; r++) {
+            for (auto c = 0; c < 64; c++) {
+                ASSERT_EQ(expected.at(r, c), rng.at(r, c)) << frame << ": " << r << ", " << c;
+            }
+        }
+        ASSERT_FLOAT_EQ(1.0f, hybrid.share(CPU) + hybrid.share(GPU));
+    }
+
+    // As do the pixel queries
+    const std::vector<Range_Calculator::Pixel> pixels { { 0, 0 }, { 44, 63 }, { 20, 5 }, 
+                                                        { 20, 5 }, { 33, 50 } };
+    std::vector<float> ranges;
+    hybrid.Calculate_Pixels(cam, t, pixels, ranges);
+    ASSERT_EQ(pixels.size(), ranges.size());
+    for (size_t i = 0; i < pixels.size(); i++) {
+        ASSERT_EQ(expected.at(pixels[i].first, pixels[i].second), ranges[i]) << i;
+    }
+
+    Buffer wrong(44, 64);
+    ASSERT_THROW(hybrid.Calculate(cam, t, wrong), std::invalid_argument);
+}
+
+
+TEST(hybrid_range_calculator, flips_a_bottom_up_device)
+{
+    Noise_Terrain_Generator generator(Noise_Params { 3, 64, 4, 20.0f, 0.5f });
+    Terrain t = generator.generate_terrain(256, 256, 1.0f, 0.5f);
+    const Camera cam = _camera(45, 64);
+
+    CPU_Range_Calculator cpu;
+    Buffer expected(45, 64);
+    cpu.Calculate(cam, t, expected);
+
+    // The image runs top-down whichever order the device keeps
+    std::unique_ptr<Range_Calculator> device(new Bottom_Up_Range_Calculator);
+    Hybrid_Range_Calculator hybrid(std::move(device), 3);
+    ASSERT_FALSE(hybrid.rows_bottom_up());
+
+    Buffer rng(45, 64);
+    hybrid.Calculate(cam, t, rng);
+    for (auto r = 0; r < 45; r++) {
+        for (auto c = 0; c < 64; c++) {
+            ASSERT_EQ(expected.at(r, c), rng.at(r, c)) << r << ", " << c;
+        }
+    }
+
+    Buffer region(10, 7);
+    hybrid.Calculate_Region(cam, t, 30, 40, region);
+    for (auto r = 0; r < 10; r++) {
+        for (auto c = 0; c < 7; c++) {
+            ASSERT_EQ(expected.at(30 + r, 40 + c), region.at(r, c)) << r << ", " << c;
+        }
+    }
+    ASSERT_THROW(hybrid.Calculate_Region(cam, t, 40, 60, region), std::out_of_range);
+
+    // Every pixel has the same range on either side of the split
+    std::vector<Range_Calculator::Pixel> pixels;
+    for (uint32_t r = 0; r < 45; r += 4) {
+        pixels.emplace_back(r, (r * 7) % 64);
+    }
+    std::vector<float> ranges;
+    hybrid.Calculate_Pixels(cam, t, pixels, ranges);
+    ASSERT_EQ(pixels.size(), ranges.size());
+    for (size_t i = 0; i < pixels.size(); i++) {
+        ASSERT_EQ(expected.at(pixels[i].first, pixels[i].second), ranges[i]) << i;
+    }
+}
+
+
+TEST(hybrid_range_calculator, rebalances_toward_faster_side)
+{
+    Noise_Terrain_Generator generator(Noise_Params { 3, 64, 4, 20.0f, 0.5f });
+    Terrain t = generator.generate_terrain(256, 256, 1.0f, 0.5f);
+    const Camera cam = _camera(32, 32);
+
+    std::unique_ptr<Range_Calculator> device(new Slow_Range_Calculator);
+    Hybrid_Range_Calculator hybrid(std::move(device), 1);
+    ASSERT_FLOAT_EQ(0.5f, hybrid.share(GPU));
+
+    Buffer rng(32, 32);
+    for (auto frame = 0; frame < 6; frame++) {
+        hybrid.Calculate(cam, t, rng);
+    }
+
+    // The slow side keeps only the minimum share needed to stay measured
+    ASSERT_LT(hybrid.share(GPU), 0.1f);
+    ASSERT_GT(hybrid.share(GPU), 0.0f);
+}
+
+}
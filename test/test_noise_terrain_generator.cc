@@ -0,0 +1,89 @@
+//! @file       test_noise_terrain_generator.cc
+//! @brief      Unit tests for the Noise_Terrain_Generator type and the noise functions
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "buffer.h"
+#include "noise.h"
+#include "noise_terrain_generator.h"
+#include "terrain.h"
+
+// Standard Imports
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+// Third-Party Imports
+#include "gtest/gtest.h"
+
+namespace
+{
+
+using namespace clarity;
+
+static const Noise_Params _PARAMS = { 31337, 256, 8, 400.0f, 0.5f };
+
+
+TEST(noise, vector_rows_match_scalar)
+{
+    std::vector<float> row(103);
+
+    for (const int64_t col0 : { static_cast<int64_t>(0), static_cast<int64_t>(-77),
+                                static_cast<int64_t>(1) << 40 }) {
+        noise::fill_row(_PARAMS, -5, col0, row.size(), row.data());
+
+        for (uint32_t c = 0; c < row.size(); c++) {
+            ASSERT_EQ(noise::height(_PARAMS, -5, col0 + c), row[c]) << col0 << " + " << c;
+        }
+    }
+}
+
+
+TEST(noise, invalid_feature_size)
+{
+    Noise_Params params = _PARAMS;
+    params.feature_size = 100;
+    ASSERT_THROW(Noise_Terrain_Generator generator(params), std::invalid_argument);
+}
+
+
+TEST(noise_terrain_generator, rectangular_and_thread_independent)
+{
+    Noise_Terrain_Generator serial(_PARAMS, 1);
+    Noise_Terrain_Generator parallel(_PARAMS, 4);
+
+    Terrain expected = serial.generate_terrain(37, 1001, 30.0f, 0.6f);
+    Terrain actual = parallel.generate_terrain(37, 1001, 30.0f, 0.6f);
+
+    ASSERT_EQ(37u, std::get<0>(actual.data().size()));
+    ASSERT_EQ(1001u, std::get<1>(actual.data().size()));
+    ASSERT_EQ(0, std::memcmp(expected.data().data().get(), actual.data().data().get(),
+                             37 * 1001 * sizeof(float)));
+}
+
+
+TEST(noise_terrain_generator, tiles_match_whole_map)
+{
+    Noise_Terrain_Generator generator(_PARAMS, 3);
+
+    Terrain whole = generator.generate_terrain(128, 96, 30.0f, _PARAMS.persistence);
+
+    // Generate the same map as a 2x3 grid of tiles
+    for (uint32_t tr = 0; tr < 2; tr++) {
+        for (uint32_t tc = 0; tc < 3; tc++) {
+            Buffer tile(64, 32);
+            generator.generate_tile(tr * 64, tc * 32, tile);
+
+            for (uint32_t r = 0; r < 64; r++) {
+                for (uint32_t c = 0; c < 32; c++) {
+                    ASSERT_EQ(whole.data().at(tr * 64 + r, tc * 32 + c), tile.at(r, c));
+                }
+            }
+        }
+    }
+}
+
+}
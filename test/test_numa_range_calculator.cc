@@ -0,0 +1,128 @@
+//! @file       test_numa_range_calculator.cc
+//! @brief      Unit tests for the NUMA_Range_Calculator type and the numa utilities
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+
+// CLarity Imports
+#include "buffer.h"
+#include "camera.h"
+#include "cpu_range_calculator.h"
+#include "noise_terrain_generator.h"
+#include "numa.h"
+#include "numa_range_calculator.h"
+#include "range_calculator.h"
+#include "terrain.h"
+
+// Standard Imports
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+// Third-Party Imports
+#include "gtest/gtest.h"
+
+namespace
+{
+
+using namespace clarity;
+
+
+TEST(numa, topology)
+{
+    const std::vector<numa::Node> nodes = numa::topology();
+    ASSERT_LT(0u, nodes.size());
+
+    // Every node has CPUs, and no CPU is in two nodes
+    std::set<unsigned> cpus;
+    for (const auto & n : nodes) {
+        ASSERT_LT(0u, n.cpus.size());
+        for (const unsigned c : n.cpus) {
+            ASSERT_TRUE(cpus.insert(c).second) << c;
+        }
+    }
+
+    // Placed memory is usable whether or not the kernel honours the placement
+    std::shared_ptr<float> a = numa::allocate_interleaved(100000, nodes);
+    std::shared_ptr<float> b = numa::allocate_on_node(100000, nodes.back());
+    for (auto i = 0; i < 100000; i++) {
+        a.get()[i] = i;
+        b.get()[i] = -i;
+    }
+    ASSERT_EQ(99999.0f, a.get()[99999]);
+    ASSERT_EQ(-99999.0f, b.get()[99999]);
+}
+
+
+TEST(numa_range_calculator, matches_cpu)
+{
+    Noise_Terrain_Generator generator(Noise_Params { 3, 64, 4, 20.0f, 0.5f });
+    Terrain t = generator.generate_terrain(256, 256, 1.0f, 0.5f);
+
+    Camera cam(60 * M_PI / 180, 45, 64);
+    cam.set_position(std::make_tuple(100.0, 80.0, 40.0));
+    cam.set_pitch(M_PI * 20.0 / 180.0);
+    cam.set_yaw(M_PI * 30.0 / 180.0);
+
+    CPU_Range_Calculator cpu;
+    Buffer expected(45, 64);
+    cpu.Calculate(cam, t, expected);
+
+    for (const auto placement : { numa::INTERLEAVE, numa::REPLICATE }) {
+        NUMA_Range_Calculator calculator(placement);
+
+        // The second frame reuses the placed terrain
+        for (auto frame = 0; frame < 2; frame++) {
+            Buffer rng(45, 64);
+            calculator.Calculate(cam, t, rng);
+            for (auto r = 0; r < 45; r++) {
+                for (auto c = 0; c < 64; c++) {
+                    ASSERT_EQ(expected.at(r, c), rng.at(r, c)) << placement << ": " << r << ", "
+                                                               << c;
+                }
+            }
+        }
+
+        // An edit in place is only seen after invalidate
+        auto heights = std::make_shared<Buffer>(256, 256);
+        for (auto r = 0; r < 256; r++) {
+            for (auto c = 0; c < 256; c++) {
+                heights->at(r, c) = t.data().at(r, c);
+            }
+        }
+        Terrain own(heights, 1.0f);
+        Buffer before(45, 64);
+        calculator.Calculate(cam, own, before);
+
+        for (auto r = 0; r < 256; r++) {
+            for (auto c = 0; c < 256; c++) {
+                heights->at(r, c) += 10.0f;
+            }
+        }
+        Buffer stale(45, 64);
+        calculator.Calculate(cam, own, stale);
+
+        calculator.invalidate();
+        Buffer fresh(45, 64);
+        calculator.Calculate(cam, own, fresh);
+        Buffer raised(45, 64);
+        cpu.Calculate(cam, own, raised);
+
+        for (auto r = 0; r < 45; r++) {
+            for (auto c = 0; c < 64; c++) {
+                ASSERT_EQ(before.at(r, c), stale.at(r, c)) << r << ", " << c;
+                ASSERT_EQ(raised.at(r, c), fresh.at(r, c)) << r << ", " << c;
+            }
+        }
+
+        Buffer wrong(44, 64);
+        ASSERT_THROW(calculator.Calculate(cam, t, wrong), std::invalid_argument);
+    }
+}
+
+}
@@ -0,0 +1,124 @@
+//! @file       test_procedural_terrain.cc
+//! @brief      Unit tests for the Procedural_Terrain type
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "buffer.h"
+#include "camera.h"
+#include "cpu_range_calculator.h"
+#include "noise.h"
+#include "procedural_terrain.h"
+#include "terrain.h"
+
+// Standard Imports
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+
+// Third-Party Imports
+#include "gtest/gtest.h"
+
+namespace
+{
+
+using namespace clarity;
+
+
+static Procedural_Terrain_Params _params(const size_t max_tiles)
+{
+    Procedural_Terrain_Params params;
+    params.noise = { 77, 64, 5, 200.0f, 0.5f };
+    params.scale = 30.0f;
+    params.tile_size = 48;
+    params.max_tiles = max_tiles;
+    params.view_distance = 5000.0f;
+    return params;
+}
+
+
+TEST(procedural_terrain, tiles_are_seamless)
+{
+    Procedural_Terrain terrain(_params(16));
+
+    // A region that straddles tiles on both sides of the origin
+    Buffer region(100, 70);
+    terrain.copy_region(-60, -20, region);
+
+    for (int64_t r = 0; r < 100; r += 3) {
+        for (int64_t c = 0; c < 70; c += 3) {
+            const float expected = noise::height(terrain.params().noise, r - 60, c - 20);
+            ASSERT_EQ(expected, region.at(r, c));
+            ASSERT_EQ(expected, terrain.height(r - 60, c - 20));
+        }
+    }
+
+    // Heights vary, and are bounded by the sum of the octave amplitudes
+    ASSERT_NE(region.at(0, 0), region.at(99, 69));
+    ASSERT_LT(std::fabs(region.at(50, 50)), 400.0f);
+}
+
+
+TEST(procedural_terrain, bounded_cache)
+{
+    Procedural_Terrain terrain(_params(4));
+
+    const float first = terrain.height(5, 5);
+    for (int64_t t = 1; t <= 10; t++) {
+        terrain.tile(t, -t);
+    }
+
+    ASSERT_EQ(4u, terrain.cached_tiles());
+    ASSERT_EQ(11u, terrain.tiles_generated());
+
+    // An evicted tile is regenerated identically
+    ASSERT_EQ(first, terrain.height(5, 5));
+    ASSERT_EQ(12u, terrain.tiles_generated());
+
+    // A cached tile is not regenerated
+    terrain.tile(10, -10);
+    ASSERT_EQ(12u, terrain.tiles_generated());
+}
+
+
+TEST(procedural_terrain, invalid_params)
+{
+    Procedural_Terrain_Params params = _params(4);
+    params.noise.feature_size = 48;
+    ASSERT_THROW(Procedural_Terrain p(params), std::invalid_argument);
+
+    params = _params(0);
+    ASSERT_THROW(Procedural_Terrain p(params), std::invalid_argument);
+
+    Terrain t(std::make_shared<Procedural_Terrain>(_params(4)));
+    ASSERT_THROW(t.data(), std::runtime_error);
+}
+
+
+TEST(procedural_terrain, cpu_range)
+{
+    auto source = std::make_shared<Procedural_Terrain>(_params(64));
+    Terrain t(source);
+
+    // Looking straight down from far outside the first tile
+    const float x = -123456.0f * 30.0f;
+    const float y = 98765.0f * 30.0f;
+    Camera cam(10 * M_PI / 180, 16, 16);
+    cam.set_position(std::make_tuple(x, y, 1000.0f));
+    cam.set_pitch(M_PI * 90.0 / 180.0);
+
+    Buffer rng(16, 16);
+    CPU_Range_Calculator calculator;
+    calculator.Calculate(cam, t, rng);
+
+    const float ground = source->height(-123456, 98765);
+    ASSERT_NEAR(1000.0f - ground, rng.at(8, 8), 15.0f);
+
+    // Only the tiles under the view were generated
+    ASSERT_LE(source->tiles_generated(), 4u);
+}
+
+}
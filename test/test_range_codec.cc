@@ -0,0 +1,114 @@
+//! @file       test_range_codec.cc
+//! @brief      Unit tests for the Range_Encoder and Range_Decoder types
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "buffer.h"
+#include "range_codec.h"
+
+// Standard Imports
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// Third-Party Imports
+#include "gtest/gtest.h"
+
+namespace
+{
+
+using namespace clarity;
+
+static const uint32_t _ROWS = 37;
+static const uint32_t _COLS = 53;
+
+
+static Buffer _frame(const uint32_t f)
+{
+    Buffer rng(_ROWS, _COLS);
+
+    for (uint32_t r = 0; r < _ROWS; r++) {
+        for (uint32_t c = 0; c < _COLS; c++) {
+            rng.at(r, c) = 1000.0f + 300.0f * std::sin(0.05f * (r + f)) + 7.0f * c + 0.25f * f;
+        }
+    }
+
+    return rng;
+}
+
+
+TEST(range_codec, round_trip_within_error_bound)
+{
+    const Range_Codec_Params params = { 0.01f, 4, 3 };
+    Range_Encoder encoder(_ROWS, _COLS, params);
+    Range_Decoder decoder(_ROWS, _COLS, 2);
+
+    std::vector<uint8_t> bytes;
+    Buffer out(_ROWS, _COLS);
+
+    for (uint32_t f = 0; f < 10; f++) {
+        const Buffer in = _frame(f);
+        ASSERT_EQ(f % 4 == 0, encoder.encode(in, bytes));
+        ASSERT_EQ(f % 4 == 0, Range_Decoder::is_keyframe(bytes.data(), bytes.size()));
+
+        // Smooth motion should compress well below the raw size
+        ASSERT_LT(bytes.size(), _ROWS * _COLS * sizeof(float));
+
+        decoder.decode(bytes.data(), bytes.size(), out);
+        for (uint32_t r = 0; r < _ROWS; r++) {
+            for (uint32_t c = 0; c < _COLS; c++) {
+                ASSERT_NEAR(in.at(r, c), out.at(r, c), 0.0101f);
+            }
+        }
+    }
+}
+
+
+TEST(range_codec, seek_to_keyframe)
+{
+    const Range_Codec_Params params = { 0.5f, 3, 0 };
+    Range_Encoder encoder(_ROWS, _COLS, params);
+
+    std::vector<std::vector<uint8_t>> frames(6);
+    for (uint32_t f = 0; f < frames.size(); f++) {
+        encoder.encode(_frame(f), frames[f]);
+    }
+
+    // A delta frame cannot be decoded without its reference
+    Range_Decoder decoder(_ROWS, _COLS);
+    Buffer out(_ROWS, _COLS);
+    ASSERT_THROW(decoder.decode(frames[4].data(), frames[4].size(), out), std::runtime_error);
+
+    // Jump to the second keyframe and decode forward from it
+    decoder.decode(frames[3].data(), frames[3].size(), out);
+    decoder.decode(frames[4].data(), frames[4].size(), out);
+    ASSERT_NEAR(_frame(4).at(20, 30), out.at(20, 30), 0.501f);
+
+    decoder.reset();
+    ASSERT_THROW(decoder.decode(frames[5].data(), frames[5].size(), out), std::runtime_error);
+
+    // Truncated frames are rejected
+    ASSERT_THROW(decoder.decode(frames[0].data(), frames[0].size() - 1, out),
+                 std::runtime_error);
+}
+
+
+TEST(range_codec, independent_of_thread_count)
+{
+    std::vector<uint8_t> single;
+    std::vector<uint8_t> multi;
+
+    Range_Encoder encoder_1(_ROWS, _COLS, { 0.1f, 8, 1 });
+    Range_Encoder encoder_4(_ROWS, _COLS, { 0.1f, 8, 4 });
+
+    for (uint32_t f = 0; f < 3; f++) {
+        encoder_1.encode(_frame(f), single);
+        encoder_4.encode(_frame(f), multi);
+        ASSERT_EQ(single, multi);
+    }
+}
+
+}
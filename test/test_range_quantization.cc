@@ -0,0 +1,64 @@
+//! @file       test_range_quantization.cc
+//! @brief      Unit tests for packing range images into 16 bit codes
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "buffer.h"
+#include "range_quantization.h"
+
+// Standard Imports
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// Third-Party Imports
+#include "gtest/gtest.h"
+
+namespace
+{
+
+using namespace clarity;
+
+
+TEST(range_quantization, round_trip_within_half_step)
+{
+    const Range_Quantization q = range_quantization::covering(100.0f, 30000.0f);
+    ASSERT_FLOAT_EQ(100.0f, q.offset);
+    ASSERT_NEAR(29900.0 / 65535.0, q.step, 1e-6);
+
+    Buffer rng(64, 80);
+    for (uint32_t r = 0; r < 64; r++) {
+        for (uint32_t c = 0; c < 80; c++) {
+            rng.at(r, c) = 100.0f + (r * 80 + c) * 5.8391f;
+        }
+    }
+
+    std::vector<uint16_t> codes(64 * 80);
+    range_quantization::quantize(rng, q, codes.data());
+
+    Buffer out(64, 80);
+    range_quantization::dequantize(codes.data(), q, out);
+    for (uint32_t r = 0; r < 64; r++) {
+        for (uint32_t c = 0; c < 80; c++) {
+            ASSERT_NEAR(rng.at(r, c), out.at(r, c), q.step / 2 + 1e-3f);
+        }
+    }
+
+    ASSERT_EQ(0u, codes[0]);
+    ASSERT_EQ(0u, range_quantization::quantize(-50.0f, q));
+    ASSERT_EQ(range_quantization::MAX_CODE, range_quantization::quantize(30000.0f, q));
+    ASSERT_EQ(range_quantization::MAX_CODE, range_quantization::quantize(1e9f, q));
+    ASSERT_EQ(0u, range_quantization::quantize(NAN, q));
+}
+
+
+TEST(range_quantization, invalid_span)
+{
+    ASSERT_THROW(range_quantization::covering(10.0f, 10.0f), std::invalid_argument);
+    ASSERT_THROW(range_quantization::covering(10.0f, 5.0f), std::invalid_argument);
+}
+
+}
@@ -0,0 +1,168 @@
+//! @file       test_range_sequence.cc
+//! @brief      Unit tests for the Range_Sequence_Writer and Range_Sequence_Reader types
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "buffer.h"
+#include "camera.h"
+#include "range_quantization.h"
+#include "range_sequence.h"
+
+// Standard Imports
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Third-Party Imports
+#include "gtest/gtest.h"
+
+namespace
+{
+
+using namespace clarity;
+
+static const std::string _SEQUENCE_FILE = "test_range_sequence.clrs";
+
+
+static void _write_frames(Range_Sequence_Writer & writer, const uint32_t count)
+{
+    Camera cam(90 * M_PI / 180, 32, 48);
+    Buffer rng(32, 48);
+
+    for (uint32_t f = 0; f < count; f++) {
+        for (auto r = 0; r < 32; r++) {
+            for (auto c = 0; c < 48; c++) {
+                rng.at(r, c) = f * 10000.0f + r * 48 + c;
+            }
+        }
+
+        cam.set_position(std::make_tuple(f * 1.0f, f * 2.0f, 1000.0f));
+        cam.set_yaw(f * 0.1f);
+        writer.append(cam, rng, f * 0.5);
+    }
+}
+
+
+TEST(range_sequence, round_trip)
+{
+    {
+        Range_Sequence_Writer writer(_SEQUENCE_FILE, 32, 48, 2);
+        _write_frames(writer, 10);
+        writer.close();
+
+        ASSERT_EQ(10u, writer.size());
+    }
+
+    Range_Sequence_Reader reader(_SEQUENCE_FILE);
+    ASSERT_EQ(10u, reader.size());
+    ASSERT_EQ(32u, reader.frame_size().first);
+    ASSERT_EQ(48u, reader.frame_size().second);
+
+    // Jump around the sequence rather than reading it in order
+    for (uint32_t f : { 7u, 0u, 9u, 3u }) {
+        const Buffer rng = reader.frame(f);
+        ASSERT_FLOAT_EQ(f * 10000.0f, rng.at(0, 0));
+        ASSERT_FLOAT_EQ(f * 10000.0f + 5 * 48 + 6, rng.at(5, 6));
+
+        const Camera cam = reader.camera(f);
+        ASSERT_FLOAT_EQ(f * 2.0f, std::get<1>(cam.position()));
+        ASSERT_FLOAT_EQ(f * 0.1f, cam.yaw());
+        ASSERT_DOUBLE_EQ(f * 0.5, reader.timestamp(f));
+    }
+
+    ASSERT_THROW(reader.frame(10), std::out_of_range);
+    std::remove(_SEQUENCE_FILE.c_str());
+}
+
+
+TEST(range_sequence, recover_unclosed_file)
+{
+    {
+        Range_Sequence_Writer writer(_SEQUENCE_FILE, 32, 48);
+        _write_frames(writer, 4);
+        writer.flush();
+
+        // Read the file before the index has been written
+        Range_Sequence_Reader reader(_SEQUENCE_FILE);
+        ASSERT_EQ(4u, reader.size());
+        ASSERT_FLOAT_EQ(3 * 10000.0f + 47, reader.frame(3).at(0, 47));
+    }
+
+    std::remove(_SEQUENCE_FILE.c_str());
+}
+
+
+TEST(range_sequence, compressed_frames)
+{
+    {
+        Range_Sequence_Writer writer(_SEQUENCE_FILE, 32, 48, { 0.5f, 4, 2 });
+        _write_frames(writer, 10);
+        writer.close();
+    }
+
+    Range_Sequence_Reader reader(_SEQUENCE_FILE);
+    ASSERT_EQ(10u, reader.size());
+
+    // Seeks decode from a keyframe; sequential reads continue from the last frame
+    for (uint32_t f : { 6u, 7u, 2u, 9u, 0u, 1u }) {
+        const Buffer rng = reader.frame(f);
+        ASSERT_NEAR(f * 10000.0f + 5 * 48 + 6, rng.at(5, 6), 0.5f);
+        ASSERT_NEAR(f * 10000.0f + 31 * 48 + 47, rng.at(31, 47), 0.5f);
+        ASSERT_FLOAT_EQ(f * 0.1f, reader.camera(f).yaw());
+    }
+
+    std::remove(_SEQUENCE_FILE.c_str());
+}
+
+
+TEST(range_sequence, quantized_frames)
+{
+    const Range_Quantization q { 0.0f, 0.5f };
+    {
+        Range_Sequence_Writer writer(_SEQUENCE_FILE, 32, 48, q);
+        _write_frames(writer, 4);
+
+        // Frames packed elsewhere are written as they are
+        Camera cam(90 * M_PI / 180, 32, 48);
+        std::vector<uint16_t> codes(32 * 48, 7);
+        writer.append(cam, codes, Range_Quantization { 100.0f, 2.0f }, 2.0);
+        ASSERT_THROW(writer.append(cam, std::vector<uint16_t>(5), q), std::invalid_argument);
+        writer.close();
+    }
+
+    Range_Sequence_Reader reader(_SEQUENCE_FILE);
+    ASSERT_EQ(5u, reader.size());
+
+    for (uint32_t f : { 3u, 0u }) {
+        const Buffer rng = reader.frame(f);
+        ASSERT_NEAR(f * 10000.0f + 5 * 48 + 6, rng.at(5, 6), 0.25f);
+        ASSERT_NEAR(f * 10000.0f + 31 * 48 + 47, rng.at(31, 47), 0.25f);
+        ASSERT_FLOAT_EQ(f * 0.1f, reader.camera(f).yaw());
+    }
+
+    ASSERT_FLOAT_EQ(114.0f, reader.frame(4).at(10, 10));
+    ASSERT_DOUBLE_EQ(2.0, reader.timestamp(4));
+
+    std::remove(_SEQUENCE_FILE.c_str());
+}
+
+
+TEST(range_sequence, wrong_frame_size)
+{
+    Range_Sequence_Writer writer(_SEQUENCE_FILE, 32, 48);
+    Camera cam(90 * M_PI / 180, 16, 16);
+    Buffer rng(16, 16);
+
+    ASSERT_THROW(writer.append(cam, rng), std::invalid_argument);
+
+    writer.close();
+    std::remove(_SEQUENCE_FILE.c_str());
+}
+
+}
@@ -0,0 +1,343 @@
+//! @file       test_render_server.cc
+//! @brief      Unit tests for the Render_Server type
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "buffer.h"
+#include "camera.h"
+#include "cpu_line_of_sight.h"
+#include "cpu_range_calculator.h"
+#include "line_of_sight.h"
+#include "range_calculator.h"
+#include "range_quantization.h"
+#include "render_server.h"
+#include "terrain.h"
+
+// Standard Imports
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Third-Party Imports
+#include "gtest/gtest.h"
+
+namespace
+{
+
+using namespace clarity;
+using namespace clarity::server_protocol;
+
+static const std::string _TERRAIN_FILE = "test_render_server.ter";
+
+
+//! @brief  A CPU calculator whose range image runs bottom-up, as a CL_Range_Calculator's does
+class Bottom_Up_Range_Calculator : public CPU_Range_Calculator
+{
+public:
+    bool rows_bottom_up() const
+    {
+        return true;
+    }
+
+    void Calculate(const Camera & cam, const Terrain & t, Buffer & rng)
+    {
+        CPU_Range_Calculator::Calculate(cam, t, rng);
+
+        const uint32_t rows = rng.size().first;
+        for (uint32_t r = 0; r < rows / 2; r++) {
+            for (uint32_t c = 0; c < rng.size().second; c++) {
+                std::swap(rng.at(r, c), rng.at(rows - 1 - r, c));
+            }
+        }
+    }
+};
+
+
+//! @brief  A server, and a client connected to it over a socket pair
+class Connection
+{
+public:
+    explicit Connection(std::unique_ptr<Range_Calculator> calculator)
+        : m_server(std::move(calculator),
+                   std::unique_ptr<Line_Of_Sight>(new CPU_Line_Of_Sight(2)))
+        , m_fds()
+        , m_thread()
+    {
+        if (::socketpair(AF_UNIX, SOCK_STREAM, 0, m_fds) != 0) {
+            throw std::runtime_error("socketpair failed");
+        }
+
+        m_thread = std::thread([this]() { m_server.serve_connection(m_fds[1]); });
+    }
+
+    ~Connection()
+    {
+        ::shutdown(m_fds[0], SHUT_RDWR);
+        finish();
+        ::close(m_fds[0]);
+        ::close(m_fds[1]);
+    }
+
+    //! @brief  Wait for the server to stop serving the connection
+    void finish()
+    {
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    //! @brief  Send raw bytes to the server
+    void send(const void * bytes, const size_t n)
+    {
+        ASSERT_EQ(static_cast<ssize_t>(n), ::write(m_fds[0], bytes, n));
+    }
+
+    //! @brief  Send a request and read its reply
+    std::vector<char> request(const uint32_t type,
+                              const uint32_t id,
+                              const std::vector<char> & payload,
+                              uint32_t & status)
+    {
+        const Message_Header h { MAGIC, type, id, static_cast<uint32_t>(payload.size()) };
+        send(&h, sizeof(h));
+        send(payload.data(), payload.size());
+        return reply(id, status);
+    }
+
+    //! @brief  Read a reply
+    std::vector<char> reply(const uint32_t id, uint32_t & status)
+    {
+        Message_Header h;
+        read(&h, sizeof(h));
+        EXPECT_EQ(MAGIC, h.magic);
+        EXPECT_EQ(id, h.id);
+        status = h.type;
+
+        std::vector<char> payload(h.payload_bytes);
+        read(payload.data(), payload.size());
+        return payload;
+    }
+
+private:
+    void read(void * dst, size_t n)
+    {
+        char * p = static_cast<char *>(dst);
+        while (n > 0) {
+            const ssize_t got = ::read(m_fds[0], p, n);
+            ASSERT_GT(got, 0);
+            p += got;
+            n -= got;
+        }
+    }
+
+    Render_Server m_server;
+    int m_fds[2];
+    std::thread m_thread;
+};
+
+
+//! @brief  Write a terrain file that slopes up along the rows
+static Terrain _write_terrain()
+{
+    auto b = std::make_shared<Buffer>(64, 64);
+    for (uint32_t i = 0; i < 64; i++) {
+        for (uint32_t j = 0; j < 64; j++) {
+            b->at(i, j) = 0.25f * i + 2.0f * std::sin(j / 5.0f);
+        }
+    }
+
+    const uint32_t size = 64;
+    const float scale = 1.0f;
+    std::ofstream out(_TERRAIN_FILE, std::ios::out | std::ios::binary);
+    out.write(reinterpret_cast<const char *>(&size), 4);
+    out.write(reinterpret_cast<const char *>(&scale), 4);
+    out.write(reinterpret_cast<const char *>(b->data().get()), 64 * 64 * sizeof(float));
+
+    return Terrain(b, scale);
+}
+
+
+//! @brief  Get the bytes of a value
+template <typename T>
+static std::vector<char> _bytes(const T & value)
+{
+    const char * p = reinterpret_cast<const char *>(&value);
+    return std::vector<char>(p, p + sizeof(value));
+}
+
+
+//! @brief  A request for a camera looking down the slope of the test terrain
+static Render_Request _render_request(const uint32_t quantized)
+{
+    Render_Request r;
+    r.terrain = 0;
+    r.rows = 12;
+    r.cols = 16;
+    r.quantized = quantized;
+    r.fov = 60 * M_PI / 180;
+    r.position[0] = 32.0f;
+    r.position[1] = 32.0f;
+    r.position[2] = 40.0f;
+    r.yaw = 0.0f;
+    r.pitch = 50 * M_PI / 180;
+    return r;
+}
+
+
+//! @brief  Render the camera of a request on the host
+static Buffer _expected_render(const Terrain & t, const Render_Request & r)
+{
+    Camera cam(r.fov, r.rows, r.cols);
+    cam.set_position(std::make_tuple(r.position[0], r.position[1], r.position[2]));
+    cam.set_yaw(r.yaw);
+    cam.set_pitch(r.pitch);
+
+    CPU_Range_Calculator calculator;
+    Buffer expected(r.rows, r.cols);
+    calculator.Calculate(cam, t, expected);
+    return expected;
+}
+
+
+//! @brief  Check every request type against a server rendering with a calculator
+static void _check_requests(std::unique_ptr<Range_Calculator> calculator)
+{
+    const Terrain t = _write_terrain();
+    Connection c(std::move(calculator));
+    uint32_t status = Status::ERROR;
+
+    // LOAD_TERRAIN, twice, and a missing file
+    const std::vector<char> path(_TERRAIN_FILE.begin(), _TERRAIN_FILE.end());
+    for (uint32_t id = 1; id <= 2; id++) {
+        const std::vector<char> payload = c.request(LOAD_TERRAIN, id, path, status);
+        ASSERT_EQ(Status::OK, status);
+        ASSERT_EQ(sizeof(Terrain_Info), payload.size());
+
+        Terrain_Info info;
+        std::memcpy(&info, payload.data(), sizeof(info));
+        ASSERT_EQ(0u, info.terrain);
+        ASSERT_EQ(64u, info.rows);
+        ASSERT_EQ(64u, info.cols);
+        ASSERT_EQ(1.0f, info.scale);
+    }
+
+    const std::string missing = "no_such_terrain.ter";
+    c.request(LOAD_TERRAIN, 3, std::vector<char>(missing.begin(), missing.end()), status);
+    ASSERT_EQ(Status::ERROR, status);
+
+    // RENDER comes back top-down, as a CPU_Range_Calculator renders it
+    const Render_Request r = _render_request(0);
+    const Buffer expected = _expected_render(t, r);
+    std::vector<char> payload = c.request(RENDER, 4, _bytes(r), status);
+    ASSERT_EQ(Status::OK, status);
+    ASSERT_EQ(12u * 16 * sizeof(float), payload.size());
+
+    std::vector<float> ranges(12 * 16);
+    std::memcpy(ranges.data(), payload.data(), payload.size());
+    for (uint32_t i = 0; i < 12; i++) {
+        for (uint32_t j = 0; j < 16; j++) {
+            ASSERT_EQ(expected.at(i, j), ranges[i * 16 + j]) << i << ", " << j;
+        }
+    }
+
+    // The quantized RENDER is in the same order
+    payload = c.request(RENDER, 5, _bytes(_render_request(1)), status);
+    ASSERT_EQ(Status::OK, status);
+    ASSERT_EQ(sizeof(Range_Quantization) + 12 * 16 * sizeof(uint16_t), payload.size());
+
+    Range_Quantization q;
+    std::memcpy(&q.offset, payload.data(), sizeof(float));
+    std::memcpy(&q.step, payload.data() + sizeof(float), sizeof(float));
+    std::vector<uint16_t> codes(12 * 16);
+    std::memcpy(codes.data(), payload.data() + sizeof(q), codes.size() * sizeof(uint16_t));
+    for (uint32_t i = 0; i < 12; i++) {
+        for (uint32_t j = 0; j < 16; j++) {
+            ASSERT_NEAR(expected.at(i, j),
+                        range_quantization::dequantize(codes[i * 16 + j], q),
+                        q.step) << i << ", " << j;
+        }
+    }
+
+    // A RENDER of an unknown terrain, and of a bad size, fail without closing the connection
+    Render_Request bad = _render_request(0);
+    bad.terrain = 9;
+    c.request(RENDER, 6, _bytes(bad), status);
+    ASSERT_EQ(Status::ERROR, status);
+    c.request(RENDER, 7, std::vector<char>(3), status);
+    ASSERT_EQ(Status::ERROR, status);
+
+    // LINE_OF_SIGHT, one line over the slope and one into it
+    const std::vector<Line_Of_Sight::Point> observers { Line_Of_Sight::Point(5.0f, 5.0f, 30.0f),
+                                                        Line_Of_Sight::Point(5.0f, 30.0f, 10.0f) };
+    const std::vector<Line_Of_Sight::Point> targets { Line_Of_Sight::Point(60.0f, 50.0f, 30.0f),
+                                                      Line_Of_Sight::Point(60.0f, 30.0f, 10.0f) };
+    std::vector<uint8_t> visible;
+    std::vector<float> distance;
+    CPU_Line_Of_Sight los(1);
+    Terrain reference(t);
+    reference.build_pyramid();
+    los.Check(reference, observers, targets, visible, distance);
+
+    std::vector<char> los_payload = _bytes(Los_Request { 0, 2 });
+    for (const auto * points : { &observers, &targets }) {
+        for (const auto & p : *points) {
+            for (const float v : { std::get<0>(p), std::get<1>(p), std::get<2>(p) }) {
+                const std::vector<char> b = _bytes(v);
+                los_payload.insert(los_payload.end(), b.begin(), b.end());
+            }
+        }
+    }
+
+    payload = c.request(LINE_OF_SIGHT, 8, los_payload, status);
+    ASSERT_EQ(Status::OK, status);
+    ASSERT_EQ(2 * (sizeof(float) + 1), payload.size());
+
+    float distances[2];
+    std::memcpy(distances, payload.data(), sizeof(distances));
+    for (size_t i = 0; i < 2; i++) {
+        ASSERT_EQ(distance[i], distances[i]) << i;
+        ASSERT_EQ(visible[i], static_cast<uint8_t>(payload[2 * sizeof(float) + i])) << i;
+    }
+    ASSERT_NE(visible[0], visible[1]);
+
+    los_payload.pop_back();
+    c.request(LINE_OF_SIGHT, 9, los_payload, status);
+    ASSERT_EQ(Status::ERROR, status);
+
+    // A malformed header is answered, and then the connection is closed
+    const Message_Header malformed { MAGIC + 1, RENDER, 10, 0 };
+    c.send(&malformed, sizeof(malformed));
+    c.reply(10, status);
+    ASSERT_EQ(Status::ERROR, status);
+    c.finish();
+
+    std::remove(_TERRAIN_FILE.c_str());
+}
+
+
+TEST(render_server, answers_requests)
+{
+    _check_requests(std::unique_ptr<Range_Calculator>(new CPU_Range_Calculator));
+}
+
+
+TEST(render_server, renders_top_down_from_a_bottom_up_calculator)
+{
+    _check_requests(std::unique_ptr<Range_Calculator>(new Bottom_Up_Range_Calculator));
+}
+
+}
@@ -0,0 +1,166 @@
+//! @file       test_residency_manager.cc
+//! @brief      Unit tests for the Residency_Manager type
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "buffer.h"
+#include "cl_utils.h"
+#include "device_buffer.h"
+#include "residency_manager.h"
+#include "terrain.h"
+
+// Standard Imports
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Third-Party Imports
+#include "cl.hpp"
+#include "gtest/gtest.h"
+
+namespace
+{
+
+using namespace clarity;
+
+
+TEST(residency_manager, uploads_once_until_dirty)
+{
+    std::shared_ptr<cl::Context> ctx = get_context();
+    Residency_Manager residency(ctx);
+
+    Buffer b(64, 32);
+    b.at(3, 4) = 7.0f;
+
+    std::shared_ptr<Device_Buffer> first = residency.acquire(b);
+    ASSERT_EQ(1u, residency.uploads());
+    ASSERT_EQ(64u * 32 * sizeof(float), residency.resident_bytes());
+
+    // A copy of the Buffer shares its memory, so it shares the device copy too
+    Buffer copy(b);
+    ASSERT_EQ(first, residency.acquire(copy));
+    ASSERT_EQ(1u, residency.uploads());
+
+    residency.mark_host_dirty(b);
+    ASSERT_EQ(first, residency.acquire(b));
+    ASSERT_EQ(2u, residency.uploads());
+    ASSERT_EQ(7.0f, first->at(3, 4));
+}
+
+
+TEST(residency_manager, uploads_edited_regions)
+{
+    std::shared_ptr<cl::Context> ctx = get_context();
+    Residency_Manager residency(ctx);
+
+    Terrain t(512, 512, 10.0f);
+    residency.acquire(t.data());
+    ASSERT_EQ(512u * 512 * sizeof(float), residency.uploaded_bytes());
+
+    t.edit(Buffer::Region { 200, 300, 16, 8 }, [](uint32_t, uint32_t, float & h) { h += 2.0f; });
+    std::shared_ptr<Device_Buffer> device = residency.acquire(t.data());
+
+    ASSERT_EQ(2u, residency.uploads());
+    ASSERT_EQ((512u * 512 + 16 * 8) * sizeof(float), residency.uploaded_bytes());
+    ASSERT_TRUE(t.data().dirty_regions().empty());
+
+    // Nothing changed since, so nothing is sent
+    residency.acquire(t.data());
+    ASSERT_EQ(2u, residency.uploads());
+}
+
+
+TEST(residency_manager, edits_reach_every_manager)
+{
+    std::shared_ptr<cl::Context> ctx = get_context();
+
+    // Each calculator keeps a manager of its own
+    Residency_Manager first(ctx);
+    Residency_Manager second(ctx);
+
+    Terrain t(256, 256, 10.0f);
+    first.acquire(t.data());
+    second.acquire(t.data());
+
+    t.edit(Buffer::Region { 10, 20, 4, 4 }, [](uint32_t, uint32_t, float & h) { h = 5.0f; });
+    first.acquire(t.data());
+    std::shared_ptr<Device_Buffer> device = second.acquire(t.data());
+
+    ASSERT_EQ(2u, first.uploads());
+    ASSERT_EQ(2u, second.uploads());
+    ASSERT_EQ((256u * 256 + 4 * 4) * sizeof(float), second.uploaded_bytes());
+    ASSERT_TRUE(t.data().dirty_regions().empty());
+
+    std::vector<float> heights(256 * 256);
+    cl::Buffer handle = device->get_cl_buffer();
+    ASSERT_EQ(CL_SUCCESS, cl::copy(handle, heights.begin(), heights.end()));
+    ASSERT_EQ(5.0f, heights[11 * 256 + 21]);
+}
+
+
+TEST(residency_manager, evicts_least_recently_used)
+{
+    std::shared_ptr<cl::Context> ctx = get_context();
+    const size_t bytes = 64 * 64 * sizeof(float);
+    Residency_Manager residency(ctx, 2 * bytes);
+
+    Buffer a(64, 64);
+    Buffer b(64, 64);
+    Buffer c(64, 64);
+
+    residency.acquire(a);
+    residency.acquire(b);
+    residency.acquire(a);
+    residency.acquire(c);
+
+    ASSERT_TRUE(residency.is_resident(a));
+    ASSERT_FALSE(residency.is_resident(b));
+    ASSERT_TRUE(residency.is_resident(c));
+    ASSERT_EQ(2 * bytes, residency.resident_bytes());
+
+    // Shrinking the budget evicts down to it
+    residency.set_budget(bytes);
+    ASSERT_TRUE(residency.is_resident(c));
+    ASSERT_FALSE(residency.is_resident(a));
+    ASSERT_EQ(bytes, residency.resident_bytes());
+}
+
+
+TEST(residency_manager, copies_device_writes_back)
+{
+    std::shared_ptr<cl::Context> ctx = get_context();
+    Residency_Manager residency(ctx);
+
+    Buffer b(16, 16);
+    std::shared_ptr<Device_Buffer> device = residency.acquire(b);
+
+    // Stand in for a kernel that writes the device copy
+    std::vector<float> written(16 * 16, 3.0f);
+    cl::Buffer handle = device->get_cl_buffer();
+    ASSERT_EQ(CL_SUCCESS, cl::copy(written.begin(), written.end(), handle));
+    residency.mark_device_dirty(b);
+
+    residency.evict(b);
+    ASSERT_FALSE(residency.is_resident(b));
+    ASSERT_EQ(3.0f, b.at(15, 15));
+}
+
+
+TEST(residency_manager, drops_released_buffers)
+{
+    std::shared_ptr<cl::Context> ctx = get_context();
+    Residency_Manager residency(ctx);
+
+    {
+        Buffer b(32, 32);
+        residency.acquire(b);
+    }
+
+    Buffer other(8, 8);
+    residency.acquire(other);
+    ASSERT_EQ(8u * 8 * sizeof(float), residency.resident_bytes());
+}
+
+}
@@ -9,8 +9,11 @@
 #include "terrain.h"
 
 // Standard Imports
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <memory>
+#include <stdexcept>
 #include <utility>
 
 // Third-Party Importss
@@ -79,4 +82,92 @@ TEST(terrain, assignment_and_copy)
 }
 
 
+TEST(terrain, edit_records_dirty_regions)
+{
+    Terrain t(256, 256, 30.0);
+    t.build_pyramid();
+    const uint64_t version = t.pyramid()->version();
+
+    // Cut a crater, 5 cells deep at the centre
+    t.edit(Buffer::Region { 100, 120, 9, 9 }, [](uint32_t r, uint32_t c, float & h) {
+        const float dr = float(r) - 104.0f;
+        const float dc = float(c) - 124.0f;
+        h -= std::max(0.0f, 5.0f - std::sqrt(dr * dr + dc * dc));
+    });
+
+    ASSERT_FLOAT_EQ(-5.0f, t.data().at(104, 124));
+    ASSERT_FLOAT_EQ(0.0f, t.data().at(100, 120));
+    ASSERT_FLOAT_EQ(0.0f, t.data().at(99, 124));
+    ASSERT_GT(t.pyramid()->version(), version);
+
+    // Copies of the buffer share the record
+    Buffer copy(t.data());
+    ASSERT_EQ(1u, copy.dirty_regions().size());
+    ASSERT_EQ(100u, copy.dirty_regions()[0].row);
+    ASSERT_EQ(120u, copy.dirty_regions()[0].col);
+    ASSERT_EQ(9u, copy.dirty_regions()[0].rows);
+    ASSERT_EQ(9u, copy.dirty_regions()[0].cols);
+
+    ASSERT_THROW(t.edit(Buffer::Region { 250, 0, 7, 1 }, [](uint32_t, uint32_t, float &) {}),
+                 std::out_of_range);
+
+    copy.clear_dirty();
+    ASSERT_TRUE(t.data().dirty_regions().empty());
+}
+
+
+TEST(terrain, dirty_regions_merge)
+{
+    Buffer b(128, 128);
+
+    // Apart, touching, then bridging the first two
+    b.mark_dirty(Buffer::Region { 0, 0, 4, 4 });
+    b.mark_dirty(Buffer::Region { 10, 10, 4, 4 });
+    ASSERT_EQ(2u, b.dirty_regions().size());
+    b.mark_dirty(Buffer::Region { 14, 10, 2, 4 });
+    ASSERT_EQ(2u, b.dirty_regions().size());
+    b.mark_dirty(Buffer::Region { 3, 3, 8, 8 });
+    ASSERT_EQ(1u, b.dirty_regions().size());
+    ASSERT_EQ(16u, b.dirty_regions()[0].rows);
+    ASSERT_EQ(14u, b.dirty_regions()[0].cols);
+
+    // Too many rectangles collapse into their bounds
+    b.clear_dirty();
+    for (uint32_t i = 0; i < 40; i++) {
+        b.mark_dirty(Buffer::Region { 3 * i, 3 * (i % 2) * 20, 1, 1 });
+    }
+    ASSERT_LE(b.dirty_regions().size(), 32u);
+    for (uint32_t i = 0; i < 40; i++) {
+        bool covered = false;
+        for (const auto & r : b.dirty_regions()) {
+            covered |= r.row <= 3 * i && 3 * i < r.row + r.rows;
+        }
+        ASSERT_TRUE(covered) << i;
+    }
+}
+
+
+
+TEST(terrain, dirty_generations)
+{
+    Buffer b(128, 128);
+    ASSERT_EQ(0u, b.dirty_generation());
+
+    b.mark_dirty(Buffer::Region { 0, 0, 4, 4 });
+    b.mark_dirty(Buffer::Region { 50, 50, 4, 4 });
+    ASSERT_EQ(2u, b.dirty_generation());
+    ASSERT_EQ(2u, b.dirty_regions_since(0).size());
+
+    // A reader that has seen the first rectangle only needs the second
+    ASSERT_EQ(1u, b.dirty_regions_since(1).size());
+    ASSERT_EQ(50u, b.dirty_regions_since(1)[0].row);
+    ASSERT_TRUE(b.dirty_regions_since(2).empty());
+
+    // Growing the first rectangle makes it new again
+    b.mark_dirty(Buffer::Region { 2, 2, 4, 4 });
+    ASSERT_EQ(1u, b.dirty_regions_since(2).size());
+    ASSERT_EQ(0u, b.dirty_regions_since(2)[0].row);
+    ASSERT_EQ(6u, b.dirty_regions_since(2)[0].rows);
+}
+
 }
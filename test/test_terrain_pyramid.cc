@@ -0,0 +1,192 @@
+//! @file       test_terrain_pyramid.cc
+//! @brief      Unit tests for the Terrain_Pyramid type
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+
+// CLarity Imports
+#include "buffer.h"
+#include "terrain.h"
+#include "terrain_pyramid.h"
+
+// Standard Imports
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+// Third-Party Imports
+#include "gtest/gtest.h"
+
+namespace
+{
+
+using namespace clarity;
+
+
+//! @brief  Fill a Buffer with heights that differ in every cell
+static void _fill(Buffer & b)
+{
+    for (uint32_t r = 0; r < b.size().first; r++) {
+        for (uint32_t c = 0; c < b.size().second; c++) {
+            b.at(r, c) = static_cast<float>((r * 37 + c * 101) % 257) - 128.0f;
+        }
+    }
+}
+
+
+TEST(terrain_pyramid, level_sizes)
+{
+    Buffer b(37, 20);
+    _fill(b);
+
+    Terrain_Pyramid pyramid(b);
+
+    // 37x20 -> 19x10 -> 10x5 -> 5x3 -> 3x2 -> 2x1 -> 1x1
+    ASSERT_EQ(6u, pyramid.levels());
+    ASSERT_EQ(std::make_pair(37u, 20u), pyramid.size(0));
+    ASSERT_EQ(std::make_pair(19u, 10u), pyramid.size(1));
+    ASSERT_EQ(std::make_pair(1u, 1u), pyramid.size(6));
+    ASSERT_THROW(pyramid.size(7), std::out_of_range);
+
+    // Levels are packed one after another
+    ASSERT_EQ(0u, pyramid.offset(1));
+    ASSERT_EQ(19u * 10u, pyramid.offset(2));
+    ASSERT_EQ(19u * 10u + 10u * 5u, pyramid.offset(3));
+
+    Terrain_Pyramid limited(b, 2);
+    ASSERT_EQ(2u, limited.levels());
+}
+
+
+TEST(terrain_pyramid, min_max_cover_each_block)
+{
+    Buffer b(37, 20);
+    _fill(b);
+
+    Terrain_Pyramid pyramid(b);
+
+    for (uint32_t level = 1; level <= pyramid.levels(); level++) {
+        const uint32_t block = 1u << level;
+
+        for (uint32_t r = 0; r < pyramid.size(level).first; r++) {
+            for (uint32_t c = 0; c < pyramid.size(level).second; c++) {
+                float lo = b.at(r * block, c * block);
+                float hi = lo;
+
+                for (uint32_t i = r * block; i < std::min((r + 1) * block, 37u); i++) {
+                    for (uint32_t j = c * block; j < std::min((c + 1) * block, 20u); j++) {
+                        lo = std::min(lo, b.at(i, j));
+                        hi = std::max(hi, b.at(i, j));
+                    }
+                }
+
+                ASSERT_EQ(lo, pyramid.min(level, r, c)) << "level " << level;
+                ASSERT_EQ(hi, pyramid.max(level, r, c)) << "level " << level;
+            }
+        }
+    }
+}
+
+
+TEST(terrain_pyramid, rebuild)
+{
+    Buffer b(64, 64);
+    _fill(b);
+
+    Terrain_Pyramid pyramid(b);
+    const uint64_t version = pyramid.version();
+
+    b.at(10, 10) = 1000.0f;
+    pyramid.rebuild(b);
+
+    ASSERT_NE(version, pyramid.version());
+    ASSERT_EQ(1000.0f, pyramid.max(pyramid.levels(), 0, 0));
+    ASSERT_EQ(1000.0f, pyramid.max(3, 1, 1));
+
+    Buffer other(32, 64);
+    ASSERT_THROW(pyramid.rebuild(other), std::invalid_argument);
+}
+
+
+TEST(terrain_pyramid, refit_matches_rebuild)
+{
+    // Odd sizes, so the last row and column of each level cover a partial block
+    for (const auto & size : { std::make_pair(37u, 20u), std::make_pair(257u, 300u) }) {
+        Buffer b(size.first, size.second);
+        _fill(b);
+
+        // Copies of a Buffer share its dirty rectangles, so this forgets the initial build
+        Terrain_Pyramid pyramid(b);
+        Buffer(pyramid.packed()).clear_dirty();
+
+        std::mt19937 gen(size.first);
+        for (int edit = 0; edit < 20; edit++) {
+            std::uniform_int_distribution<uint32_t> row(0, size.first - 1);
+            std::uniform_int_distribution<uint32_t> col(0, size.second - 1);
+            const uint32_t r = row(gen);
+            const uint32_t c = col(gen);
+            const Buffer::Region region { r,
+                                          c,
+                                          std::min<uint32_t>(1 + edit % 7, size.first - r),
+                                          std::min<uint32_t>(1 + edit % 5, size.second - c) };
+
+            // Raise and lower, so both bounds grow and shrink
+            for (uint32_t i = region.row; i < region.row + region.rows; i++) {
+                for (uint32_t j = region.col; j < region.col + region.cols; j++) {
+                    b.at(i, j) += edit % 2 == 0 ? 500.0f : -700.0f;
+                }
+            }
+
+            const uint64_t version = pyramid.version();
+            pyramid.refit(b, region);
+            ASSERT_GT(pyramid.version(), version);
+
+            const Terrain_Pyramid expected(b);
+            const uint32_t cells = expected.packed().size().first;
+            for (uint32_t i = 0; i < cells; i++) {
+                ASSERT_EQ(expected.packed().at(i, 0, 0), pyramid.packed().at(i, 0, 0)) << i;
+                ASSERT_EQ(expected.packed().at(i, 0, 1), pyramid.packed().at(i, 0, 1)) << i;
+            }
+        }
+
+        // Only the cells above an edit are marked for upload
+        Buffer(pyramid.packed()).clear_dirty();
+        b.at(size.first / 2, size.second / 2) = 5000.0f;
+        pyramid.refit(b, Buffer::Region { size.first / 2, size.second / 2, 1, 1 });
+
+        size_t marked = 0;
+        for (const auto & region : pyramid.packed().dirty_regions()) {
+            marked += region.rows;
+        }
+        ASSERT_EQ(pyramid.levels(), pyramid.packed().dirty_regions().size());
+        ASSERT_EQ(pyramid.levels(), marked);
+        ASSERT_EQ(5000.0f, pyramid.max(pyramid.levels(), 0, 0));
+    }
+
+    Buffer b(16, 16);
+    Terrain_Pyramid pyramid(b);
+    ASSERT_THROW(pyramid.refit(b, Buffer::Region { 10, 10, 7, 1 }), std::out_of_range);
+}
+
+
+TEST(terrain_pyramid, shared_by_terrain_copies)
+{
+    auto b = std::make_shared<Buffer>(64, 64);
+    _fill(*b);
+
+    Terrain t(b, 30.0f);
+    ASSERT_EQ(nullptr, t.pyramid());
+
+    t.build_pyramid();
+    Terrain copy(t);
+
+    ASSERT_NE(nullptr, copy.pyramid());
+    ASSERT_EQ(t.pyramid(), copy.pyramid());
+    ASSERT_EQ(6u, copy.pyramid()->levels());
+}
+
+}
@@ -0,0 +1,98 @@
+//! @file       test_thread_pool.cc
+//! @brief      Unit tests for the Thread_Pool type
+//!
+//! @author     Jeffrey Wallace
+//! @copyright  MIT
+
+// CLarity Imports
+#include "thread_pool.h"
+
+// Standard Imports
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// Third-Party Imports
+#include "gtest/gtest.h"
+
+namespace
+{
+
+using namespace clarity;
+
+
+TEST(thread_pool, visits_every_index_once)
+{
+    Thread_Pool pool(4);
+    ASSERT_EQ(4u, pool.size());
+
+    std::vector<std::atomic<uint32_t>> visits(1000);
+    for (auto & v : visits) {
+        v = 0;
+    }
+
+    pool.parallel_for(10, 1000, [&](const uint32_t begin, const uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            visits[i]++;
+        }
+    }, 7);
+
+    for (uint32_t i = 0; i < visits.size(); i++) {
+        ASSERT_EQ(i < 10 ? 0u : 1u, visits[i].load());
+    }
+}
+
+
+TEST(thread_pool, nested_and_empty_loops)
+{
+    Thread_Pool pool(3);
+    std::atomic<uint32_t> count(0);
+
+    pool.parallel_for(5, 5, [&](const uint32_t, const uint32_t) { count++; });
+    ASSERT_EQ(0u, count.load());
+
+    pool.parallel_for(0, 8, [&](const uint32_t begin, const uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            pool.parallel_for(0, 10, [&](const uint32_t b, const uint32_t e) { count += e - b; });
+        }
+    });
+    ASSERT_EQ(80u, count.load());
+}
+
+
+TEST(thread_pool, rethrows_on_caller)
+{
+    Thread_Pool pool(4);
+
+    ASSERT_THROW(pool.parallel_for(0, 100, [](const uint32_t begin, const uint32_t) {
+        if (begin == 0) {
+            throw std::runtime_error("failed");
+        }
+    }), std::runtime_error);
+
+    // The pool is still usable afterwards
+    std::atomic<uint32_t> count(0);
+    pool.parallel_for(0, 100, [&](const uint32_t begin, const uint32_t end) {
+        count += end - begin;
+    });
+    ASSERT_EQ(100u, count.load());
+}
+
+
+TEST(thread_pool, pinned_workers)
+{
+    // Pinning to a CPU the process may not own fails quietly; the pool still runs the loop
+    Thread_Pool pool(std::vector<unsigned> { 0, 0, 0 });
+    ASSERT_EQ(3u, pool.size());
+
+    std::atomic<uint32_t> count(0);
+    pool.parallel_for(0, 300, [&](const uint32_t begin, const uint32_t end) {
+        count += end - begin;
+    });
+    ASSERT_EQ(300u, count.load());
+
+    ASSERT_THROW(Thread_Pool(std::vector<unsigned>()), std::invalid_argument);
+}
+
+}